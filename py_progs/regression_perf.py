@@ -0,0 +1,480 @@
+#!/usr/bin/env python
+
+'''
+                    Space Telescope Science Institute
+
+Synopsis:
+
+Run the regression models at a fixed number of photons on several
+numbers of processors, and check that python has not become slower
+or larger than it was when a baseline was recorded
+
+
+Command line usage (if any):
+
+    usage: regression_perf.py [-h] [-np 1,2,4,8] [-nphot 100000] [-ion_cycles 2]
+                [-spec_cycles 1] [-pf_dir regress] [-out_dir foo] [-models cv,star]
+                [-baseline perf_baseline.json] [-save] [-tol 0.2] [-tol_rss 0.1]
+                [-mpirun mpirun] version
+
+    where
+
+        version         the executable of python
+        -np 1,2,4,8     the numbers of processors on which to run each model (default 1,2,4,8)
+        -nphot 100000   the number of photons per cycle, which replaces the number in
+                        the .pf files so that every model does a fixed amount of work
+        -ion_cycles 2   the number of ionization cycles
+        -spec_cycles 1  the number of spectral cycles
+        -pf_dir test    the directory containing the .pf files, as for regression.py.  The
+                        default is $PYTHON/examples/regress.  The .pf files in the
+                        subdirectories matom_balmer and hydro are also run
+        -out_dir foo    The directory where the models are run.  The default
+                        is constructed from the version and the date
+        -models cv,star run only these models
+        -baseline file  the baseline to compare with (default $PYTHON/examples/regress/perf_baseline.json)
+        -save           write the results of this run as the new baseline, rather than
+                        comparing with it
+        -tol 0.2        the fractional increase in a time, or decrease in the rate at which
+                        photons are processed, that counts as a regression
+        -tol_rss 0.1    the fractional increase in the peak memory that counts as a regression
+        -mpirun mpirun  the command, with any options, used to start parallel runs
+
+Description:
+
+    Each model is run once for each number of processors, in a subdirectory
+    np1, np2 ... of the output directory.  Python always starts from the same
+    random number seed, so that a given model on a given number of processors
+    does exactly the same work every time.
+
+    For each run the routine records, from the .sig file, the time taken to set up the
+    model, the time spent in the ionization cycles and the time spent in the
+    spectral cycles, the peak resident memory of the largest process, and the
+    number of photons processed per second.   These are written as a strong scaling
+    table, with the speedup and parallel efficiency relative to the run on the fewest
+    processors, to Perf_summary.txt in the output directory, and as json to perf_results.json.
+
+    The results are then compared with the baseline.  Times that are more than tol
+    (and more than 1 s) longer, a photon rate that is more than tol slower, or a peak
+    memory that is more than tol_rss larger than the baseline are marked as a REGRESSION,
+    as are runs that did not complete.  If there are any, they are listed at the
+    end and the routine exits with status 1.
+
+Primary routines:
+
+    doit:       Internal routine which runs python on all of the models and processor counts. Use
+                this if working in a python shell
+    steer:      A routine to parse the command line
+    compare:    A routine which compares the results with the baseline
+
+Notes:
+
+    The baseline depends on the machine, so it should be recorded (with -save) on the
+    machine where the tests are going to be run.
+
+    The peak memory is obtained from the operating system for the process started
+    by the routine, and for parallel runs relies on mpirun waiting for the processes
+    it starts.
+
+History:
+
+2610 Coding begun
+
+'''
+
+import sys
+import os
+import shutil
+import subprocess
+import time
+import json
+from glob import glob
+
+
+def get_models(pf_dir,models=[]):
+    '''
+    Find the .pf files to be run, returning a list of the pf files
+    and, for each, the directory whose files need to be copied with it.
+
+    The special models in the matom_balmer and hydro subdirectories
+    are run as ordinary models.  The restart of the hydro model is skipped,
+    because it depends on the output of another run.
+    '''
+
+    pf_files=sorted(glob(pf_dir+'/*.pf'))+sorted(glob(pf_dir+'/*/*.pf'))
+
+    records=[]
+    for one in pf_files:
+        if one.count('.out.pf') or one.count('restart'):
+            continue
+        root=os.path.basename(one).replace('.pf','')
+        if len(models) and models.count(root)==0:
+            continue
+        records.append([one,os.path.dirname(one)])
+
+    return records
+
+
+def make_pf(pf_file,out_file,nphot,ion_cycles,spec_cycles):
+    '''
+    Copy a .pf file, replacing the number of photons and of cycles
+    '''
+
+    changes={'Photons_per_cycle':nphot,'Ionization_cycles':ion_cycles,'Spectrum_cycles':spec_cycles}
+
+    x=open(pf_file)
+    lines=x.readlines()
+    x.close()
+
+    g=open(out_file,'w')
+    for line in lines:
+        words=line.split()
+        if len(words) and words[0] in changes:
+            line='%-40s %d\n' % (words[0],changes[words[0]])
+        g.write(line)
+    g.close()
+    return
+
+
+def read_sig(root):
+    '''
+    Get the times at which the phases of a run began and ended from
+    the .sig file, returning a dictionary with the times taken for setup
+    and for the ionization and spectral cycles, and whether the run
+    completed
+    '''
+
+    result={'complete':False,'t_setup':0.0,'t_ion':0.0,'t_spec':0.0,'t_total':0.0}
+
+    try:
+        x=open(root+'.sig')
+        lines=x.readlines()
+        x.close()
+    except IOError:
+        return result
+
+    ion_start=ion_end=spec_start=spec_end=-1.
+    for line in lines:
+        words=line.split()
+        if len(words)<7:
+            continue
+        try:
+            t=float(words[5])
+        except ValueError:
+            continue
+        if line.count('Starting') and line.count('ionization cycles') and ion_start<0:
+            ion_start=t
+        elif line.count('Finished') and line.count('ionization cycles'):
+            ion_end=t
+        elif line.count('Starting') and line.count('spectrum cycles') and spec_start<0:
+            spec_start=t
+        elif line.count('Finished') and line.count('spectrum cycles'):
+            spec_end=t
+        elif words[6]=='COMPLETE':
+            result['complete']=True
+            result['t_total']=t
+
+    starts=[one for one in [ion_start,spec_start] if one>=0]
+    if len(starts):
+        result['t_setup']=min(starts)
+    if ion_end>=0:
+        result['t_ion']=ion_end-ion_start
+    if spec_end>=0:
+        result['t_spec']=spec_end-spec_start
+
+    return result
+
+
+def run_one(command,root):
+    '''
+    Run one model, returning the peak resident memory in MB of the largest process,
+    which is obtained from the resource usage of the finished process and its children
+    '''
+
+    out=open(root+'.stdout.txt','w')
+    err=open(root+'.stderr.txt','w')
+    proc=subprocess.Popen(command.split(),stdout=out,stderr=err)
+    pid,status,usage=os.wait4(proc.pid,0)
+    proc.returncode=os.waitstatus_to_exitcode(status)
+    out.close()
+    err.close()
+
+    # ru_maxrss is in kB on linux but in bytes on macOS
+    rss=usage.ru_maxrss/1024.
+    if sys.platform=='darwin':
+        rss/=1024.
+
+    return rss
+
+
+def doit(version='py',pf_dir='',out_dir='',nprocs=[1,2,4,8],nphot=100000,ion_cycles=2,spec_cycles=1,
+         models=[],mpirun='mpirun'):
+    '''
+    Run all of the models on each number of processors, and return a list of the results
+
+    Each result is a dictionary containing the model, the number of processors, the
+    times taken for the phases of the run, the peak memory, and the number of
+    photons processed per second
+    '''
+
+    date=time.strftime("%y%m%d", time.gmtime())
+
+    if out_dir=='':
+        out_dir='perf_%s_%s' % (os.path.basename(version),date)
+
+    PYTHON=os.environ['PYTHON']
+
+    if pf_dir=='':
+        pf_dir=PYTHON+'/examples/regress'
+    elif os.path.isdir(pf_dir)==False and os.path.isdir('%s/examples/%s' % (PYTHON,pf_dir)):
+        pf_dir='%s/examples/%s' % (PYTHON,pf_dir)
+
+    if os.path.isdir(pf_dir)==False:
+        print('Error: The pf directory %s does not appear to exist' % pf_dir)
+        return out_dir,[]
+
+    records=get_models(pf_dir,models)
+    if len(records)==0:
+        print('No input files found in %s' % pf_dir)
+        return out_dir,[]
+
+    cwd=os.getcwd()
+
+    results=[]
+    for np in nprocs:
+        work_dir='%s/np%d' % (out_dir,np)
+        if os.path.exists(work_dir)==False:
+            os.makedirs(work_dir)
+
+        for pf_file,model_dir in records:
+            # Models in subdirectories may need the other files there
+            if model_dir!=pf_dir:
+                for one in glob(model_dir+'/*'):
+                    if one.count('.pf')==0:
+                        shutil.copy(one,work_dir)
+            root=os.path.basename(pf_file).replace('.pf','')
+            make_pf(pf_file,'%s/%s.pf' % (work_dir,root),nphot,ion_cycles,spec_cycles)
+
+        os.chdir(work_dir)
+        proc=subprocess.Popen('Setup_Py_Dir',shell=True,stdout=subprocess.PIPE,stderr=subprocess.PIPE)
+        proc.communicate()
+
+        for pf_file,model_dir in records:
+            root=os.path.basename(pf_file).replace('.pf','')
+            if np<=1:
+                command='%s %s.pf' % (version,root)
+            else:
+                command='%s -np %d %s %s.pf' % (mpirun,np,version,root)
+
+            print('Running %s' % command)
+            rss=run_one(command,root)
+
+            one=read_sig(root)
+            one['model']=root
+            one['np']=np
+            one['rss']=rss
+            one['phot_s']=0.0
+            if one['t_ion']+one['t_spec']>0:
+                one['phot_s']=nphot*(ion_cycles+spec_cycles)/(one['t_ion']+one['t_spec'])
+            print('   setup %.1f s  ionization %.1f s  spectra %.1f s  peak memory %.0f MB  %.0f photons/s' %
+                    (one['t_setup'],one['t_ion'],one['t_spec'],one['rss'],one['phot_s']))
+            results.append(one)
+
+        os.chdir(cwd)
+
+    return out_dir,results
+
+
+def compare(results,baseline,tol=0.2,tol_rss=0.1):
+    '''
+    Compare the results with a baseline, returning a list of the regressions.  Each
+    result is given a status, which is OK, NEW if there is no baseline for it, or
+    REGRESSION
+    '''
+
+    regressions=[]
+    for one in results:
+        key='%s/%d' % (one['model'],one['np'])
+        one['status']='OK'
+
+        if one['complete']==False:
+            one['status']='REGRESSION'
+            regressions.append('%s did not complete' % key)
+            continue
+
+        if key not in baseline:
+            one['status']='NEW'
+            continue
+
+        base=baseline[key]
+        for name in ['t_setup','t_ion','t_spec','t_total']:
+            if one[name]>base[name]*(1.+tol) and one[name]-base[name]>1.0:
+                one['status']='REGRESSION'
+                regressions.append('%s %s %.1f s is slower than the baseline %.1f s' % (key,name,one[name],base[name]))
+        if base['rss']>0 and one['rss']>base['rss']*(1.+tol_rss):
+            one['status']='REGRESSION'
+            regressions.append('%s peak memory %.0f MB is larger than the baseline %.0f MB' % (key,one['rss'],base['rss']))
+        if one['phot_s']*(1.+tol)<base['phot_s']:
+            one['status']='REGRESSION'
+            regressions.append('%s %.0f photons/s is slower than the baseline %.0f photons/s' % (key,one['phot_s'],base['phot_s']))
+
+    return regressions
+
+
+def write_table(results,outputfile):
+    '''
+    Write the strong scaling table, in which the speedup and efficiency
+    of each model are relative to its run on the fewest processors
+    '''
+
+    f=open(outputfile,'w')
+    string='%-20s %4s %8s %8s %8s %8s %8s %10s %7s %5s %s' % ('model','np','t_setup','t_ion','t_spec','t_total',
+                    'rss_MB','phot/s','speedup','eff','status')
+    print(string)
+    f.write('%s\n' % string)
+
+    models=[]
+    for one in results:
+        if models.count(one['model'])==0:
+            models.append(one['model'])
+
+    for model in models:
+        rows=sorted([one for one in results if one['model']==model],key=lambda one:one['np'])
+        first=rows[0]
+        for one in rows:
+            speedup=eff=0.0
+            if one['t_total']>0 and first['t_total']>0:
+                speedup=first['t_total']/one['t_total']
+                eff=speedup*first['np']/one['np']
+            string='%-20s %4d %8.1f %8.1f %8.1f %8.1f %8.0f %10.0f %7.2f %5.2f %s' % (model,one['np'],one['t_setup'],
+                    one['t_ion'],one['t_spec'],one['t_total'],one['rss'],one['phot_s'],speedup,eff,one['status'])
+            print(string)
+            f.write('%s\n' % string)
+
+    f.close()
+    return
+
+
+def steer(argv):
+    '''
+    This is just a steering routine so that switches can be processed
+    from the command line
+    '''
+    pf_dir=''
+    out_dir=''
+    nprocs=[1,2,4,8]
+    nphot=100000
+    ion_cycles=2
+    spec_cycles=1
+    models=[]
+    baseline_file=''
+    save=False
+    tol=0.2
+    tol_rss=0.1
+    mpirun='mpirun'
+
+    i=1
+    words=[]
+    while i<len(argv):
+        if argv[i]=='-h':
+            print(__doc__)
+            return 0
+        elif argv[i]=='-np':
+            i=i+1
+            nprocs=[int(one) for one in argv[i].split(',')]
+        elif argv[i]=='-nphot':
+            i=i+1
+            nphot=int(float(argv[i]))
+        elif argv[i]=='-ion_cycles':
+            i=i+1
+            ion_cycles=int(argv[i])
+        elif argv[i]=='-spec_cycles':
+            i=i+1
+            spec_cycles=int(argv[i])
+        elif argv[i]=='-pf_dir':
+            i=i+1
+            pf_dir=(argv[i])
+        elif argv[i]=='-out_dir':
+            i=i+1
+            out_dir=(argv[i])
+        elif argv[i]=='-models':
+            i=i+1
+            models=argv[i].split(',')
+        elif argv[i]=='-baseline':
+            i=i+1
+            baseline_file=argv[i]
+        elif argv[i]=='-save':
+            save=True
+        elif argv[i]=='-tol':
+            i=i+1
+            tol=float(argv[i])
+        elif argv[i]=='-tol_rss':
+            i=i+1
+            tol_rss=float(argv[i])
+        elif argv[i]=='-mpirun':
+            i=i+1
+            mpirun=argv[i]
+        elif argv[i][0]=='-':
+            print('Error: Unknown switch ---  %s' % argv[i])
+            return 1
+        else:
+            words.append(argv[i])
+        i+=1
+
+    if(len(words)==0):
+        print('Error: Consumed of command line without a python executable')
+        return 1
+
+    if baseline_file=='':
+        baseline_file=os.environ['PYTHON']+'/examples/regress/perf_baseline.json'
+
+    out_dir,results=doit(version=words[0],pf_dir=pf_dir,out_dir=out_dir,nprocs=nprocs,nphot=nphot,
+                ion_cycles=ion_cycles,spec_cycles=spec_cycles,models=models,mpirun=mpirun)
+
+    if len(results)==0:
+        return 1
+
+    baseline={}
+    if save==False:
+        if os.path.exists(baseline_file):
+            x=open(baseline_file)
+            baseline=json.load(x)
+            x.close()
+        else:
+            print('Warning: There is no baseline %s to compare with' % baseline_file)
+
+    regressions=compare(results,baseline,tol,tol_rss)
+
+    write_table(results,out_dir+'/Perf_summary.txt')
+
+    x=open(out_dir+'/perf_results.json','w')
+    json.dump(results,x,indent=1)
+    x.close()
+
+    if save:
+        for one in results:
+            if one['complete']:
+                baseline['%s/%d' % (one['model'],one['np'])]=one
+        x=open(baseline_file,'w')
+        json.dump(baseline,x,indent=1,sort_keys=True)
+        x.close()
+        print('Saved the baseline in %s' % baseline_file)
+
+    if len(regressions):
+        print('\n!!! %d PERFORMANCE REGRESSIONS !!!' % len(regressions))
+        for one in regressions:
+            print('   %s' % one)
+        return 1
+
+    print('\nNo performance regressions were found')
+    return 0
+
+
+
+
+# Next lines permit one to run the routine from the command line
+if __name__ == "__main__":
+    import sys
+    if len(sys.argv)>1:
+        sys.exit(steer(sys.argv))
+    else:
+        print(__doc__)
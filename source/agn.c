@@ -410,6 +410,8 @@ photo_gen_agn (p, r, alpha, weight, f1, f2, spectype, istart, nphot)
     p[i].nres = -1;             // It's a continuum photon - so it is not made in a resonance
     p[i].nnscat = 1;            // Set to one scatter
 
+    qmc_start (QMC_AGN);
+
     if (spectype == SPECTYPE_BB)        //Blackbody spectrum, we use the supplied temperature
     {
       p[i].freq = planck (t, freqmin, freqmax);
@@ -448,6 +450,7 @@ photo_gen_agn (p, r, alpha, weight, f1, f2, spectype, istart, nphot)
 
     if (geo.pl_geometry == PL_GEOMETRY_SPHERE)
     {
+      qmc_skip (QMC_STAR_POS);
       randvec (p[i].x, r);      //Simple random coordinate on the surface of a shpere
 
       /* Added by SS August 2004 for finite disk. */
@@ -465,6 +468,7 @@ photo_gen_agn (p, r, alpha, weight, f1, f2, spectype, istart, nphot)
           Exit (0);
         }
       }
+      qmc_skip (QMC_STAR_DIR);
       randvcos (p[i].lmn, p[i].x);      //Random direction centred on the previously randmised vector
     }
 
@@ -478,6 +482,7 @@ photo_gen_agn (p, r, alpha, weight, f1, f2, spectype, istart, nphot)
       p[i].x[0] = p[i].x[1] = 0.0;
 
       /* need to set the z coordinate to the lamp post height, but allow it to be above or below */
+      qmc_skip (QMC_STAR_POS);
       if (random_number (-1.0, 1.0) > 0.0)
 
       {                         /* Then the photon emerges in the upper hemisphere */
@@ -488,8 +493,10 @@ photo_gen_agn (p, r, alpha, weight, f1, f2, spectype, istart, nphot)
         p[i].x[2] = -geo.lamp_post_height;
       }
 
+      qmc_skip (QMC_STAR_DIR);
       randvec (p[i].lmn, 1.0);  // lamp-post geometry is isotropic, so completely random vector
     }
+    qmc_stop ();
   }
 
   return (0);
@@ -19,8 +19,9 @@
  * generate Monte Carlo spectra from precalculated Kurucz models).
  *
  * Once the cdfs are generated one can sample the full distribution distritution function
- * with cdf_get_rand, or one can sample a part of the distribution by setting the
- * part that one wants with cdf_limit and then sampling the distribution with cdf_get_rand_limit
+ * with cdf_get_rand, or cdf_get_rand_n if many values are needed, or one can sample a part of the
+ * distribution by setting the part that one wants with cdf_limit and then sampling the distribution
+ * with cdf_get_rand_limit
  *
  * There are a number of helper functions that are internal to the generation of the cdfs,
  * and verification that the cdfs are readonable.
@@ -33,6 +34,12 @@
  * points, e.g on either side of a discontinuity.  When generating a CDF from a function, the
  * discontinuities should be well sampled in the array that is provided.
  *
+ * The arrays of each cdf are allocated by cdf_alloc to the number of points in it, and are only
+ * reallocated if a later cdf generated in the same structure is larger.  A guide table, which gives
+ * the interval containing each of ncdf equally spaced values of y, means that cdf_get_rand need
+ * only step through one or two intervals, rather than search the whole cdf, to find the one which
+ * contains a random number.
+ *
  * @bug For reasons, which are currently unclear there are differences in the number of points
  * maintained in the cdfs for different generation methods.
  *
@@ -41,7 +48,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <gsl/gsl_sort.h>
-#include <gsl/gsl_interp.h>
+#include <math.h>
 #include <gsl/gsl_rng.h>
 #include <gsl/gsl_randist.h>
 
@@ -61,6 +68,9 @@ int init_pdf = 0;
 /// Pointer to pdf_array - made external because it is used in varous routines
 double *pdf_array;
 
+/// The total memory allocated to the arrays of all of the cdfs
+double cdf_bytes = 0;
+
 
 /**********************************************************/
 /**
@@ -148,6 +158,8 @@ cdf_gen_from_func (cdf, func, xmin, xmax, njumps, jump)
 
   /* OK, all the input data seems OK */
 
+  cdf_alloc (cdf, FUNC_CDF);
+
   /* Construct what is effectively is the definite integral from xmin to x. Note
      however that currently cdf_array[0] corresponds awkwardly to the integral
      from xmin to xstep.
@@ -233,6 +245,9 @@ cdf_gen_from_func (cdf, func, xmin, xmax, njumps, jump)
   {
     Error ("cdf_gen_from_function: error %d on cdf_check\n", icheck);
   }
+
+  calc_cdf_guide (cdf);
+
   return (icheck);
 
 }
@@ -413,13 +428,6 @@ cdf_gen_from_array (cdf, x, y, n_xy, xmin, xmax)
 /* Perform various checks on the inputs */
 
 
-  if (n_xy > NCDF)              //If the supplied data array is larger than the output array - fixed as NCDF
-  {
-    Error ("cdf_gen_from_array: supplied data %i is larger than default aray size %i - increase NCDF\n", n_xy, NCDF);
-    Exit (1);
-  }
-
-
   if (xmax < xmin)              //This must be a mistake, the limits are reversed
   {
     Error ("cdf_gen_from_array: xmin %g <= xmax %g\n", xmin, xmax);
@@ -569,6 +577,7 @@ cdf_gen_from_array (cdf, x, y, n_xy, xmin, xmax)
 
   if (xmax < x[0] || xmin > x[n_xy - 1] || allzero == 0)
   {                             // These are special (probably nonsensical) cases
+    cdf_alloc (cdf, 1);
     cdf->x[0] = xmin;
     cdf->y[0] = 0.;
     cdf->x[1] = xmax;
@@ -590,6 +599,7 @@ cdf_gen_from_array (cdf, x, y, n_xy, xmin, xmax)
     // the integral up to that poont, so it starts at 0 and ends at the total
 
     cdf_n = (nmax - nmin);      //The number of points in the integration
+    cdf_alloc (cdf, cdf_n);
     cdf->x[0] = x[nmin];        //The initial x - point in the cdf
     cdf->y[0] = 0.0;            //The initial y value of the cdf - must be zero at the start
     for (n = 1; n < cdf_n + 1; n++)     //Loop over all the CDF
@@ -625,6 +635,8 @@ cdf_gen_from_array (cdf, x, y, n_xy, xmin, xmax)
   }
 //  cdf_to_file(cdf,"foo.diag"); //output the CDF to a file
 
+  calc_cdf_guide (cdf);
+
   if (zcheck)
   {
     return (zcheck);            // Trap the case where values were initially all zeros
@@ -642,54 +654,145 @@ cdf_gen_from_array (cdf, x, y, n_xy, xmin, xmax)
  * @return   x  a random value fronm the cdf between xmin and xmax
  *
  * @details
+ * The guide table gives an interval close to the one that contains a random number r, and
+ * the interval is found by stepping up from there.  The position within the interval is then
+ * found from a second random number, using the gradient of the CDF at either end of the interval.
  *
  * ### Notes ###
  *
+ * The interval found is the same as the one a binary search of the cdf would give.
+ *
  **********************************************************/
 
 double
 cdf_get_rand (cdf)
      CdfPtr cdf;
 {
-  double x, r;
-  int i, j;
-  double q;
-  double a, b, c, s[2];
-  int xquadratic ();
+  double x, r, q;
+  int i;
+
 /* Find the interval within which x lies */
   r = random_number (0.0, 1.0); //This *exludes* 0.0 and 1.0.
-  i = gsl_interp_bsearch (cdf->y, r, 0, cdf->ncdf);     //find the interval in the CDF where this number lies
+  i = cdf->guide[(int) (r * cdf->ncdf)];
+  while (cdf->y[i + 1] <= r)
+    i++;
 
 /* Now calculate a place within that interval - we use the gradient of the CDF to get a more accurate value between the CDF points */
-  q = random_number (0.0, 1.0);
-  a = 0.5 * (cdf->d[i + 1] - cdf->d[i]);
-  b = cdf->d[i];
-  c = (-0.5) * (cdf->d[i + 1] + cdf->d[i]) * q;
-  if ((j = xquadratic (a, b, c, s)) < 0)
+  q = cdf_interval_position (cdf, i, random_number (0.0, 1.0));
+
+  x = cdf->x[i] * (1. - q) + cdf->x[i + 1] * q;
+  if (!(cdf->x[0] <= x && x <= cdf->x[cdf->ncdf]))
   {
-    Error ("cdf_get_rand: %d\n", j);
+    Error ("cdf_get_rand: %g %d %g %g\n", r, i, q, x);
   }
-  else
+  return (x);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Generate a number of samples from a cdf
+ *
+ * @param [in] CdfPtr  cdf   a structure which contains the cumulative distribution function.
+ * @param [out] double *  x   an array which is filled with the random values
+ * @param [in] int  n   the number of values required
+ * @return   the number of values generated
+ *
+ * @details
+ * This is equivalent to calling cdf_get_rand n times, and returns the
+ * same values for the same sequence of random numbers, but is intended
+ * for generating the sets of photon frequencies which are stored for
+ * later use.
+ *
+ * ### Notes ###
+ *
+ **********************************************************/
+
+int
+cdf_get_rand_n (cdf, x, n)
+     CdfPtr cdf;
+     double x[];
+     int n;
+{
+  double r, q, xmin, xmax;
+  int i, m;
+
+  xmin = cdf->x[0];
+  xmax = cdf->x[cdf->ncdf];
+
+  for (m = 0; m < n; m++)
   {
-    q = s[j];
-    if (q < 0 || q > 1)
+    r = random_number (0.0, 1.0);
+    i = cdf->guide[(int) (r * cdf->ncdf)];
+    while (cdf->y[i + 1] <= r)
+      i++;
+
+    q = cdf_interval_position (cdf, i, random_number (0.0, 1.0));
+
+    x[m] = cdf->x[i] * (1. - q) + cdf->x[i + 1] * q;
+    if (!(xmin <= x[m] && x[m] <= xmax))
     {
-      Error ("cdf_get_rand: q out of range %d  %f\n", j, q);
+      Error ("cdf_get_rand_n: %g %d %g %g\n", r, i, q, x[m]);
     }
   }
 
-  x = cdf->x[i] * (1. - q) + cdf->x[i + 1] * q;
-  if (!(cdf->x[0] <= x && x <= cdf->x[cdf->ncdf]))
+  return (n);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Find the fractional position within an interval of a cdf
+ * which corresponds to a random number
+ *
+ * @param [in] CdfPtr  cdf   a structure which contains the cumulative distribution function.
+ * @param [in] int  i   the interval
+ * @param [in] double  u   a random number between 0 and 1
+ * @return   the fractional position, between 0 and 1, in the interval
+ *
+ * @details
+ * Within the interval the probability density is taken to vary linearly
+ * from d[i] to d[i+1], so that the fraction of the probability in the interval
+ * which lies below q is
+ *
+ * (d[i] q + 0.5 (d[i+1]-d[i]) q**2) / (0.5 (d[i] + d[i+1]))
+ *
+ * Setting this equal to u and solving the quadratic for q gives
+ *
+ * q = (d[i] + d[i+1]) u / (d[i] + sqrt (d[i]**2 + (d[i+1]**2 - d[i]**2) u))
+ *
+ * which, unlike the usual formula, can be used when the gradients at
+ * the ends of the interval are the same.  ds and dd are calculated for each interval
+ * by calc_cdf_guide.
+ *
+ * ### Notes ###
+ *
+ * If the gradient is zero throughout the interval, the position is
+ * taken to be uniformly distributed.
+ *
+ **********************************************************/
+
+double
+cdf_interval_position (cdf, i, u)
+     CdfPtr cdf;
+     int i;
+     double u;
+{
+  double denom;
+
+  denom = cdf->d[i] + sqrt (cdf->d[i] * cdf->d[i] + cdf->dd[i] * u);
+  if (denom > 0.0)
   {
-    Error ("cdf_get_rand: %g %d %g %g\n", r, i, q, x);
+    return (cdf->ds[i] * u / denom);
   }
-  return (x);
+  return (u);
 }
 
 
 
 
-
 /**********************************************************/
 /**
  * @brief      sets limit1 and limit2 so that one can generate distributions
@@ -817,36 +920,19 @@ cdf_get_rand_limit (cdf)
      CdfPtr cdf;
 {
   double x, r;
-  int i, j;
+  int i;
   double q;
-  double a, b, c, s[2];
-  int xquadratic ();
   r = random_number (0.0, 1.0); //
 
   r = r * cdf->limit2 + (1. - r) * cdf->limit1;
-  i = r * cdf->ncdf;
+  i = cdf->guide[(int) (r * cdf->ncdf)];
   while (cdf->y[i + 1] < r && i < cdf->ncdf - 1)
     i++;
   while (cdf->y[i] > r && i > 0)
     i--;
   while (TRUE)
   {
-    q = random_number (0.0, 1.0);
-    a = 0.5 * (cdf->d[i + 1] - cdf->d[i]);
-    b = cdf->d[i];
-    c = (-0.5) * (cdf->d[i + 1] + cdf->d[i]) * q;
-    if ((j = xquadratic (a, b, c, s)) < 0)
-    {
-      Error ("pdf_get_rand: %d\n", j);
-    }
-    else
-    {
-      q = s[j];
-      if (q < 0 || q > 1)
-      {
-        Error ("cdf_get_rand_limit: q out of range %d  %f\n", j, q);
-      }
-    }
+    q = cdf_interval_position (cdf, i, random_number (0.0, 1.0));
 
     x = cdf->x[i] * (1. - q) + cdf->x[i + 1] * q;
     if (cdf->x1 < x && x < cdf->x2)
@@ -1067,6 +1153,116 @@ calc_cdf_gradient (cdf)
 
 
 
+/**********************************************************/
+/**
+ * @brief      Calculate the guide table, and the coefficients used to find the position
+ * within each interval, for a cdf
+ *
+ * @param [in, out] CdfPtr  cdf   A ptr to a cdf structure
+ * @return     Always returns 0
+ *
+ * @details
+ * guide[k] is set to the interval i for which y[i] <= k/ncdf < y[i+1], so
+ * that the interval which contains a random number r can be found by starting
+ * at guide[(int) (r*ncdf)] and stepping up.  Since there are as many entries
+ * in the guide table as intervals, only one or two steps are needed on average.
+ *
+ * ### Notes ###
+ *
+ * This must be called once the cdf and its gradients are complete, since
+ * cdf_check may alter the cdf.
+ *
+ **********************************************************/
+
+int
+calc_cdf_guide (cdf)
+     CdfPtr cdf;
+{
+  int i, k;
+  double y;
+
+  i = 0;
+  for (k = 0; k < cdf->ncdf; k++)
+  {
+    y = (double) k / cdf->ncdf;
+    while (i < cdf->ncdf - 1 && cdf->y[i + 1] <= y)
+      i++;
+    cdf->guide[k] = i;
+  }
+
+  for (i = 0; i < cdf->ncdf; i++)
+  {
+    cdf->ds[i] = cdf->d[i] + cdf->d[i + 1];
+    cdf->dd[i] = cdf->d[i + 1] * cdf->d[i + 1] - cdf->d[i] * cdf->d[i];
+  }
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Make sure the arrays of a cdf are large enough for a cdf with n intervals
+ *
+ * @param [in, out] CdfPtr  cdf   A ptr to a cdf structure
+ * @param [in] int  n   The number of intervals, so the cdf has n+1 points
+ * @return     Always returns 0
+ *
+ * @details
+ * The arrays are allocated as a single block, which is only replaced if
+ * a larger cdf is needed, so that cdfs which are generated repeatedly, for
+ * example for the free-bound emission of each cell, do not cause repeated
+ * allocations.
+ *
+ * ### Notes ###
+ *
+ * The contents of the arrays are not preserved when they are reallocated.
+ *
+ **********************************************************/
+
+int
+cdf_alloc (cdf, n)
+     CdfPtr cdf;
+     int n;
+{
+  double *block;
+  int npts;
+
+  npts = n + 1;
+  if (cdf->nalloc >= npts)
+  {
+    return (0);
+  }
+
+  if (cdf->x != NULL)
+  {
+    free (cdf->x);
+    cdf_bytes -= cdf->nalloc * (5. * sizeof (double) + sizeof (int));
+  }
+
+  if ((block = calloc (npts, 5 * sizeof (double) + sizeof (int))) == NULL)
+  {
+    Error ("cdf_alloc: Could not allocate memory for a cdf with %d points\n", npts);
+    Exit (1);
+  }
+
+  cdf->x = block;
+  cdf->y = block + npts;
+  cdf->d = block + 2 * npts;
+  cdf->ds = block + 3 * npts;
+  cdf->dd = block + 4 * npts;
+  cdf->guide = (int *) (block + 5 * npts);
+  cdf->nalloc = npts;
+
+  cdf_bytes += npts * (5. * sizeof (double) + sizeof (int));
+  mem_register (MEM_CDF, "cdf", cdf_bytes);
+
+  return (0);
+}
+
+
+
 /**********************************************************/
 /**
  * @brief      Given two paralel arrays, x and y, this routine reorders the array
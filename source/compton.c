@@ -384,6 +384,8 @@ double
 compton_func (double f, void *params)
 {
   double ans;
+
+  PERF_COUNT (PERF_COMPTON_EVALS);
   ans = (sigma_compton_partial (f, x1) / sigma_max) - sigma_rand;
   return (ans);
 }
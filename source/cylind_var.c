@@ -411,6 +411,8 @@ cylvar_volumes (ndom, w)
     for (j = 0; j < mdim - 1; j++)
     {
       wind_ij_to_n (ndom, i, j, &n);
+      if (!setup_cell_mine (n))
+        continue;               /* Another thread sets up this cell */
 
       /* Encapsulate the grid cell with a rectangle for integrating */
       rmin = w[n].x[0];
@@ -360,6 +360,8 @@ cylind_volumes (ndom, w)
     {
 
       wind_ij_to_n (ndom, i, j, &n);
+      if (!setup_cell_mine (n))
+        continue;               /* Another thread sets up this cell */
 
       rmin = one_dom->wind_x[i];
       rmax = one_dom->wind_x[i + 1];
@@ -301,11 +301,50 @@ vdisk (x, v)
  * 	often needs to take this account if for example one has
  * 	a photon that hits the disk below the z=0 plane.
  *
+ * 	Inside geo.diskrad the height is taken from the piecewise
+ * 	representation of the surface constructed by disk_surface_init,
+ * 	so that it is consistent with the intersections found by
+ * 	ds_to_disk.  This differs from the power law by at most
+ * 	z1 (z1-1) / (8 NDISK_SURFACE**2) of the height at the edge of the disk
+ * 	except very close to the centre of the disk.
+ *
  **********************************************************/
 
 double
 zdisk (r)
      double r;
+{
+  int k;
+
+  if (geo.diskrad != disk_surf.diskrad || geo.disk_z0 != disk_surf.z0 || geo.disk_z1 != disk_surf.z1)
+    disk_surface_init ();
+
+  if (r >= 0.0 && r < geo.diskrad)
+  {
+    if ((k = r / disk_surf.dr) > NDISK_SURFACE - 1)
+      k = NDISK_SURFACE - 1;
+    return (disk_surf.a[k] + disk_surf.b[k] * r);
+  }
+
+  return (zdisk_power (r));
+}
+
+
+
+/**********************************************************/
+/** 
+ * @brief      Calculate the height of a vertically extended disk from the power law
+ * which defines it
+ *
+ * @param [in] double  r   a radial position in the disk.
+ * @return     The vertical height of the disk at that point in the xy
+ * 	plane.
+ *
+ **********************************************************/
+
+double
+zdisk_power (r)
+     double r;
 {
   double z;
   z = geo.disk_z0 * pow (r / geo.diskrad, geo.disk_z1) * geo.diskrad;
@@ -314,9 +353,84 @@ zdisk (r)
 
 
 
+/**********************************************************/
+/** 
+ * @brief      Calculate the slope of the surface of the disk at a certain radius
+ *
+ * @param [in] double  r   a radial position in the disk.
+ * @return     dz/dr for the surface of the disk at r
+ *
+ * The slope is that of the annulus of the piecewise representation of the
+ * surface that contains r, and is zero outside the disk.
+ *
+ **********************************************************/
+
+double
+zdisk_slope (r)
+     double r;
+{
+  int k;
+
+  if (geo.diskrad != disk_surf.diskrad || geo.disk_z0 != disk_surf.z0 || geo.disk_z1 != disk_surf.z1)
+    disk_surface_init ();
+
+  if (r >= 0.0 && r < geo.diskrad)
+  {
+    if ((k = r / disk_surf.dr) > NDISK_SURFACE - 1)
+      k = NDISK_SURFACE - 1;
+    return (disk_surf.b[k]);
+  }
+
+  return (0.0);
+}
+
+
+
+/**********************************************************/
+/** 
+ * @brief      Construct the piecewise representation of the surface of the disk
+ *
+ * @return     Always returns 0
+ *
+ * The disk is divided into NDISK_SURFACE annuli of equal width, and in each
+ * the surface is replaced by the frustum of a cone which meets the power law
+ * surface at the inner and outer edges of the annulus.
+ *
+ * ###Notes###
+ *
+ * zdisk calls this routine whenever the parameters of the disk have
+ * changed since the surface was last constructed.
+ *
+ **********************************************************/
+
+int
+disk_surface_init ()
+{
+  int k;
+  double r1, r2, z1, z2;
+
+  disk_surf.diskrad = geo.diskrad;
+  disk_surf.z0 = geo.disk_z0;
+  disk_surf.z1 = geo.disk_z1;
+  disk_surf.dr = geo.diskrad / NDISK_SURFACE;
+
+  for (k = 0; k < NDISK_SURFACE; k++)
+  {
+    r1 = k * disk_surf.dr;
+    r2 = (k + 1) * disk_surf.dr;
+    z1 = zdisk_power (r1);
+    z2 = zdisk_power (r2);
+    disk_surf.b[k] = (z2 - z1) / (r2 - r1);
+    disk_surf.a[k] = z1 - disk_surf.b[k] * r1;
+  }
+
+  return (0);
+}
+
+
+
 int ds_to_disk_init = 0;
-struct photon ds_to_disk_photon;
-struct plane diskplane, disktop, diskbottom;
+struct plane diskplane;
 
 
 /**********************************************************/
@@ -351,6 +465,15 @@ struct plane diskplane, disktop, diskbottom;
  * zdisk.  The outside edge of the disk is assumed to be 
  * a cylinder at geo.diskrad
  *
+ * For a vertically extended disk, the part of the path which lies
+ * within the cylinder that encloses the disk, bounded by the planes
+ * at the maximum height of the disk, is found first.  If the path
+ * enters this region through its curved side, it hits the edge of the disk.
+ * Otherwise the first crossing of the surface of the disk in this region
+ * is found with ds_to_disk_surface.  This works whether the photon
+ * begins inside or outside of the region, and above or below the plane
+ * of the disk.
+ *
  * The need to allow for negative distances arises
  * because several of the parameterization for the wind (SV, KWD) depend
  * on the distance between the current position and footpoint
@@ -370,23 +493,18 @@ ds_to_disk (p, allow_negative)
      struct photon *p;
      int allow_negative;
 {
-  double x1, x2;
-  double s, s_negative, s_test;
-  double s_plane, s_top, s_bottom, s_diskrad;
-  double s_disk = 0;
-  double r, r_top, r_bottom;
+  double s, s_plane, r, h;
+  double s_top, s_bottom, s_in, s_out;
+  double q, pp, rho2, disc, c1, c2;
   double smin, smax;
   struct photon phit;
 
 
 
-
   if (geo.disk_type == DISK_NONE)
     return (VERY_BIG);          /* There is no disk! */
 
-  /* Initialize 3 structures that define
-     the plane of the disk, and two other
-     planes that encompass the disk */
+  /* Initialize the structure that defines the plane of the disk */
 
   if (ds_to_disk_init == 0)
   {
@@ -394,276 +512,331 @@ ds_to_disk (p, allow_negative)
     diskplane.lmn[0] = diskplane.lmn[1] = 0.0;
     diskplane.lmn[2] = 1.0;
 
-
-    disktop.x[0] = disktop.x[1] = 0.0;
-    disktop.x[2] = geo.diskrad * geo.disk_z0;
-    disktop.lmn[0] = disktop.lmn[1] = 0.0;
-    disktop.lmn[2] = 1.0;
-
-    diskbottom.x[0] = diskbottom.x[1] = 0.0;
-    diskbottom.x[2] = (-geo.diskrad * geo.disk_z0);
-    diskbottom.lmn[0] = diskbottom.lmn[1] = 0.0;
-    diskbottom.lmn[2] = 1.0;
-
     ds_to_disk_init++;          // Only initialize once
 
   }
 
-  s_test = s_plane = ds_to_plane (&diskplane, p);
-  stuff_phot (p, &phit);
-  move_phot (&phit, s_test);
-  r = sqrt (phit.x[0] * phit.x[0] + phit.x[1] * phit.x[1]);
-
-
-  s = VERY_BIG;
-
   if (geo.disk_type == DISK_FLAT)
   {
+    s_plane = ds_to_plane (&diskplane, p);
+    stuff_phot (p, &phit);
+    move_phot (&phit, s_plane);
+    r = sqrt (phit.x[0] * phit.x[0] + phit.x[1] * phit.x[1]);
+
     if (r > geo.diskrad)
       return (VERY_BIG);
-    else if (allow_negative)
-    {
+    else if (allow_negative || s_plane > 0)
       return (s_plane);
-    }
-    else if (s_plane > 0)
-    {
-      return (s_plane);
-      return (VERY_BIG);
-    }
+    return (VERY_BIG);
   }
 
   /* At this point, we have completed the simple case.  It is simple
    * because there is only one possible intersection with the disk
-   * boundary
+   * boundary.
    *
-   * For the vertically extended disk we have to keep track of
-   * the smallest positive value and the smallest (in absolute
-   * terms negative value.
-   * 
-   * We would like to
-   * avoid actually having to calculate the intercept to the disk
-   * if we can because this is likely time consuming. So we first
-   * determine this, by checking where the ray hits a sphere that
-   * just encompasses the disk
-   */
-
-  s = VERY_BIG;
-  s_negative = -VERY_BIG;
-
-  s_test = s_top = ds_to_plane (&disktop, p);
-  stuff_phot (p, &phit);
-  move_phot (&phit, s_test);
-  r = r_top = sqrt (phit.x[0] * phit.x[0] + phit.x[1] * phit.x[1]);
-
-  if (r < geo.diskrad)
+   * For the vertically extended disk, first find the part of the path
+   * between the planes at the top and bottom of the disk */
+
+  h = geo.disk_z0 * geo.diskrad;
+
+  if (p->lmn[2] == 0.0)
   {
-    if (s_test >= 0)
+    if (fabs (p->x[2]) > h)
+      return (VERY_BIG);
+    s_top = -VERY_BIG;
+    s_bottom = VERY_BIG;
+  }
+  else
+  {
+    s_top = (h - p->x[2]) / p->lmn[2];
+    s_bottom = (-h - p->x[2]) / p->lmn[2];
+    if (s_top > s_bottom)
     {
       s = s_top;
-    }
-    else
-    {
-      s_negative = s_top;
+      s_top = s_bottom;
+      s_bottom = s;
     }
   }
 
-  /* So at this point, the distance to the top plane is
-   * known, and stored in s_top and if this hits within
-   * geo.diskrad stored in either s, or s_negative
-   */
-
+  /* and then the part of the path inside the cylinder at the outer edge of the disk */
 
+  q = p->lmn[0] * p->lmn[0] + p->lmn[1] * p->lmn[1];
+  pp = p->x[0] * p->lmn[0] + p->x[1] * p->lmn[1];
+  rho2 = p->x[0] * p->x[0] + p->x[1] * p->x[1];
 
-  s_test = s_bottom = ds_to_plane (&diskbottom, p);
-  stuff_phot (p, &phit);
-  move_phot (&phit, s_test);
-  r = r_bottom = sqrt (phit.x[0] * phit.x[0] + phit.x[1] * phit.x[1]);
-
-  if (r < geo.diskrad)
+  if (q == 0.0)
   {
-    if (s_test >= 0 && s_test < s)
-    {
-      s = s_test;
-    }
-    else if (s_test < 0 && s_test > s_negative)
-    {
-      s_negative = s_test;
-    }
+    if (rho2 >= geo.diskrad * geo.diskrad)
+      return (VERY_BIG);
+    c1 = -VERY_BIG;
+    c2 = VERY_BIG;
+  }
+  else
+  {
+    disc = pp * pp - q * (rho2 - geo.diskrad * geo.diskrad);
+    if (disc <= 0.0)
+      return (VERY_BIG);
+    disc = sqrt (disc);
+    c1 = (-pp - disc) / q;
+    c2 = (-pp + disc) / q;
   }
 
-  /* So at this point, the distance to the bottom plane is
-   * known, and stored in s_bottom  and if this hits within
-   * geo.diskrad stored in either s, or s_negative (if these
-   * distances are smaller than they were in absolute value
-   *
-   * Now we check whether the photon hits the cylinder that 
-   * defines the outer edge of the disk
-   */
-
-  s_test = s_diskrad = ds_to_cylinder (geo.diskrad, p);
-  stuff_phot (p, &phit);
-  move_phot (&phit, s_test);
+  smin = fmax (s_top, c1);
+  smax = fmin (s_bottom, c2);
+  if (smin >= smax)
+    return (VERY_BIG);          /* The path misses the region containing the disk */
 
-  /* At this point phit is on the cylinder but but we need to 
-   * check whether it is hitting the outside edge of the disk
-   * so we check where exactly it hit.  If it hit the 
-   * edge we once again look to reduce the distances
-   */
+  /* Look for a hit going forward.  If the path enters the region through the cylinder,
+   * it hits the edge of the disk, since the edge is as high as the region */
 
-  if (fabs (phit.x[2]) < geo.disk_z0 * geo.diskrad)
+  if (smax > 0.0)
   {
-    if (s_test >= 0 && s_test < s)
-    {
-      s = s_test;
-    }
-    else if (s_test < 0 && s_test > s_negative)
-    {
-      s_negative = s_test;
-    }
+    if (smin >= 0.0 && c1 >= s_top)
+      return (smin);
 
+    s_in = fmax (smin, 0.0);
+    if ((s = ds_to_disk_surface (p, s_in, smax)) != VERY_BIG)
+      return (s);
   }
 
-  /* So at this point we have the smallest positive and smallest negative values.  If we
-   * have missed the boundary, we have s as VERY_BIG and s_negative as -VERY_BIG */
+  if (allow_negative == 0 || smin >= 0.0)
+    return (VERY_BIG);
 
+  /* There was no hit going forward, so look for the closest one going backward */
 
-  if (s == VERY_BIG)
-  {
-    if (s_negative == -VERY_BIG || allow_negative == 0)
-    {
-      return (VERY_BIG);
-    }
-    else
-    {
-      // This is the case where we allow s to be negative, and there was no positive intercept
-      s_negative = s;
-    }
-  }
-
+  if (smax <= 0.0 && c2 <= s_bottom)
+    return (smax);
 
-/* At this point we must find the intercept with the disk */
+  s_out = fmin (smax, 0.0);
+  return (ds_to_disk_surface (p, s_out, smin));
+}
 
 
-  /*  First we check the unlikely case that the photon hit the edge of the
-   *  disk.  This is easy because if so s will be the same as s_diskrad
-   *  */
 
-  if (s == s_diskrad)
-  {
-    return (s);
-  }
+/**********************************************************/
+/** 
+ * @brief      Find the range of cylindrical radii covered by the part
+ * of the path of a photon that lies within a given height of a face of the disk
+ *
+ * @param [in] struct photon *  p   a photon pointer.
+ * @param [in] double  sign   1 for the upper face of the disk, -1 for the lower
+ * @param [in] double  h   The height above the face
+ * @param [in] double  s1   One end of the part of the path to consider
+ * @param [in] double  s2   The other end of the part of the path to consider
+ * @param [out] double *  r2lo   The square of the minimum radius
+ * @param [out] double *  r2hi   The square of the maximum radius
+ * @return     TRUE if some part of the path between s1 and s2 lies between
+ * the face of the disk and a height h above it, FALSE otherwise
+ *
+ * ###Notes###
+ *
+ * The squares of the radii are returned so that no square roots
+ * need to be taken.
+ *
+ **********************************************************/
 
-  /*  Now we need to find exactly where we have hit the disk.  This
-   *  is not trivial.  Basically we need to bracket the possibilities
-   *
-   * At this point we know the photon is on a path that passes
-   * through (or passed through the disk) and we must locate it.
-   * There are two possibilities.  It hit the disk edge, or it hit
-   * the face of the disk.  Most of the time it will hit the disk face
-   * so we will calculate this first, and then check if s is less
-   * than s_diskrad.
-   *
-   * To setup rtsafe, we have to find distances which bracket what
-   * we want.  smax should be no more than the distance to the
-   * disk_plane (assuming we have a photon headed toward the plane)
-   *
-   * Note that the next little section is intended to select between the
-   * top and bottom face of the disk
-   */
+int
+disk_path_r2_range (p, sign, h, s1, s2, r2lo, r2hi)
+     struct photon *p;
+     double sign, h, s1, s2;
+     double *r2lo, *r2hi;
+{
+  double w0, wz, ua, ub, u, q, pp, rho2, r2a, r2b, s_close;
 
+  w0 = sign * p->x[2];
+  wz = sign * p->lmn[2];
+  ua = fmin (s1, s2);
+  ub = fmax (s1, s2);
 
-  x1 = s_plane;
-  if (p->x[2] > 0.0)
+  if (wz == 0.0)
   {
-    if (r_top < geo.diskrad)
-    {
-      x2 = s_top;
-    }
-    else
-    {
-      x2 = s_bottom;
-    }
+    if (w0 < 0.0 || w0 > h)
+      return (FALSE);
   }
   else
   {
-    if (r_bottom < geo.diskrad)
-    {
-      x2 = s_bottom;
-    }
+    u = -w0 / wz;
+    if (wz > 0.0)
+      ua = fmax (ua, u);
     else
-    {
-      x2 = s_top;
-    }
-  }
-
-  if (fabs (x2) > fabs (x1))
-  {
-    smin = x1;
-    smax = x2;
-  }
-  else
-  {
-    smin = x2;
-    smax = x1;
+      ub = fmin (ub, u);
+    u = (h - w0) / wz;
+    if (wz > 0.0)
+      ub = fmin (ub, u);
+    else
+      ua = fmax (ua, u);
+    if (ua > ub)
+      return (FALSE);
   }
 
+  q = p->lmn[0] * p->lmn[0] + p->lmn[1] * p->lmn[1];
+  pp = p->x[0] * p->lmn[0] + p->x[1] * p->lmn[1];
+  rho2 = p->x[0] * p->x[0] + p->x[1] * p->x[1];
 
-  stuff_phot (p, &ds_to_disk_photon);
-  move_phot (&ds_to_disk_photon, smin);
-
-  if ((smax - smin) > 0.)
-    s_disk = zero_find (disk_height, 0.0, smax - smin, 1e-8);
-  else
-    s_disk = zero_find (disk_height, smax - smin, 0.0, 1e-8);
-
-
-
-  s_disk += smin;
-
-  /* Note that s_disk can still be negative */
+  r2a = rho2 + 2. * pp * ua + q * ua * ua;
+  r2b = rho2 + 2. * pp * ub + q * ub * ub;
+  *r2lo = fmin (r2a, r2b);
+  *r2hi = fmax (r2a, r2b);
 
+  if (q > 0.0)
+  {
+    s_close = -pp / q;
+    if (s_close > ua && s_close < ub)
+      *r2lo = fmax (0.0, rho2 + pp * s_close);
+  }
 
-  return (s_disk);
+  return (TRUE);
 }
 
 
 
 /**********************************************************/
 /** 
- * @brief      Calculate the change in disk height as s function of s
+ * @brief      Find where the path of a photon crosses the surface of a
+ * vertically extended disk between two distances
  *
- * @param [in] double  s  A distance along the path of a photon
- *           void params  unused variable required to present the correct function to gsl
-
- * @param [out] double *  value   the disk height at s
- * @return     N/A
+ * @param [in] struct photon *  p   a photon pointer.
+ * @param [in] double  s1   The distance along the path at which to start
+ * @param [in] double  s2   The distance along the path at which to stop
+ * @return     The distance from the photon to the first crossing of the surface
+ * encountered in going from s1 to s2, or VERY_BIG if there is none
  *
- * Used in ds_to_disk by zero_find
- * the place a photon hits a vertically extended disk
+ * Both faces of the disk are considered.  The crossing with each annulus of
+ * the piecewise representation of the surface that the path could pass over
+ * is found analytically, by solving for the intersection of the path with
+ * the cone of which the annulus is part.
  *
  * ###Notes###
  *
+ * This replaces a search for the zero of the difference between the
+ * height of the disk and the height of the photon.  Because zdisk
+ * uses the same representation of the surface, the results are consistent
+ * with those of zdisk to within rounding errors.
  *
- *  The function we are trying to zero is the
- *  difference between the height of the disk and the z height of the photon.
- *  Modified 2019 to allow use of gsl rather than old numerical recipies
+ * To avoid solving for the crossing with every annulus, the annuli are
+ * taken in blocks of NDISK_SURFACE_BLOCK, and only the annuli in blocks
+ * under the part of the path which is below the highest point of the
+ * surface in the block are examined.
  *
  **********************************************************/
 
-
 double
-disk_height (double s, void *params)
+ds_to_disk_surface (p, s1, s2)
+     struct photon *p;
+     double s1, s2;
 {
-  struct photon phit;
-  double z1, r1;
+  double sign, dir, send, w0, wz, b2, q, pp, rho2, zmax;
+  double r2lo, r2hi, rlo2, rhi2, r2, dr2;
+  double aa, bb, cc, qq, disc, root[2], s, best;
+  int face, kfirst, kend, kstep, kblock, klast, k, i;
+
+  if (geo.diskrad != disk_surf.diskrad || geo.disk_z0 != disk_surf.z0 || geo.disk_z1 != disk_surf.z1)
+    disk_surface_init ();
+
+  dir = (s2 >= s1) ? 1.0 : -1.0;
+  q = p->lmn[0] * p->lmn[0] + p->lmn[1] * p->lmn[1];
+  pp = p->x[0] * p->lmn[0] + p->x[1] * p->lmn[1];
+  rho2 = p->x[0] * p->x[0] + p->x[1] * p->x[1];
+  dr2 = disk_surf.dr * disk_surf.dr;
+
+  best = VERY_BIG;
+  for (face = 0; face < 2; face++)
+  {
+    sign = (face == 0) ? 1.0 : -1.0;
+    wz = sign * p->lmn[2];
 
-  stuff_phot (&ds_to_disk_photon, &phit);
-  move_phot (&phit, s);
-  r1 = sqrt (phit.x[0] * phit.x[0] + phit.x[1] * phit.x[1]);
-  z1 = zdisk (r1) - fabs (phit.x[2]);   // this is the function
+    /* Once a crossing has been found, only the part of the path before it need be examined */
 
-  return (z1);
+    send = (best == VERY_BIG) ? s2 : best;
+
+    /* Find the blocks under the part of the path which is below the top of the disk */
+
+    if (!disk_path_r2_range (p, sign, disk_surf.z0 * disk_surf.diskrad, s1, send, &r2lo, &r2hi))
+      continue;
+    kfirst = sqrt (r2lo) / disk_surf.dr;
+    kfirst -= kfirst % NDISK_SURFACE_BLOCK;
+    kend = sqrt (r2hi) / disk_surf.dr;
+    if (kend > NDISK_SURFACE - 1)
+      kend = NDISK_SURFACE - 1;
+    kend -= kend % NDISK_SURFACE_BLOCK;
+
+    /* Take the blocks in the order the path reaches them, so that later blocks can often be skipped */
+
+    kstep = NDISK_SURFACE_BLOCK;
+    if ((pp + q * s1) * dir < 0.0)
+    {
+      kblock = kfirst;
+      kfirst = kend;
+      kend = kblock;
+      kstep = -NDISK_SURFACE_BLOCK;
+    }
+
+    for (kblock = kfirst; (kend - kblock) * kstep >= 0; kblock += kstep)
+    {
+      klast = kblock + NDISK_SURFACE_BLOCK - 1;
+      if (klast > NDISK_SURFACE - 1)
+        klast = NDISK_SURFACE - 1;
+
+      /* The surface rises outwards, so its highest point in the block is at the outer edge */
+
+      zmax = disk_surf.a[klast] + disk_surf.b[klast] * (klast + 1) * disk_surf.dr;
+      send = (best == VERY_BIG) ? s2 : best;
+      if (!disk_path_r2_range (p, sign, zmax, s1, send, &r2lo, &r2hi))
+        continue;
+      if (r2hi < kblock * kblock * dr2 || r2lo > (klast + 1) * (klast + 1) * dr2)
+        continue;
+
+      for (k = kblock; k <= klast; k++)
+      {
+        rlo2 = k * k * dr2;
+        rhi2 = (k + 1) * (k + 1) * dr2;
+        if (r2hi < rlo2 || r2lo > rhi2)
+          continue;
+
+        /* Solve (w - a)**2 = b**2 r**2 along the path, where w is the height above the face */
+
+        w0 = sign * p->x[2] - disk_surf.a[k];
+        b2 = disk_surf.b[k] * disk_surf.b[k];
+        aa = wz * wz - b2 * q;
+        bb = 2. * (w0 * wz - b2 * pp);
+        cc = w0 * w0 - b2 * rho2;
+
+        if (fabs (aa) < 1e-12 * (wz * wz + b2 * q))
+        {
+          if (bb == 0.0)
+            continue;
+          root[0] = root[1] = -cc / bb;
+        }
+        else
+        {
+          disc = bb * bb - 4. * aa * cc;
+          if (disc < 0.0)
+            continue;
+          disc = sqrt (disc);
+          qq = -0.5 * (bb + (bb >= 0.0 ? disc : -disc));
+          root[0] = qq / aa;
+          root[1] = (qq != 0.0) ? cc / qq : root[0];
+        }
+
+        for (i = 0; i < 2; i++)
+        {
+          s = root[i];
+          if ((s - s1) * dir < 0.0 || (s2 - s) * dir < 0.0)
+            continue;           /* Not between s1 and s2 */
+          if (best != VERY_BIG && (s - best) * dir >= 0.0)
+            continue;           /* Not closer than a crossing already found */
+          if (w0 + wz * s < 0.0)
+            continue;           /* A crossing of the reflection of the cone in its apex */
+          r2 = rho2 + 2. * pp * s + q * s * s;
+          if (r2 < rlo2 || r2 > rhi2)
+            continue;           /* Not in this annulus */
+          best = s;
+        }
+      }
+    }
+  }
 
+  return (best);
 }
 
 
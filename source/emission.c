@@ -260,6 +260,7 @@ photo_gen_wind (p, weight, freqmin, freqmax, photstart, nphot)
        geo.f_wind refers to the specific flux between freqmin and freqmax.  Note that
        we make sure that xlum is not == 0 or to geo.f_wind. */
 
+    qmc_start (QMC_WIND_CELL);
     xlum = random_number (0.0, 1.0) * geo.f_wind;
 
 
@@ -292,6 +293,7 @@ photo_gen_wind (p, weight, freqmin, freqmax, photstart, nphot)
 
     lum = plasmamain[nplasma].lum_tot;
     xlum = lum * random_number (0.0, 1.0);
+    qmc_stop ();
     xlumsum = 0;
 
     p[n].nres = -1;
@@ -327,6 +329,7 @@ photo_gen_wind (p, weight, freqmin, freqmax, photstart, nphot)
 
     for (np = photstart; np < photstop; np++)
     {
+      qmc_start (QMC_WIND);
 
       if (np < photstart + ptype[n][0])
       {
@@ -360,6 +363,7 @@ photo_gen_wind (p, weight, freqmin, freqmax, photstart, nphot)
       }
 
       p[np].w = weight;
+      qmc_skip (QMC_WIND_POS);
       get_random_location (icell, p[np].x);
       p[np].grid = icell;
 
@@ -369,6 +373,8 @@ photo_gen_wind (p, weight, freqmin, freqmax, photstart, nphot)
          the type of photon that was generated
        */
 
+      qmc_skip (QMC_WIND_DIR);
+
       if (p[np].nres < 0 || geo.scatter_mode == SCATTER_MODE_ISOTROPIC)
       {
         randvec (p[np].lmn, 1.0);       /* The photon is emitted isotropically */
@@ -378,6 +384,7 @@ photo_gen_wind (p, weight, freqmin, freqmax, photstart, nphot)
         randwind_thermal_trapping (&p[np], &nnscat);
       }
       p[np].nnscat = nnscat;
+      qmc_stop ();
 
       /* Photons are generated in the CMF and so must be Doppler shifted into 
          the Lab Frame.  We only correct the frequency to first order for the velocity of the wind.,
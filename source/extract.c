@@ -161,7 +161,7 @@ one is odd. We do frequency here but weighting is carried out in  extract */
       if (itype == PTYPE_WIND)
       {                         /* If the photon was scattered in the wind, 
                                    the frequency also must be shifted */
-        ndom = wmain[p->grid].ndom;
+        ndom = WIND_NDOM (p->grid);
         vwind_xyz (ndom, &pp, v);       /*  Get the velocity at the position of pp */
         doppler (p, &pp, v, pp.nres);   /*  Doppler shift the photon -- test! */
 
@@ -252,12 +252,16 @@ extract_one (w, pp, itype, nspec)
   double lfreqmin, lfreqmax, ldfreq;
   int ishell;
   double normal[3];
+  double t_roulette;
 
 
+  PERF_COUNT (PERF_EXTRACT_RAYS);
+
   weight_min = EPSILON * pp->w;
   istat = P_INWIND;
   tau = 0;
   icell = 0;
+  t_roulette = -1.0;
 
 /* Preserve the starting position of the photon so one can use this to determine whether the
  * photon encountered the disk or star as it tried to exist the wind.
@@ -326,10 +330,12 @@ the same resonance again */
 
 /* Now we can actually extract the reweighted photon */
 
+  extracting_ray = TRUE;
   while (istat == P_INWIND)
   {
     istat = translate (w, pp, 20., &tau, &nres);
     icell++;
+    PERF_COUNT (PERF_EXTRACT_CELLS);
 
     istat = walls (pp, &pstart, normal);
     if (istat == -1)
@@ -356,8 +362,42 @@ the same resonance again */
     {                           /* Cause the photon to scatter and reinitilize */
       break;
     }
+
+    /* If the ray can now add only a negligible fraction of what is already in the bin it would
+     * land in, play Russian roulette with it.  Survivors have their weight increased by 1/(1-p)
+     * so that the spectrum is unbiased */
+
+    if (geo.extract_roulette && istat == P_INWIND)
+    {
+      k = (pp->freq - xxspec[nspec].freqmin) / xxspec[nspec].dfreq;
+      if (k < 0)
+        k = 0;
+      else if (k > NWAVE - 1)
+        k = NWAVE - 1;
+
+      if (pp->w * exp (-tau) < geo.roulette_frac * xxspec[nspec].f[k])
+      {
+        if (random_number (0.0, 1.0) < geo.roulette_kill)
+        {
+          xxspec[nspec].nroulette_kill++;
+          istat = P_ABSORB;
+          break;
+        }
+        pp->w /= (1. - geo.roulette_kill);
+        if (t_roulette < 0)
+        {
+          xxspec[nspec].nroulette_live++;
+          t_roulette = timer ();
+        }
+      }
+    }
   }
 
+  extracting_ray = FALSE;
+
+  if (t_roulette >= 0)
+    xxspec[nspec].roulette_tlive += timer () - t_roulette;
+
   if (istat == P_ESCAPE)
   {
 
@@ -447,3 +487,45 @@ the same resonance again */
 
   return (istat);
 }
+
+
+
+
+/**********************************************************/
+/** 
+ * @brief      Summarize the effect of Russian roulette on the extracted spectra
+ *
+ * @return     Always returns 0
+ *
+ * @details
+ * For each observer, log the number of extracted rays that were killed by
+ * Russian roulette in extract_one and an estimate of the time this saved.
+ *
+ * ### Notes ###
+ * The time saved is estimated from the rays which survived roulette, since
+ * these are the rays whose remaining flight is what a killed ray would
+ * have cost.  The numbers are for this thread only.
+ *
+ **********************************************************/
+
+int
+extract_roulette_summary ()
+{
+  int n;
+  double t_saved;
+
+  if (!geo.extract_roulette)
+    return (0);
+
+  Log ("Extract: Russian roulette with threshold %.2e of bin and kill probability %.2f\n", geo.roulette_frac, geo.roulette_kill);
+  for (n = MSPEC; n < nspectra; n++)
+  {
+    t_saved = 0.0;
+    if (xxspec[n].nroulette_live > 0)
+      t_saved = xxspec[n].nroulette_kill * xxspec[n].roulette_tlive / xxspec[n].nroulette_live;
+    Log ("Extract: %-10s rays killed %10d survived %10d  estimated time saved %10.2f s\n", xxspec[n].name,
+         xxspec[n].nroulette_kill, xxspec[n].nroulette_live, t_saved);
+  }
+
+  return (0);
+}
@@ -29,16 +29,21 @@
  * @details
  *
  * ### Notes ###
- * For spherical coordinates the routine calculates the gradient
- * on the fly, that is moves the photon a bit and calculates dvds
- *
  * For 2d systems, the velocity gradient is calculated using
  * the velocity gradient tensors, which contain the velocity
  * gradient in the xz plane.
  *
- * It's not clear how much faster the method used for 2d systems
- * actually is, and one might want to consider the on-the-
- * fly appoach for all systems.
+ * For spherical coordinates the flow is radial, v = v(r) r_hat, and so
+ *
+ * dv/ds = mu**2 dv/dr + (1 - mu**2) v/r
+ *
+ * where mu is the cosine of the angle between the direction of the
+ * photon and the radial direction.  dv/dr and v/r are obtained from the
+ * velocity gradient tensors of the cells by spherical_vgrad, interpolated
+ * to the position of the photon, and combined with mu.  This replaces an
+ * on-the-fly finite difference with model_velocity, which was adopted
+ * because the tensors, which are calculated in the xz plane at 45 degrees
+ * to the axes, cannot be interpolated directly (see issue #118).
  *
  **********************************************************/
 
@@ -57,7 +62,7 @@ dvwind_ds (p)
 
   int ndom;
 
-  ndom = wmain[p->grid].ndom;
+  ndom = WIND_NDOM (p->grid);
 
 
   /* We want the change in velocity along the line of sight, but we
@@ -83,27 +88,23 @@ dvwind_ds (p)
 
   if (zdom[ndom].coord_type == SPHERICAL)
   {
-    struct photon pnew;
-    double v1[3], v2[3], diff[3];
-    double ds;
+    double dvdr, v_over_r, dvdr_cell, v_over_r_cell;
+    double r, mu;
 
-    /* choose a small distance which is dependent on the cell size */
-    vsub (pp.x, wmain[pp.grid].x, diff);
-    ds = 0.001 * length (diff);
+    coord_fraction (ndom, 0, pp.x, nnn, frac, &nelem);
 
-    /* calculate the velocity at the position of the photon */
-    /* note we use model velocity, which could potentially be slow,
-       but avoids interpolating (see #118) */
-    model_velocity (ndom, pp.x, v1);
+    dvdr = v_over_r = 0.0;
+    for (nn = 0; nn < nelem; nn++)
+    {
+      spherical_vgrad (WIND_V_GRAD (nnn[nn]), &dvdr_cell, &v_over_r_cell);
+      dvdr += dvdr_cell * frac[nn];
+      v_over_r += v_over_r_cell * frac[nn];
+    }
 
-    /* copy the photon and move it by ds, and evaluate the velocity
-       at the new point */
-    stuff_phot (&pp, &pnew);
-    move_phot (&pnew, ds);
-    model_velocity (ndom, pnew.x, v2);
+    r = length (pp.x);
+    mu = dot (pp.x, pp.lmn) / r;
 
-    /* calculate the relevant gradient */
-    dvds = fabs (dot (v1, pp.lmn) - dot (v2, pp.lmn)) / ds;
+    dvds = fabs (mu * mu * dvdr + (1. - mu * mu) * v_over_r);
   }
 
   else                          // for non spherical coords we interpolate on v_grad
@@ -118,7 +119,7 @@ dvwind_ds (p)
       {
         x = 0;
         for (nn = 0; nn < nelem; nn++)
-          x += wmain[nnn[nn]].v_grad[j][k] * frac[nn];
+          x += WIND_V_GRAD (nnn[nn])[j][k] * frac[nn];
 
         v_grad[j][k] = x;
 
@@ -155,6 +156,182 @@ dvwind_ds (p)
 
 
 
+/**********************************************************/
+/**
+ * @brief      Set up the segment of the path of a photon along which
+ * the velocity of the wind is treated as linear
+ *
+ * @param [in] int  ndom   The domain of the cell the photon is in
+ * @param [in] PhotPtr  p   The photon at the start of the segment
+ * @param [in] double  smax   The maximum length of the segment
+ * @return     The length of the segment, which may be less than smax
+ *
+ * @details
+ * The velocity projected onto the direction of travel is calculated at
+ * the two ends of the path, and then at its midpoint.  If the velocity at the
+ * midpoint differs from the average of the velocities at the two ends by
+ * more than VCHECK, the path is halved and the check is repeated.  The
+ * result is stored in vseg.
+ *
+ * ### Notes ###
+ * When a photon has just crossed from one cell to the next, p is the photon
+ * at the end of the previous segment, and the velocity there is not
+ * calculated again.
+ *
+ **********************************************************/
+
+double
+vseg_init (ndom, p, smax)
+     int ndom;
+     PhotPtr p;
+     double smax;
+{
+  struct photon p_now;
+  double v_inner[3], v_outer[3], v_check[3];
+  double vch, vc;
+
+  if (vseg.ok && comp_phot (&vseg.p2, p) == 0)
+  {
+    vseg.v1 = vseg.v2;
+  }
+  else
+  {
+    vwind_xyz (ndom, p, v_inner);
+    vseg.v1 = dot (p->lmn, v_inner);
+  }
+
+  stuff_phot (p, &vseg.p1);
+  stuff_phot (p, &vseg.p2);
+  move_phot (&vseg.p2, smax);
+  vwind_xyz (ndom, &vseg.p2, v_outer);
+  vseg.v2 = dot (vseg.p2.lmn, v_outer);
+
+  vc = VLIGHT;
+  while (vc > VCHECK && smax > DFUDGE)
+  {
+    stuff_phot (p, &p_now);
+    move_phot (&p_now, smax / 2.);
+    vwind_xyz (ndom, &p_now, v_check);
+    vch = dot (p_now.lmn, v_check);
+
+    vc = fabs (vch - 0.5 * (vseg.v1 + vseg.v2));
+
+    if (vc > VCHECK)
+    {
+      stuff_phot (&p_now, &vseg.p2);
+      smax *= 0.5;
+      vseg.v2 = vch;
+    }
+  }
+
+  vseg.len = smax;
+  vseg.dvds_ok = FALSE;
+  vseg.ok = TRUE;
+
+  return (smax);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Obtain the projected velocity of the wind at a distance
+ * along the current segment
+ *
+ * @param [in] PhotPtr  p   The photon whose path the segment is meant to describe
+ * @param [in] double  s   The distance from the start of the segment
+ * @param [out] double *  v   The velocity along the direction of travel
+ * @return     TRUE if the segment describes this part of the path of p,
+ * FALSE otherwise, in which case v is not set
+ *
+ * @details
+ * The velocity is interpolated linearly between the ends of the segment,
+ * which is exact at the ends.
+ *
+ **********************************************************/
+
+int
+vseg_v (p, s, v)
+     PhotPtr p;
+     double s;
+     double *v;
+{
+  if (!vseg.ok || s > vseg.len || comp_phot (&vseg.p1, p))
+    return (FALSE);
+
+  if (s == vseg.len)
+    *v = vseg.v2;
+  else
+    *v = vseg.v1 + (vseg.v2 - vseg.v1) * s / vseg.len;
+
+  return (TRUE);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Obtain dv/ds along the current segment
+ *
+ * @param [in] double  x   The fractional position along the segment
+ * @return     dv/ds in the direction of travel
+ *
+ * @details
+ * dv/ds is calculated with dvwind_ds at the two ends of the segment the
+ * first time it is needed, and interpolated linearly between them.
+ *
+ **********************************************************/
+
+double
+vseg_dvds (x)
+     double x;
+{
+  if (!vseg.dvds_ok)
+  {
+    vseg.dvds1 = dvwind_ds (&vseg.p1);
+    vseg.dvds2 = dvwind_ds (&vseg.p2);
+    vseg.dvds_ok = TRUE;
+  }
+
+  return ((1. - x) * vseg.dvds1 + x * vseg.dvds2);
+}
+
+
+
+
+/**********************************************************/
+/**
+ * @brief      Decompose the velocity gradient tensor of a cell in a
+ * spherical domain into its radial and tangential parts
+ *
+ * @param [in] double  v_grad[][3]   The velocity gradient tensor of the cell
+ * @param [out] double *  dvdr   The radial gradient dv/dr
+ * @param [out] double *  v_over_r   The tangential part of the gradient, v/r
+ * @return     Always returns 0
+ *
+ * @details
+ * For a radial flow the gradient tensor at a position with unit vector
+ * r_hat is dv/dr r_hat r_hat + v/r (I - r_hat r_hat).  In spherical domains
+ * the tensors are calculated at positions in the xz plane at 45 degrees to
+ * the axes, so that r_hat = (1, 0, 1) / sqrt(2).  dv/dr is then r_hat.v_grad.r_hat,
+ * and v/r is the yy component of the tensor, which is perpendicular to r_hat.
+ *
+ **********************************************************/
+
+int
+spherical_vgrad (v_grad, dvdr, v_over_r)
+     double v_grad[][3];
+     double *dvdr, *v_over_r;
+{
+  *dvdr = 0.5 * (v_grad[0][0] + v_grad[0][2] + v_grad[2][0] + v_grad[2][2]);
+  *v_over_r = v_grad[1][1];
+
+  return (0);
+}
+
+
+
+
 #define N_DVDS_AVE	10000
 
 /**********************************************************/
@@ -183,6 +360,10 @@ dvwind_ds (p)
  *
  * There is an advanced mode which prints this information to
  * file.
+ *
+ * With MPI, each thread samples the cells it owns (see setup_cell_mine)
+ * and the results are then shared, except in the advanced mode, where
+ * every thread samples every cell so that the file is complete.
  **********************************************************/
 
 
@@ -210,6 +391,9 @@ dvds_ave ()
 
   for (icell = 0; icell < NDIM2; icell++)
   {
+    if (!modes.print_dvds_info && !setup_cell_mine (icell))
+      continue;
+
     ndom = wmain[icell].ndom;
 
     dvds_max = 0.0;             // Set dvds_max to zero for the cell.
@@ -283,5 +467,7 @@ dvds_ave ()
   if (modes.print_dvds_info)
     fclose (optr);
 
+  setup_share (SETUP_DVDS);
+
   return (0);
 }
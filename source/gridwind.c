@@ -47,6 +47,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
 #include "atomic.h"
@@ -156,6 +157,7 @@ calloc_wind (nelem)
       ("Allocated %10d bytes for each of %5d elements of             totaling %10.1f Mb\n",
        sizeof (wind_dummy), nelem, 1.e-6 * nelem * sizeof (wind_dummy));
   }
+  mem_register (MEM_WIND, "wmain", (double) (nelem + 1) * sizeof (wind_dummy));
 
   return (0);
 }
@@ -216,6 +218,10 @@ calloc_plasma (nelem)
       ("Allocated %10d bytes for each of %5d elements of      plasma totaling %10.1f Mb \n",
        sizeof (plasma_dummy), (nelem + 1), 1.e-6 * (nelem + 1) * sizeof (plasma_dummy));
   }
+  mem_register (MEM_PLASMA, "plasmamain", (double) (nelem + 1) * sizeof (plasma_dummy));
+
+  /* The cached level populations belong to the cells of the old plasma structure */
+  tla_cache_free ();
 
   /* Now allocate space for storing photon frequencies -- 57h */
   if (photstoremain != NULL)
@@ -235,6 +241,7 @@ calloc_plasma (nelem)
       ("Allocated %10d bytes for each of %5d elements of photonstore totaling %10.1f Mb \n",
        sizeof (photon_store_dummy), (nelem + 1), 1.e-6 * (nelem + 1) * sizeof (photon_store_dummy));
   }
+  mem_register (MEM_PHOTSTORE, "photstoremain", (double) (nelem + 1) * sizeof (photon_store_dummy));
 
   /* Repeat above for matom storage photon frequencies -- 82h */
   if (matomphotstoremain != NULL)
@@ -254,6 +261,7 @@ calloc_plasma (nelem)
       ("Allocated %10d bytes for each of %5d elements of matomphotonstore totaling %10.1f Mb \n",
        sizeof (matom_photon_store_dummy), (nelem + 1), 1.e-6 * (nelem + 1) * sizeof (matom_photon_store_dummy));
   }
+  mem_register (MEM_PHOTSTORE, "matomphotstoremain", (double) (nelem + 1) * sizeof (matom_photon_store_dummy));
 
   return (0);
 }
@@ -357,6 +365,7 @@ calloc_macro (nelem)
   {
     Log ("calloc_macro: Allocated no space for macro since nlevels_macro==0\n");
   }
+  mem_register (MEM_MACRO, "macromain", (double) (nelem + 1) * sizeof (macro_dummy));
 
   return (0);
 }
@@ -537,6 +546,9 @@ calloc_estimators (nelem)
   {
     Log_silent ("Allocated no space for macro since nlevels_macro==0\n");
   }
+  mem_register (MEM_MACRO, "macro_estimators",
+                (double) nelem * (2. * nlevels_macro + 2. * size_alpha_est + 10. * size_gamma_est + 2. * size_Jbar_est + 2. * nphot_total +
+                                  nlines) * sizeof (double));
 
   return (0);
 }
@@ -672,6 +684,110 @@ calloc_dyn_plasma (nelem)
   Log
     ("Allocated %10d bytes for each of %5d elements variable length plasma arrays totaling %10.1f Mb \n",
      sizeof (double) * nions * 14, (nelem + 1), 1.e-6 * (nelem + 1) * sizeof (double) * (nions * 14 + nlte_levels + nphot_total * 2));
+  mem_register (MEM_PLASMA, "plasma_arrays",
+                (double) (nelem + 1) * ((11. * nions + n_inner_tot + nlte_levels + 3. * nphot_total) * sizeof (double) + nions * sizeof (int)));
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/** 
+ * @brief      Copy the parts of wmain and plasmamain which are needed while photons
+ * are in flight into the compact arrays wmain_hot and plasmamain_hot
+ *
+ * @return     Always returns 0
+ *
+ * @details
+ * The arrays are allocated the first time the routine is called, and 
+ * reallocated if the size of the wind changes.  On return wind_hot_ok is
+ * set to TRUE, so that the accessor macros WIND_V etc read from the 
+ * compact arrays.
+ *
+ * ### Notes ###
+ *
+ * The routine is called at the start of each ionization and spectral cycle,
+ * after the wind has been updated, so that the copies are made once for all
+ * of the batches of photons in the cycle.  The copies are not kept up
+ * to date if wmain or plasmamain change, so wind_hot_release must be
+ * called once the photons of the cycle have been transported.
+ *
+ **********************************************************/
+
+int
+wind_hot_update ()
+{
+  static int nwind_hot = 0, nplasma_hot = 0;
+  int n;
+
+  if (wmain_hot == NULL || nwind_hot != NDIM2 + 1)
+  {
+    free (wmain_hot);
+    nwind_hot = NDIM2 + 1;
+    if ((wmain_hot = (WindHotPtr) calloc (sizeof (wind_hot_dummy), nwind_hot)) == NULL)
+    {
+      Error ("wind_hot_update: Error in allocating memory for %d wind cells\n", nwind_hot);
+      Exit (0);
+    }
+  }
+
+  if (plasmamain_hot == NULL || nplasma_hot != NPLASMA + 1)
+  {
+    free (plasmamain_hot);
+    nplasma_hot = NPLASMA + 1;
+    if ((plasmamain_hot = (PlasmaHotPtr) calloc (sizeof (plasma_hot_dummy), nplasma_hot)) == NULL)
+    {
+      Error ("wind_hot_update: Error in allocating memory for %d plasma cells\n", nplasma_hot);
+      Exit (0);
+    }
+  }
+
+  mem_register (MEM_WIND, "wind_hot", (double) nwind_hot * sizeof (wind_hot_dummy) + (double) nplasma_hot * sizeof (plasma_hot_dummy));
+
+  for (n = 0; n < nwind_hot; n++)
+  {
+    memcpy (wmain_hot[n].v, wmain[n].v, sizeof (wmain[n].v));
+    memcpy (wmain_hot[n].v_grad, wmain[n].v_grad, sizeof (wmain[n].v_grad));
+    wmain_hot[n].vol = wmain[n].vol;
+    wmain_hot[n].dfudge = wmain[n].dfudge;
+    wmain_hot[n].ndom = wmain[n].ndom;
+    wmain_hot[n].nwind = wmain[n].nwind;
+    wmain_hot[n].nplasma = wmain[n].nplasma;
+    wmain_hot[n].inwind = wmain[n].inwind;
+  }
+
+  for (n = 0; n < nplasma_hot; n++)
+  {
+    plasmamain_hot[n].ne = plasmamain[n].ne;
+    plasmamain_hot[n].t_e = plasmamain[n].t_e;
+    plasmamain_hot[n].vol = plasmamain[n].vol;
+    plasmamain_hot[n].nwind = plasmamain[n].nwind;
+  }
+
+  wind_hot_ok = TRUE;
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/** 
+ * @brief      Mark the compact copies of wmain and plasmamain as out of date
+ *
+ * @return     Always returns 0
+ *
+ * @details
+ * After this, the accessor macros read from wmain again.  The memory is
+ * kept for the next call to wind_hot_update.
+ *
+ **********************************************************/
+
+int
+wind_hot_release ()
+{
+  wind_hot_ok = FALSE;
 
   return (0);
 }
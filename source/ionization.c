@@ -256,6 +256,11 @@ convergence (PlasmaPtr xplasma)
 
   xplasma->converge_whole = whole_check = trcheck + techeck + hccheck;
 
+  if (whole_check == CONVERGENCE_CHECK_PASS)
+    xplasma->nconverged++;
+  else
+    xplasma->nconverged = 0;
+
   /*
    * Now we check to see if a cell is converging:
    * Converging is a situation where the change in electron temperature is dropping with time and the cell is
@@ -626,6 +631,8 @@ zero_emit (double t)
 {
   double difference;
 
+  PERF_COUNT (PERF_TE_EVALS);
+
   /*Original method */
   xxxplasma->t_e = t;
 
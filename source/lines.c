@@ -243,20 +243,9 @@ two_level_atom (line_ptr, xplasma, d1, d2)
      PlasmaPtr xplasma;
      double *d1, *d2;
 {
-  double a, a21 ();
-  double q, q21 (), c12, c21;
-  double freq;
-  double g2_over_g1;
-  double n2_over_n1;
-  double n1_over_ng;
-  double n2_over_ng;
-  double z;
-  double exp ();
-  int gg;
-  double xw;
+  double n1_over_dd, n2_over_dd;
   double ne, te, w, tr, dd;
   int nion;
-  double J;                     //Model of the specific intensity
 
 
   //Check and exit if this routine is called for a macro atom, since this should never happen
@@ -289,8 +278,77 @@ two_level_atom (line_ptr, xplasma, d1, d2)
   }
   else
   {
-    if (line_ptr->el == 0.0)
-    {                           // Then the lower level is the ground state
+    old_n2_over_n1 = two_level_fractions (line_ptr, xplasma, &n1_over_dd, &n2_over_dd);
+
+    *d1 = dd * n1_over_dd;
+    *d2 = dd * n2_over_dd;
+
+    old_line_ptr = line_ptr;
+    old_ne = ne;
+    old_te = te;
+    old_w = w;
+    old_tr = tr;
+    old_dd = dd;
+    old_d1 = (*d1);
+    old_d2 = (*d2);
+  }
+
+  return (old_n2_over_n1);
+
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      calculates the populations of the two levels of a line
+ * relative to the density of the lower level given by the partition function
+ *
+ * @param [in] struct lines *  line_ptr   The line of interest
+ * @param [in] PlasmaPtr  xplasma   The plasma cell of interest
+ * @param [out] double *  n1_over_dd   The density of the lower level as a fraction of dd
+ * @param [out] double *  n2_over_dd   The density of the upper level as a fraction of dd
+ * @return     The density ratio n2/n1
+ *
+ * @details
+ * dd is the density of the ion multiplied by g/z for the ground
+ * state, as calculated in two_level_atom.  The fractions depend only
+ * on the line and on the conditions (ne, t_e, t_r, w and the model of
+ * the mean intensity) in the cell, and not on the density of the ion.
+ * The approximations used are described in two_level_atom.
+ *
+ * ### Notes ###
+ * For a ground state connected transition n1_over_dd is 1.
+ *
+ **********************************************************/
+
+double
+two_level_fractions (line_ptr, xplasma, n1_over_dd, n2_over_dd)
+     struct lines *line_ptr;
+     PlasmaPtr xplasma;
+     double *n1_over_dd, *n2_over_dd;
+{
+  double a, a21 ();
+  double q, q21 (), c12, c21;
+  double freq;
+  double g2_over_g1;
+  double n2_over_n1;
+  double n1_over_ng;
+  double n2_over_ng;
+  double z;
+  double exp ();
+  int gg;
+  double xw;
+  double ne, te, w, tr;
+  double J;                     //Model of the specific intensity
+
+  ne = xplasma->ne;
+  te = xplasma->t_e;
+  tr = xplasma->t_r;
+  w = xplasma->w;
+
+  if (line_ptr->el == 0.0)
+  {                             // Then the lower level is the ground state
 
 /* For a ground state connected transition we correct for the partition
 function in calculating the density of the lower level, and then we
@@ -300,38 +358,35 @@ function directly is the allowance for collisions, and also for the
 possibility that not all lines have upper levels that are included
 in the configuration structure. 01dec ksl */
 
-      a = a21 (line_ptr);
-      q = q21 (line_ptr, te);
-      freq = line_ptr->freq;
-      g2_over_g1 = line_ptr->gu / line_ptr->gl;
-
+    a = a21 (line_ptr);
+    q = q21 (line_ptr, te);
+    freq = line_ptr->freq;
+    g2_over_g1 = line_ptr->gu / line_ptr->gl;
 
-      c21 = ne * q;
-      c12 = c21 * g2_over_g1 * exp (-H_OVER_K * freq / te);
 
+    c21 = ne * q;
+    c12 = c21 * g2_over_g1 * exp (-H_OVER_K * freq / te);
 
-      z = (VLIGHT * VLIGHT) / (2. * PLANCK * freq * freq * freq);       //This is the factor which relates the A coefficient to the b coefficient
 
+    z = (VLIGHT * VLIGHT) / (2. * PLANCK * freq * freq * freq); //This is the factor which relates the A coefficient to the b coefficient
 
-      /* we call mean intensity with mode 1 - this means we are happy to use the
-         dilute blackbody approximation even if we havent run enough spectral cycles
-         to have a model for J */
-      J = mean_intensity (xplasma, freq, 1);
 
-      /* this equation is equivalent to equation 4.29 in NSH's thesis with the
-         einstein b coefficients replaced by a multiplied by suitable conversion
-         factors from the einstein relations. */
-      n2_over_n1 = (c12 + g2_over_g1 * a * z * J) / (c21 + a * (1. + (J * z)));
+    /* we call mean intensity with mode 1 - this means we are happy to use the
+       dilute blackbody approximation even if we havent run enough spectral cycles
+       to have a model for J */
+    J = mean_intensity (xplasma, freq, 1);
 
+    /* this equation is equivalent to equation 4.29 in NSH's thesis with the
+       einstein b coefficients replaced by a multiplied by suitable conversion
+       factors from the einstein relations. */
+    n2_over_n1 = (c12 + g2_over_g1 * a * z * J) / (c21 + a * (1. + (J * z)));
 
+    *n1_over_dd = 1.0;
+    *n2_over_dd = n2_over_n1;
 
-
-      *d1 = dd;
-      *d2 = *d1 * n2_over_n1;
-
-    }
-    else
-    {                           // The transition has both levels above the ground state
+  }
+  else
+  {                             // The transition has both levels above the ground state
 
 /*
  * In the event that both levels are above the ground state, we assume
@@ -340,9 +395,9 @@ in the configuration structure. 01dec ksl */
  * is matastable in which case we set the weight to 1 and force equlibrium
 */
 
-      gg = ion[line_ptr->nion].g;
-      z = w / (exp (line_ptr->eu / (BOLTZMANN * tr)) + w - 1.);
-      n2_over_ng = line_ptr->gu / gg * z;
+    gg = ion[line_ptr->nion].g;
+    z = w / (exp (line_ptr->eu / (BOLTZMANN * tr)) + w - 1.);
+    n2_over_ng = line_ptr->gu / gg * z;
 
 /* For lower level, use an on the spot approximation if the lower level has a short radiative lifetive;
 Othewise, assert that the lower level is metastable and set the radiative weight to 1
@@ -352,30 +407,154 @@ ERROR -- or conceptually
 07mar - ksl - We still need to determine whether this makes sense at all !!
 */
 
-      xw = w;                   // Assume all lower levels are allowed at present
+    xw = w;                     // Assume all lower levels are allowed at present
+
+    z = xw / (exp (line_ptr->el / (BOLTZMANN * tr)) + xw - 1.);
+    n1_over_ng = line_ptr->gl / gg * z;
+
+    *n1_over_dd = n1_over_ng;
+    *n2_over_dd = n2_over_ng;
+    n2_over_n1 = n2_over_ng / n1_over_ng;
+  }
+
+  return (n2_over_n1);
+}
+
 
-      z = xw / (exp (line_ptr->el / (BOLTZMANN * tr)) + xw - 1.);
-      n1_over_ng = line_ptr->gl / gg * z;
 
-      *d1 = dd * n1_over_ng;
-      *d2 = dd * n2_over_ng;
-      n2_over_n1 = n2_over_ng / n1_over_ng;
+/**********************************************************/
+/**
+ * @brief      calculates the densities of the two levels of a line for
+ * a given density of the ion, using the cache of level populations for
+ * the cell while photons are in flight
+ *
+ * @param [in] struct lines *  line_ptr   The line of interest
+ * @param [in] PlasmaPtr  xplasma   The plasma cell of interest
+ * @param [in] double  den_ion   The density of the ion, which need not be
+ * the density stored for the cell
+ * @param [out] double *  d1   The calculated density of the lower level
+ * @param [out] double *  d2   The calculated density of the upper level
+ * @return     The density ratio d2/d1
+ *
+ * @details
+ * This gives the same answer as two_level_atom would if xplasma->density
+ * contained den_ion for the ion, but does not alter xplasma.
+ *
+ * While the photons of a cycle are generated and transported (wind_hot_ok
+ * is TRUE) the conditions in the plasma cells do not change, and so the fractional populations
+ * returned by two_level_fractions are kept and reused.  The cache is a
+ * single table of NTLA_CACHE slots, allocated the first time it is needed,
+ * in which a line of a cell is kept in a slot found from the numbers of the
+ * line and the cell.  Because the lines are ordered in frequency, the lines
+ * which lie within the Doppler width of a photon do not displace one another.
+ * The whole cache is invalidated by tla_cache_reset, which is called from
+ * wind_update, and freed by tla_cache_free when the plasma structure is
+ * reallocated.
+ *
+ * At other times, notably when the temperature of a cell is being
+ * adjusted, the populations are calculated afresh.
+ *
+ **********************************************************/
+
+double
+two_level_atom_den (line_ptr, xplasma, den_ion, d1, d2)
+     struct lines *line_ptr;
+     PlasmaPtr xplasma;
+     double den_ion;
+     double *d1, *d2;
+{
+  double dd, n1_over_dd, n2_over_dd;
+  int nion, nline, n;
+  TlaCachePtr slot;
+
+  nion = line_ptr->nion;
+  dd = den_ion;
+  if (ion[nion].nlevels > 0)
+  {
+    dd *= config[ion[nion].firstlevel].g / xplasma->partition[nion];
+  }
+
+  if (wind_hot_ok)
+  {
+    if (tla_cache == NULL)
+    {
+      if ((tla_cache = (TlaCachePtr) calloc (sizeof (tla_cache_dummy), NTLA_CACHE)) == NULL)
+      {
+        Error ("two_level_atom_den: Error in allocating memory for the cache of level populations\n");
+        Exit (0);
+      }
+      for (n = 0; n < NTLA_CACHE; n++)
+        tla_cache[n].nline = -1;
+      mem_register (MEM_PLASMA, "tla_cache", (double) NTLA_CACHE * sizeof (tla_cache_dummy));
     }
 
+    nline = line_ptr - line;
+    slot = &tla_cache[((unsigned) nline + TLA_CACHE_STRIDE * (unsigned) xplasma->nplasma) & (NTLA_CACHE - 1)];
 
-    old_line_ptr = line_ptr;
-    old_ne = ne;
-    old_te = te;
-    old_w = w;
-    old_tr = tr;
-    old_dd = dd;
-    old_d1 = (*d1);
-    old_d2 = (*d2);
-    old_n2_over_n1 = n2_over_n1;
+    if (slot->nline != nline || slot->nplasma != xplasma->nplasma || slot->ngen != tla_cache_gen)
+    {
+      two_level_fractions (line_ptr, xplasma, &slot->n1_over_dd, &slot->n2_over_dd);
+      slot->nplasma = xplasma->nplasma;
+      slot->nline = nline;
+      slot->ngen = tla_cache_gen;
+    }
+    n1_over_dd = slot->n1_over_dd;
+    n2_over_dd = slot->n2_over_dd;
+  }
+  else
+  {
+    two_level_fractions (line_ptr, xplasma, &n1_over_dd, &n2_over_dd);
   }
 
-  return (old_n2_over_n1);
+  *d1 = dd * n1_over_dd;
+  *d2 = dd * n2_over_dd;
+
+  return (n2_over_dd / n1_over_dd);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Invalidate the cached level populations of all cells
+ *
+ * @return     Always returns 0
+ *
+ * @details
+ * This must be called whenever the conditions in the plasma cells
+ * change, which is to say in wind_update.
+ *
+ **********************************************************/
 
+int
+tla_cache_reset ()
+{
+  tla_cache_gen++;
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Free the cache of level populations
+ *
+ * @return     Always returns 0
+ *
+ * @details
+ * The slots of the cache are identified by the number of the plasma
+ * cell, so the cache is discarded whenever the plasma structure is
+ * reallocated.  It is allocated again the next time it is needed.
+ *
+ **********************************************************/
+
+int
+tla_cache_free ()
+{
+  free (tla_cache);
+  tla_cache = NULL;
+  mem_register (MEM_PLASMA, "tla_cache", 0.0);
+  return (0);
 }
 
 
@@ -693,6 +872,7 @@ line_heat (xplasma, pp, nres)
   x = pp->w * (1. - sf);
   xplasma->heat_lines += x;
   xplasma->heat_tot += x;
+  xplasma->heat2 += x * x;      /* For the error in heat_tot */
 
   // Reduce the weight of the photon bundle
 
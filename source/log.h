@@ -35,9 +35,12 @@ int Error_silent(char *format, ...);
 int Shout(char *format, ...);
 int sane_check(double x);
 int error_count(char *format);
+unsigned int error_hash_value(char *description);
 int error_summary(char *message);
 int error_summary_parallel(char *msg);
+int error_summary_all(char *message);
 int Log_flush(void);
+int log_flush_check(void);
 int Log_set_mpi_rank(int rank, int n_mpi);
 int Log_parallel(char *format, ...);
 int Debug(char *format, ...);
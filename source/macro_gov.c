@@ -66,6 +66,8 @@ macro_gov (p, nres, matom_or_kpkt, which_out)
   /* Beginning of the main loop for processing a macro-atom */
   while (escape == 0)
   {
+    PERF_COUNT (PERF_MACRO_LOOPS);
+
     if (matom_or_kpkt == 1)     //excite a macro atom (either complete or simple)
     {
 
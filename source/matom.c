@@ -134,6 +134,7 @@ matom (p, nres, escape)
   double pjnorm_known[NLEVELS_MACRO], penorm_known[NLEVELS_MACRO];
   int prbs_known[NLEVELS_MACRO];
 
+  PERF_COUNT (PERF_MATOM_CALLS);
 
   for (n = 0; n < NLEVELS_MACRO; n++)
   {
@@ -144,6 +145,7 @@ matom (p, nres, escape)
   one = &wmain[p->grid];        //This is to identify the grid cell in which we are
   xplasma = &plasmamain[one->nplasma];
   check_plasma (xplasma, "matom");
+  xplasma->cost_matom++;
 
   mplasma = &macromain[xplasma->nplasma];
 
@@ -454,6 +456,8 @@ matom (p, nres, escape)
   /* When is gets here either the sum has reached maxjumps: didn't find an emission: this is
      an error and stops the run OR an emission mechanism has been chosen in which case all is well. SS */
 
+  PERF_ADD (PERF_MATOM_JUMPS, njumps);
+
   if (njumps == MAXJUMPS)
   {
     Error ("Matom: jumped %d times with no emission. Abort.\n", MAXJUMPS);
@@ -790,9 +794,12 @@ kpkt (p, nres, escape, mode)
      and so we only have spontaneous recombination to worry about here for ALL cases. */
 
 
+  PERF_COUNT (PERF_KPKT_CALLS);
+
   one = &wmain[p->grid];
   xplasma = &plasmamain[one->nplasma];
   check_plasma (xplasma, "kpkt");
+  xplasma->cost_matom++;
   mplasma = &macromain[xplasma->nplasma];
 
   electron_temperature = xplasma->t_e;
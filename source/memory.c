@@ -0,0 +1,356 @@
+/***********************************************************/
+/** @file  memory.c
+ * @date   October, 2026
+ *
+ * @brief  Routines which keep track of the memory used by
+ * each part of the program, and report it together with the
+ * peak memory used by each process
+ *
+ * The places where the large arrays are allocated, such as
+ * calloc_wind, calloc_plasma, calloc_estimators and spectrum_init,
+ * register the number of bytes they allocate under the name of the
+ * array and the subsystem to which it belongs.  The largest of the arrays
+ * whose sizes are fixed when the program is compiled are registered
+ * by mem_static_init.  mem_report then writes out how much memory each
+ * subsystem is using, and the peak resident memory of each process, so that
+ * the memory needed for each process of a large run can be estimated,
+ * and the arrays responsible for it identified.
+ *
+ * ### Notes ###
+ *
+ * Only the large arrays are registered, so the total registered memory
+ * is somewhat less than the resident memory of the process.  Much of
+ * the memory of the fixed arrays is never touched for small atomic data sets,
+ * and is therefore not resident.
+ *
+ ***********************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "atomic.h"
+#include "python.h"
+#include "models.h"
+
+
+char *mem_subsystem_names[NMEM_SUBSYSTEMS] = {
+  "atomic", "models", "cdf", "wind", "plasma", "photstore", "macro", "photons", "spectra", "reverb"
+};
+
+int mem_file_started = FALSE;   /* Whether the header of the .mem file has been written by this run */
+
+
+
+/**********************************************************/
+/**
+ * @brief      Record the number of bytes allocated to an array
+ *
+ * @param [in] int  subsystem   The subsystem to which the array belongs, one of mem_subsystem_enum
+ * @param [in] char *  name   The name of the array
+ * @param [in] double  bytes   The number of bytes now allocated to the array
+ * @return     The number of arrays which have been registered
+ *
+ * @details
+ * If an array with the same name has already been registered, its size
+ * is replaced, so that an array which is freed and allocated again
+ * is only counted once.  An array which is freed can be registered
+ * with zero bytes.
+ *
+ * ### Notes ###
+ *
+ * For arrays which are allocated separately for each cell, such as
+ * the arrays in plasmamain for each ion, the total over all of the cells
+ * should be registered once.
+ *
+ **********************************************************/
+
+int
+mem_register (subsystem, name, bytes)
+     int subsystem;
+     char *name;
+     double bytes;
+{
+  return (mem_record (subsystem, name, bytes, FALSE));
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Add or update an entry in the registry of memory
+ *
+ * @param [in] int  subsystem   The subsystem to which the array belongs
+ * @param [in] char *  name   The name of the array
+ * @param [in] double  bytes   The number of bytes allocated to the array
+ * @param [in] int  fixed   TRUE if the size of the array is fixed at compile time
+ * @return     The number of arrays which have been registered
+ *
+ * @details
+ * This does the work for mem_register and mem_static_init
+ *
+ **********************************************************/
+
+int
+mem_record (subsystem, name, bytes, fixed)
+     int subsystem;
+     char *name;
+     double bytes;
+     int fixed;
+{
+  int n;
+
+  if (subsystem < 0 || subsystem >= NMEM_SUBSYSTEMS)
+  {
+    Error ("mem_record: Unknown subsystem %d for %s\n", subsystem, name);
+    return (nmem_entries);
+  }
+
+  for (n = 0; n < nmem_entries; n++)
+  {
+    if (strcmp (mem_entries[n].name, name) == 0)
+    {
+      break;
+    }
+  }
+
+  if (n == nmem_entries)
+  {
+    if (nmem_entries == NMEM_ENTRIES)
+    {
+      Error ("mem_record: There are more than %d arrays, so %s was not registered\n", NMEM_ENTRIES, name);
+      return (nmem_entries);
+    }
+    strncpy (mem_entries[n].name, name, LINELENGTH - 1);
+    nmem_entries++;
+  }
+
+  mem_entries[n].subsystem = subsystem;
+  mem_entries[n].fixed = fixed;
+  mem_entries[n].bytes = bytes;
+
+  return (nmem_entries);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Register the largest of the arrays whose size is fixed
+ * when the program is compiled
+ *
+ * @return     The number of arrays which have been registered
+ *
+ * @details
+ * These are mainly the arrays of atomic data which are dimensioned
+ * by NLINES, NLEVELS and NIONS, the models, and the tables of the
+ * surfaces of the Roche lobe and the disk.
+ *
+ * ### Notes ###
+ *
+ * The structures for the elements, ions, levels and lines are allocated
+ * by get_atomic_data, which does not use the rest of python, with sizes
+ * fixed by NELEMENTS, NIONS, NLEVELS and NLINES.  They are registered here,
+ * as allocated arrays, so this routine should be called after the atomic
+ * data have been read.
+ *
+ **********************************************************/
+
+int
+mem_static_init ()
+{
+  mem_record (MEM_ATOMIC, "ele", (double) NELEMENTS * sizeof (ele_dummy), FALSE);
+  mem_record (MEM_ATOMIC, "ion", (double) NIONS * sizeof (ion_dummy), FALSE);
+  mem_record (MEM_ATOMIC, "config", (double) NLEVELS * sizeof (config_dummy), FALSE);
+  mem_record (MEM_ATOMIC, "line", (double) NLINES * sizeof (line_dummy), FALSE);
+  mem_record (MEM_ATOMIC, "phot_top", sizeof (phot_top) + sizeof (phot_top_ptr), TRUE);
+  mem_record (MEM_ATOMIC, "inner_cross", sizeof (inner_cross) + sizeof (inner_cross_ptr), TRUE);
+  mem_record (MEM_ATOMIC, "inner_yields", sizeof (inner_elec_yield) + sizeof (inner_fluor_yield), TRUE);
+  mem_record (MEM_ATOMIC, "coll_stren", sizeof (coll_stren), TRUE);
+  mem_record (MEM_ATOMIC, "lin_ptr", sizeof (lin_ptr), TRUE);
+  mem_record (MEM_ATOMIC, "recomb_data",
+              sizeof (ground_frac) + sizeof (drecomb) + sizeof (total_rr) + sizeof (bad_gs_rr) + sizeof (dere_di_rate) +
+              sizeof (gaunt_total), TRUE);
+  mem_record (MEM_ATOMIC, "freebound", sizeof (freebound) + sizeof (xnrecomb) + sizeof (xninnerrecomb), TRUE);
+  mem_record (MEM_MODELS, "mods", sizeof (mods), TRUE);
+  mem_record (MEM_MODELS, "comp", sizeof (comp), TRUE);
+  mem_record (MEM_WIND, "roche_surf", sizeof (roche_surf), TRUE);
+  mem_record (MEM_WIND, "disk_surf", sizeof (disk_surf), TRUE);
+
+  return (nmem_entries);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Get the peak and current resident memory of this process
+ *
+ * @param [out] double *  rss_peak   The peak resident memory in bytes
+ * @param [out] double *  rss_now   The current resident memory in bytes, or
+ * 0 if this cannot be determined
+ * @return     Always returns 0
+ *
+ * @details
+ * The peak comes from getrusage, the current value from /proc/self/statm, which
+ * only exists on linux.
+ *
+ **********************************************************/
+
+int
+mem_rss (rss_peak, rss_now)
+     double *rss_peak, *rss_now;
+{
+  struct rusage usage;
+  FILE *fptr;
+  long npages_total, npages_resident;
+
+  *rss_peak = *rss_now = 0.0;
+
+  if (getrusage (RUSAGE_SELF, &usage) == 0)
+  {
+#ifdef __APPLE__
+    *rss_peak = usage.ru_maxrss;        /* bytes on macOS */
+#else
+    *rss_peak = 1024. * usage.ru_maxrss;        /* kilobytes on linux */
+#endif
+  }
+
+  if ((fptr = fopen ("/proc/self/statm", "r")) != NULL)
+  {
+    if (fscanf (fptr, "%ld %ld", &npages_total, &npages_resident) == 2)
+    {
+      *rss_now = (double) npages_resident *sysconf (_SC_PAGESIZE);
+    }
+    fclose (fptr);
+  }
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Report the memory used by each subsystem, and the resident
+ * memory of each process
+ *
+ * @param [in] char *  phase   The phase of the calculation, setup, ion or spec
+ * @param [in] int  cycle   The number of the cycle, starting at 0
+ * @return     Always returns 0
+ *
+ * @details
+ * Each process writes the arrays it has registered, and the total for each
+ * subsystem, to its diag file.  The totals and the peak and current resident
+ * memory of every process are gathered to the master process, which writes one
+ * row for each process to the .mem file, with a header line naming the columns
+ * so that it can be read as an astropy table, and logs the largest peak
+ * resident memory of any process.  All of the sizes are in MB.
+ *
+ * ### Notes ###
+ *
+ * This routine must be called by all of the MPI processes.  The .mem
+ * file is begun afresh the first time it is written by a run.
+ *
+ **********************************************************/
+
+int
+mem_report (phase, cycle)
+     char *phase;
+     int cycle;
+{
+  FILE *fptr;
+  double *sendbuf, *recvbuf;
+  double rss_peak, rss_now, mb, peak_max;
+  int nvalues, nranks, nrank, n, nmax;
+
+  nvalues = NMEM_SUBSYSTEMS + 4;
+  nranks = np_mpi_global > 1 ? np_mpi_global : 1;
+
+  sendbuf = calloc (sizeof (double), nvalues);
+  recvbuf = calloc (sizeof (double), nvalues * nranks);
+  if (sendbuf == NULL || recvbuf == NULL)
+  {
+    Error ("mem_report: Could not allocate memory for the reports of %d processes\n", nranks);
+    Exit (1);
+  }
+
+  mem_rss (&rss_peak, &rss_now);
+
+  /* The values are the peak and current resident memory, the memory in fixed and
+     in allocated arrays, and then the total for each subsystem */
+
+  mb = 1. / (1024. * 1024.);
+  sendbuf[0] = rss_peak * mb;
+  sendbuf[1] = rss_now * mb;
+
+  Log_silent ("mem_report: %s %d: the arrays which have been registered are\n", phase, cycle);
+  for (n = 0; n < nmem_entries; n++)
+  {
+    sendbuf[mem_entries[n].fixed ? 2 : 3] += mem_entries[n].bytes * mb;
+    sendbuf[4 + mem_entries[n].subsystem] += mem_entries[n].bytes * mb;
+    Log_silent ("mem_report:   %-10s %-24s %-5s %10.2f MB\n", mem_subsystem_names[mem_entries[n].subsystem],
+                mem_entries[n].name, mem_entries[n].fixed ? "fixed" : "", mem_entries[n].bytes * mb);
+  }
+  for (n = 0; n < NMEM_SUBSYSTEMS; n++)
+  {
+    Log_silent ("mem_report:   %-10s total %10.2f MB\n", mem_subsystem_names[n], sendbuf[4 + n]);
+  }
+  Log_silent ("mem_report: %s %d: fixed %.2f MB allocated %.2f MB resident %.2f MB peak resident %.2f MB\n",
+              phase, cycle, sendbuf[2], sendbuf[3], sendbuf[1], sendbuf[0]);
+
+#ifdef MPI_ON
+  MPI_Gather (sendbuf, nvalues, MPI_DOUBLE, recvbuf, nvalues, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+#else
+  memcpy (recvbuf, sendbuf, nvalues * sizeof (double));
+#endif
+
+  if (rank_global == 0)
+  {
+    peak_max = 0.0;
+    nmax = 0;
+    for (nrank = 0; nrank < nranks; nrank++)
+    {
+      if (recvbuf[nrank * nvalues] > peak_max)
+      {
+        peak_max = recvbuf[nrank * nvalues];
+        nmax = nrank;
+      }
+    }
+    Log ("Memory: %s %d: registered arrays %.1f MB, peak resident memory %.1f MB (process %d of %d)\n",
+         phase, cycle, recvbuf[nmax * nvalues + 2] + recvbuf[nmax * nvalues + 3], peak_max, nmax, nranks);
+
+    if ((fptr = fopen (files.mem, mem_file_started ? "a" : "w")) == NULL)
+    {
+      Error ("mem_report: Unable to open %s\n", files.mem);
+    }
+    else
+    {
+      if (!mem_file_started)
+      {
+        fprintf (fptr, "phase cycle rank rss_peak rss_now fixed allocated");
+        for (n = 0; n < NMEM_SUBSYSTEMS; n++)
+          fprintf (fptr, " %s", mem_subsystem_names[n]);
+        fprintf (fptr, "\n");
+        mem_file_started = TRUE;
+      }
+
+      for (nrank = 0; nrank < nranks; nrank++)
+      {
+        fprintf (fptr, "%s %d %d", phase, cycle, nrank);
+        for (n = 0; n < nvalues; n++)
+          fprintf (fptr, " %.2f", recvbuf[nrank * nvalues + n]);
+        fprintf (fptr, "\n");
+      }
+      fclose (fptr);
+    }
+  }
+
+  free (sendbuf);
+  free (recvbuf);
+
+  return (0);
+}
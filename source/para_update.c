@@ -60,6 +60,8 @@ communicate_estimators_para ()
      for each cell, plus one array of length NXBANDS */
   plasma_int_helpers = (7 + NXBANDS) * NPLASMA;
 
+  PARA_START (PARA_ESTIMATORS);
+
 
   maxfreqhelper = calloc (sizeof (double), NPLASMA);
   maxfreqhelper2 = calloc (sizeof (double), NPLASMA);
@@ -178,6 +180,9 @@ communicate_estimators_para ()
   /* JM 1607 -- send out the qdisk values to all threads */
   MPI_Bcast (qdisk_helper2, NRINGS, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 
+  PARA_BYTES (PARA_ESTIMATORS, sizeof (double) * (3 * plasma_double_helpers + 4 * NPLASMA * NXBANDS + 2 * NPLASMA
+                                                  + 2 * NPLASMA * nions + 2 * NPLASMA * n_inner_tot + 3 * NRINGS));
+
 
   for (mpi_i = 0; mpi_i < NPLASMA; mpi_i++)
   {
@@ -300,6 +305,8 @@ communicate_estimators_para ()
   MPI_Bcast (iredhelper2, plasma_int_helpers, MPI_INT, 0, MPI_COMM_WORLD);
   MPI_Bcast (iqdisk_helper2, NRINGS, MPI_INT, 0, MPI_COMM_WORLD);
 
+  PARA_BYTES (PARA_ESTIMATORS, sizeof (int) * (2 * plasma_int_helpers + 3 * NRINGS));
+
 
   for (mpi_i = 0; mpi_i < NPLASMA; mpi_i++)
   {
@@ -328,6 +335,7 @@ communicate_estimators_para ()
   free (iqdisk_helper);
   free (iqdisk_helper2);
 
+  PARA_STOP (PARA_ESTIMATORS);
 #endif
   return (0);
 }
@@ -359,6 +367,8 @@ gather_spectra_para (nspec_helper, nspecs)
   double *redhelper, *redhelper2;
   int mpi_i, mpi_j;
 
+  PARA_START (PARA_SPECTRA);
+
   redhelper = calloc (sizeof (double), nspec_helper);
   redhelper2 = calloc (sizeof (double), nspec_helper);
 
@@ -376,6 +386,7 @@ gather_spectra_para (nspec_helper, nspecs)
 
   MPI_Reduce (redhelper, redhelper2, nspec_helper, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
   MPI_Bcast (redhelper2, nspec_helper, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  PARA_BYTES (PARA_SPECTRA, 2 * sizeof (double) * nspec_helper);
 
   for (mpi_i = 0; mpi_i < NWAVE; mpi_i++)
   {
@@ -391,6 +402,126 @@ gather_spectra_para (nspec_helper, nspecs)
 
   free (redhelper);
   free (redhelper2);
+
+  PARA_STOP (PARA_SPECTRA);
+#endif
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief sum the counters of the work done in each cell between threads
+ *
+ * @details
+ * The counters cost_steps, cost_lines, cost_matom and cost_extract are
+ * accumulated separately by each thread as it transports its photons.  They
+ * are summed with an MPI_Allreduce, so that every thread, and in particular
+ * the one that writes the windsave file, holds the totals for the cycle.
+ * cost_solve is not summed, since it is communicated by wind_update along
+ * with the rest of the results for each cell.
+ *
+ **********************************************************/
+
+int
+communicate_costs_para ()
+{
+#ifdef MPI_ON                   // these routines should only be called anyway in parallel but we need these to compile
+
+  double *redhelper, *redhelper2;
+  int mpi_i;
+
+  PARA_START (PARA_ESTIMATORS);
+
+  redhelper = calloc (sizeof (double), 4 * NPLASMA);
+  redhelper2 = calloc (sizeof (double), 4 * NPLASMA);
+
+  for (mpi_i = 0; mpi_i < NPLASMA; mpi_i++)
+  {
+    redhelper[mpi_i] = plasmamain[mpi_i].cost_steps;
+    redhelper[mpi_i + NPLASMA] = plasmamain[mpi_i].cost_lines;
+    redhelper[mpi_i + 2 * NPLASMA] = plasmamain[mpi_i].cost_matom;
+    redhelper[mpi_i + 3 * NPLASMA] = plasmamain[mpi_i].cost_extract;
+  }
+
+  MPI_Allreduce (redhelper, redhelper2, 4 * NPLASMA, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  PARA_BYTES (PARA_ESTIMATORS, 4 * sizeof (double) * NPLASMA);
+
+  for (mpi_i = 0; mpi_i < NPLASMA; mpi_i++)
+  {
+    plasmamain[mpi_i].cost_steps = redhelper2[mpi_i];
+    plasmamain[mpi_i].cost_lines = redhelper2[mpi_i + NPLASMA];
+    plasmamain[mpi_i].cost_matom = redhelper2[mpi_i + 2 * NPLASMA];
+    plasmamain[mpi_i].cost_extract = redhelper2[mpi_i + 3 * NPLASMA];
+  }
+
+  free (redhelper);
+  free (redhelper2);
+
+  PARA_STOP (PARA_ESTIMATORS);
+#endif
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief sum the squares of the contributions to the radiation
+ * estimators between threads
+ *
+ * @details
+ * j2, ip2, heat2 and xj2 are accumulated separately by each thread
+ * as it transports its photons, and like the estimators themselves
+ * are summed with an MPI_Allreduce.  They are only needed when the
+ * number of photons is chosen from the errors in the estimators, or
+ * when converged cells keep their solutions, and so are only communicated
+ * in those cases.
+ *
+ **********************************************************/
+
+int
+communicate_noise_para ()
+{
+#ifdef MPI_ON                   // these routines should only be called anyway in parallel but we need these to compile
+
+  double *redhelper, *redhelper2;
+  int mpi_i, i, nsum;
+
+  PARA_START (PARA_ESTIMATORS);
+
+  nsum = 3 + geo.nxfreq;
+  redhelper = calloc (sizeof (double), nsum * NPLASMA);
+  redhelper2 = calloc (sizeof (double), nsum * NPLASMA);
+
+  for (mpi_i = 0; mpi_i < NPLASMA; mpi_i++)
+  {
+    redhelper[mpi_i] = plasmamain[mpi_i].j2;
+    redhelper[mpi_i + NPLASMA] = plasmamain[mpi_i].ip2;
+    redhelper[mpi_i + 2 * NPLASMA] = plasmamain[mpi_i].heat2;
+    for (i = 0; i < geo.nxfreq; i++)
+      redhelper[mpi_i + (3 + i) * NPLASMA] = plasmamain[mpi_i].xj2[i];
+  }
+
+  MPI_Allreduce (redhelper, redhelper2, nsum * NPLASMA, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+  PARA_BYTES (PARA_ESTIMATORS, nsum * sizeof (double) * NPLASMA);
+
+  for (mpi_i = 0; mpi_i < NPLASMA; mpi_i++)
+  {
+    plasmamain[mpi_i].j2 = redhelper2[mpi_i];
+    plasmamain[mpi_i].ip2 = redhelper2[mpi_i + NPLASMA];
+    plasmamain[mpi_i].heat2 = redhelper2[mpi_i + 2 * NPLASMA];
+    for (i = 0; i < geo.nxfreq; i++)
+      plasmamain[mpi_i].xj2[i] = redhelper2[mpi_i + (3 + i) * NPLASMA];
+  }
+
+  free (redhelper);
+  free (redhelper2);
+
+  PARA_STOP (PARA_ESTIMATORS);
 #endif
 
   return (0);
@@ -432,6 +563,7 @@ communicate_matom_estimators_para ()
     return (0);
   }
 
+  PARA_START (PARA_MATOM_ESTIMATORS);
 
 
   /* allocate helper arrays for the estimators we want to communicate */
@@ -541,6 +673,9 @@ communicate_matom_estimators_para ()
   MPI_Bcast (cooling_bf_helper2, NPLASMA * 2 * nphot_total, MPI_DOUBLE, 0, MPI_COMM_WORLD);
   MPI_Bcast (cooling_bb_helper2, NPLASMA * nlines, MPI_DOUBLE, 0, MPI_COMM_WORLD);
 
+  PARA_BYTES (PARA_MATOM_ESTIMATORS, 2 * sizeof (double) * NPLASMA * (7 + nlevels_macro + size_Jbar_est + 4 * size_gamma_est
+                                                                      + 2 * size_alpha_est + 2 * nphot_total + nlines));
+
 
 
 
@@ -623,8 +758,153 @@ communicate_matom_estimators_para ()
   free (alpha_helper2);
   free (cooling_bf_helper2);
   free (cooling_bb_helper2);
+
+  PARA_STOP (PARA_MATOM_ESTIMATORS);
+#endif
+
+
+  return (0);
+}
+
+
+
+char *para_region_names[NPARA_REGIONS] = {
+  "trans_phot", "wait", "estimators", "matom_estimators", "spectra",
+  "wind_solve", "wind_comm", "matom_f", "matom_f_comm"
+};
+
+int para_profile_started = FALSE;       /* Whether the header of the .mpi.csv file has been written by this run */
+
+
+
+/**********************************************************/
+/**
+ * @brief      Set the times and byte counts of the MPI profile to zero at the start of a cycle
+ *
+ * @return     Always returns 0
+ *
+ **********************************************************/
+
+int
+para_profile_reset ()
+{
+  int n;
+
+  for (n = 0; n < NPARA_REGIONS; n++)
+  {
+    para_time[n] = 0.0;
+    para_bytes[n] = 0.0;
+  }
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Summarise how the work of a cycle was balanced between the
+ * MPI processes, and reset the profile
+ *
+ * @param [in] char *  cycle_type   The type of cycle, ion or spec
+ * @param [in] int  cycle   The number of the cycle, starting at 0
+ * @return     Always returns 0
+ *
+ * @details
+ * The time each process spent in each of the regions listed in para_region_enum,
+ * and the number of bytes it passed to MPI there, are gathered to the master
+ * process.  For each region this logs the minimum, mean and maximum time over the
+ * processes, the imbalance (the ratio of the maximum to the mean, which is 1 when
+ * the work is evenly shared), and the total number of bytes, and writes the same
+ * quantities as one row of the .mpi.csv file.
+ *
+ * The time in trans_phot shows how evenly the photons shared the work, and the time
+ * spent waiting at barriers how much this cost.  Comparing the time spent
+ * communicating with that spent transporting photons as the number of processes
+ * changes shows whether it is better to add processes or photons.
+ *
+ * ### Notes ###
+ *
+ * This routine must be called by all of the MPI processes.  It does nothing
+ * unless Python was compiled with MPI_ON.  The byte counts are the sizes of the
+ * buffers handed to MPI, not what was actually sent over the network.
+ *
+ **********************************************************/
+
+int
+para_profile_write (cycle_type, cycle)
+     char *cycle_type;
+     int cycle;
+{
+#ifdef MPI_ON
+  FILE *fptr;
+  double sendbuf[2 * NPARA_REGIONS];
+  double *recvbuf;
+  double t, t_min, t_max, t_sum, bytes;
+  int nrank, n;
+
+  for (n = 0; n < NPARA_REGIONS; n++)
+  {
+    sendbuf[n] = para_time[n];
+    sendbuf[NPARA_REGIONS + n] = para_bytes[n];
+  }
+
+  recvbuf = calloc (sizeof (double), 2 * NPARA_REGIONS * np_mpi_global);
+  if (recvbuf == NULL)
+  {
+    Error ("para_profile_write: Could not allocate memory for the profiles of %d processes\n", np_mpi_global);
+    Exit (1);
+  }
+
+  MPI_Gather (sendbuf, 2 * NPARA_REGIONS, MPI_DOUBLE, recvbuf, 2 * NPARA_REGIONS, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+  if (rank_global == 0)
+  {
+    if ((fptr = fopen (files.mpi_profile, para_profile_started ? "a" : "w")) == NULL)
+    {
+      Error ("para_profile_write: Unable to open %s\n", files.mpi_profile);
+    }
+    else if (!para_profile_started)
+    {
+      fprintf (fptr, "cycle_type,cycle,region,nranks,t_min,t_mean,t_max,imbalance,bytes\n");
+      para_profile_started = TRUE;
+    }
+
+    Log ("MPI profile of %s cycle %d over %d processes\n", cycle_type, cycle, np_mpi_global);
+    Log ("  %-16s %10s %10s %10s %9s %10s\n", "region", "t_min", "t_mean", "t_max", "max/mean", "MBytes");
+
+    for (n = 0; n < NPARA_REGIONS; n++)
+    {
+      t_min = t_max = recvbuf[n];
+      t_sum = bytes = 0.0;
+      for (nrank = 0; nrank < np_mpi_global; nrank++)
+      {
+        t = recvbuf[nrank * 2 * NPARA_REGIONS + n];
+        if (t < t_min)
+          t_min = t;
+        if (t > t_max)
+          t_max = t;
+        t_sum += t;
+        bytes += recvbuf[nrank * 2 * NPARA_REGIONS + NPARA_REGIONS + n];
+      }
+
+      t = t_sum / np_mpi_global;
+      Log ("  %-16s %10.3f %10.3f %10.3f %9.2f %10.2f\n", para_region_names[n], t_min, t, t_max, t > 0 ? t_max / t : 0.0,
+           bytes / 1e6);
+
+      if (fptr != NULL)
+        fprintf (fptr, "%s,%d,%s,%d,%.4f,%.4f,%.4f,%.3f,%.0f\n", cycle_type, cycle, para_region_names[n], np_mpi_global, t_min, t,
+                 t_max, t > 0 ? t_max / t : 0.0, bytes);
+    }
+
+    if (fptr != NULL)
+      fclose (fptr);
+  }
+
+  free (recvbuf);
 #endif
 
+  para_profile_reset ();
 
   return (0);
 }
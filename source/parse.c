@@ -187,6 +187,71 @@ parse_command_line (argc, argv)
         }
         j = i;
       }
+      else if (strcmp (argv[i], "--phot_adapt") == 0)
+      {
+        Log ("The number of photons in ionization cycles will be chosen from the errors in the estimators\n");
+        modes.photon_adaptive = 1;
+        if (!modes.photon_speedup)
+        {
+          PHOT_RANGE = 1.;
+        }
+        PHOT_ERR_TARGET = 0.05;
+        PHOT_ERR_FRAC = 0.9;
+        if (sscanf (argv[i + 1], "%lf", &PHOT_ERR_TARGET) == 1)
+        {
+          i++;
+          if (sscanf (argv[i + 1], "%lf", &PHOT_ERR_FRAC) == 1)
+          {
+            i++;
+          }
+        }
+        if (PHOT_ERR_TARGET <= 0 || PHOT_ERR_FRAC <= 0 || PHOT_ERR_FRAC > 1)
+        {
+          Error ("python: Expected a positive error and a fraction between 0 and 1 after --phot_adapt switch\n");
+          exit (1);
+        }
+        j = i;
+      }
+      else if (strcmp (argv[i], "--freeze_converged") == 0)
+      {
+        modes.freeze_cells = 1;
+        Log ("Converged cells whose estimators change by no more than the noise will keep their solutions\n");
+        j = i;
+      }
+      else if (strcmp (argv[i], "--qmc") == 0)
+      {
+        modes.qmc_launch = 1;
+        Log ("Photons will be launched from the star, disk, wind and AGN with a scrambled Halton sequence\n");
+        j = i;
+      }
+      else if (strcmp (argv[i], "--batch") == 0)
+      {
+        if (sscanf (argv[i + 1], "%d", &NPHOT_BATCH) != 1 || NPHOT_BATCH < 1)
+        {
+          Error ("python: Expected a positive number of photons after --batch switch\n");
+          exit (1);
+        }
+        i++;
+        j = i;
+      }
+      else if (strcmp (argv[i], "--event") == 0)
+      {
+        modes.event_transport = 1;
+        Log ("Photons will be transported in batches with the event based engine\n");
+        j = i;
+      }
+      else if (strcmp (argv[i], "--setup_cache") == 0)
+      {
+        modes.setup_cache = 1;
+        Log ("The volumes and velocity gradients of the wind cells will be cached\n");
+        j = i;
+      }
+      else if (strcmp (argv[i], "--compress_windsave") == 0)
+      {
+        modes.compress_windsave = 1;
+        Log ("Windsave files will be compressed\n");
+        j = i;
+      }
       else if (strcmp (argv[i], "--dry-run") == 0)
       {
         modes.quit_after_inputs = 1;
@@ -271,7 +336,7 @@ help ()
 \n\
 This program simulates radiative transfer in a (biconical) CV, YSO, quasar or (spherical) stellar wind \n\
 \n\
-Usage:  py [-h] [-r] [-t time_max] [-v n] [--dry-run] [-i] [--version] [--rseed] [-p n_steps] xxx  or simply py \n\
+Usage:  py [-h] [-r] [-t time_max] [-v n] [--dry-run] [-i] [--version] [--rseed] [-p n_steps] [--phot_adapt [err [frac]]] [--freeze_converged] [--qmc] [--event] [--batch n] [--setup_cache] [--compress_windsave] xxx  or simply py \n\
 \n\
 where xxx is the rootname or full name of a parameter file, e. g. test.pf \n\
 \n\
@@ -304,6 +369,21 @@ These are largely diagnostic or for special cases. These include\n\
                 Range is in powers of 10, the difference beween the number of photons in the first cycle \n\
                 compared to the last. If range is missing, range is assumed to be 1, in which case the  \n\
                 number of photons will in the first cycle will be one order of magniude less than in the last cycle \n\
+ --phot_adapt [err [frac]]  Choose the number of photons for each ionization cycle from the errors in the estimators \n\
+                of j, ip and the heating in the last cycle, so that the relative error would be below err (by default \n\
+                0.05) in a fraction frac (by default 0.9) of the cells.  The number is kept between the maximum and \n\
+                the minimum which -p would give in the first cycle \n\
+ --freeze_converged  Keep the ionization and temperature of a cell which has converged, rather than solving for \n\
+                them again, while its estimators change by no more than the noise in them \n\
+ --qmc          Take the random numbers which set the positions, directions and frequencies of photons from the \n\
+                star, disk, wind and AGN from a scrambled Halton sequence, which reduces the noise in the spectra \n\
+ --event        Transport photons in batches, one step at a time, with the event based engine, rather than \n\
+                following each photon until it leaves the system before starting the next \n\
+ --batch n      Generate and transport the photons for each cycle in batches of at most n photons per thread, \n\
+                so that the memory needed for photons does not grow with the number of photons per cycle \n\
+ --setup_cache  Save the volumes and velocity gradients of the wind cells to a file whose name depends on the \n\
+                geometry of the wind, and read them from this file in later runs with the same geometry \n\
+ --compress_windsave  Compress the windsave files, by removing the runs of zeros which make up much of them \n\
 \n\
 If one simply types py or pyZZ where ZZ is the version number, one is queried for a name \n\
 of the parameter file and inputs will be requested from the command line. \n\
@@ -191,6 +191,10 @@ wind_paths_init (WindPtr wind)
       wind[i].line_paths[j] = (Wind_Paths_Ptr) wind_paths_constructor (&wind[i]);
     }
   }
+  mem_register (MEM_REVERB, "wind_paths",
+                (double) geo.ndim2 * ((1. + geo.reverb_lines) * (sizeof (wind_paths_dummy) +
+                                                                  4. * geo.reverb_path_bins * (sizeof (double) + sizeof (int))) +
+                                      geo.reverb_lines * sizeof (Wind_Paths_Ptr)));
   return (0);
 }
 
@@ -0,0 +1,172 @@
+/***********************************************************/
+/** @file  perf.c
+ * @date   October, 2026
+ *
+ * @brief  Routines which write out and reset the counters and
+ * timers of the hot paths of the code
+ *
+ * The counters record how often the innermost operations of the
+ * code are carried out, for example the number of steps taken by
+ * photons, the number of resonances examined in calculate_ds, or the
+ * number of jumps made by macro atoms.  The timers record the time spent
+ * in each phase of a cycle.  Together they give a profile of a run
+ * which, unlike one from a build for gprof (make D), does not distort
+ * the routines which are being measured.
+ *
+ * ### Notes ###
+ *
+ * The counters and timers are only compiled in if PERF_COUNTERS is
+ * defined, which is done with make PERF=yes.  Otherwise the macros
+ * PERF_COUNT, PERF_ADD, PERF_START and PERF_STOP, which are defined
+ * in python.h, are empty and these routines do nothing.
+ *
+ ***********************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "atomic.h"
+#include "python.h"
+
+
+char *perf_counter_names[NPERF_COUNTERS] = {
+  "photons", "translate_steps", "res_scanned", "res_interacted", "cont_xsections",
+  "matom_calls", "matom_jumps", "kpkt_calls", "macro_loops", "extract_rays", "extract_cells",
+  "grid_lookups", "grid_searches", "grid_cache_hits", "grid_hint_hits", "te_evals", "compton_evals"
+};
+
+char *perf_timer_names[NPERF_TIMERS] = {
+  "t_define_phot", "t_trans_phot", "t_spectrum_create", "t_communicate", "t_wind_update", "t_output"
+};
+
+double perf_cycle_start = -1.0;         /* The time at which the current cycle began */
+int perf_file_started = FALSE;  /* Whether the header of the .perf file has been written by this run */
+
+
+
+/**********************************************************/
+/**
+ * @brief      Set the counters and timers to zero at the start of a cycle
+ *
+ * @return     Always returns 0
+ *
+ **********************************************************/
+
+int
+perf_reset ()
+{
+#ifdef PERF_COUNTERS
+  int n;
+
+  for (n = 0; n < NPERF_COUNTERS; n++)
+    perf_counter[n] = 0.0;
+  for (n = 0; n < NPERF_TIMERS; n++)
+    perf_timer[n] = 0.0;
+
+  perf_cycle_start = timer ();
+#endif
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Write the counters and timers of all of the MPI processes
+ * to the .perf file at the end of a cycle, and reset them
+ *
+ * @param [in] char *  cycle_type   The type of cycle, ion or spec
+ * @param [in] int  cycle   The number of the cycle, starting at 0
+ * @return     Always returns 0
+ *
+ * @details
+ * The file has a header line giving the names of the columns, and then
+ * one row for each MPI process for each cycle, so that it can be read
+ * as an astropy table.  The columns are the type and number of the cycle,
+ * the rank of the process, the counters, the timers for each phase of the
+ * cycle, and the total time taken by the cycle.
+ *
+ * ### Notes ###
+ *
+ * This routine must be called by all of the MPI processes, since the
+ * counters and timers are gathered to the master process, which writes the file.
+ * The file is begun afresh the first time it is written by a run.
+ *
+ **********************************************************/
+
+int
+perf_write (cycle_type, cycle)
+     char *cycle_type;
+     int cycle;
+{
+#ifdef PERF_COUNTERS
+  FILE *fptr;
+  double *sendbuf, *recvbuf;
+  int nvalues, nranks, nrank, n;
+
+  nvalues = NPERF_COUNTERS + NPERF_TIMERS + 1;
+  nranks = np_mpi_global > 1 ? np_mpi_global : 1;
+
+  sendbuf = calloc (sizeof (double), nvalues);
+  recvbuf = calloc (sizeof (double), nvalues * nranks);
+  if (sendbuf == NULL || recvbuf == NULL)
+  {
+    Error ("perf_write: Could not allocate memory for the counters of %d processes\n", nranks);
+    Exit (1);
+  }
+
+  for (n = 0; n < NPERF_COUNTERS; n++)
+    sendbuf[n] = perf_counter[n];
+  for (n = 0; n < NPERF_TIMERS; n++)
+    sendbuf[NPERF_COUNTERS + n] = perf_timer[n];
+  sendbuf[nvalues - 1] = (perf_cycle_start < 0) ? 0.0 : timer () - perf_cycle_start;
+
+#ifdef MPI_ON
+  MPI_Gather (sendbuf, nvalues, MPI_DOUBLE, recvbuf, nvalues, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+#else
+  memcpy (recvbuf, sendbuf, nvalues * sizeof (double));
+#endif
+
+  if (rank_global == 0)
+  {
+    if ((fptr = fopen (files.perf, perf_file_started ? "a" : "w")) == NULL)
+    {
+      Error ("perf_write: Unable to open %s\n", files.perf);
+    }
+    else
+    {
+      if (!perf_file_started)
+      {
+        fprintf (fptr, "cycle_type cycle rank");
+        for (n = 0; n < NPERF_COUNTERS; n++)
+          fprintf (fptr, " %s", perf_counter_names[n]);
+        for (n = 0; n < NPERF_TIMERS; n++)
+          fprintf (fptr, " %s", perf_timer_names[n]);
+        fprintf (fptr, " t_cycle\n");
+        perf_file_started = TRUE;
+      }
+
+      for (nrank = 0; nrank < nranks; nrank++)
+      {
+        fprintf (fptr, "%s %d %d", cycle_type, cycle, nrank);
+        for (n = 0; n < NPERF_COUNTERS; n++)
+          fprintf (fptr, " %.0f", recvbuf[nrank * nvalues + n]);
+        for (n = NPERF_COUNTERS; n < nvalues; n++)
+          fprintf (fptr, " %.4f", recvbuf[nrank * nvalues + n]);
+        fprintf (fptr, "\n");
+      }
+      fclose (fptr);
+    }
+  }
+
+  free (sendbuf);
+  free (recvbuf);
+#endif
+
+  perf_reset ();
+
+  return (0);
+}
@@ -0,0 +1,221 @@
+/***********************************************************/
+/** @file  phot_budget.c
+ * @date   October, 2026
+ *
+ * @brief  Routines which choose the number of photons for the next
+ * ionization cycle from the Monte Carlo errors in the estimators of
+ * the radiation field in the last one
+ *
+ * With the -p switch the number of photons rises geometrically from
+ * one ionization cycle to the next, however noisy the estimators are.
+ * With --phot_adapt the relative errors in j, ip and heat_tot are
+ * estimated for every cell at the end of each ionization cycle, and the
+ * next cycle is given the number of photons which would bring the error
+ * below PHOT_ERR_TARGET in a fraction PHOT_ERR_FRAC of the cells.
+ *
+ * ### Notes ###
+ *
+ * Each contribution to an estimator, that is each passage of a photon
+ * through a cell, is treated as an independent sample.  This underestimates
+ * the error in cells through which the same photon passes many times, and so
+ * the error is never taken to be less than 1/sqrt(ntot), where ntot is the
+ * number of passages through the cell.
+ *
+ * The errors in the banded estimators xj are logged, but are not used
+ * to choose the number of photons, since the bands which few photons reach
+ * would otherwise always demand the largest number.
+ *
+ ***********************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "atomic.h"
+#include "python.h"
+
+
+double phot_budget_used = 0;    /* The photons transported in the ionization cycles so far, summed over threads */
+double phot_budget_max = 0;     /* The photons which would have been transported in these cycles with NPHOT_MAX */
+
+
+/**********************************************************/
+/**
+ * @brief      the relative error in a Monte Carlo estimator
+ *
+ * @param [in] double  sum   The sum of the contributions to the estimator
+ * @param [in] double  sum2   The sum of the squares of the contributions
+ * @param [in] double  nphot   The number of photons from which the contributions came
+ * @return     The relative error in sum, or VERY_BIG if sum is not positive
+ *
+ * @details
+ * The variance of a sum of contributions from nphot photons is
+ * sum2 - sum**2/nphot, so the relative error is sqrt(sum2/sum**2 - 1/nphot).
+ *
+ **********************************************************/
+
+double
+phot_budget_rel_error (sum, sum2, nphot)
+     double sum, sum2, nphot;
+{
+  double x;
+
+  if (sum <= 0)
+    return (VERY_BIG);
+
+  x = sum2 / (sum * sum) - 1. / nphot;
+
+  return (x > 0 ? sqrt (x) : 0.0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      the relative error in the estimators of the radiation field in a cell
+ *
+ * @param [in] PlasmaPtr  xplasma   The cell
+ * @param [in] double  nphot   The number of photons transported in the cycle, summed over threads
+ * @return     The largest of the relative errors in j, ip and heat_tot
+ *
+ * @details
+ * The errors are found from the sums of the squares of the contributions
+ * to the estimators, j2, ip2 and heat2, and so must be calculated before
+ * wind_update normalises the estimators.  ip is only included if the cell
+ * has seen H-ionizing photons, and heat_tot only if heat2 has been accumulated,
+ * which it is not in macro-atom mode.  A cell which no photon has reached has
+ * an error of VERY_BIG.
+ *
+ **********************************************************/
+
+double
+phot_budget_error (xplasma, nphot)
+     PlasmaPtr xplasma;
+     double nphot;
+{
+  double err, x;
+
+  if (xplasma->ntot == 0)
+    return (VERY_BIG);
+
+  err = 1. / sqrt ((double) xplasma->ntot);
+
+  if ((x = phot_budget_rel_error (xplasma->j, xplasma->j2, nphot)) > err)
+    err = x;
+
+  if (xplasma->ip > 0 && (x = phot_budget_rel_error (xplasma->ip, xplasma->ip2, nphot)) > err)
+    err = x;
+
+  if (xplasma->heat2 > 0 && (x = phot_budget_rel_error (xplasma->heat_tot, xplasma->heat2, nphot)) > err)
+    err = x;
+
+  return (err);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      choose the number of photons for the next ionization cycle
+ *
+ * @param [in] int  nphot   The number of photons per thread transported in the cycle which has just finished
+ * @return     The number of photons per thread for the next ionization cycle
+ *
+ * @details
+ * The error in each cell falls as the square root of the number of photons,
+ * so if the error which is reached in a fraction PHOT_ERR_FRAC of the cells
+ * is err_q, the next cycle needs nphot (err_q/PHOT_ERR_TARGET)**2 photons.
+ * The number is kept between NPHOT_MAX/10**PHOT_RANGE and NPHOT_MAX.
+ *
+ * The errors in the estimators, the number of photons chosen and the error
+ * predicted for it, and the photons transported so far as a fraction of those
+ * which would have been with NPHOT_MAX in every cycle, are logged.
+ *
+ * ### Notes ###
+ *
+ * In parallel runs, j2, ip2, heat2 and xj2 must have been summed over the
+ * threads with communicate_noise_para, so that every thread chooses the same
+ * number of photons.
+ *
+ **********************************************************/
+
+int
+phot_budget_next (nphot)
+     int nphot;
+{
+  double *err;
+  double nphot_tot, nphot_min, x, err_q, scale;
+  int n, i, nq, nband, n_now, n_next, nphot_next;
+
+  nphot_tot = (double) nphot *np_mpi_global;
+  phot_budget_used += nphot_tot;
+  phot_budget_max += (double) NPHOT_MAX *np_mpi_global;
+
+  err = calloc (NPLASMA, sizeof (double));
+
+  n_now = 0;
+  for (n = 0; n < NPLASMA; n++)
+  {
+    err[n] = phot_budget_error (&plasmamain[n], nphot_tot);
+    if (err[n] <= PHOT_ERR_TARGET)
+      n_now++;
+  }
+
+  qsort (err, NPLASMA, sizeof (double), compare_doubles);
+
+  nq = ceil (PHOT_ERR_FRAC * NPLASMA) - 1;
+  if (nq < 0)
+    nq = 0;
+  if (nq > NPLASMA - 1)
+    nq = NPLASMA - 1;
+  err_q = err[nq];
+
+  nphot_min = NPHOT_MAX / pow (10., PHOT_RANGE);
+  if (err_q >= VERY_BIG)
+    x = NPHOT_MAX;
+  else
+    x = nphot * (err_q / PHOT_ERR_TARGET) * (err_q / PHOT_ERR_TARGET);
+
+  if (x < nphot_min)
+    x = nphot_min;
+  if (x > NPHOT_MAX)
+    x = NPHOT_MAX;
+  nphot_next = x;
+
+  scale = sqrt ((double) nphot / nphot_next);
+  n_next = 0;
+  for (n = 0; n < NPLASMA; n++)
+  {
+    if (err[n] * scale <= PHOT_ERR_TARGET)
+      n_next++;
+  }
+
+  Log ("Photon budget: %.2e photons gave an error of %.3g or less in %.0f%% of cells, and below %.3g in %.0f%% of them\n",
+       nphot_tot, err_q, 100. * PHOT_ERR_FRAC, PHOT_ERR_TARGET, 100. * n_now / NPLASMA);
+  Log ("Photon budget: next cycle %.2e photons (%.2f of the maximum), predicted error %.3g, below %.3g in %.0f%% of cells\n",
+       (double) nphot_next * np_mpi_global, (double) nphot_next / NPHOT_MAX, err_q * scale, PHOT_ERR_TARGET, 100. * n_next / NPLASMA);
+  Log ("Photon budget: %.2e photons transported in ionization cycles so far, %.2f of the number with the maximum in every cycle\n",
+       phot_budget_used, phot_budget_used / phot_budget_max);
+
+  /* The median error in each band, over the cells which photons in the band reached */
+
+  for (i = 0; i < geo.nxfreq; i++)
+  {
+    nband = 0;
+    for (n = 0; n < NPLASMA; n++)
+    {
+      if (plasmamain[n].nxtot[i] > 0)
+        err[nband++] = phot_budget_rel_error (plasmamain[n].xj[i], plasmamain[n].xj2[i], nphot_tot);
+    }
+    if (nband > 0)
+    {
+      qsort (err, nband, sizeof (double), compare_doubles);
+      Log_silent ("Photon budget: band %2d %10.3e - %10.3e Hz  %6d cells  median error %.3g\n", i, geo.xfreq[i], geo.xfreq[i + 1], nband,
+                  err[nband / 2]);
+    }
+  }
+
+  free (err);
+
+  return (nphot_next);
+}
@@ -221,7 +221,7 @@ get_matom_f (mode)
 #endif
 
 
-
+    PARA_START (PARA_MATOM_F);
 
     for (n = my_nmin; n < my_nmax; n++)
     {
@@ -431,9 +431,12 @@ get_matom_f (mode)
     }
 
 
+    PARA_STOP (PARA_MATOM_F);
+
     /*This is the end of the update loop that is parallelised. We now need to exchange data between the tasks.
        This is done much the same way as in wind_update */
 #ifdef MPI_ON
+    PARA_START (PARA_MATOM_F_COMM);
 
     /* JM Add an MPI Barrier here */
     MPI_Barrier (MPI_COMM_WORLD);
@@ -468,6 +471,7 @@ get_matom_f (mode)
       MPI_Barrier (MPI_COMM_WORLD);
       MPI_Bcast (commbuffer, size_of_commbuffer, MPI_PACKED, n_mpi, MPI_COMM_WORLD);
       MPI_Barrier (MPI_COMM_WORLD);
+      PARA_BYTES (PARA_MATOM_F_COMM, size_of_commbuffer);
       Log_parallel ("MPI task %d survived broadcasting matom emissivity information.\n", rank_global);
 
 
@@ -492,6 +496,8 @@ get_matom_f (mode)
 
     /* add an MPI Barrier after unpacking stage */
     MPI_Barrier (MPI_COMM_WORLD);
+
+    PARA_STOP (PARA_MATOM_F_COMM);
 #endif
 
   }                             // end of if loop which controls whether to compute the emissivities or not 
@@ -446,13 +446,14 @@ translate_in_wind (w, p, tau_scat, tau, nres)
   int inwind;
 
   WindPtr one;
+  WindHotPtr hot;
   PlasmaPtr xplasma;
 
 
 /* First verify that the photon is in the grid, and if not
 return and record an error */
 
-  if ((p->grid = n = where_in_grid (wmain[p->grid].ndom, p->x)) < 0)
+  if ((p->grid = n = where_in_grid_hint (wmain_hot[p->grid].ndom, p->x, p->grid)) < 0)
   {
 //OLD    if (translate_in_wind_failure < 1000)
 //OLD    {
@@ -465,11 +466,16 @@ return and record an error */
   }
 /* Assign the pointers for the cell containing the photon */
 
-  one = &wmain[n];              /* one is the grid cell where the photon is */
-  nplasma = one->nplasma;
+  hot = &wmain_hot[n];          /* hot is the grid cell where the photon is */
+  nplasma = hot->nplasma;
   xplasma = &plasmamain[nplasma];
-  ndom = one->ndom;
-  inwind = one->inwind;
+  ndom = hot->ndom;
+
+  if (extracting_ray)
+    xplasma->cost_extract++;
+  else
+    xplasma->cost_steps++;
+  inwind = hot->inwind;
 
 
 
@@ -479,7 +485,7 @@ return and record an error */
   {
     return ((int) smax);
   }
-  if (one->inwind == W_PART_INWIND)
+  if (inwind == W_PART_INWIND)
   {                             /* The cell is partially in the wind */
     s = ds_to_wind (p, &ndom_current);  /* smax is set to be the distance to edge of the wind */
     if (s < smax)
@@ -488,14 +494,14 @@ return and record an error */
     if (s > 0 && s < smax)
       smax = s;
   }
-  else if (one->inwind == W_IGNORE)
+  else if (inwind == W_IGNORE)
   {
-    smax += one->dfudge;
+    smax += hot->dfudge;
     move_phot (p, smax);
     return (p->istat);
 
   }
-  else if (one->inwind == W_NOT_INWIND)
+  else if (inwind == W_NOT_INWIND)
   {                             /* The cell is not in the wind at all */
 
     Error ("translate_in_wind: Grid cell %d of photon is not in wind, moving photon %.2e\n", n, smax);
@@ -508,7 +514,7 @@ return and record an error */
 
 /* At this point we now know how far the photon can travel in it's current grid cell */
 
-  smax += one->dfudge;          /* dfudge is to force the photon through the cell boundaries. */
+  smax += hot->dfudge;          /* dfudge is to force the photon through the cell boundaries. */
 
 /* Set limits the distance a photon can travel.  There are
 a good many photons which travel more than this distance without this
@@ -550,7 +556,7 @@ The choice of SMAX_FRAC can affect execution time.*/
      */
 
     one = &w[p->grid];
-    nplasma = one->nplasma;
+    nplasma = wmain_hot[p->grid].nplasma;
     xplasma = &plasmamain[nplasma];
 
     if (geo.ioniz_or_extract == 1)
@@ -778,9 +784,11 @@ walls (p, pold, normal)
       stuff_phot (pold, p);
       move_phot (p, s - DFUDGE);
 
-      /* Finally, we must calculate the normal to the disk at this point */
+      /* Finally, we must calculate the normal to the disk at this point, which is
+       * where the photon hit the disk rather than where it had overshot to */
 
-      theta = atan ((zdisk (r * (1. + EPSILON)) - z) / (EPSILON * r));
+      rho = sqrt (p->x[0] * p->x[0] + p->x[1] * p->x[1]);
+      theta = atan (zdisk_slope (rho));
       phi = atan2 (p->x[0], p->x[1]);
 
       normal[0] = (-cos (phi) * sin (theta));
@@ -800,7 +808,7 @@ walls (p, pold, normal)
   {                             /* Then the photon crossed the xy plane and probably hit the disk */
     s = (-(pold->x[2])) / (pold->lmn[2]);
 
-    if (s < 0 && fabs (pold->x[2]) < wmain[pold->grid].dfudge && pold->lmn[2] * p->lmn[2] < 0.0)
+    if (s < 0 && fabs (pold->x[2]) < wmain_hot[pold->grid].dfudge && pold->lmn[2] * p->lmn[2] < 0.0)
     {
       Error ("walls: Reposition error\n");
       return (p->istat = P_REPOSITION_ERROR);
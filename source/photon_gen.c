@@ -42,6 +42,8 @@ int iwind_old = 0;
  * @param [in] int  iwind   A variable (see below) that controls the generation of phtons for the wind
  * @param [in] int  freq_sampling   If 0, generate photons over the full frequency range without banding,
  * else use banding
+ * @param [in] int  nphot_cycle   The number of photons to be generated on this thread in this cycle
+ * @param [in] int  iphot_first   The position within the cycle of the first photon to be generated by this call
  * @return     Always returns 0
  *
  * @details
@@ -57,6 +59,14 @@ int iwind_old = 0;
  * still used for detailed spectrum calculation. Which of this choices to use is controlled by freq_sampling
  * (The weights are established here)
  *
+ * Photons need not all be generated at once.  A cycle of nphot_cycle photons can
+ * be generated in batches, with each call to define_phot generating the NPHOT
+ * photons which start at position iphot_first in the cycle.  The numbers of photons
+ * assigned to each band, and within a band to each radiation source, are worked out
+ * for the whole cycle, and each batch generates its share of these, so the stratification
+ * is the same however the cycle is divided up.  If nphot_cycle is NPHOT and iphot_first
+ * is 0, all of the photons for the cycle are generated at once.
+ *
  * iwind is a variable that determines how or whether to create photons from the wind:
  * * -1-> Do not consider wind photons under any circumstances
  * * 0  ->Consider wind photons.  There is no need to recalculate the
@@ -72,33 +82,40 @@ int iwind_old = 0;
  **********************************************************/
 
 int
-define_phot (p, f1, f2, nphot_tot, ioniz_or_final, iwind, freq_sampling)
+define_phot (p, f1, f2, nphot_tot, ioniz_or_final, iwind, freq_sampling, nphot_cycle, iphot_first)
      PhotPtr p;
      double f1, f2;
      long nphot_tot;
      int ioniz_or_final;
      int iwind;
      int freq_sampling;         // 0 --> old uniform approach, 1 --> minimum fractions ins various bins
+     int nphot_cycle;           // The number of photons in the whole cycle
+     int iphot_first;           // The position in the cycle of the first photon of this batch
 
 {
   double natural_weight, weight;
   double ftot;
   int n;
   int iphot_start, nphot_rad, nphot_k;
+  int iband_first, nstart, nstop;
   long nphot_tot_rad, nphot_tot_k;
 
+  /* If photons are launched with a Halton sequence, scramble it afresh at the start of each cycle */
+  if (modes.qmc_launch && iphot_first == 0)
+    qmc_init (nphot_cycle);
+
   /* if we are generating nonradiative kpackets, then we need to subtract 
      off the fraction reserved for k-packets */
   if (geo.nonthermal && (geo.rt_mode == RT_MODE_MACRO) && (ioniz_or_final == 0))
   {
-    nphot_k = (geo.frac_extra_kpkts * NPHOT);
-    nphot_rad = NPHOT - nphot_k;
+    nphot_k = (geo.frac_extra_kpkts * nphot_cycle);
+    nphot_rad = nphot_cycle - nphot_k;
     nphot_tot_k = (geo.frac_extra_kpkts * nphot_tot);
     nphot_tot_rad = nphot_tot - nphot_tot_k;
   }
   else
   {
-    nphot_rad = NPHOT;
+    nphot_rad = nphot_cycle;
     nphot_tot_rad = nphot_tot;
   }
 
@@ -119,26 +136,40 @@ define_phot (p, f1, f2, nphot_tot, ioniz_or_final, iwind, freq_sampling)
     for (n = 0; n < NPHOT; n++)
       p[n].path = -1.0;         /* SWM - Zero photon paths */
 
-    xmake_phot (p, f1, f2, ioniz_or_final, iwind, weight, 0, nphot_rad);
+    /* Generate this batch's share of the radiative photons in the cycle */
+
+    nstart = iphot_first;
+    nstop = iphot_first + NPHOT < nphot_rad ? iphot_first + NPHOT : nphot_rad;
+    iphot_start = 0;
+
+    if (nstop > nstart)
+    {
+      xmake_phot (p, f1, f2, ioniz_or_final, iwind, weight, iphot_start, nstop - nstart, nstart, nphot_rad);
+      iphot_start += nstop - nstart;
+    }
   }
   else
   {                             /* Use banding, create photons with different weights in different wavelength
                                    bands.  This is used for the for ionization calculation where one wants to assure
                                    that you have "enough" photons at high energy */
 
-    ftot = populate_bands (ioniz_or_final, iwind, &xband);
+    ftot = populate_bands (ioniz_or_final, iwind, &xband, nphot_rad);
 
     for (n = 0; n < NPHOT; n++)
       p[n].path = -1.0;         /* SWM - Zero photon paths */
 
-    /* Now generate the photons */
+    /* Now generate the photons.  The photons for the bands are laid out one band after 
+       another through the cycle, and this batch generates those that fall within it */
 
     iphot_start = 0;
+    iband_first = 0;
 
     for (n = 0; n < xband.nbands; n++)
     {
+      nstart = iband_first > iphot_first ? iband_first : iphot_first;
+      nstop = iband_first + xband.nphot[n] < iphot_first + NPHOT ? iband_first + xband.nphot[n] : iphot_first + NPHOT;
 
-      if (xband.nphot[n] > 0)
+      if (xband.nphot[n] > 0 && nstop > nstart)
       {
         /* Reinitialization is required here always because we are changing
          * the frequencies around all the time */
@@ -153,10 +184,12 @@ define_phot (p, f1, f2, nphot_tot, ioniz_or_final, iwind, freq_sampling)
 
         geo.weight = (natural_weight) = (ftot) / (nphot_tot_rad);
         xband.weight[n] = weight = natural_weight * xband.nat_fraction[n] / xband.used_fraction[n];
-        xmake_phot (p, xband.f1[n], xband.f2[n], ioniz_or_final, iwind, weight, iphot_start, xband.nphot[n]);
+        xmake_phot (p, xband.f1[n], xband.f2[n], ioniz_or_final, iwind, weight, iphot_start, nstop - nstart, nstart - iband_first,
+                    xband.nphot[n]);
 
-        iphot_start += xband.nphot[n];
+        iphot_start += nstop - nstart;
       }
+      iband_first += xband.nphot[n];
     }
   }
 
@@ -181,8 +214,12 @@ define_phot (p, f1, f2, nphot_tot, ioniz_or_final, iwind, freq_sampling)
     Log ("!! xdefine_phot: total & banded kpkt luminosity due to non-radiative heating: %8.2e %8.2e \n", geo.heat_shock, geo.f_kpkt);
 
 
-    /* generate the actual photons produced by the k-packets */
-    photo_gen_kpkt (p, weight, iphot_start, nphot_k);
+    /* generate the actual photons produced by the k-packets, which come after the radiative
+       photons in the cycle */
+    nstart = iphot_first > nphot_rad ? iphot_first : nphot_rad;
+    nstop = iphot_first + NPHOT;
+    if (nstop > nstart)
+      photo_gen_kpkt (p, weight, iphot_start, nstop - nstart);
   }
 
 
@@ -212,6 +249,7 @@ define_phot (p, f1, f2, nphot_tot, ioniz_or_final, iwind, freq_sampling)
  * @param [in] int  ioniz_or_final   indicate whether this is for an ioniz_or_final
  * @param [in] int  iwind   indicates where wind photons are created
  * @param [in,out] struct xbands *  band   is a pointer to the band sturctue where everythin is
+ * @param [in] int  nphot_rad   The number of photons in the cycle, less any reserved for k-packets
  * @return     ftot which is the sum of the band limited luminosities
  *
  * @details
@@ -228,24 +266,19 @@ define_phot (p, f1, f2, nphot_tot, ioniz_or_final, iwind, freq_sampling)
  **********************************************************/
 
 double
-populate_bands (ioniz_or_final, iwind, band)
+populate_bands (ioniz_or_final, iwind, band, nphot_rad)
      int ioniz_or_final;
      int iwind;
      struct xbands *band;
+     int nphot_rad;
 
 {
   double ftot, frac_used, z;
-  int n, nphot, most, nphot_rad;
+  int n, nphot, most;
 
   /* Get all of the band limited luminosities */
   ftot = 0.0;
 
-  /* this is the number of photons minus the number reserved for k-packets */
-  if (geo.nonthermal && (geo.rt_mode == RT_MODE_MACRO))
-    nphot_rad = NPHOT - (geo.frac_extra_kpkts * NPHOT);
-  else
-    nphot_rad = NPHOT;
-
   for (n = 0; n < band->nbands; n++)    // Now get the band limited luminosities
   {
     if (band->f1[n] < band->f2[n])
@@ -287,7 +320,7 @@ populate_bands (ioniz_or_final, iwind, band)
     }
   }
 
-  /* Because of roundoff errors nphot may not sum to the desired value, namely NPHOT less kpackets.  
+  /* Because of roundoff errors nphot may not sum to the desired value, namely nphot_rad.  
      So add a few more photons to the band with most photons already. It should only be a few, at most
      one photon for each band. */
 
@@ -486,6 +519,43 @@ phot_status ()
 }
 
 
+/**********************************************************/
+/**
+ * @brief      Find how many of the photons from one source fall within a batch
+ *
+ * @param [in, out] int *  ifirst   The position of the first photon from this source; on
+ * return, the position of the first photon from the next source
+ * @param [in] int  n   The number of photons from this source
+ * @param [in] int  istart   The position of the first photon in the batch
+ * @param [in] int  nphot   The number of photons in the batch
+ * @return     The number of photons from the source which are in the batch
+ *
+ * @details
+ * Photons from different sources (or bands) are laid out one after another
+ * through a cycle, and a batch is a contiguous part of the cycle, so the number
+ * of photons a batch has to generate from a source is just the overlap
+ * of the two ranges.
+ *
+ * ### Notes ###
+ *
+ **********************************************************/
+
+int
+batch_share (ifirst, n, istart, nphot)
+     int *ifirst;
+     int n, istart, nphot;
+{
+  int nlo, nhi;
+
+  nlo = *ifirst > istart ? *ifirst : istart;
+  nhi = *ifirst + n < istart + nphot ? *ifirst + n : istart + nphot;
+  *ifirst += n;
+
+  return (nhi > nlo ? nhi - nlo : 0);
+}
+
+
+
 /**********************************************************/
 /**
  * @brief      just makes photons (in a particular wavelength range for
@@ -500,6 +570,8 @@ phot_status ()
  * @param [in] double  weight   The weight of photons to generate
  * @param [in] int  iphot_start   The position in the photon structure to start storing photons
  * @param [in] int  nphotons   The number of photons to generate
+ * @param [in] int  iphot_band   The position of the first of these photons among all those for this band in this cycle
+ * @param [in] int  nphot_band   The number of photons to be generated for this band in the whole cycle
  * @return     Always returns 0
  *
  * @details
@@ -509,12 +581,17 @@ phot_status ()
  * wind, and creates photons for each, using the ratio of the band limited luminosites to the
  * total band limited luminosity to determine how many photons to select from each source.
  *
+ * The number of photons from each source is worked out for all nphot_band photons for the
+ * band in the cycle.  The sources are laid out one after another in the order in which they are
+ * generated, and this call generates those that fall within the nphotons photons starting
+ * at iphot_band.
+ *
  * ### Notes ###
  *
  **********************************************************/
 
 int
-xmake_phot (p, f1, f2, ioniz_or_final, iwind, weight, iphot_start, nphotons)
+xmake_phot (p, f1, f2, ioniz_or_final, iwind, weight, iphot_start, nphotons, iphot_band, nphot_band)
      PhotPtr p;
      double f1, f2;
      int ioniz_or_final;
@@ -522,10 +599,13 @@ xmake_phot (p, f1, f2, ioniz_or_final, iwind, weight, iphot_start, nphotons)
      double weight;
      int iphot_start;           //The place to begin putting photons in the photon structure in this call
      int nphotons;              //The total number of photons to generate in this call
+     int iphot_band;            //The position of the first photon of this call among those for the band
+     int nphot_band;            //The number of photons for the band in the whole cycle
 {
 
   int nphot, nn;
   int nstar, nbl, nwind, ndisk, nmatom, nagn, nkpkt;
+  int isource_first;
   double agn_f1;
 
   nstar = nbl = nwind = ndisk = 0;
@@ -533,50 +613,61 @@ xmake_phot (p, f1, f2, ioniz_or_final, iwind, weight, iphot_start, nphotons)
 
   if (geo.star_radiation)
   {
-    nstar = geo.f_star / geo.f_tot * nphotons;
+    nstar = geo.f_star / geo.f_tot * nphot_band;
   }
   if (geo.bl_radiation)
   {
-    nbl = geo.f_bl / geo.f_tot * nphotons;
+    nbl = geo.f_bl / geo.f_tot * nphot_band;
   }
   if (iwind >= 0)
   {
-    nwind = geo.f_wind / geo.f_tot * nphotons;
+    nwind = geo.f_wind / geo.f_tot * nphot_band;
   }
   if (geo.disk_radiation)
   {
-    ndisk = geo.f_disk / geo.f_tot * nphotons;  /* Ensure that nphot photons are created */
+    ndisk = geo.f_disk / geo.f_tot * nphot_band;        /* Ensure that nphot photons are created */
   }
   if (geo.agn_radiation)
   {
-    nagn = geo.f_agn / geo.f_tot * nphotons;    /* Ensure that nphot photons are created */
+    nagn = geo.f_agn / geo.f_tot * nphot_band;  /* Ensure that nphot photons are created */
   }
   if (geo.matom_radiation || geo.nonthermal)
   {
-    nkpkt = geo.f_kpkt / geo.f_tot * nphotons;
+    nkpkt = geo.f_kpkt / geo.f_tot * nphot_band;
 
     if (geo.matom_radiation)
-      nmatom = geo.f_matom / geo.f_tot * nphotons;
+      nmatom = geo.f_matom / geo.f_tot * nphot_band;
   }
 
 
   nphot = ndisk + nwind + nbl + nstar + nagn + nkpkt + nmatom;
 
-  if (nphot < nphotons)
+  if (nphot < nphot_band)
   {
     if (ndisk > 0)
-      ndisk += (nphotons - nphot);
+      ndisk += (nphot_band - nphot);
     else if (nwind > 0)
-      nwind += (nphotons - nphot);
+      nwind += (nphot_band - nphot);
     else if (nbl > 0)
-      nbl += (nphotons - nphot);
+      nbl += (nphot_band - nphot);
     else if (nagn > 0)
-      nagn += (nphotons - nphot);
+      nagn += (nphot_band - nphot);
     else
-      nstar += (nphotons - nphot);
+      nstar += (nphot_band - nphot);
   }
 
 
+  /* Now find how many photons from each source fall within the part of the band being generated here */
+
+  isource_first = 0;
+  nstar = batch_share (&isource_first, nstar, iphot_band, nphotons);
+  nbl = batch_share (&isource_first, nbl, iphot_band, nphotons);
+  nwind = batch_share (&isource_first, nwind, iphot_band, nphotons);
+  ndisk = batch_share (&isource_first, ndisk, iphot_band, nphotons);
+  nagn = batch_share (&isource_first, nagn, iphot_band, nphotons);
+  nkpkt = batch_share (&isource_first, nkpkt, iphot_band, nphotons);
+  nmatom = batch_share (&isource_first, nmatom, iphot_band, nphotons);
+
   Log
     ("photon_gen: band %6.2e to %6.2e weight %6.2e nphotons %8d ndisk %7d nwind %7d nstar %7d npow %d \n",
      f1, f2, weight, nphotons, ndisk, nwind, nstar, nagn);
@@ -849,6 +940,8 @@ photo_gen_star (p, r, t, weight, f1, f2, spectype, istart, nphot)
     p[i].nres = -1;             // It's a continuum photon
     p[i].nnscat = 1;
 
+    qmc_start (QMC_STAR);
+
     if (spectype == SPECTYPE_BB)
     {
       p[i].freq = planck (t, freqmin, freqmax);
@@ -869,6 +962,7 @@ photo_gen_star (p, r, t, weight, f1, f2, spectype, istart, nphot)
       Error_silent ("photo_gen_star: phot no. %d freq %g out of range %g %g\n", i, p[i].freq, freqmin, freqmax);
     }
 
+    qmc_skip (QMC_STAR_POS);
     randvec (p[i].x, r);
 
     if (geo.disk_type == DISK_VERTICALLY_EXTENDED)
@@ -886,7 +980,9 @@ photo_gen_star (p, r, t, weight, f1, f2, spectype, istart, nphot)
       }
     }
 
+    qmc_skip (QMC_STAR_DIR);
     randvcos (p[i].lmn, p[i].x);
+    qmc_stop ();
   }
   return (0);
 }
@@ -1141,9 +1237,19 @@ disk_init (rmin, rmax, m, mdot, freqmin, freqmax, ioniz_or_final, ftot)
  * @return     Always returns 0
  *
  * @details
+ * The rings into which the disk is divided each emit the same luminosity in
+ * the band of interest, so the number of photons generated in each ring is first drawn
+ * from a multinomial distribution with equal probabilities.  The photons for
+ * each ring are then generated together.
  *
  * ### Notes ###
  *
+ * Generating the photons ring by ring means that successive calls to planck
+ * or one_continuum are for the same temperature and gravity, so that
+ * the limits of the cdf (for planck) or the cdf itself (for one_continuum),
+ * which these routines save from one call to the next, are
+ * calculated once for each ring rather than once for each photon.
+ *
  **********************************************************/
 
 int
@@ -1157,10 +1263,11 @@ photo_gen_disk (p, weight, f1, f2, spectype, istart, nphot)
 
   double freqmin, freqmax;
   int i, iend;
-  double planck ();
-  double t, r, z, theta, phi;
   int nring;
-  double north[3], v[3];
+  static double ring_prob[NRINGS - 1];
+  unsigned int ring_count[NRINGS - 1];
+  unsigned int k;
+
   if ((iend = istart + nphot) > NPHOT)
   {
     Error ("photo_gen_disk: iend %d > NPHOT %d\n", iend, NPHOT);
@@ -1174,115 +1281,150 @@ photo_gen_disk (p, weight, f1, f2, spectype, istart, nphot)
   Log_silent ("photo_gen_disk creates nphot %5d photons from %5d to %5d \n", nphot, istart, iend);
   freqmin = f1;
   freqmax = f2;
-  for (i = istart; i < iend; i++)
-  {
-    p[i].origin = PTYPE_DISK;   // identify this as a disk photon
-    p[i].w = weight;
-    p[i].istat = p[i].nscat = p[i].nrscat = 0;
-    p[i].tau = 0;
-    p[i].nres = -1;             // It's a continuum photon
-    p[i].nnscat = 1;
-    if (geo.reverb_disk == REV_DISK_UNCORRELATED)
-      p[i].path = 0;            //If we're assuming disk photons are uncorrelated, leave them at 0
 
 /* The ring boundaries are defined so that an equal number of photons are
- * generated in each ring.  Howver, there is a possibility that the number
- * of photons to be generated is small, and therefore we, we still randomly
- * generate photon.  04march -- ksl
+ * generated in each ring.  However, there is a possibility that the number
+ * of photons to be generated is small, and therefore we still randomly
+ * assign photons to rings.  04march -- ksl
  */
 
-    nring = random_number (0.0, 1.0) * (NRINGS - 1);
-
+  if (ring_prob[0] == 0)
+  {
+    for (nring = 0; nring < NRINGS - 1; nring++)
+      ring_prob[nring] = 1.0;
+  }
+  random_multinomial (NRINGS - 1, nphot, ring_prob, ring_count);
 
-    if ((nring < 0) || (nring > NRINGS - 2))
+  i = istart;
+  for (nring = 0; nring < NRINGS - 1; nring++)
+  {
+    disk.nphot[nring] += ring_count[nring];
+    for (k = 0; k < ring_count[nring]; k++, i++)
     {
-      Error ("photon_gen: photon launch out of bounds. nring = %d\n", nring);
-      Exit (0);
+      qmc_start (QMC_DISK);
+      photo_gen_disk_one (&p[i], weight, nring, spectype, freqmin, freqmax);
+      qmc_stop ();
     }
+  }
 
-    disk.nphot[nring]++;
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Generate a single photon from one ring of the disk
+ *
+ * @param [out] PhotPtr  p   The photon to generate
+ * @param [in] double  weight   The weight of the photon
+ * @param [in] int  nring   The ring from which the photon is to be emitted
+ * @param [in] int  spectype   The spectrum type to generate
+ * @param [in] double  freqmin   The minimum frequency
+ * @param [in] double  freqmax   The maxnimum frequency
+ * @return     Always returns 0
+ *
+ * @details
+ * The photon is emitted from a random position in the ring, in a random direction
+ * from the upper or lower surface of the disk, with a frequency drawn from the
+ * spectrum of the ring, which is then Doppler shifted by the motion of the disk.
+ *
+ **********************************************************/
+
+int
+photo_gen_disk_one (p, weight, nring, spectype, freqmin, freqmax)
+     PhotPtr p;
+     double weight;
+     int nring;
+     int spectype;
+     double freqmin, freqmax;
+{
+  double planck ();
+  double t, r, z, theta, phi;
+  double north[3], v[3];
+
+  p->origin = PTYPE_DISK;       // identify this as a disk photon
+  p->w = weight;
+  p->istat = p->nscat = p->nrscat = 0;
+  p->tau = 0;
+  p->nres = -1;                 // It's a continuum photon
+  p->nnscat = 1;
+  if (geo.reverb_disk == REV_DISK_UNCORRELATED)
+    p->path = 0;                //If we're assuming disk photons are uncorrelated, leave them at 0
 
 /* The next line is really valid only if dr is small.  Otherwise one
  * should account for the area.  But haven't fixed this yet ?? 04Dec
  */
 
-    r = disk.r[nring] + (disk.r[nring + 1] - disk.r[nring]) * random_number (0.0, 1.0);
-
-    /* Generate a photon in the plane of the disk a distance r */
+  r = disk.r[nring] + (disk.r[nring + 1] - disk.r[nring]) * random_number (0.0, 1.0);
 
+  /* Generate a photon in the plane of the disk a distance r */
 
-    phi = 2. * PI * random_number (0.0, 1.0);
 
-    p[i].x[0] = r * cos (phi);
-    p[i].x[1] = r * sin (phi);
+  phi = 2. * PI * random_number (0.0, 1.0);
 
+  p->x[0] = r * cos (phi);
+  p->x[1] = r * sin (phi);
 
-    z = 0.0;
-    north[0] = 0;
-    north[1] = 0;
-    north[2] = 1;
 
-    /* Correct photon direction of a vertically extended disk
-     */
+  z = 0.0;
+  north[0] = 0;
+  north[1] = 0;
+  north[2] = 1;
 
-    if (geo.disk_type == DISK_VERTICALLY_EXTENDED)
-    {
-      if (r == 0)
-        theta = 0;
-      else
-      {
-        z = zdisk (r);
-        theta = atan ((zdisk (r * (1. + EPSILON)) - z) / (EPSILON * r));
-      }
-      north[0] = (-cos (phi) * sin (theta));
-      north[1] = (-sin (phi) * sin (theta));
-      north[2] = cos (theta);
-
-    }
+  /* Correct photon direction of a vertically extended disk
+   */
 
-    if (random_number (-0.5, 0.5) > 0.0)        //Get a uniform random number brtween -0.5 and 0.5- use sign to toss a coin.
-    {                           /* Then the photon emerges in the upper hemisphere */
-      p[i].x[2] = (z + EPSILON);
-    }
-    else
-    {
-      p[i].x[2] = -(z + EPSILON);
-      north[2] *= -1;
-    }
-    randvcos (p[i].lmn, north);
+  if (geo.disk_type == DISK_VERTICALLY_EXTENDED)
+  {
+    z = zdisk (r);
+    theta = atan (zdisk_slope (r));
+    north[0] = (-cos (phi) * sin (theta));
+    north[1] = (-sin (phi) * sin (theta));
+    north[2] = cos (theta);
 
-    /* Note that the next bit of code is almost duplicated in photo_gen_star.  It's
-     * possilbe this should be collected into a single routine   080518 -ksl
-     */
+  }
 
-    if (spectype == SPECTYPE_BB)
-    {
-      t = disk.t[nring];
-      p[i].freq = planck (t, freqmin, freqmax);
-    }
-    else if (spectype == SPECTYPE_UNIFORM)
-    {                           //Produce a uniform distribution of frequencies
+  if (random_number (-0.5, 0.5) > 0.0)  //Get a uniform random number brtween -0.5 and 0.5- use sign to toss a coin.
+  {                             /* Then the photon emerges in the upper hemisphere */
+    p->x[2] = (z + EPSILON);
+  }
+  else
+  {
+    p->x[2] = -(z + EPSILON);
+    north[2] *= -1;
+  }
+  randvcos (p->lmn, north);
 
-      p[i].freq = random_number (freqmin, freqmax);     //Get a random frequency between fmin and fmax (exluding the ends)
-    }
+  /* Note that the next bit of code is almost duplicated in photo_gen_star.  It's
+   * possilbe this should be collected into a single routine   080518 -ksl
+   */
 
-    else
-    {                           /* Then we will use a model which was read in */
-      p[i].freq = one_continuum (spectype, disk.t[nring], log10 (disk.g[nring]), freqmin, freqmax);
-    }
+  if (spectype == SPECTYPE_BB)
+  {
+    t = disk.t[nring];
+    p->freq = planck (t, freqmin, freqmax);
+  }
+  else if (spectype == SPECTYPE_UNIFORM)
+  {                             //Produce a uniform distribution of frequencies
 
-    if (p[i].freq < freqmin || freqmax < p[i].freq)
-    {
-      Error_silent ("photo_gen_disk: phot no. %d freq %g out of range %g %g\n", i, p[i].freq, freqmin, freqmax);
-    }
-    /* Now Doppler shift this. Use convention of dividing when going from rest
-       to moving frame */
+    p->freq = random_number (freqmin, freqmax); //Get a random frequency between fmin and fmax (exluding the ends)
+  }
 
-    vdisk (p[i].x, v);
-    p[i].freq /= (1. - dot (v, p[i].lmn) / VLIGHT);
+  else
+  {                             /* Then we will use a model which was read in */
+    p->freq = one_continuum (spectype, disk.t[nring], log10 (disk.g[nring]), freqmin, freqmax);
+  }
 
+  if (p->freq < freqmin || freqmax < p->freq)
+  {
+    Error_silent ("photo_gen_disk: ring %d freq %g out of range %g %g\n", nring, p->freq, freqmin, freqmax);
   }
+  /* Now Doppler shift this. Use convention of dividing when going from rest
+     to moving frame */
 
+  vdisk (p->x, v);
+  p->freq /= (1. - dot (v, p->lmn) / VLIGHT);
 
   return (0);
 }
@@ -0,0 +1,876 @@
+/***********************************************************/
+/** @file  py_bench.c
+ * @date   October, 2026
+ *
+ * @brief  A standalone routine which times the kernels that dominate
+ * the run time of Python, using the wind of a completed model
+ *
+ * This routine is run from the command line, as follows
+ *
+ * py_bench [-n ncalls] [-p nphot] [-s seed] [-k kernel] rootname
+ *
+ * where rootname is the rootname of a windsave file.  If the
+ * spec_save file of the same run exists it is also read, so that the
+ * extraction of photons into the observer spectra can be timed.
+ *
+ * The routine creates a set of photon states within the cells of the
+ * wind, and then calls each kernel repeatedly for these states, recording
+ * the time per call, the number of calls per second, and a checksum formed
+ * from the values the kernel returns.  The random number generator is
+ * restarted with the same seed before each kernel, so that the checksums
+ * are reproducible and so can be used to check that a change which was
+ * meant to make a kernel faster has not changed its results.
+ *
+ * ### Notes ###
+ *
+ * The photons which were actually followed when the model was run are
+ * not saved, so the photon states are drawn from the wind itself: each
+ * photon is placed at the centre of a cell which is entirely in the wind,
+ * rotated by a random azimuth, with a random direction and a frequency
+ * which is uniform in log between BENCH_FMIN and BENCH_FMAX.
+ *
+ * Some of the kernels modify the plasma structure, so the checksums are
+ * only comparable between runs which time the same set of kernels.
+ *
+ ***********************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/time.h>
+
+#include "atomic.h"
+#include "python.h"
+
+
+#define BENCH_FMIN      1.e14   /* The range of frequencies of the photon states */
+#define BENCH_FMAX      1.e17
+#define BENCH_SEED      1084515760
+
+/* The requirements which a model must meet for a kernel to be timed */
+
+enum bench_require_enum
+{
+  BENCH_ALL = 0,                /* The kernel can be timed for any model */
+  BENCH_MACRO = 1,              /* The kernel needs macro atoms */
+  BENCH_SPEC = 2,               /* The kernel needs the spectra from the spec_save file */
+  BENCH_DOMAIN = 3              /* The kernel is timed separately for each domain */
+};
+
+/* The kernels which are timed.  Each is called with the number of a photon state, and returns
+   a value which is added to the checksum.  Kernels which are expensive are called fewer times,
+   by the factor given in the last column */
+
+struct bench_kernel
+{
+  char *name;
+  double (*func) (int i);
+  int require;
+  int divisor;
+} bench_kernels[] = {
+  {"calculate_ds", bench_calculate_ds, BENCH_ALL, 1},
+  {"radiation", bench_radiation, BENCH_ALL, 1},
+  {"sigma_phot", bench_sigma_phot, BENCH_ALL, 1},
+  {"kappa_bf", bench_kappa_bf, BENCH_ALL, 10},
+  {"sobolev", bench_sobolev, BENCH_ALL, 1},
+  {"two_level_atom", bench_two_level_atom, BENCH_ALL, 1},
+  {"where_in_grid", bench_where_in_grid, BENCH_DOMAIN, 1},
+  {"ds_in_cell", bench_ds_in_cell, BENCH_DOMAIN, 1},
+  {"vwind_xyz", bench_vwind_xyz, BENCH_ALL, 1},
+  {"dvwind_ds", bench_dvwind_ds, BENCH_ALL, 1},
+  {"cdf_get_rand", bench_cdf_get_rand, BENCH_ALL, 1},
+  {"planck", bench_planck, BENCH_ALL, 1},
+  {"compton_dir", bench_compton_dir, BENCH_ALL, 1},
+  {"kpkt", bench_kpkt, BENCH_MACRO, 10},
+  {"matom", bench_matom, BENCH_MACRO, 10},
+  {"extract_one", bench_extract_one, BENCH_SPEC, 100},
+  {"matrix_ion_populations", bench_matrix_ion_populations, BENCH_ALL, 10000},
+};
+
+#define NBENCH_KERNELS (sizeof (bench_kernels) / sizeof (struct bench_kernel))
+
+char *bench_coord_names[] = { "spherical", "cylindrical", "rtheta", "cylvar" };
+
+/* The photon states, and the quantities for each which some of the kernels need */
+
+int bench_nphot;
+PhotPtr bench_phot;
+double *bench_smax;             /* The distance to the edge of the cell */
+double *bench_tau_scat;         /* The optical depth to the next scatter */
+double *bench_dvds;             /* The velocity gradient along the direction of the photon */
+int *bench_line;                /* A randomly chosen line which is not part of a macro atom, an index into lin_ptr */
+int *bench_order;               /* The photon states ordered by domain */
+int bench_dom_start[MaxDom + 1];        /* The first element of bench_order for each domain */
+int bench_ndom;                 /* The domain for which a BENCH_DOMAIN kernel is being timed */
+
+int *bench_macro_line;          /* The lines, as indices into lin_ptr, which belong to macro atoms */
+int bench_nmacro_line;
+int *bench_simple_line;         /* The lines, as indices into lin_ptr, which do not */
+int bench_nsimple_line;
+
+double *bench_density, *bench_partition, *bench_levden;
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the kernel which finds the distance to the next interaction
+ *
+ * @param [in] int  i   The photon state
+ * @return     The optical depth accumulated along the path
+ *
+ **********************************************************/
+
+double
+bench_calculate_ds (int i)
+{
+  struct photon pp;
+  double tau;
+  int nres, istat;
+
+  stuff_phot (&bench_phot[i], &pp);
+  tau = 0.0;
+  istat = P_INWIND;
+  calculate_ds (wmain, &pp, bench_tau_scat[i], &tau, &nres, bench_smax[i], &istat);
+  return (tau);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the kernel which reduces the weight of a photon and
+ * records the radiation field estimators along a path
+ *
+ * @param [in] int  i   The photon state
+ * @return     The weight of the photon at the end of the path
+ *
+ **********************************************************/
+
+double
+bench_radiation (int i)
+{
+  struct photon pp;
+
+  stuff_phot (&bench_phot[i], &pp);
+  radiation (&pp, bench_smax[i]);
+  return (pp.w);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the photoionization cross section
+ *
+ * @param [in] int  i   The photon state
+ * @return     The cross section
+ *
+ * @details
+ * The cross sections are used in turn, at a frequency up to a factor
+ * of two above the threshold.
+ *
+ **********************************************************/
+
+double
+bench_sigma_phot (int i)
+{
+  struct topbase_phot *x_ptr;
+
+  if (nphot_total == 0)
+    return (0.0);
+
+  x_ptr = &phot_top[i % nphot_total];
+  return (sigma_phot (x_ptr, x_ptr->freq[0] * (1. + bench_phot[i].lmn[0] * bench_phot[i].lmn[0])));
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the bound free opacity
+ *
+ * @param [in] int  i   The photon state
+ * @return     The opacity
+ *
+ **********************************************************/
+
+double
+bench_kappa_bf (int i)
+{
+  return (kappa_bf (&plasmamain[wmain[bench_phot[i].grid].nplasma], bench_phot[i].freq, 0));
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the Sobolev optical depth of a line
+ *
+ * @param [in] int  i   The photon state
+ * @return     The optical depth
+ *
+ **********************************************************/
+
+double
+bench_sobolev (int i)
+{
+  return (sobolev (&wmain[bench_phot[i].grid], bench_phot[i].x, -1.0, lin_ptr[bench_line[i]], bench_dvds[i]));
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the two level atom approximation for the populations of a line
+ *
+ * @param [in] int  i   The photon state
+ * @return     The ratio of the upper to the lower level densities
+ *
+ **********************************************************/
+
+double
+bench_two_level_atom (int i)
+{
+  double d1, d2;
+
+  return (two_level_atom (lin_ptr[bench_line[i]], &plasmamain[wmain[bench_phot[i].grid].nplasma], &d1, &d2));
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the search for the cell which contains a position
+ *
+ * @param [in] int  i   The photon state
+ * @return     The cell
+ *
+ **********************************************************/
+
+double
+bench_where_in_grid (int i)
+{
+  return (where_in_grid (bench_ndom, bench_phot[i].x));
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the distance to the edge of a cell
+ *
+ * @param [in] int  i   The photon state
+ * @return     The distance
+ *
+ **********************************************************/
+
+double
+bench_ds_in_cell (int i)
+{
+  struct photon pp;
+
+  stuff_phot (&bench_phot[i], &pp);
+  return (ds_in_cell (bench_ndom, &pp));
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the velocity of the wind at a position
+ *
+ * @param [in] int  i   The photon state
+ * @return     The sum of the components of the velocity
+ *
+ **********************************************************/
+
+double
+bench_vwind_xyz (int i)
+{
+  double v[3];
+
+  vwind_xyz (wmain[bench_phot[i].grid].ndom, &bench_phot[i], v);
+  return (v[0] + v[1] + v[2]);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the velocity gradient along the direction of a photon
+ *
+ * @param [in] int  i   The photon state
+ * @return     The velocity gradient
+ *
+ **********************************************************/
+
+double
+bench_dvwind_ds (int i)
+{
+  return (dvwind_ds (&bench_phot[i]));
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time sampling from a cumulative distribution function
+ *
+ * @param [in] int  i   The photon state, which is not used
+ * @return     The sampled value
+ *
+ * @details
+ * The cdf is the one for a blackbody, which is used by planck.
+ *
+ **********************************************************/
+
+double
+bench_cdf_get_rand (int i)
+{
+  return (cdf_get_rand (&cdf_bb));
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time sampling the frequency of a photon from a blackbody
+ *
+ * @param [in] int  i   The photon state
+ * @return     The frequency, in units of 1e15 Hz
+ *
+ * @details
+ * The temperature is the radiation temperature of the cell containing the photon.
+ *
+ **********************************************************/
+
+double
+bench_planck (int i)
+{
+  return (planck (plasmamain[wmain[bench_phot[i].grid].nplasma].t_r, BENCH_FMIN, BENCH_FMAX) / 1.e15);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the direction of a photon after Compton scattering
+ *
+ * @param [in] int  i   The photon state
+ * @return     The sum of the new direction cosines
+ *
+ **********************************************************/
+
+double
+bench_compton_dir (int i)
+{
+  struct photon pp;
+
+  stuff_phot (&bench_phot[i], &pp);
+  compton_dir (&pp);
+  return (pp.lmn[0] + pp.lmn[1] + pp.lmn[2]);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the deactivation of a k-packet
+ *
+ * @param [in] int  i   The photon state
+ * @return     The process which deactivated the k-packet, and whether
+ * the packet escaped
+ *
+ **********************************************************/
+
+double
+bench_kpkt (int i)
+{
+  struct photon pp;
+  int nres, escape;
+
+  stuff_phot (&bench_phot[i], &pp);
+  nres = -1;
+  escape = 0;
+  kpkt (&pp, &nres, &escape, KPKT_MODE_ALL);
+  return (nres + 0.5 * escape);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the deactivation of a macro atom excited by a line
+ *
+ * @param [in] int  i   The photon state
+ * @return     The process which deactivated the macro atom, and whether
+ * the packet escaped
+ *
+ **********************************************************/
+
+double
+bench_matom (int i)
+{
+  struct photon pp;
+  int nres, escape;
+
+  stuff_phot (&bench_phot[i], &pp);
+  nres = bench_macro_line[i % bench_nmacro_line];
+  escape = 0;
+  matom (&pp, &nres, &escape);
+  return (nres + 0.5 * escape);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the extraction of a photon into the first observer spectrum
+ *
+ * @param [in] int  i   The photon state
+ * @return     The weight of the photon when it leaves the wind
+ *
+ **********************************************************/
+
+double
+bench_extract_one (int i)
+{
+  struct photon pp;
+
+  stuff_phot (&bench_phot[i], &pp);
+  stuff_v (xxspec[MSPEC].lmn, pp.lmn);
+  extract_one (wmain, &pp, PTYPE_WIND, MSPEC);
+  return (pp.w);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time the solution of the ionization balance in a cell
+ *
+ * @param [in] int  i   The photon state
+ * @return     The electron density which was calculated, in units
+ * of the one it replaced
+ *
+ * @details
+ * The electron density, ion densities, partition functions and level
+ * densities of the cell are restored after the call, so that each call
+ * starts from the saved state of the model.
+ *
+ **********************************************************/
+
+double
+bench_matrix_ion_populations (int i)
+{
+  PlasmaPtr xplasma;
+  double ne, ne_new;
+
+  xplasma = &plasmamain[wmain[bench_phot[i].grid].nplasma];
+
+  ne = xplasma->ne;
+  memcpy (bench_density, xplasma->density, nions * sizeof (double));
+  memcpy (bench_partition, xplasma->partition, nions * sizeof (double));
+  memcpy (bench_levden, xplasma->levden, nlte_levels * sizeof (double));
+
+  matrix_ion_populations (xplasma, NEBULARMODE_MATRIX_BB);
+  ne_new = xplasma->ne;
+
+  xplasma->ne = ne;
+  memcpy (xplasma->density, bench_density, nions * sizeof (double));
+  memcpy (xplasma->partition, bench_partition, nions * sizeof (double));
+  memcpy (xplasma->levden, bench_levden, nlte_levels * sizeof (double));
+
+  return (ne_new / ne);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Create the photon states which the kernels use
+ *
+ * @param [in] int  nphot   The number of photon states
+ * @return     The number of photon states which were created
+ *
+ * @details
+ * Each photon is placed at the centre of a cell which is entirely
+ * in the wind, rotated by a random azimuth, and given a random direction
+ * and a frequency which is uniform in log between BENCH_FMIN and BENCH_FMAX.
+ * The distance to the edge of the cell, the optical depth to the next
+ * scatter, the velocity gradient along the path and a line which is not part
+ * of a macro atom are recorded for each.
+ *
+ * The photon states are then ordered by domain, so that the kernels which
+ * depend on the coordinate system can be timed for each domain separately.
+ *
+ **********************************************************/
+
+int
+bench_photons (nphot)
+     int nphot;
+{
+  int *cells, ncells;
+  int n, i, ndom;
+  double phi, rho;
+  PhotPtr p;
+
+  cells = calloc (sizeof (int), NDIM2);
+  ncells = 0;
+  for (n = 0; n < NDIM2; n++)
+  {
+    if (wmain[n].inwind == W_ALL_INWIND)
+      cells[ncells++] = n;
+  }
+
+  if (ncells == 0)
+  {
+    Error ("bench_photons: There are no cells entirely in the wind\n");
+    Exit (1);
+  }
+
+  bench_phot = calloc (sizeof (p_dummy), nphot);
+  bench_smax = calloc (sizeof (double), nphot);
+  bench_tau_scat = calloc (sizeof (double), nphot);
+  bench_dvds = calloc (sizeof (double), nphot);
+  bench_line = calloc (sizeof (int), nphot);
+  bench_order = calloc (sizeof (int), nphot);
+
+  if (bench_phot == NULL || bench_smax == NULL || bench_tau_scat == NULL || bench_dvds == NULL || bench_line == NULL
+      || bench_order == NULL)
+  {
+    Error ("bench_photons: Could not allocate memory for %d photons\n", nphot);
+    Exit (1);
+  }
+
+  for (i = 0; i < nphot; i++)
+  {
+    p = &bench_phot[i];
+    n = cells[(int) random_number (0.0, ncells)];
+
+    phi = random_number (0.0, 2. * PI);
+    rho = sqrt (wmain[n].xcen[0] * wmain[n].xcen[0] + wmain[n].xcen[1] * wmain[n].xcen[1]);
+    p->x[0] = rho * cos (phi);
+    p->x[1] = rho * sin (phi);
+    p->x[2] = wmain[n].xcen[2];
+    randvec (p->lmn, 1.0);
+    p->freq = p->freq_orig = BENCH_FMIN * pow (BENCH_FMAX / BENCH_FMIN, random_number (0.0, 1.0));
+    p->w = p->w_orig = 1.0;
+    p->tau = 0.0;
+    p->istat = P_INWIND;
+    p->nres = -1;
+    p->origin = PTYPE_WIND;
+    p->np = i;
+
+    p->grid = n;
+    bench_smax[i] = ds_in_cell (wmain[n].ndom, p);
+    if (p->grid != n)
+    {
+      Error ("bench_photons: The centre of cell %d was placed in cell %d\n", n, p->grid);
+      p->grid = n;
+    }
+    bench_tau_scat[i] = -log (random_number (0.0, 1.0));
+    bench_dvds[i] = dvwind_ds (p);
+    bench_line[i] = bench_simple_line[(int) random_number (0.0, bench_nsimple_line)];
+  }
+
+  n = 0;
+  for (ndom = 0; ndom < geo.ndomain; ndom++)
+  {
+    bench_dom_start[ndom] = n;
+    for (i = 0; i < nphot; i++)
+    {
+      if (wmain[bench_phot[i].grid].ndom == ndom)
+        bench_order[n++] = i;
+    }
+  }
+  bench_dom_start[geo.ndomain] = n;
+
+  free (cells);
+
+  return (nphot);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Time one kernel and print the results
+ *
+ * @param [in] int  nkernel   The kernel, an index into bench_kernels
+ * @param [in] char *  name   The name under which the results are printed
+ * @param [in] int  ncalls   The number of calls to make
+ * @param [in] int  seed   The seed with which the photon states were created
+ * @return     Always returns 0
+ *
+ * @details
+ * For kernels which are timed for each domain, bench_ndom is the domain
+ * and only the photon states in that domain are used.
+ *
+ **********************************************************/
+
+int
+bench_run (nkernel, name, ncalls, seed)
+     int nkernel;
+     char *name;
+     int ncalls, seed;
+{
+  struct bench_kernel *kernel;
+  struct timeval t0, t1;
+  double checksum, dt;
+  int i, nstart, nstates;
+
+  kernel = &bench_kernels[nkernel];
+
+  if (kernel->require == BENCH_DOMAIN)
+  {
+    nstart = bench_dom_start[bench_ndom];
+    nstates = bench_dom_start[bench_ndom + 1] - nstart;
+    if (nstates == 0)
+    {
+      printf ("%-32s skipped: there are no photon states in this domain\n", name);
+      return (0);
+    }
+  }
+  else
+  {
+    nstart = 0;
+    nstates = bench_nphot;
+  }
+
+  ncalls /= kernel->divisor;
+  if (ncalls < 1)
+    ncalls = 1;
+
+  /* The photon states were created with seed, so a different one is used for the kernels, lest
+     the random numbers they draw repeat those from which the photon states were made */
+  init_rand (seed + 1);
+  checksum = 0.0;
+
+  gettimeofday (&t0, NULL);
+  if (kernel->require == BENCH_DOMAIN)
+  {
+    for (i = 0; i < ncalls; i++)
+      checksum += kernel->func (bench_order[nstart + i % nstates]);
+  }
+  else
+  {
+    for (i = 0; i < ncalls; i++)
+      checksum += kernel->func (i % nstates);
+  }
+  gettimeofday (&t1, NULL);
+
+  dt = (t1.tv_sec - t0.tv_sec) + (t1.tv_usec - t0.tv_usec) * 1e-6;
+
+  printf ("%-32s %10d %12.1f %12.4e %20.12e\n", name, ncalls, 1.e9 * dt / ncalls, (dt > 0) ? ncalls / dt : 0.0, checksum);
+  fflush (stdout);
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief Parse the command line arguments given to py_bench
+ *
+ * @param[in] int argc        The number of arguments in the command line
+ * @param[in] char *argv[]    The command line arguments
+ * @param[out] char root[]    The rootname of the Python simulation
+ * @param[out] int *ncalls   The number of calls to make to each kernel
+ * @param[out] int *nphot   The number of photon states
+ * @param[out] int *seed   The seed for the random number generator
+ * @param[out] char kernel[]   The kernel to time, or an empty string for all kernels
+ *
+ * @return void
+ *
+ **********************************************************/
+
+char py_bench_help[] = "Usage: py_bench [-n ncalls] [-p nphot] [-s seed] [-k kernel] [-h] rootname \n\
+-n the number of calls to make to each kernel, which is reduced for the most expensive kernels \n\
+-p the number of photon states to create \n\
+-s the seed for the random number generator \n\
+-k time only the named kernel \n\
+-h get this help message and quit\n\
+";
+
+void
+bench_parse_arguments (int argc, char *argv[], char root[], int *ncalls, int *nphot, int *seed, char kernel[])
+{
+  int i;
+
+  *ncalls = 1000000;
+  *nphot = 10000;
+  *seed = BENCH_SEED;
+  strcpy (kernel, "");
+  strcpy (root, "");
+
+  for (i = 1; i < argc; i++)
+  {
+    if (!strcmp (argv[i], "-h"))
+    {
+      printf ("%s", py_bench_help);
+      exit (0);
+    }
+    else if (!strcmp (argv[i], "-n") && i + 1 < argc)
+    {
+      *ncalls = atoi (argv[++i]);
+    }
+    else if (!strcmp (argv[i], "-p") && i + 1 < argc)
+    {
+      *nphot = atoi (argv[++i]);
+    }
+    else if (!strcmp (argv[i], "-s") && i + 1 < argc)
+    {
+      *seed = atoi (argv[++i]);
+    }
+    else if (!strcmp (argv[i], "-k") && i + 1 < argc)
+    {
+      strncpy (kernel, argv[++i], LINELENGTH - 1);
+      kernel[LINELENGTH - 1] = '\0';
+    }
+    else if (!strncmp (argv[i], "-", 1))
+    {
+      printf ("Unknown switch %s\nExiting\n\n", argv[i]);
+      printf ("%s", py_bench_help);
+      exit (0);
+    }
+    else
+    {
+      get_root (root, argv[i]);
+    }
+  }
+
+  if (strlen (root) == 0 || *ncalls < 1 || *nphot < 1)
+  {
+    printf ("%s", py_bench_help);
+    exit (0);
+  }
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      py_bench times the kernels of Python for the wind
+ * of a completed model.  This is the main routine.
+ *
+ * @param [in] int  argc   The number of argments in the command line
+ * @param [in] char *  argv[]   The command line
+ * @return     Always returns 0
+ *
+ * @details
+ * The routine reads the windsave file, which also reads the atomic data,
+ * and if it exists the spec_save file.  It then creates the photon states
+ * and times each of the kernels in turn.
+ *
+ * ### Notes ###
+ *
+ * Kernels which cannot be timed for the model, for example those for
+ * macro atoms when the model does not use them, are listed as skipped.
+ *
+ **********************************************************/
+
+int
+main (argc, argv)
+     int argc;
+     char *argv[];
+{
+  char root[LINELENGTH], kernel[LINELENGTH];
+  char windsavefile[LINELENGTH + 12], specsavefile[LINELENGTH + 12];
+  char name[LINELENGTH];
+  int ncalls, nphot, seed;
+  int n, have_spec;
+  FILE *fptr;
+
+  Log_set_verbosity (3);
+  init_advanced_modes ();
+
+  bench_parse_arguments (argc, argv, root, &ncalls, &nphot, &seed, kernel);
+
+  sprintf (windsavefile, "%s.wind_save", root);
+  sprintf (specsavefile, "%s.spec_save", root);
+
+  if (wind_read (windsavefile) < 0)
+  {
+    Error ("py_bench: Could not open %s\n", windsavefile);
+    exit (0);
+  }
+
+  have_spec = FALSE;
+  if ((fptr = fopen (specsavefile, "r")) != NULL)
+  {
+    fclose (fptr);
+    spec_read (specsavefile);
+    have_spec = (nspectra > MSPEC);
+  }
+
+  /* The care factors are not saved in the windsave file, so the standard ones are used */
+  get_standard_care_factors ();
+  DFUDGE = setup_dfudge ();
+  setup_windcone ();
+  kbf_need (BENCH_FMIN, BENCH_FMAX);
+  wind_hot_update ();
+  init_rand (seed);
+
+  /* Initialise the blackbody cdf, which is used by cdf_get_rand */
+  planck (1.e4, BENCH_FMIN, BENCH_FMAX);
+
+  bench_nmacro_line = bench_nsimple_line = 0;
+  bench_macro_line = calloc (sizeof (int), nlines + 1);
+  bench_simple_line = calloc (sizeof (int), nlines + 1);
+  for (n = 0; n < nlines; n++)
+  {
+    if (lin_ptr[n]->macro_info == 1)
+      bench_macro_line[bench_nmacro_line++] = n;
+    else
+      bench_simple_line[bench_nsimple_line++] = n;
+  }
+
+  if (bench_nsimple_line == 0)
+  {
+    Error ("py_bench: There are no lines which are not part of a macro atom\n");
+    exit (0);
+  }
+
+  bench_density = calloc (sizeof (double), nions);
+  bench_partition = calloc (sizeof (double), nions);
+  bench_levden = calloc (sizeof (double), nlte_levels + 1);
+
+  init_rand (seed);
+  bench_nphot = bench_photons (nphot);
+
+  printf ("Timing kernels for %s with %d photon states, seed %d\n\n", root, bench_nphot, seed);
+  printf ("%-32s %10s %12s %12s %20s\n", "Kernel", "Calls", "ns/call", "calls/s", "Checksum");
+
+  for (n = 0; n < (int) NBENCH_KERNELS; n++)
+  {
+    if (strlen (kernel) > 0 && strcmp (kernel, bench_kernels[n].name))
+      continue;
+
+    if (bench_kernels[n].require == BENCH_MACRO && (geo.rt_mode != RT_MODE_MACRO || nlevels_macro == 0 || bench_nmacro_line == 0))
+    {
+      printf ("%-32s skipped: the model does not use macro atoms\n", bench_kernels[n].name);
+    }
+    else if (bench_kernels[n].require == BENCH_SPEC && !have_spec)
+    {
+      printf ("%-32s skipped: there are no observer spectra in %s\n", bench_kernels[n].name, specsavefile);
+    }
+    else if (bench_kernels[n].require == BENCH_DOMAIN)
+    {
+      for (bench_ndom = 0; bench_ndom < geo.ndomain; bench_ndom++)
+      {
+        sprintf (name, "%s[%d:%s]", bench_kernels[n].name, bench_ndom, bench_coord_names[zdom[bench_ndom].coord_type]);
+        bench_run (n, name, ncalls, seed);
+      }
+    }
+    else
+    {
+      bench_run (n, bench_kernels[n].name, ncalls, seed);
+    }
+  }
+
+  return (0);
+}
@@ -158,6 +158,7 @@ main (argc, argv)
 /* Allocate the domain structure */
 
   zdom = (DomainPtr) calloc (sizeof (domain_dummy), MaxDom);
+  mem_register (MEM_WIND, "zdom", (double) MaxDom * sizeof (domain_dummy));
 
   /* BEGIN GATHERING INPUT DATA */
 
@@ -648,6 +649,11 @@ main (argc, argv)
 
   disk_init (geo.rstar, geo.diskrad, geo.mstar, geo.disk_mdot, freqmin, freqmax, 0, &geo.f_disk);
   qdisk_init ();                /* Initialize a disk qdisk to store the information about photons impinging on the disk */
+
+  /* Report the memory used by each process now that the main arrays have been allocated */
+  mem_static_init ();
+  mem_report ("setup", 0);
+
   xsignal (files.root, "%-20s Finished initialization for %s\n", "NOK", files.root);
   check_time (files.root);
 
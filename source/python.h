@@ -100,8 +100,14 @@ double PHOT_RANGE;              /* When a variable number of photons are called
                                    cycles this is the log of the difference between NPHOT_MAX
                                    and the value in the first cycle
                                  */
+double PHOT_ERR_TARGET;         /* When the number of photons in ionization cycles is chosen from the Monte
+                                   Carlo errors in the estimators, the relative error which is to be reached
+                                 */
+double PHOT_ERR_FRAC;           /* The fraction of the cells in the wind in which PHOT_ERR_TARGET is to be reached */
 int NPHOT_MAX;                  /* The maximum number of photon bundles created per cycle */
 int NPHOT;                      /* The number of photon bundles created, defined in setup.c */
+int NPHOT_BATCH;                /* The maximum number of photon bundles generated and transported at once, and
+                                   so the size of the photon structure */
 
 #define NWAVE  			  10000 //This is the number of wavelength bins in spectra that are produced
 #define MAXSCAT 			2000
@@ -183,6 +189,24 @@ typedef struct plane            /*SWM 10-10-14 - Switched to TypeDef */
 plane_dummy plane_l1, plane_sec, plane_m2_far;  /* these all define planes which are perpendicular to the line of sight from the 
                                                    primary to the seconday */
 
+/* A table of the radius of the Roche lobe of the secondary, measured from the centre of the secondary,
+   as a function of direction.  theta is the angle from the line joining the secondary to the primary,
+   and phi_r is the azimuthal angle about this line, measured from the plane of the orbit.  Because
+   the lobe is symmetric about the plane of the orbit and about the plane which contains the line
+   of centres and the rotation axis, phi_r only runs from 0 to 90 degrees.  See roche.c */
+
+#define NROCHE_THETA  361
+#define NROCHE_PHI    46
+
+struct roche_surface
+{
+  double r[NROCHE_THETA][NROCHE_PHI];   /* The radius of the lobe in each direction */
+  double dtheta, dphi;          /* The spacing of the table in theta and phi_r, in radians */
+  double rmin, rmax;            /* The smallest and largest radius in the table */
+  int ok;                       /* TRUE once the table has been constructed */
+}
+roche_surf;
+
 
 /* Note that since we are interested in biconical flows, our definition of a cone is not exactly
  * what one might guess.  The cone is defined in the positive z direction but reflected through 
@@ -365,6 +389,10 @@ struct geometry
   double rho_select[NSPEC], z_select[NSPEC], az_select[NSPEC], r_select[NSPEC];
   double swavemin, swavemax, sfmin, sfmax;      // The minimum and maximum wavelengths/freqs for detailed spectra
   int select_extract, select_spectype;
+  int extract_roulette;         /* TRUE if extracted rays which can no longer contribute significantly to a spectrum
+                                   are subject to Russian roulette, see extract_one */
+  double roulette_frac;         /* The fraction of the running total in a spectral bin below which a ray is subject to roulette */
+  double roulette_kill;         /* The probability that a ray which is subject to roulette is killed */
 
 /* Begin description of the actual geometry */
 
@@ -677,6 +705,34 @@ disk, qdisk;                    /* disk defines zones in the disk which in a spe
                                    is changed.  qdisk stores the amount of heating of the disk as a result of
                                    illumination by the star or wind. It's boundaries are fixed throughout a cycle */
 
+/* A piecewise representation of the surface of a vertically extended disk.  The disk is divided
+   into NDISK_SURFACE annuli of equal width, and within each the surface is the frustum of a cone,
+   |z| = a + b r, which passes through the surface given by the power law at the edges of the annulus.
+   The annuli are grouped into blocks of NDISK_SURFACE_BLOCK, so that a path can be tested against the
+   maximum height of the surface in a block before the annuli in the block are examined.  See disk.c */
+
+#define NDISK_SURFACE  1000
+#define NDISK_SURFACE_BLOCK  25
+
+struct disk_surface
+{
+  double a[NDISK_SURFACE], b[NDISK_SURFACE];    /* The height of the surface in each annulus is a + b r */
+  double dr;                    /* The width of each annulus */
+  double diskrad, z0, z1;       /* The parameters of the disk for which the surface was constructed */
+}
+disk_surf;
+
+/* When the photons for an ionization cycle are generated and transported in batches, the heating
+   of the star and disk in the previous cycle, which is what sets up these sources, has to be kept
+   separate from the heating that is building up in the current cycle.  See swap_back_heating */
+
+struct back_heating
+{
+  double lum_star_back;         /* The luminosity of photons which hit the star */
+  double lum_disk_back;         /* The luminosity of photons which hit the disk */
+  double heat[NRINGS];          /* The heating of each annulus of the disk, as in qdisk */
+};
+
 /* the next structure is intended to store a non standard temperature
    profile for the disk
    */
@@ -857,6 +913,20 @@ typedef struct plasma
   int n_ds;                     /* NSH 6/9/12 Added to allow the mean ds to be computed */
   int nrad;                     /* Total number of photons created within the cell */
   int nioniz;                   /* Total number of photon passages by photons capable of ionizing H */
+
+  /* The work done in the cell in the last cycle, summed over all MPI processes, as a map of where
+     the time in a run goes.  See wind_cost_init */
+
+  double cost_steps;            /* Steps taken by photons through the cell */
+  double cost_lines;            /* Resonant line interactions, that is scatters or absorptions in a line, in the cell */
+  double cost_matom;            /* Activations of macro atoms and k-packets */
+  double cost_extract;          /* Steps taken through the cell by rays extracted towards an observer */
+  double cost_solve;            /* Time in seconds taken by wind_update for the cell in the last ionization cycle */
+
+  /* The sums of the squares of the contributions to j, ip, heat_tot and xj in the last cycle,
+     from which the Monte Carlo errors in these estimators are found.  See phot_budget_next */
+
+  double j2, ip2, heat2, xj2[NXBANDS];
   double *ioniz, *recomb;       /* Number of ionizations and recombinations for each ion.
                                    The sense is ionization from ion[n], and recombinations 
                                    to each ion[n].  */
@@ -953,6 +1023,14 @@ typedef struct plasma
 #define CONVERGENCE_CHECK_FAIL 1        /* Indicator for that the cell has failed a convergence check */
 #define CONVERGENCE_CHECK_OVER_TEMP 2   /* Indicator for a cell that its electron temperature is more than TMAX */
 
+  int nconverged;               /* The number of successive cycles in which the cell has passed all of the convergence checks */
+  int nfrozen;                  /* The number of successive cycles in which the cell has kept its last solution.  See wind_update_frozen */
+  double j_solved, ave_freq_solved, heat_solved, xj_solved[NXBANDS];    /* The estimators from which the last solution was found */
+
+#define FREEZE_NCONVERGED 2     /* The number of successive cycles a cell must have converged before it can keep its solution */
+#define FREEZE_NSIGMA     2.0   /* The number of standard deviations by which the estimators can change in a cell which keeps its solution */
+#define FREEZE_RECHECK    3     /* The maximum number of successive cycles for which a cell can keep its solution */
+
   /* 1108 Increase sim estimators to cover all of the bands */
   /* 1208 Add parameters for an exponential representation, and a switch to say which we prefer. */
   enum spec_mod_type_enum
@@ -977,6 +1055,217 @@ typedef struct plasma
 
 PlasmaPtr plasmamain;
 
+/* The wind and plasma structures are large, and most of what is in them is not needed while photons
+   are in flight.  The structures below hold compact copies of the parts of wmain and plasmamain which
+   are read on every step of a photon's flight, so that those steps touch as little memory as possible.
+   The copies are made by wind_hot_update at the start of each ionization and spectral cycle, once the wind
+   has been updated, and are only valid (wind_hot_ok is TRUE) until the photons of the cycle have all been
+   transported; nothing in them may be changed in between.
+   Routines which are only used while photons are in flight read wmain_hot and plasmamain_hot directly.
+   Routines which are used elsewhere as well should use the accessor macros, which fall back to wmain 
+   when the copies are not valid.  See gridwind.c */
+
+typedef struct wind_hot
+{
+  double v[3];                  /* velocity at inner vertex of cell, as in wmain */
+  double v_grad[3][3];          /* velocity gradient tensor at the inner vertex of the cell */
+  double vol;                   /* valid volume of this cell */
+  double dfudge;                /* push through distance for this cell */
+  int ndom;                     /* The domain associated with this element of the wind */
+  int nwind;                    /* A self-reference to this cell */
+  int nplasma;                  /* A cross reference to the corresponding cell in the plasma structure */
+  int inwind;                   /* Whether the cell is in the wind, see inwind_enum */
+}
+wind_hot_dummy, *WindHotPtr;
+
+typedef struct plasma_hot
+{
+  double ne;                    /* electron density in the cell */
+  double t_e;                   /* electron temperature */
+  double vol;                   /* volume of the cell that is filled with material */
+  int nwind;                    /* A cross reference to the corresponding cell in the wind structure */
+}
+plasma_hot_dummy, *PlasmaHotPtr;
+
+WindHotPtr wmain_hot;
+PlasmaHotPtr plasmamain_hot;
+int wind_hot_ok;                /* TRUE while wmain_hot and plasmamain_hot are copies of the current wind */
+
+#define WIND_V(n)       (wind_hot_ok ? wmain_hot[(n)].v : wmain[(n)].v)
+#define WIND_V_GRAD(n)  (wind_hot_ok ? wmain_hot[(n)].v_grad : wmain[(n)].v_grad)
+#define WIND_NDOM(n)    (wind_hot_ok ? wmain_hot[(n)].ndom : wmain[(n)].ndom)
+#define WIND_NPLASMA(n) (wind_hot_ok ? wmain_hot[(n)].nplasma : wmain[(n)].nplasma)
+
+/* The topology of the wind grid.  For each cell in wmain this records the bounding surfaces of the
+   cell, with the coefficients needed to test whether a position lies inside it, and the cell on the
+   other side of each face.  Since a photon almost always moves either within its cell or into one of
+   the neighbouring cells, this allows the new cell to be found without searching the entire grid.
+   The topology is constructed by wind_topology whenever the description of the grid is completed
+   (see wind_complete) and is purely geometrical, so it is not written to the windsave file.
+   See wind_topology.c */
+
+enum face_enum
+{
+  FACE_INNER = 0,               /* The face at smaller rho or r */
+  FACE_OUTER = 1,               /* The face at larger rho or r */
+  FACE_LOWER = 2,               /* The face at smaller z, or for rtheta coordinates, smaller theta */
+  FACE_UPPER = 3,               /* The face at larger z, or for rtheta coordinates, larger theta */
+  NFACE = 4
+};
+
+typedef struct cell_topology
+{
+  double r2lo, r2hi;            /* The squares of the inner and outer radial (rho or r) boundaries */
+  double zlo[2], zhi[2];        /* For cylindrical coordinates, the lower and upper boundaries in |z| as a + b rho; 
+                                   for rtheta coordinates, zlo[0] and zhi[0] are the cosines of the larger and 
+                                   smaller theta boundaries */
+  double zmax;                  /* For cylvar coordinates, the largest |z| in the column of cells */
+  int nbr[NFACE];               /* The cell on the other side of each face, or -1 if the face is the edge of the grid */
+  int ok;                       /* TRUE if positions can be located in this cell from its boundaries */
+}
+topology_dummy, *TopologyPtr;
+
+TopologyPtr wmain_topology;
+
+/* The constants for the 64 bit FNV-1a hashes calculated by setup_hash */
+
+#define FNV_OFFSET  14695981039346656037ULL
+#define FNV_PRIME   1099511628211ULL
+
+/* The groups of quantities which are calculated cell by cell when the wind is set up, and
+   which are shared between threads by setup_share.  See wind_setup.c */
+
+enum setup_share_enum
+{
+  SETUP_VOLUMES = 0,            /* vol and inwind */
+  SETUP_DIV_V = 1,              /* div_v */
+  SETUP_DVDS = 2                /* dvds_ave, dvds_max and lmn */
+};
+
+/* The parts of a windsave file which can be read selectively by wind_read_parts.  The geometry,
+   domains, wind and plasma structures, the ion densities and partition functions, and the macro
+   atom structures are always read.  See windsave.c */
+
+enum windsave_part_enum
+{
+  WINDSAVE_ION_ESTIMATORS = 1,  /* The ion by ion estimators, such as ioniz, recomb and heat_ion */
+  WINDSAVE_RATES = 2,           /* levden, and the recombination rates and opacities of each cross section */
+  WINDSAVE_MACRO_ESTIMATORS = 4,        /* The estimators for each macro atom level and transition */
+  WINDSAVE_ALL = 7
+};
+
+/* A variable length array which belongs to each plasma cell or each macro atom cell, the
+   variable which gives its length, and the part of a windsave file to which it belongs.
+   Arrays with a part of 0 are always read */
+
+struct windsave_array
+{
+  char *name;
+  size_t offset;                /* The offset of the pointer to the array in the structure for a cell */
+  int elsize;
+  int *nelem;
+  int part;
+};
+
+/* A windsave file consists of a header, a set of named fields, and a directory giving the location
+   of each field.  A field is an array of rows of equal size, for example one plasma structure or the
+   ion densities of one cell per row, and it is stored as a set of chunks of whole rows, each of which
+   may be compressed, so that any range of rows can be read without reading the rest of the file.  The
+   header records a hash of the sizes of the structures which are written out as they are in memory,
+   so that a file which was written with different structures is recognised.  See windsave_format.c */
+
+#define WINDSAVE_MAGIC  "PYWSAVE"
+#define WINDSAVE_FORMAT  1      /* The version of the layout of the file */
+#define NWINDSAVE_FIELDS  64    /* The maximum number of fields in a file */
+#define WINDSAVE_CHUNK_BYTES  4194304   /* The size of the chunks into which a field is divided */
+
+struct windsave_header
+{
+  char magic[8];
+  int format;
+  char version[LINELENGTH];     /* The version of Python which wrote the file */
+  unsigned long long struct_hash;
+  int nfield;
+  long long directory;          /* The offset of the directory of fields */
+};
+
+typedef struct windsave_field
+{
+  char name[32];
+  int rowsize;                  /* The number of bytes in a row */
+  int nrow;
+  int rows_per_chunk;
+  int nchunk;
+  long long table;              /* The offset of a table giving the offset and stored size of each chunk */
+} windsave_field_dummy, *WindsaveFieldPtr;
+
+typedef struct windsave_file
+{
+  FILE *fptr;
+  int compress;                 /* TRUE if chunks are to be compressed when they are written */
+  struct windsave_header header;
+  windsave_field_dummy field[NWINDSAVE_FIELDS];
+} windsave_file_dummy, *WindsaveFilePtr;
+
+/* The tables written by windsave2table (and by python itself when tables are made each cycle) are
+   assembled column by column.  All of the columns of all of the tables for a domain are first
+   gathered from wmain and plasmamain in a single pass through the cells, and the tables are then
+   written from these buffers, as ascii files and optionally as binary columnar files */
+
+#define NTABLE_COLUMNS  64
+#define NEXPORT_TABLES  64
+
+enum table_column_enum
+{
+  TABLE_WIND_DOUBLE = 0,        // A double in the wind structure for the cell
+  TABLE_WIND_INT = 1,           // An integer in the wind structure for the cell
+  TABLE_CELL_I = 2,             // The first index of the cell in the domain
+  TABLE_CELL_J = 3,             // The second index of the cell in the domain
+  TABLE_PLASMA_DOUBLE = 4,      // A double in the plasma structure, 0 if the cell has no volume
+  TABLE_PLASMA_INT = 5,         // An integer in the plasma structure, 0 if the cell has no volume
+  TABLE_ION = 6                 // A quantity for one ion, 0 if the cell has no volume or density
+};
+
+typedef struct table_column
+{
+  char name[20];
+  char head[12];                /* The format of the heading of the column in the ascii file */
+  char fmt[12];                 /* The format of each value in the ascii file */
+  int kind;                     /* What the column contains, one of table_column_enum */
+  size_t offset;                /* For wind and plasma columns, the offset of the value in the structure */
+  int nion, nelem, iswitch;     /* For ion columns, the ion, its element and what is to be tabulated */
+  double *x;                    /* The values for each cell in the domain, held as doubles */
+} table_column_dummy, *TableColumnPtr;
+
+typedef struct export_table
+{
+  char filename[LINELENGTH + 40];       /* The name of the table files, without the extension */
+  int ncols;
+  table_column_dummy col[NTABLE_COLUMNS];
+} export_table_dummy, *ExportTablePtr;
+
+/* A cache of the fractional populations of the levels of simple lines in the plasma cells, as
+   calculated by two_level_fractions.  These depend only on the conditions in the cell, and so
+   while photons are in flight they need only be calculated once for each line in each cell.
+   The cache is a single direct-mapped table, of a fixed size whatever the size of the wind, in
+   which line nline of cell nplasma is kept in slot (nline + TLA_CACHE_STRIDE * nplasma) modulo
+   NTLA_CACHE.  It is allocated when it is first used.  See two_level_atom_den in lines.c */
+
+#define NTLA_CACHE        16384 /* The number of slots in the cache, which must be a power of 2 */
+#define TLA_CACHE_STRIDE  1031  /* The offset between the slots of neighbouring cells */
+
+typedef struct tla_cache
+{
+  double n1_over_dd, n2_over_dd;        /* The lower and upper level densities as fractions of the lower level density from the partition function */
+  int nplasma;                  /* The plasma cell */
+  int nline;                    /* The line in the line array, or -1 if the slot is empty */
+  int ngen;                     /* The value of tla_cache_gen when the slot was filled */
+}
+tla_cache_dummy, *TlaCachePtr;
+
+TlaCachePtr tla_cache;
+int tla_cache_gen;              /* Incremented by tla_cache_reset whenever the plasma changes, invalidating the cache */
+
 /* A storage area for photons.  The idea is that it is sometimes time-consuming to create the
 cumulative distribution function for a process, but trivial to create more than one photon 
 of a particular type once one has the cdf,  This appears to be case for f fb photons.  But 
@@ -1183,6 +1472,50 @@ PhotPtr photmain;               /* A pointer to all of the photons that have bee
                                    breaking the main routine of python into separate rooutines for inputs and running the
                                    program */
 
+    /* The state of a photon part way through its flight through the wind.  trans_phot_single
+       carries this from one step of the flight to the next, and the event based transport
+       engine in trans_phot_event.c holds one for every photon that is still in flight, so 
+       that photons can be moved and made to interact in batches rather than one at a time.
+     */
+
+typedef struct flight
+{
+  struct photon pp;             /* The photon at the end of the last move, as opposed to p, where it started */
+  double tau_scat;              /* The optical depth at which the photon will next scatter */
+  double tau;                   /* The optical depth the photon has accumulated since it last scattered */
+  double weight_min;            /* The weight below which the photon is considered absorbed */
+  double normal[3];             /* The normal to the surface the photon last hit */
+  int istat;                    /* The status of the photon after the last move or interaction */
+  int nres;                     /* The transition or process which caused the photon to scatter */
+  int icell;                    /* The number of steps the photon has taken since it last scattered */
+  int done;                     /* TRUE once the flight is over and the photon has been saved */
+}
+flight_dummy, *FlightPtr;
+
+    /* The velocity of the wind along the straight path which a photon is about to take through a
+       cell.  calculate_ds sets up the segment with vseg_init, shortening it until the velocity
+       projected onto the direction of travel is linear along it to within VCHECK.  The resonance
+       loop in calculate_ds and then radiation obtain the velocity and dv/ds at any point along the
+       segment from the values at its ends, rather than interpolating in the wind again.  See gradv.c
+     */
+
+typedef struct vsegment
+{
+  struct photon p1;             /* The photon at the start of the segment */
+  struct photon p2;             /* The photon at the end of the segment */
+  double len;                   /* The length of the segment */
+  double v1, v2;                /* The velocity projected onto the direction of travel at the two ends */
+  double dvds1, dvds2;          /* dv/ds along the direction of travel at the two ends, once dvds_ok is TRUE */
+  int dvds_ok;                  /* TRUE once dvds1 and dvds2 have been calculated */
+  int ok;                       /* TRUE once a segment has been set up */
+}
+vsegment_dummy, *VsegPtr;
+
+struct vsegment vseg;           /* The segment for the photon currently being transported */
+
+int extracting_ray;             /* TRUE while extract_one is moving a ray, so that translate_in_wind
+                                   charges its steps to cost_extract rather than cost_steps */
+
     /* minimum value for tau for p_escape_from_tau function- below this we 
        set to p_escape_ to 1 */
 #define TAU_MIN 1e-6
@@ -1271,6 +1604,11 @@ typedef struct spectrum
   double f_wind[NWAVE];         /* The spectrum of photons created in the wind or scattered in the wind. Created for 
                                    reflection studies but possibly useful for other reasons as well. */
   double lf_wind[NWAVE];        /* The logarithmic version of this */
+
+  int nroulette_kill;           /* The number of extracted rays killed by Russian roulette in extract_one */
+  int nroulette_live;           /* The number of extracted rays which survived at least one round of Russian roulette */
+  double roulette_tlive;        /* The wall time spent following rays after they first survived roulette, used 
+                                   to estimate the time saved by those that were killed */
 }
 spectrum_dummy, *SpecPtr;
 
@@ -1291,11 +1629,13 @@ generated from a function which is usually only proportional to the probability
 function or from an array.  It is sometimes useful, e.g. in calculating the reweighting function to
 have access to the proper normalization.  
 
-
+The arrays are allocated, to the size of the CDF, by cdf_alloc when the CDF is generated.  The
+guide table and the coefficients for each interval are calculated by calc_cdf_guide, and allow
+cdf_get_rand to find the interval and the position within it without a search or solving a quadratic.
 */
 
 
-#define NCDF 30000              //The default size for these arrays.  This needs to be greater than
+#define NCDF 30000              //The size of the working arrays from which CDFs are made.  This needs to be greater than
                                 //the size of any model that is read in, hence larger than NWAVE in models.h
 #define FUNC_CDF  200           //The size for CDFs made from functional form CDFs
 #define ARRAY_PDF 1000          //The size for PDFs to be turned into CDFs from arrays
@@ -1303,9 +1643,13 @@ have access to the proper normalization.
 
 typedef struct Cdf
 {
-  double x[NCDF];               /* Positions for which the CDF is calculated */
-  double y[NCDF];               /* The value of the CDF at x */
-  double d[NCDF];               /* 57i -- the rate of change of the CDF at x */
+  double *x;                    /* Positions for which the CDF is calculated */
+  double *y;                    /* The value of the CDF at x */
+  double *d;                    /* 57i -- the rate of change of the CDF at x */
+  double *ds;                   /* d[i]+d[i+1] for each interval, used to find the position within it */
+  double *dd;                   /* d[i+1]**2-d[i]**2 for each interval */
+  int *guide;                   /* guide[k] is the interval which contains y=k/ncdf */
+  int nalloc;                   /* The number of points for which the arrays have been allocated */
   double limit1, limit2;        /* Limits (running from 0 to 1) that define a portion
                                    of the CDF to sample */
   double x1, x2;                /* limits if they exist on what is returned */
@@ -1322,6 +1666,40 @@ struct Cdf cdf_brem;
 
 
 
+/* The random numbers used to launch photons from the star, disk, wind and AGN can be taken from a
+   scrambled Halton sequence rather than the random number generator.  See qmc_init */
+
+enum qmc_source_enum
+{
+  QMC_STAR = 0,                 /* The star and the boundary layer */
+  QMC_DISK,                     /* The disk */
+  QMC_WIND_CELL,                /* The choice of the cell and the process which produces a wind photon */
+  QMC_WIND,                     /* The frequency, position and direction of a wind photon */
+  QMC_AGN,                      /* The central source of an AGN */
+  NQMC_SOURCES
+};
+
+#define QMC_NDIM     8          /* The number of random numbers in the launch of a photon which are taken from the sequence */
+#define QMC_NDIGITS  53         /* The largest number of digits of each coordinate, for base 2 */
+#define QMC_MAXBASE  19         /* The largest base, for the last dimension */
+#define QMC_STAR_POS 3          /* The first dimension of the position of a photon from the star or an AGN, after its frequency */
+#define QMC_STAR_DIR 5          /* The first dimension of its direction */
+#define QMC_WIND_POS 2          /* The first dimension of the position of a wind photon in its cell, after its frequency */
+#define QMC_WIND_DIR 6          /* The first dimension of its direction */
+#define QMC_SEED     1084515760 /* The seed of the generator which scrambles the sequences, the same in every thread */
+
+struct qmc
+{
+  int active;                   /* TRUE while a photon is being launched */
+  int source;                   /* The source of the photon being launched */
+  int dim;                      /* The dimension of the next random number for this photon */
+  long index;                   /* The index in the sequence of the photon being launched */
+  long next[NQMC_SOURCES];      /* The index of the next photon launched from each source */
+  unsigned char perm[NQMC_SOURCES][QMC_NDIM][QMC_NDIGITS][QMC_MAXBASE];        /* The permutation of the digits at each position */
+} qmc;
+
+
+
 
 /* Variable used to allow something to be printed out the first few times
    an event occurs */
@@ -1451,6 +1829,12 @@ struct advanced_modes
   int zeus_connect;             // We are connecting to zeus, do not seek new temp and output a heating and cooling file
   int rand_seed_usetime;        // default random number seed is fixed, not based on time
   int photon_speedup;
+  int photon_adaptive;          // choose the number of photons in ionization cycles from the errors in the estimators
+  int freeze_cells;             // keep the solutions of converged cells whose estimators have changed by no more than the noise
+  int qmc_launch;               // take the random numbers used to launch photons from a scrambled Halton sequence
+  int event_transport;          // transport photons in batches with the event based engine
+  int setup_cache;              // save and reuse the volumes and velocity gradients of the wind cells
+  int compress_windsave;        // compress the chunks of windsave files
 }
 modes;
 
@@ -1482,6 +1866,9 @@ struct filenames
   char tprofile[LINELENGTH];    // non standard tprofile fname
   char phot[LINELENGTH];        // photfile e.g. python.phot
   char windrad[LINELENGTH];     // wind rad file
+  char perf[LINELENGTH];        // .perf file of the counters and timers of the hot paths
+  char mpi_profile[LINELENGTH]; // .mpi.csv file of the balance of work between MPI processes
+  char mem[LINELENGTH];         // .mem file of the memory used by each process
 }
 files;
 
@@ -1531,6 +1918,127 @@ files;
 int xxxbound;
 
 
+/* Counters and timers for the hot paths of the code.  They are only compiled in if PERF_COUNTERS
+   is defined (make PERF=yes), so that otherwise they cost nothing.  Each MPI process keeps its
+   own, and they are written to the .perf file and reset at the end of each cycle.  See perf.c */
+
+enum perf_counter_enum
+{
+  PERF_PHOTONS = 0,             /* photons whose flights were started */
+  PERF_TRANSLATE_STEPS = 1,     /* steps taken by photons in flight, one per call to translate */
+  PERF_RES_SCANNED = 2,         /* resonances examined by calculate_ds */
+  PERF_RES_INTERACTED = 3,      /* resonances for which calculate_ds computed a Sobolev optical depth */
+  PERF_CONTINUUM_XSECTIONS = 4, /* photoionization cross sections evaluated by radiation */
+  PERF_MATOM_CALLS = 5,         /* activations of macro atoms */
+  PERF_MATOM_JUMPS = 6,         /* internal jumps made by macro atoms */
+  PERF_KPKT_CALLS = 7,          /* k-packets which were deactivated */
+  PERF_MACRO_LOOPS = 8,         /* passes through the loop in macro_gov between macro atoms and k-packets */
+  PERF_EXTRACT_RAYS = 9,        /* rays extracted towards an observer */
+  PERF_EXTRACT_CELLS = 10,      /* cells crossed by extracted rays */
+  PERF_GRID_LOOKUPS = 11,       /* calls to where_in_grid */
+  PERF_GRID_SEARCHES = 12,      /* searches of the grid made by where_in_grid */
+  PERF_GRID_CACHE_HITS = 13,    /* positions which were the same as the last one located */
+  PERF_GRID_HINT_HITS = 14,     /* positions found in the hinted cell or its neighbours by where_in_grid_hint */
+  PERF_TE_EVALS = 15,           /* evaluations of the heating and cooling balance by calc_te */
+  PERF_COMPTON_EVALS = 16,      /* evaluations of the function whose root compton_dir finds */
+  NPERF_COUNTERS = 17
+};
+
+enum perf_timer_enum
+{
+  PERF_T_DEFINE_PHOT = 0,       /* generating photons */
+  PERF_T_TRANS_PHOT = 1,        /* transporting photons */
+  PERF_T_SPECTRUM_CREATE = 2,   /* binning the photons into spectra */
+  PERF_T_COMMUNICATE = 3,       /* gathering the estimators and spectra from the MPI processes */
+  PERF_T_WIND_UPDATE = 4,       /* updating the ionization and temperatures of the wind */
+  PERF_T_OUTPUT = 5,            /* writing spectra and windsave files */
+  NPERF_TIMERS = 6
+};
+
+double perf_counter[NPERF_COUNTERS];
+double perf_timer[NPERF_TIMERS];
+double perf_timer_start[NPERF_TIMERS];
+
+#ifdef PERF_COUNTERS
+#define PERF_COUNT(n)   (perf_counter[(n)] += 1.)
+#define PERF_ADD(n,x)   (perf_counter[(n)] += (x))
+#define PERF_START(n)   (perf_timer_start[(n)] = timer ())
+#define PERF_STOP(n)    (perf_timer[(n)] += timer () - perf_timer_start[(n)])
+#else
+#define PERF_COUNT(n)
+#define PERF_ADD(n,x)
+#define PERF_START(n)
+#define PERF_STOP(n)
+#endif
+
+/* A profile of how the work is balanced between the MPI processes.  Each process times the
+   regions below and adds up the bytes it passes to MPI in them; at the end of each cycle
+   para_profile_write gathers these to the master process, which logs the minimum, mean and
+   maximum over the processes and writes them to the .mpi.csv file.  See para_update.c */
+
+enum para_region_enum
+{
+  PARA_TRANS_PHOT = 0,          /* transporting photons */
+  PARA_WAIT = 1,                /* waiting at the barriers in calculate_ionization and make_spectra */
+  PARA_ESTIMATORS = 2,          /* communicate_estimators_para and communicate_costs_para */
+  PARA_MATOM_ESTIMATORS = 3,    /* communicate_matom_estimators_para */
+  PARA_SPECTRA = 4,             /* gather_spectra_para */
+  PARA_WIND_SOLVE = 5,          /* updating the cells assigned to the process in wind_update */
+  PARA_WIND_COMM = 6,           /* exchanging the updated cells in wind_update */
+  PARA_MATOM_F = 7,             /* calculating the emissivities assigned to the process in get_matom_f */
+  PARA_MATOM_F_COMM = 8,        /* exchanging the emissivities in get_matom_f */
+  NPARA_REGIONS = 9
+};
+
+double para_time[NPARA_REGIONS];
+double para_time_start[NPARA_REGIONS];
+double para_bytes[NPARA_REGIONS];
+
+#ifdef MPI_ON
+#define PARA_START(n)   (para_time_start[(n)] = timer ())
+#define PARA_STOP(n)    (para_time[(n)] += timer () - para_time_start[(n)])
+#define PARA_BYTES(n,x) (para_bytes[(n)] += (x))
+#else
+#define PARA_START(n)
+#define PARA_STOP(n)
+#define PARA_BYTES(n,x)
+#endif
+
+/* A registry of the memory used by each part of the program.  The places where the large arrays
+   are allocated record their size with mem_register, and mem_static_init records the largest
+   of the arrays whose size is fixed when the program is compiled.  mem_report writes the totals
+   for each subsystem, together with the peak resident memory of each process, to the .mem file.
+   See memory.c */
+
+enum mem_subsystem_enum
+{
+  MEM_ATOMIC = 0,               /* atomic data, including the fixed arrays of photoionization and collision data */
+  MEM_MODELS = 1,               /* stellar and disk atmosphere models */
+  MEM_CDF = 2,                  /* the cumulative distribution functions */
+  MEM_WIND = 3,                 /* the domains, wmain, the compact copies used during photon transport and the Roche lobe and disk surfaces */
+  MEM_PLASMA = 4,               /* plasmamain, its arrays for each ion and the cache of level populations */
+  MEM_PHOTSTORE = 5,            /* the stores of photon frequencies for each plasma cell */
+  MEM_MACRO = 6,                /* macromain and the macro atom estimators */
+  MEM_PHOTONS = 7,              /* the photon bank and the buffers of the event based transport */
+  MEM_SPECTRA = 8,              /* the spectra */
+  MEM_REVERB = 9,               /* the path distributions and delay dump for reverberation mapping */
+  NMEM_SUBSYSTEMS = 10
+};
+
+#define NMEM_ENTRIES 100        /* The maximum number of arrays which can be registered */
+
+typedef struct mem_entry
+{
+  char name[LINELENGTH];        /* The name of the array */
+  int subsystem;                /* The subsystem to which it belongs, one of mem_subsystem_enum */
+  int fixed;                    /* TRUE if the size of the array is fixed at compile time */
+  double bytes;                 /* The number of bytes currently allocated */
+} mem_entry_dummy, *MemEntryPtr;
+
+struct mem_entry mem_entries[NMEM_ENTRIES];
+int nmem_entries;
+
+
 /* Structures associated with rdchoice.  This 
  * shtructure is required only in cases where one 
  * wants to use rdchoice multiple times with different
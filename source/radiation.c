@@ -55,7 +55,7 @@ radiation (p, ds)
 {
   TopPhotPtr x_top_ptr;
 
-  WindPtr one;
+  WindHotPtr one;
   PlasmaPtr xplasma;
 
   double freq, freq_store;
@@ -71,7 +71,7 @@ radiation (p, ds)
   double density, ft, tau, tau2;
   double energy_abs;
   int n, nion;
-  double q, x, z;
+  double q, x, z, z_heat;
   double w_ave, w_in, w_out;
   double den_config ();
   int nconf;
@@ -84,7 +84,7 @@ radiation (p, ds)
   struct photon phot, phot_mid;
   int ndom, i;
 
-  one = &wmain[p->grid];        /* So one is the grid cell of interest */
+  one = &wmain_hot[p->grid];    /* So one is the grid cell of interest */
 
   ndom = one->ndom;
   xplasma = &plasmamain[one->nplasma];
@@ -96,9 +96,13 @@ radiation (p, ds)
      We currently take the average of this frequency along ds. In principle
      this could be improved, so we throw an error if the difference between v1 and v2 is large */
 
-  /* calculate velocity at original position */
-  vwind_xyz (ndom, p, v_inner); // get velocity vector at new pos
-  v1 = dot (p->lmn, v_inner);   // get direction cosine
+  /* calculate velocity at original position, using the segment set up by calculate_ds
+     for this step if there is one */
+  if (vseg_v (p, 0.0, &v1) == FALSE)
+  {
+    vwind_xyz (ndom, p, v_inner);       // get velocity vector at new pos
+    v1 = dot (p->lmn, v_inner); // get direction cosine
+  }
 
   /* compute the initial momentum of the photon */
 
@@ -112,8 +116,11 @@ radiation (p, ds)
 
   stuff_phot (p, &phot);        // copy photon ptr
   move_phot (&phot, ds);        // move it by ds
-  vwind_xyz (ndom, &phot, v_outer);     // get velocity vector at new pos
-  v2 = dot (phot.lmn, v_outer); // get direction cosine
+  if (vseg_v (p, ds, &v2) == FALSE)
+  {
+    vwind_xyz (ndom, &phot, v_outer);   // get velocity vector at new pos
+    v2 = dot (phot.lmn, v_outer);       // get direction cosine
+  }
 
   /* calculate photon frequencies in rest frame of cell */
 
@@ -231,6 +238,7 @@ radiation (p, ds)
           {
 
             /* Note that this includes a filling factor  */
+            PERF_COUNT (PERF_CONTINUUM_XSECTIONS);
             kappa_tot += x = sigma_phot (x_top_ptr, freq_xs) * density * frac_path * zdom[ndom].fill;
 
 
@@ -296,6 +304,7 @@ radiation (p, ds)
                 }
                 if (density > DENSITY_PHOT_MIN)
                 {
+                  PERF_COUNT (PERF_CONTINUUM_XSECTIONS);
                   kappa_tot += x = sigma_phot (x_top_ptr, freq_xs) * density * frac_path * zdom[ndom].fill;
                   if (geo.ioniz_or_extract && x_top_ptr->n_elec_yield != -1)    // Calculate during ionization cycles only
                   {
@@ -414,7 +423,7 @@ radiation (p, ds)
 
   if (modes.save_cell_stats && ncstat > 0)
   {
-    save_photon_stats (one, p, ds, w_ave);      // save photon statistics (extra diagnostics)
+    save_photon_stats (&wmain[p->grid], p, ds, w_ave);     // save photon statistics (extra diagnostics)
   }
 
 
@@ -451,8 +460,10 @@ radiation (p, ds)
 
     xplasma->heat_tot += z * frac_ind_comp;     /* Calculate the heating in the cell due to induced Compton heating */
     xplasma->heat_ind_comp += z * frac_ind_comp;        /* Increment the induced Compton heating counter for the cell */
+    z_heat = z * (frac_ff + frac_comp + frac_ind_comp);
     if (freq > phot_freq_min)
     {
+      z_heat += z * (frac_tot + frac_auger);
       xplasma->abs_photo += z * frac_tot_abs;   //Here we store the energy absorbed from the photon flux - different from the heating by the binding energy
       xplasma->abs_auger += z * frac_auger_abs; //same for auger
       xplasma->abs_tot += z * frac_tot_abs;     /* The energy absorbed from the photon field in this cell */
@@ -481,6 +492,7 @@ radiation (p, ds)
         xplasma->inner_ioniz[n] += kappa_inner_ion[n] * q;      //This is the number of ionizations from this innershell cross section - at this point, inner_ioniz is ordered by frequency                
       }
     }
+    xplasma->heat2 += z_heat * z_heat;  /* For the error in heat_tot */
   }
 
   stuff_phot (p, &phot_mid);    // copy photon ptr
@@ -558,7 +570,7 @@ kappa_ff (xplasma, freq)
   int ndom;
 
   /* get the domain number */
-  ndom = wmain[xplasma->nwind].ndom;
+  ndom = WIND_NDOM (xplasma->nwind);
 
   if (gaunt_n_gsqrd == 0)       //Maintain old behaviour
   {
@@ -839,6 +851,7 @@ update_banded_estimators (xplasma, p, ds, w_ave)
   /*photon weight times distance in the shell is proportional to the mean intensity */
 
   xplasma->j += w_ave * ds;
+  xplasma->j2 += (w_ave * ds) * (w_ave * ds);
 
   if (p->nscat == 0)
   {
@@ -894,6 +907,7 @@ update_banded_estimators (xplasma, p, ds, w_ave)
       xplasma->xave_freq[i] += p->freq * w_ave * ds;    /* frequency weighted by weight and distance */
       xplasma->xsd_freq[i] += p->freq * p->freq * w_ave * ds;   /* input to allow standard deviation to be calculated */
       xplasma->xj[i] += w_ave * ds;     /* photon weight times distance travelled */
+      xplasma->xj2[i] += (w_ave * ds) * (w_ave * ds);
       xplasma->nxtot[i]++;      /* increment the frequency banded photon counter */
       /* work out the range of frequencies within a band where photons have been seen */
       if (p->freq < xplasma->fmin[i])
@@ -940,6 +954,7 @@ update_banded_estimators (xplasma, p, ds, w_ave)
     /* IP needs to be radiation density in the cell. We sum contributions from
        each photon, then it is normalised in wind_update. */
     xplasma->ip += ((w_ave * ds) / (PLANCK * p->freq));
+    xplasma->ip2 += ((w_ave * ds) / (PLANCK * p->freq)) * ((w_ave * ds) / (PLANCK * p->freq));
 
     if (HEV * p->freq < 13600)  //Tartar et al integrate up to 1000Ryd to define the ionization parameter
     {
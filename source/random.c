@@ -25,6 +25,7 @@
  */
 
 gsl_rng *rng;                   // pointer to a global random number generator
+gsl_rng *qmc_rng;               // the generator which scrambles the Halton sequences, which is the same in every thread
 
 
 /**********************************************************/
@@ -246,7 +247,8 @@ vcos (x)
  * is addressed by the pointer rng, which is set up as a local
  * variable at the top of the file. The type of generator is
  * set in the call to gsl_rng_alloc - currently a meursenne
- * twister
+ * twister.  If the generator already exists, it is simply
+ * restarted with the new seed.
  *
  * ###Notes###
  * 2/18	-	Written by NSH
@@ -257,7 +259,8 @@ int
 init_rand (seed)
      int seed;
 {
-  rng = gsl_rng_alloc (gsl_rng_mt19937);        //Set the random number generator to the GSL Meursenne twirster
+  if (rng == NULL)
+    rng = gsl_rng_alloc (gsl_rng_mt19937);      //Set the random number generator to the GSL Meursenne twirster
   gsl_rng_set (rng, seed);
   return (0);
 }
@@ -281,7 +284,293 @@ init_rand (seed)
 double
 random_number (double min, double max)
 {
-  double num = gsl_rng_uniform_pos (rng);
-  double x = min + ((max - min) * num);
+  double num;
+  double x;
+
+  if (qmc.active && qmc.dim < QMC_NDIM)
+    num = qmc_uniform ();
+  else
+    num = gsl_rng_uniform_pos (rng);
+
+  x = min + ((max - min) * num);
   return (x);
 }
+
+
+
+/* The base of the radical inverse for each dimension of the Halton sequence */
+
+int qmc_base[QMC_NDIM] = { 2, 3, 5, 7, 11, 13, 17, 19 };
+
+
+
+/**********************************************************/
+/**
+ * @brief	Scrambles the Halton sequences used to launch photons for a new cycle
+ *
+ * @param [in] int  nphot			The number of photons this thread generates in the cycle
+ * @return  Always returns 0
+ *
+ * With --qmc, the first QMC_NDIM random numbers used to launch each photon
+ * from the star, the disk, the wind or an AGN are the coordinates of a point of a
+ * Halton sequence, rather than numbers from the random number generator.  The
+ * photons from each source use successive points of their own sequence, so
+ * that their positions, directions and frequencies cover the possible values more
+ * evenly than independent random numbers would.  Once a photon has been launched
+ * it is transported with numbers from the random number generator, as usual.
+ *
+ * The Halton sequence is randomised by a random permutation of the digits at each
+ * position of each coordinate, drawn afresh for each source at the start of each cycle.
+ * Each point is then uniformly distributed, so the results of a cycle are unbiased,
+ * and the results of successive cycles are independent.  The threads of a parallel
+ * run use separate ranges of points of the same sequences: the permutations are drawn
+ * from a generator of their own, qmc_rng, which is seeded with QMC_SEED in every thread,
+ * rather than from the generator for the other random numbers, whose seed depends on
+ * the thread.  Every thread scrambles the sequences once per cycle, so the generators
+ * stay in step.
+ *
+ * ### Notes ###
+ *
+ * The dimensions are used in the order in which the random numbers are drawn,
+ * but the photons from a source are generated in the same way, so the
+ * same dimensions describe the same property of each photon.  For the star and an AGN,
+ * the frequency starts at dimension 0, the position at QMC_STAR_POS and the direction at
+ * QMC_STAR_DIR.  For the disk, dimensions 0 and 1 are the radius and the azimuth within
+ * the ring, 2 chooses the side of the disk, 3 to 5 are the direction and 6 and 7 the frequency.
+ * For the wind, the cell and the process are chosen with dimensions 0 and 1 of QMC_WIND_CELL,
+ * and the frequency, the position and the direction of the photon start at dimensions 0,
+ * QMC_WIND_POS and QMC_WIND_DIR of QMC_WIND.  A dimension which is passed over when a
+ * property needs fewer random numbers than are allowed for it is left unused, and one
+ * which needs more, for example when a position is rejected and drawn again, takes its
+ * numbers from the following dimensions, or from the random number generator, so that
+ * no coordinate is used twice.
+ *
+***********************************************************/
+
+int
+qmc_init (nphot)
+     int nphot;
+{
+  int i, j, k, m, n, b;
+  unsigned char tmp, *perm;
+
+  if (qmc_rng == NULL)
+  {
+    qmc_rng = gsl_rng_alloc (gsl_rng_mt19937);
+    gsl_rng_set (qmc_rng, QMC_SEED);
+  }
+
+  for (i = 0; i < NQMC_SOURCES; i++)
+  {
+    qmc.next[i] = (long) rank_global *nphot;
+    for (j = 0; j < QMC_NDIM; j++)
+    {
+      b = qmc_base[j];
+      for (k = 0; k < QMC_NDIGITS; k++)
+      {
+        perm = qmc.perm[i][j][k];
+        for (m = 0; m < b; m++)
+          perm[m] = m;
+        for (m = b - 1; m > 0; m--)
+        {
+          n = gsl_rng_uniform_int (qmc_rng, m + 1);
+          tmp = perm[m];
+          perm[m] = perm[n];
+          perm[n] = tmp;
+        }
+      }
+    }
+  }
+
+  qmc.active = FALSE;
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief	Starts the launch of a photon from a source
+ *
+ * @param [in] int  source			The source of the photon, QMC_STAR, QMC_DISK, etc.
+ * @return  Always returns 0
+ *
+ * From now until qmc_stop is called, random_number returns the coordinates of the
+ * next point of the sequence for the source.  Nothing is done without --qmc.
+ *
+***********************************************************/
+
+int
+qmc_start (source)
+     int source;
+{
+  if (modes.qmc_launch)
+  {
+    qmc.active = TRUE;
+    qmc.source = source;
+    qmc.dim = 0;
+    qmc.index = qmc.next[source]++;
+  }
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief	Moves on to a given dimension of the point for the photon being launched
+ *
+ * @param [in] int  dim			The dimension which is to provide the next random number
+ * @return  Always returns 0
+ *
+ * If earlier properties of the photon have already used dimension dim, the
+ * next random number comes from the first unused dimension, as before.
+ *
+***********************************************************/
+
+int
+qmc_skip (dim)
+     int dim;
+{
+  if (qmc.active && dim > qmc.dim)
+    qmc.dim = dim;
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief	Ends the launch of a photon, so that random_number returns to the random number generator
+ *
+ * @return  Always returns 0
+ *
+***********************************************************/
+
+int
+qmc_stop ()
+{
+  qmc.active = FALSE;
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief	Suspends the launch of a photon, so that random_number returns to the random number generator
+ *
+ * @return  TRUE if a photon was being launched from the sequence, FALSE otherwise
+ *
+ * This is for random numbers which are drawn during the launch of a photon but do
+ * not describe it, for example those which fill a store of frequencies for later
+ * photons.  The launch is taken up again, at the same dimension, by passing the value
+ * returned to qmc_resume.
+ *
+***********************************************************/
+
+int
+qmc_suspend ()
+{
+  int active;
+
+  active = qmc.active;
+  qmc.active = FALSE;
+
+  return (active);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief	Takes up a launch suspended by qmc_suspend
+ *
+ * @param [in] int  active			The value returned by qmc_suspend
+ * @return  Always returns 0
+ *
+***********************************************************/
+
+int
+qmc_resume (active)
+     int active;
+{
+  qmc.active = active;
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief	Returns the next coordinate of the point for the photon being launched
+ *
+ * @return  A number between 0 and 1 (exclusive)
+ *
+ * The coordinate is the radical inverse of the index of the point in the base for
+ * its dimension, with the digits permuted by the permutations drawn by qmc_init.  Enough
+ * digits are used to fill a double, which means the trailing zeros of the index are
+ * permuted too.  In the unlikely event that the result is 0 or 1, a number from the random
+ * number generator is returned instead.
+ *
+***********************************************************/
+
+double
+qmc_uniform ()
+{
+  int k, b;
+  long n;
+  double x, f;
+  unsigned char (*perm)[QMC_MAXBASE];
+
+  b = qmc_base[qmc.dim];
+  perm = qmc.perm[qmc.source][qmc.dim];
+  n = qmc.index;
+  x = 0.0;
+  f = 1. / b;
+
+  for (k = 0; k < QMC_NDIGITS && f > 1e-17; k++)
+  {
+    x += f * perm[k][n % b];
+    n /= b;
+    f /= b;
+  }
+
+  qmc.dim++;
+
+  if (x <= 0.0 || x >= 1.0)
+    x = gsl_rng_uniform_pos (rng);
+
+  return (x);
+}
+
+
+
+/**********************************************************/
+/** 
+ * @brief	Divides a number of events randomly between a set of categories
+ *
+ * @param [in] int  ncat			The number of categories
+ * @param [in] int  ntot			The total number of events
+ * @param [in] double  prob[]			The relative probability of each category, which
+ * need not be normalised
+ * @param [out] unsigned int  counts[]		The number of events in each category
+ * @return  Always returns 0
+ *
+ * The counts follow a multinomial distribution, so that they are distributed
+ * exactly as if each event had been assigned to a category with its own random
+ * number, but only ncat binomial deviates are needed.
+ *
+***********************************************************/
+
+int
+random_multinomial (int ncat, int ntot, double prob[], unsigned int counts[])
+{
+  gsl_ran_multinomial (rng, ncat, ntot, prob, counts);
+  return (0);
+}
@@ -483,6 +483,7 @@ one_fb (one, f1, f2)
   int n, nn, nnn;
   double fthresh, dfreq;
   int nplasma;
+  int qmc_active;
   PlasmaPtr xplasma;
   PhotStorePtr xphot;
 
@@ -630,11 +631,14 @@ one_fb (one, f1, f2)
     Error ("one_fb:  freq %e  freqmin %e freqmax %e out of range\n", freq, f1, f2);
   }
 
-/* Now create and store for future use a set of additonal photons */
+/* Now create and store for future use a set of additonal photons.  These are not the photon being
+   launched, so they do not use the quasi-random sequence */
 
+  qmc_active = qmc_suspend ();
+  cdf_get_rand_n (&cdf_fb, xphot->freq, NSTORE);
+  qmc_resume (qmc_active);
   for (n = 0; n < NSTORE; n++)
   {
-    xphot->freq[n] = cdf_get_rand (&cdf_fb);
     if (xphot->freq[n] < f1 || xphot->freq[n] > f2)
     {
       Error ("one_fb:  freq %e  freqmin %e freqmax %e out of range\n", xphot->freq[n], f1, f2);
@@ -1678,6 +1682,7 @@ matom_select_bf_freq (WindPtr one, int nconf)
   MatomPhotStorePtr matomxphot;
 
   int n;
+  int qmc_active;
 
   fbfr = FB_FULL;               //set external variable to sample the full emissivity of this process
   fb_xtop = &phot_top[nconf];   //set external pointer to the right bf process
@@ -1757,11 +1762,14 @@ matom_select_bf_freq (WindPtr one, int nconf)
   }
 
 
-/* Now create and store for future use a set of additonal photons */
+/* Now create and store for future use a set of additonal photons.  These are not the photon being
+   launched, so they do not use the quasi-random sequence */
 
+  qmc_active = qmc_suspend ();
+  cdf_get_rand_n (&cdf_fb, matomxphot->freq, NSTORE);
+  qmc_resume (qmc_active);
   for (n = 0; n < NSTORE; n++)
   {
-    matomxphot->freq[n] = cdf_get_rand (&cdf_fb);
     if (matomxphot->freq[n] < f1 || matomxphot->freq[n] > f2)
     {
       Error ("matom_select_bf_freq:  freq %e  freqmin %e freqmax %e out of range\n", matomxphot->freq[n], f1, f2);
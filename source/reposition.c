@@ -47,13 +47,13 @@ reposition (PhotPtr p)
   if (p->nres < 0)
     return (0);                 /* Do nothing for non-resonant scatters */
 
-  if ((p->grid = n = where_in_grid (wmain[p->grid].ndom, p->x)) < 0)
+  if ((p->grid = n = where_in_grid_hint (wmain_hot[p->grid].ndom, p->x, p->grid)) < 0)
   {
     Error ("reposition: Photon not in grid when routine entered %d \n", n);
     return (n);                 /* Photon was not in wind */
   }
 
-  move_phot (p, wmain[p->grid].dfudge);
+  move_phot (p, wmain_hot[p->grid].dfudge);
 
   return (0);
 }
@@ -23,8 +23,6 @@
 #include "atomic.h"
 #include "python.h"
 
-struct photon cds_phot_old;
-double cds_v2_old, cds_dvds2_old;
 
 
 /**********************************************************/
@@ -89,17 +87,15 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
   double kap_es;
   double freq_inner, freq_outer, dfreq, ttau, freq_av;
   double mean_freq;             //A mean freq used in compton calculations.
-  int n, nn, nstart, ndelt;
+  int n, nn, n2, nstart, ndelt;
   double x;
   double ds_current, ds;
-  double v_inner[3], v_outer[3], v1, v2, dvds, dd;
-  double v_check[3], vch, vc;
-  double dvds1, dvds2;
-  struct photon phot, p_now;
-  int init_dvds;
+  double v1, v2, dvds, dd;
+  struct photon p_now;
   double kap_bf_tot, kap_ff, kap_cont;
   double tau_sobolev;
-  WindPtr one, two;
+  WindPtr one;
+  WindHotPtr hot, two;
   int check_in_grid;
   int nplasma;
   PlasmaPtr xplasma, xplasma2;
@@ -107,15 +103,14 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
   double normal[3];
 
   one = &w[p->grid];            //pointer to the cell where the photon bundle is located.
+  hot = &wmain_hot[p->grid];    //and to the parts of it that are needed on every step
 
-  nplasma = one->nplasma;
+  nplasma = hot->nplasma;
   xplasma = &plasmamain[nplasma];
-  ndom = one->ndom;
+  ndom = hot->ndom;
 
   ttau = *tau;
   ds_current = 0;
-  init_dvds = 0;
-  dvds1 = dvds2 = 0.0;
   *nres = -1;
   *istat = P_INWIND;
 
@@ -125,53 +120,14 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
   }
 
 
-/* Note that comp_phot compares the position and
- * direction of two photons.  If they are the same, then
- * it just takes v1 from the old value.  */
-
-  if (comp_phot (&cds_phot_old, p))
-  {
-    vwind_xyz (ndom, p, v_inner);
-    v1 = dot (p->lmn, v_inner);
-  }
-  else
-  {
-    v1 = cds_v2_old;
-  }
-
-  /* Initialize two photon structures phot and p_now for internal work
-   * "phot"  will be a photon vector at the far edge of the cell, while p
-   * remains the photon at its current positon. p_now  is located
-   * at the midpoint between these tow positions.
-   */
-
-  stuff_phot (p, &phot);
-  move_phot (&phot, smax);
-  vwind_xyz (ndom, &phot, v_outer);
-  v2 = dot (phot.lmn, v_outer);
+/* vseg_init calculates the velocity along the line of sight at the
+ * current position and at the far edge of the cell, shortening smax
+ * if the velocity is not close to linear along the path. The photon
+ * at the end of the path is vseg.p2 */
 
-  /* Check to see that the velocity is monotonic across the cell
-   * by calculating the velocity at the midpoint of the path
-   *
-   * If it is not monitocinc, then reduce smax
-   */
-  vc = VLIGHT;
-  while (vc > VCHECK && smax > DFUDGE)
-  {
-    stuff_phot (p, &p_now);
-    move_phot (&p_now, smax / 2.);
-    vwind_xyz (ndom, &p_now, v_check);
-    vch = dot (p_now.lmn, v_check);
-
-    vc = fabs (vch - 0.5 * (v1 + v2));
-
-    if (vc > VCHECK)
-    {
-      stuff_phot (&p_now, &phot);
-      smax *= 0.5;
-      v2 = vch;
-    }
-  }
+  smax = vseg_init (ndom, p, smax);
+  v1 = vseg.v1;
+  v2 = vseg.v2;
 
 
 /* This Doppler shift shifts the photon from the global to the local
@@ -182,7 +138,7 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
 
 
   freq_inner = p->freq * (1. - v1 / VLIGHT);
-  freq_outer = phot.freq * (1. - v2 / VLIGHT);
+  freq_outer = vseg.p2.freq * (1. - v2 / VLIGHT);
   dfreq = freq_outer - freq_inner;
 
 
@@ -203,7 +159,7 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
 
   if (fabs (dfreq) < EPSILON)
   {
-    Error ("calculate_ds: v same at both sides of cell %d\n", one->nwind);
+    Error ("calculate_ds: v same at both sides of cell %d\n", hot->nwind);
     x = -1;
     return (smax);              // This is not really the best thing to do, but it avoids disaster below
 
@@ -228,7 +184,7 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
   /*Compute the angle averaged electron scattering cross section.  Note the es is always
      treated as a scattering event. */
 
-  kap_es = klein_nishina (mean_freq) * xplasma->ne * zdom[ndom].fill;
+  kap_es = klein_nishina (mean_freq) * plasmamain_hot[nplasma].ne * zdom[ndom].fill;
 
 /* If in macro-atom mode, calculate the bf and ff opacities, becuase in macro-atom mode
  * everthing including bf is calculated as a scattering process.  The routine
@@ -256,7 +212,7 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
     /* Okay the bound free contribution to the opacity is now sorted out (SS) */
   }
 
-  if (one->vol == 0)
+  if (hot->vol == 0)
   {
     kap_bf_tot = kap_ff = 0.0;
     Error_silent ("ds_calculate vol = 0: cell %d position %g %g %g\n", p->grid, p->x[0], p->x[1], p->x[2]);
@@ -277,6 +233,7 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
     nn = nstart + n * ndelt;    /* So if the frequency of resonance increases as we travel through
                                    the grid cell, we go up in the array, otherwise down */
     x = (lin_ptr[nn]->freq - freq_inner) / dfreq;
+    PERF_COUNT (PERF_RES_SCANNED);
 
     if (0. < x && x < 1.)
     {                           /* this particular line is in resonance */
@@ -322,22 +279,15 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
 
         if (dd > LDEN_MIN)
         {
-/* If we have reached this point then we have to initalize dvds1 and dvds2.
- * Otherwise there is no need to do this, especially as dvwind_ds is an
- * expensive calculation time wise */
-
-          if (init_dvds == 0)
-          {
-            dvds1 = dvwind_ds (p);
-            dvds2 = dvwind_ds (&phot);
-            init_dvds = 1;
-          }
+/* dvds is only calculated at the ends of the segment if we reach this
+ * point, as dvwind_ds is an expensive calculation time wise */
 
-          dvds = (1. - x) * dvds1 + x * dvds2;
+          dvds = vseg_dvds (x);
 
 
 
           tau_sobolev = sobolev (one, p->x, dd, lin_ptr[nn], dvds);
+          PERF_COUNT (PERF_RES_INTERACTED);
 
 /* tau_sobolev now stores the optical depth. This is fed into the next statement for the bb estimator calculation. SS March 2004 */
 
@@ -358,14 +308,15 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
             if (check_in_grid != P_HIT_STAR && check_in_grid != P_HIT_DISK && check_in_grid != P_ESCAPE)
             {
               /* The next line may be redundant.  */
-              two = &w[where_in_grid (wmain[p_now.grid].ndom, p_now.x)];
+              n2 = where_in_grid_hint (wmain_hot[p_now.grid].ndom, p_now.x, p_now.grid);
+              two = &wmain_hot[n2];
 
               if (lin_ptr[nn]->macro_info == 1 && geo.macro_simple == 0)
               {
 /* The line is part of a macro atom so increment the estimator if desired */
                 if (geo.ioniz_or_extract == 1)
                 {
-                  bb_estimators_increment (two, p, tau_sobolev, dvds, nn);
+                  bb_estimators_increment (&w[n2], p, tau_sobolev, dvds, nn);
                 }
               }
               else if (two->vol == 0)
@@ -463,9 +414,6 @@ calculate_ds (w, p, tau_scat, tau, nres, smax, istat)
 
   *tau = ttau;
 
-  stuff_phot (&phot, &cds_phot_old);    // Store the final photon position
-  cds_v2_old = v2;              // and the velocity along the line of sight
-
   return (ds_current);
 }
 
@@ -606,7 +554,7 @@ kappa_bf (xplasma, freq, macro_all)
   macro_all--;                  // Subtract one from macro_all to avoid >= in for loop below.
 
 
-  ndom = wmain[xplasma->nwind].ndom;
+  ndom = WIND_NDOM (xplasma->nwind);
 
   for (nn = 0; nn < xplasma->kbf_nuse; nn++)    // Loop over photoionisation processes.
   {
@@ -778,16 +726,15 @@ sobolev (one, x, den_ion, lptr, dvds)
      double dvds;
 {
   double tau, xden_ion, tau_x_dvds, levden_upper;
-  double two_level_atom (), d1, d2;
+  double d1, d2;
   int nion;
-  double d_hold;
   int nplasma;
   int ndom;
   PlasmaPtr xplasma;
 
   nplasma = one->nplasma;
   xplasma = &plasmamain[nplasma];
-  ndom = wmain[plasmamain->nwind].ndom;
+  ndom = WIND_NDOM (plasmamain->nwind);
   nion = lptr->nion;
 
   if ((dvds = fabs (dvds)) == 0.0)      // This forces dvds to be positive -- a good thing!
@@ -808,21 +755,14 @@ sobolev (one, x, den_ion, lptr, dvds)
   else
   {
 /* Next few steps to allow used of better calculation of density of this particular
-ion which was done above in calculate ds.  It was made necessary by a change in the
-calls to two_level atom
+ion which was done above in calculate ds.  two_level_atom_den calculates the level
+densities for this density of the ion without altering the plasma structure
 */
-    d_hold = xplasma->density[nion];    // Store the density of this ion in the cell
-
     if (den_ion < 0)
     {
-      xplasma->density[nion] = get_ion_density (ndom, x, lptr->nion);   // Forced calculation of density
-    }
-    else
-    {
-      xplasma->density[nion] = den_ion; // Put den_ion into the density array
+      den_ion = get_ion_density (ndom, x, lptr->nion);  // Forced calculation of density
     }
-    two_level_atom (lptr, xplasma, &d1, &d2);   // Calculate d1 & d2
-    xplasma->density[nion] = d_hold;    // Restore w
+    two_level_atom_den (lptr, xplasma, den_ion, &d1, &d2);      // Calculate d1 & d2
     levden_upper = d2 / xplasma->density[nion];
   }
 
@@ -1019,7 +959,6 @@ scatter (p, nres, nnscat)
   struct photon pold;
   int i, n;
   double p_init[3], p_final[3], dp[3], dp_cyl[3];
-  WindPtr one;
   double prob_kpkt, kpkt_choice, freq_comoving;
   double gamma_twiddle, gamma_twiddle_e, stim_fact;
   int m, llvl, ulvl;
@@ -1030,9 +969,8 @@ scatter (p, nres, nnscat)
 
 
   /* get wind+plasma ptrs and domain number */
-  one = &wmain[p->grid];
-  xplasma = &plasmamain[one->nplasma];
-  ndom = wmain[p->grid].ndom;
+  xplasma = &plasmamain[WIND_NPLASMA (p->grid)];
+  ndom = WIND_NDOM (p->grid);
 
 
   stuff_phot (p, &pold);
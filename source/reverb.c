@@ -87,6 +87,7 @@ delay_dump_prep (int restart_stat)
   //Allocate and zero dump files and set extract status
   delay_dump_bank = (PhotPtr) calloc (sizeof (p_dummy), delay_dump_bank_size);
   delay_dump_spec = (int *) calloc (sizeof (int), delay_dump_bank_size);
+  mem_register (MEM_REVERB, "delay_dump_bank", (double) delay_dump_bank_size * (sizeof (p_dummy) + sizeof (int)));
   for (i = 0; i < delay_dump_bank_size; i++)
     delay_dump_spec[i] = 0;
 
@@ -142,6 +143,7 @@ delay_dump_finish (void)
   }
   free (delay_dump_bank);
   free (delay_dump_spec);
+  mem_register (MEM_REVERB, "delay_dump_bank", 0.0);
   return (0);
 }
 
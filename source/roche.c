@@ -15,7 +15,10 @@
  *    which encloses the Roche lobe of the secondary.  It must be called before
  *    the other routines can be used!
  *
- *    - hit_secondary   determines whether a photon defined by p_roche will hit the secondary
+ *    - roche_surface_init which tabulates the radius of the Roche lobe of the secondary
+ *    as a function of direction from the centre of the secondary.
+ *
+ *    - hit_secondary   determines whether a photon will hit the secondary
  *    or not.  If it misses, hit_secondary returns 0, if it hits, the return is
  *    P_SEC (or hit secondary as contained in python.h).
  *
@@ -23,20 +26,18 @@
  *
  * The secondary is located along the x, i.e. 0, axis
  *
- *    To utilize the routines you must stuff the photon of interest into the external photon "p_roche".
- *    This is necessary because the program makes use of two Numerical Recipes Routines rtsafe
- *    and golden to find zeroes and minima respectively.  Note that it is possible (likely) that these are
- *    not the very best choices of Numerical Recipes routines to use.  In particular it is possible that
- *    BRENT could replace both routines.
+ *    The routines which set up the geometry make use of the external photon "p_roche", to pass
+ *    a position and direction to the functions which are handed to zero_find and func_minimiser.
+ *
+ *    The Roche surface of the secondary does not change during a run, so once the geometry has been
+ *    established, the radius of the lobe is tabulated on a grid of directions from the centre of the
+ *    secondary.  hit_secondary first checks whether a photon passes through a sphere which encloses the
+ *    lobe, whose radius is the distance from the secondary to L1, and if it does compares the distance
+ *    of points along the path from the centre of the secondary with the tabulated radius.
  *
- *    The routines adopt the same approach as in Keith Horne's routines dealing with the Roche
- *    geometry, that is a pillbox is defined around the secondary.  The radius of the pillbox is
- *    determined by the maximum size of the secondary perpendicular to the line of sight between
- *    the two stars.  One end of the pillbox is defined by the L1 point.  The other end of the pillbox
- *    is defined by the backside of the secondary.  One first tests to find out whether a photon
- *    intersects the pillbox, and then one checks more carefully to see whether the photon actually
- *    hits the secondary (using the intersections with the pillbox to define the limits of the careful
- *    search.
+ *    An older approach, which followed Keith Horne's routines, enclosed the secondary in a pillbox
+ *    and then searched for the minimum of the potential along the path of the photon.  The pillbox
+ *    routine has been retained.
  *
 
  *
@@ -133,7 +134,7 @@ binary_basics ()
 
   /* Set geo.r2_far to be the radius of the secondary on the backside of the secondary */
 
-  x = zero_find (phi, 1.01 * geo.a, geo.l2, geo.a / 1000.) - geo.a;
+  geo.r2_far = zero_find (phi, 1.01 * geo.a, geo.l2, geo.a / 1000.) - geo.a;
 
   /* Define a plane on the backside of the secondary */
 
@@ -149,12 +150,175 @@ binary_basics ()
 
   geo.r2_width = roche2_width_max ();
   Log_silent ("binary_basics: r2_width=%6.2e\n", geo.r2_width);
+
+  roche_surface_init ();
+
+  return (0);
+}
+
+
+
+
+
+
+/**********************************************************/
+/**
+ * @brief      Tabulate the radius of the Roche lobe of the secondary as a function of direction
+ *
+ * @return     Always returns 0
+ *
+ * @details
+ * For each direction in the table roche_surf, the routine finds the distance from the
+ * centre of the secondary at which the Roche potential (which binary_basics has
+ * arranged to be zero on the surface of the lobe) changes sign, by bisection.
+ *
+ * ### Notes ###
+ *
+ * The lobe extends furthest from the secondary at L1, so the search in each direction
+ * is bounded by geo.l1_from_m2. In the direction of L1 itself the potential touches zero
+ * without changing sign, and so the radius is simply set to geo.l1_from_m2.
+ *
+ * The table depends only on quantities which are saved in the windsave file, so if
+ * it has not been constructed, as for a restarted run, hit_secondary constructs it.
+ *
+ **********************************************************/
+
+int
+roche_surface_init ()
+{
+  int i, j, n;
+  double theta, phi_r, u[3], x[3];
+  double rlo, rhi, rmid;
+
+  roche_surf.dtheta = PI / (NROCHE_THETA - 1);
+  roche_surf.dphi = 0.5 * PI / (NROCHE_PHI - 1);
+  roche_surf.rmin = roche_surf.rmax = geo.l1_from_m2;
+
+  for (i = 0; i < NROCHE_THETA; i++)
+  {
+    theta = i * roche_surf.dtheta;
+    for (j = 0; j < NROCHE_PHI; j++)
+    {
+      if (i == 0)
+      {
+        roche_surf.r[i][j] = geo.l1_from_m2;
+        continue;
+      }
+
+      phi_r = j * roche_surf.dphi;
+      u[0] = -cos (theta);
+      u[1] = sin (theta) * cos (phi_r);
+      u[2] = sin (theta) * sin (phi_r);
+
+      rlo = 1.e-3 * geo.l1_from_m2;
+      rhi = geo.l1_from_m2;
+      for (n = 0; n < 60; n++)
+      {
+        rmid = 0.5 * (rlo + rhi);
+        x[0] = geo.a + rmid * u[0];
+        x[1] = rmid * u[1];
+        x[2] = rmid * u[2];
+        if (roche_potential (x) < 0.0)
+          rlo = rmid;
+        else
+          rhi = rmid;
+      }
+      roche_surf.r[i][j] = 0.5 * (rlo + rhi);
+
+      if (roche_surf.r[i][j] < roche_surf.rmin)
+        roche_surf.rmin = roche_surf.r[i][j];
+    }
+  }
+
+  roche_surf.ok = TRUE;
+
+  Log_silent ("roche_surface_init: The radius of the Roche lobe of the secondary ranges from %8.2e to %8.2e\n",
+              roche_surf.rmin, roche_surf.rmax);
+
   return (0);
 }
 
 
 
 
+/**********************************************************/
+/**
+ * @brief      Find the radius of the Roche lobe of the secondary in a given direction
+ *
+ * @param [in] double  d[]   A vector from the centre of the secondary
+ * @param [in] double  r   The length of d, which must be non-zero
+ * @return     The distance from the centre of the secondary to the Roche surface
+ * in the direction of d
+ *
+ * @details
+ * The radius is interpolated bilinearly in the table constructed by roche_surface_init.
+ *
+ **********************************************************/
+
+double
+roche_radius (d, r)
+     double d[];
+     double r;
+{
+  double cost, theta, phi_r, ft, fp;
+  int i, j;
+
+  cost = -d[0] / r;
+  if (cost > 1.0)
+    cost = 1.0;
+  else if (cost < -1.0)
+    cost = -1.0;
+
+  theta = acos (cost) / roche_surf.dtheta;
+  phi_r = atan2 (fabs (d[2]), fabs (d[1])) / roche_surf.dphi;
+
+  i = (int) theta;
+  if (i > NROCHE_THETA - 2)
+    i = NROCHE_THETA - 2;
+  j = (int) phi_r;
+  if (j > NROCHE_PHI - 2)
+    j = NROCHE_PHI - 2;
+
+  ft = theta - i;
+  fp = phi_r - j;
+
+  return ((1. - ft) * ((1. - fp) * roche_surf.r[i][j] + fp * roche_surf.r[i][j + 1])
+          + ft * ((1. - fp) * roche_surf.r[i + 1][j] + fp * roche_surf.r[i + 1][j + 1]));
+}
+
+
+
+
+#define NROCHE_SAMPLE  9        /* The number of points at which the path through the enclosing sphere is first sampled */
+#define NROCHE_REFINE  16       /* The number of golden section steps used to refine the closest approach */
+
+
+/**********************************************************/
+/**
+ * @brief      Find the amount by which a point lies outside the Roche lobe of the secondary
+ *
+ * @param [in] double  x[]   A position
+ * @return     The distance of x from the centre of the secondary, less the radius of the
+ * Roche lobe in that direction.  This is negative if x is inside the lobe.
+ *
+ **********************************************************/
+
+double
+roche_excess (x)
+     double x[];
+{
+  double d[3], r;
+
+  d[0] = x[0] - geo.a;
+  d[1] = x[1];
+  d[2] = x[2];
+
+  if ((r = length (d)) == 0)
+    return (-roche_surf.rmin);
+
+  return (r - roche_radius (d, r));
+}
+
 
 
 /**********************************************************/
@@ -169,13 +333,16 @@ binary_basics ()
  *
  * ###Notes###
  *
- * The routine first checks if the photon encounters a pill_box that surrouds the secondary.  Photons
- * that do not encounter this pill box do not hit the secondar.  If  the photon enters the pill box, then
- * the routine determines whether the photon hits the roche surface of the secondary, by finding the minimum
- * value of the Rooche potential. If this is greater than 0, then the photon has missed the secondary. If less
- * thn zero then it has hit the secondary.
+ * The routine first finds where the path of the photon crosses a sphere around the
+ * secondary which encloses the Roche lobe.  Photons which miss the sphere miss the
+ * secondary, and photons which pass through a sphere which is enclosed by the lobe
+ * hit it.  Otherwise the distance of points along the path inside the enclosing sphere
+ * from the centre of the secondary is compared with the tabulated radius of the lobe,
+ * first at a set of evenly spaced points, and then with a golden section search about
+ * the point which came closest to the surface.
  *
- * modified in 2019 to use gsl routines instead of numerical recipies
+ * The photon itself is not modified, and no external variables other than the table
+ * are used.
  *
  **********************************************************/
 
@@ -183,63 +350,99 @@ int
 hit_secondary (p)
      PhotPtr p;
 {
-  double smin, smax, smid, s;
-  double potential;
-  double idelt = 1e-2;
-  double pillbox ();
-  void *dummy_par = NULL;       //A variable required (but not set) for calls to phi
+  double d[3], b, c, disc;
+  double smin, smax, s, ds, h, hbest;
+  double s1, s2, s3, s4, h3, h4;
+  double x[3];
+  int n, nbest;
+
+  if (!roche_surf.ok)
+    roche_surface_init ();
 
+  /* Find where the path crosses the sphere which encloses the lobe */
 
-  if (pillbox (p, &smin, &smax) == VERY_BIG)
+  d[0] = p->x[0] - geo.a;
+  d[1] = p->x[1];
+  d[2] = p->x[2];
+
+  b = dot (d, p->lmn);
+  c = dot (d, d);
+  disc = b * b - c + roche_surf.rmax * roche_surf.rmax;
+
+  if (disc <= 0.0)
     return (0);                 /* Missed secondary */
-  stuff_phot (p, &p_roche);
 
+  disc = sqrt (disc);
+  smax = -b + disc;
+  if (smax <= 0.0)
+    return (0);                 /* The secondary is behind the photon */
+  smin = -b - disc;
+  if (smin < 0.0)
+    smin = 0.0;
+
+  /* Check whether the path passes through a sphere which lies entirely within the lobe */
+
+  if (c < roche_surf.rmin * roche_surf.rmin || (b < 0.0 && c - b * b < roche_surf.rmin * roche_surf.rmin))
+    return (P_SEC);
 
-  smid = 0.5 * (smin + smax);
-  if (phi (smid, dummy_par) > phi (smin, dummy_par) || phi (smid, dummy_par) > phi (smax, dummy_par))   //value of the function at the midpoint is greater than the end(s) problem
+  /* Sample the path through the enclosing sphere */
+
+  ds = (smax - smin) / (NROCHE_SAMPLE - 1);
+  hbest = VERY_BIG;
+  nbest = 0;
+  for (n = 0; n < NROCHE_SAMPLE; n++)
   {
-    if (phi (smin + idelt * (smax - smin), dummy_par) > phi (smin, dummy_par) && phi (smax - idelt * (smax - smin), dummy_par) < phi (smax, dummy_par)) //monotonically rising? - no minimum
+    s = smin + n * ds;
+    vmove (p->x, p->lmn, s, x);
+    if ((h = roche_excess (x)) < 0.0)
+      return (P_SEC);
+    if (h < hbest)
     {
-      potential = fmin (phi (smin, dummy_par), phi (smax, dummy_par));
+      hbest = h;
+      nbest = n;
     }
+  }
 
-    else if (phi (smin + idelt * (smax - smin), dummy_par) < phi (smin, dummy_par) && phi (smax - idelt * (smax - smin), dummy_par) > phi (smax, dummy_par))    //monotonically rising? - no minimum
-    {
-      potential = fmin (phi (smin, dummy_par), phi (smax, dummy_par));
-    }
-    else if (phi (smin + idelt * (smax - smin), dummy_par) > phi (smin, dummy_par) && phi (smax - idelt * (smax - smin), dummy_par) > phi (smax, dummy_par))    //hump - probably no minimum
-    {
-      potential = fmin (phi (smin, dummy_par), phi (smax, dummy_par));
-    }
-    else if (phi (smin + idelt * (smax - smin), dummy_par) < phi (smin, dummy_par) && phi (smax - idelt * (smax - smin), dummy_par) < phi (smax, dummy_par))    //there most likely is a minimum - need to find a sensibly midpoint 
+  /* Refine the search between the neighbours of the sample which came closest to the surface */
+
+  s1 = smin + (nbest > 0 ? nbest - 1 : 0) * ds;
+  s2 = smin + (nbest < NROCHE_SAMPLE - 1 ? nbest + 1 : NROCHE_SAMPLE - 1) * ds;
+
+  s3 = s2 - 0.618034 * (s2 - s1);
+  s4 = s1 + 0.618034 * (s2 - s1);
+  vmove (p->x, p->lmn, s3, x);
+  h3 = roche_excess (x);
+  vmove (p->x, p->lmn, s4, x);
+  h4 = roche_excess (x);
+
+  for (n = 0; n < NROCHE_REFINE; n++)
+  {
+    if (h3 < 0.0 || h4 < 0.0)
+      return (P_SEC);
+    if (h3 < h4)
     {
-      if (phi (smin, dummy_par) < phi (smax, dummy_par))
-      {
-        smid = smin + idelt * (smax - smin);    //the function at this point, just inside smin should be lower than the function at smin
-      }
-      else
-      {
-        smid = smax - idelt * (smax - smin);    //the function at this point, just inside smax should be lower than the function at smax
-      }
-      potential = func_minimiser (smin, smid, smax, phi, 0.0001, &s);   //call the minimuser            
+      s2 = s4;
+      s4 = s3;
+      h4 = h3;
+      s3 = s2 - 0.618034 * (s2 - s1);
+      vmove (p->x, p->lmn, s3, x);
+      h3 = roche_excess (x);
     }
     else
     {
-      potential = 1.;           //goodness only knows, lets say the photon missed
+      s1 = s3;
+      s3 = s4;
+      h3 = h4;
+      s4 = s1 + 0.618034 * (s2 - s1);
+      vmove (p->x, p->lmn, s4, x);
+      h4 = roche_excess (x);
     }
   }
-  else
-  {
-    potential = func_minimiser (smin, smid, smax, phi, 0.0001, &s);     //All is well behaved, call the minimiser
-  }
-
-
-
-  if (potential > 0.0)
-    return (0);                 /*Missed secondary) */
 
+  if (h3 < 0.0 || h4 < 0.0)
+    return (P_SEC);
 
-  return (P_SEC);
+  return (0);                   /*Missed secondary) */
 }
 
 
@@ -401,27 +604,23 @@ int phi_init = 0;
 double phi_gm1, phi_gm2, phi_3, phi_4;
 
 
+
 /**********************************************************/
 /**
- * @brief      Calculate the Roche potential at position indicated by the photon p_roche and the length s
- *
- * @param [in] double  s   The distance from the current position of the photon to the point where one wishes to calculate the Roche potential
- *              void * params  An unused variable required to make the function compatible with the gsl routine used to minimise it
- * @return     The Roche potential at the postiong given by the photon moved by a distance s
- *
- * Given a photon stored in p_roche and a distance s to move the photone, phi returns the roche potentail at that point
- *
- * ###Notes###
+ * @brief      Calculate the Roche potential at a position
  *
+ * @param [in] double  x[]   A position, measured from the primary
+ * @return     The Roche potential at x, offset so that it is zero on the Roche
+ * lobes once binary_basics has set geo.phi
  *
  **********************************************************/
 
 double
-phi (double s, void *params)
+roche_potential (x)
+     double x[];
 {
-  struct photon pp;
+  double xx[3];
   double x1, x2, z, z1, z2, z3;
-  double length ();
 
   if (phi_init == 0)
   {
@@ -433,16 +632,15 @@ phi (double s, void *params)
     phi_init++;
   }
 
-  stuff_phot (&p_roche, &pp);
-  move_phot (&pp, s);           /* So now we have the actuaal position of the photon relative to the WD */
-
-  if ((x1 = length (&pp.x[0])) == 0)
+  if ((x1 = length (x)) == 0)
     return (-VERY_BIG);
   z1 = -phi_gm1 / x1;
-  z3 = -phi_3 * ((pp.x[0] - phi_4) * (pp.x[0] - phi_4) + pp.x[1] * pp.x[1]) - geo.phi;
+  z3 = -phi_3 * ((x[0] - phi_4) * (x[0] - phi_4) + x[1] * x[1]) - geo.phi;
 
-  pp.x[0] -= geo.a;             /* Here we make pp refer to the positions w.r.t. the secondary */
-  if ((x2 = length (&pp.x[0])) == 0)
+  xx[0] = x[0] - geo.a;         /* Here we make xx refer to the positions w.r.t. the secondary */
+  xx[1] = x[1];
+  xx[2] = x[2];
+  if ((x2 = length (xx)) == 0)
     return (-VERY_BIG);
 
   z2 = -phi_gm2 / x2;
@@ -453,8 +651,34 @@ phi (double s, void *params)
     z = -1.e20;
 
   return (z);
+}
+
+
+
+
+/**********************************************************/
+/**
+ * @brief      Calculate the Roche potential at position indicated by the photon p_roche and the length s
+ *
+ * @param [in] double  s   The distance from the current position of the photon to the point where one wishes to calculate the Roche potential
+ *              void * params  An unused variable required to make the function compatible with the gsl routine used to minimise it
+ * @return     The Roche potential at the postiong given by the photon moved by a distance s
+ *
+ * Given a photon stored in p_roche and a distance s to move the photone, phi returns the roche potentail at that point
+ *
+ * ###Notes###
+ *
+ *
+ **********************************************************/
+
+double
+phi (double s, void *params)
+{
+  double x[3];
 
+  vmove (p_roche.x, p_roche.lmn, s, x);  /* So now we have the actual position of the photon relative to the WD */
 
+  return (roche_potential (x));
 }
 
 #define EPS 10000.
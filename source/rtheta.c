@@ -397,6 +397,8 @@ rtheta_volumes (ndom, w)
     for (j = 0; j < mdim; j++)
     {
       wind_ij_to_n (ndom, i, j, &n);
+      if (!setup_cell_mine (n))
+        continue;               /* Another thread sets up this cell */
 
       rmin = zdom[ndom].wind_x[i];
       rmax = zdom[ndom].wind_x[i + 1];
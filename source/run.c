@@ -50,7 +50,8 @@ calculate_ionization (restart_stat)
      int restart_stat;
 {
   int n, nn;
-  double zz, zzz, zze, ztot, zz_adiab, zz_lofreq;
+  int nphot_cycle, nphot_first, nphot_adapt;
+  double zz, zz_batch, zzz, zze, ztot, zz_adiab, zz_lofreq;
   double zz_abs, zz_scat, zz_star, zz_disk;
   double zz_err, zz_else;
   int nn_adiab, nn_lofreq;
@@ -62,12 +63,15 @@ calculate_ionization (restart_stat)
   double freqmin, freqmax, x;
   long nphot_to_define, nphot_min;
   int iwind;
+  struct back_heating back_heating;
 
 
 #ifdef MPI_ON
   int ioniz_spec_helpers;
 #endif
 
+  nphot_adapt = 0;              /* The number of photons chosen by phot_budget_next for the next cycle */
+
   /* Save the the windfile before the first ionization cycle in order to
    * allow investigation of issues that may have arisen at the very beginning
    */
@@ -129,6 +133,8 @@ calculate_ionization (restart_stat)
 
     Log ("!!Python: Beginning cycle %d of %d for defining wind\n", geo.wcycle + 1, geo.wcycles);
     Log_flush ();               /* Flush the log file (so that we know where are if there are problems */
+    perf_reset ();
+    para_profile_reset ();
 
     /* Initialize all of the arrays, etc, that need initialization for each cycle
      */
@@ -150,10 +156,15 @@ calculate_ionization (restart_stat)
 
 
     /* If we are using photon speed up mode then the number of photons varies by cycle in the
-     * ionization phase.  We set this up here
+     * ionization phase.  We set this up here.  If the number is chosen from the errors in the
+     * estimators, the first cycle, including the first after a restart, starts from the minimum
      */
 
-    if (modes.photon_speedup)
+    if (modes.photon_adaptive)
+    {
+      NPHOT = nphot_adapt > 0 ? nphot_adapt : NPHOT_MAX / pow (10., PHOT_RANGE);
+    }
+    else if (modes.photon_speedup)
     {
       nphot_min = NPHOT_MAX / pow (10., PHOT_RANGE);
 
@@ -167,105 +178,149 @@ calculate_ionization (restart_stat)
 
     Log ("!!Python: %1.2e photons will be transported for cycle %i\n", (double) NPHOT, geo.wcycle);
 
-    /* Create the photons that need to be transported through the wind
+    /* Create the photons that need to be transported through the wind, and transport them.
      *
-     * NPHOT is the number of photon bundles which will equal the luminosity; 
+     * nphot_cycle is the number of photon bundles which will equal the luminosity; 
      * 0 => for ionization calculation 
+     *
+     * If the photons do not all fit in the photon structure, they are generated and transported
+     * in batches of at most NPHOT_BATCH, with NPHOT set to the number in the current batch.
      */
 
-    nphot_to_define = (long) NPHOT;
+    nphot_cycle = NPHOT;
+    nphot_to_define = (long) nphot_cycle;
 
-    define_phot (p, freqmin, freqmax, nphot_to_define, 0, iwind, 1);
-
-    /* Zero the arrays, and other variables that need to be zeroed after the photons are generated. */
+    zz = zzz = zze = zz_adiab = zz_abs = zz_scat = zz_star = zz_disk = zz_err = zz_else = zz_lofreq = 0.0;
+    nn_adiab = nn_lofreq = 0;
 
+    /* Make the compact copies of the wind which are read while photons are in flight, once for all the batches */
+    wind_hot_update ();
 
-    geo.lum_star_back = 0;
-    geo.lum_disk_back = 0;
+    for (nphot_first = 0; nphot_first < nphot_cycle; nphot_first += NPHOT)
+    {
+      NPHOT = nphot_cycle - nphot_first < NPHOT_BATCH ? nphot_cycle - nphot_first : NPHOT_BATCH;
 
+      /* The sources are set up using the heating of the star and disk in the previous cycle, so 
+         for later batches, put this back while the photons are generated */
 
-    for (n = 0; n < NRINGS; n++)
-    {
-      qdisk.heat[n] = qdisk.nphot[n] = qdisk.w[n] = qdisk.ave_freq[n] = 0;
-    }
+      if (nphot_first > 0)
+        swap_back_heating (&back_heating);
 
+      PERF_START (PERF_T_DEFINE_PHOT);
+      define_phot (p, freqmin, freqmax, nphot_to_define, 0, iwind, 1, nphot_cycle, nphot_first);
+      PERF_STOP (PERF_T_DEFINE_PHOT);
 
+      if (nphot_first > 0)
+        swap_back_heating (&back_heating);
+      else
+      {
+        /* Zero the arrays, and other variables that need to be zeroed after the photons are generated. */
 
-    photon_checks (p, freqmin, freqmax, "Check before transport");
+        back_heating.lum_star_back = geo.lum_star_back;
+        back_heating.lum_disk_back = geo.lum_disk_back;
 
+        geo.lum_star_back = 0;
+        geo.lum_disk_back = 0;
 
 
-    zz = 0.0;
-    for (nn = 0; nn < NPHOT; nn++)
-    {
-      zz += p[nn].w;
-    }
+        for (n = 0; n < NRINGS; n++)
+        {
+          back_heating.heat[n] = qdisk.heat[n];
+          qdisk.heat[n] = qdisk.nphot[n] = qdisk.w[n] = qdisk.ave_freq[n] = 0;
+        }
+      }
 
-    Log ("!!python: Total photon luminosity before transphot %18.12e\n", zz);
-    Log_flush ();
-    ztot += zz;                 /* Total luminosity in all cycles, used for calculating disk heating */
 
-    /* kbf_need determines how many & which bf processes one needs to considere.  It was introduced
-     * as a way to speed up the program.  It has to be recalculated evey time one changes
-     * freqmin and freqmax
-     */
 
-    kbf_need (freqmin, freqmax);
+      photon_checks (p, freqmin, freqmax, "Check before transport");
 
-    /* NSH 22/10/12  This next call populates the prefactor for free free heating for each cell in the plasma array */
-    /* NSH 4/12/12  Changed so it is only called if we have read in gsqrd data */
-    if (gaunt_n_gsqrd > 0)
-      pop_kappa_ff_array ();
 
-    /* Transport the photons through the wind */
-    trans_phot (w, p, 0);
 
-    /*Determine how much energy was absorbed in the wind */
-    zze = zzz = zz_adiab = zz_abs = zz_scat = zz_star = zz_disk = zz_err = zz_else = zz_lofreq = 0.0;
-    nn_adiab = nn_lofreq = 0;
-    for (nn = 0; nn < NPHOT; nn++)
-    {
-      zzz += p[nn].w;
-      if (p[nn].istat == P_ESCAPE)
-      {
-        zze += p[nn].w;
-      }
-      else if (p[nn].istat == P_ADIABATIC)
+      zz_batch = 0.0;
+      for (nn = 0; nn < NPHOT; nn++)
       {
-        zz_adiab += p[nn].w;
-        nn_adiab++;
+        zz_batch += p[nn].w;
       }
-      else if (p[nn].istat == P_LOFREQ_FF)
+      zz += zz_batch;
+      ztot += zz_batch;         /* Total luminosity in all cycles, used for calculating disk heating */
+
+      /* kbf_need determines how many & which bf processes one needs to considere.  It was introduced
+       * as a way to speed up the program.  It has to be recalculated evey time one changes
+       * freqmin and freqmax
+       */
+
+      kbf_need (freqmin, freqmax);
+
+      /* NSH 22/10/12  This next call populates the prefactor for free free heating for each cell in the plasma array */
+      /* NSH 4/12/12  Changed so it is only called if we have read in gsqrd data */
+      if (gaunt_n_gsqrd > 0)
+        pop_kappa_ff_array ();
+
+      /* Transport the photons through the wind */
+      PERF_START (PERF_T_TRANS_PHOT);
+      PARA_START (PARA_TRANS_PHOT);
+      trans_phot (w, p, 0);
+      PARA_STOP (PARA_TRANS_PHOT);
+      PERF_STOP (PERF_T_TRANS_PHOT);
+
+      /*Determine how much energy was absorbed in the wind */
+      for (nn = 0; nn < NPHOT; nn++)
       {
-        zz_lofreq += p[nn].w;
-        nn_lofreq++;
-      }
-      else if (p[nn].istat == P_ABSORB)
-      {
-        zz_abs += p[nn].w;
-      }
-      else if (p[nn].istat == P_TOO_MANY_SCATTERS)
-      {
-        zz_scat += p[nn].w;
-      }
-      else if (p[nn].istat == P_HIT_STAR)
-      {
-        zz_star += p[nn].w;
-      }
-      else if (p[nn].istat == P_HIT_DISK)
-      {
-        zz_disk += p[nn].w;
-      }
-      else if (p[nn].istat == P_ERROR || p[nn].istat == P_ERROR_MATOM)
-      {
-        zz_err += p[nn].w;
-      }
-      else
-      {
-        zz_else += p[nn].w;
+        zzz += p[nn].w;
+        if (p[nn].istat == P_ESCAPE)
+        {
+          zze += p[nn].w;
+        }
+        else if (p[nn].istat == P_ADIABATIC)
+        {
+          zz_adiab += p[nn].w;
+          nn_adiab++;
+        }
+        else if (p[nn].istat == P_LOFREQ_FF)
+        {
+          zz_lofreq += p[nn].w;
+          nn_lofreq++;
+        }
+        else if (p[nn].istat == P_ABSORB)
+        {
+          zz_abs += p[nn].w;
+        }
+        else if (p[nn].istat == P_TOO_MANY_SCATTERS)
+        {
+          zz_scat += p[nn].w;
+        }
+        else if (p[nn].istat == P_HIT_STAR)
+        {
+          zz_star += p[nn].w;
+        }
+        else if (p[nn].istat == P_HIT_DISK)
+        {
+          zz_disk += p[nn].w;
+        }
+        else if (p[nn].istat == P_ERROR || p[nn].istat == P_ERROR_MATOM)
+        {
+          zz_err += p[nn].w;
+        }
+        else
+        {
+          zz_else += p[nn].w;
+        }
       }
+
+      photon_checks (p, freqmin, freqmax, "Check after transport");
+
+      PERF_START (PERF_T_SPECTRUM_CREATE);
+      spectrum_create (p, freqmin, freqmax, geo.nangles, geo.select_extract);
+      PERF_STOP (PERF_T_SPECTRUM_CREATE);
     }
 
+    wind_hot_release ();
+
+    NPHOT = nphot_cycle;
+
+    Log ("!!python: Total photon luminosity before transphot %18.12e\n", zz);
+    Log_flush ();
+
     Log
       ("!!python: Total photon luminosity after transphot  %18.12e (absorbed/lost  %18.12e). Radiated luminosity %18.12e\n",
        zzz, zzz - zz, zze);
@@ -282,22 +337,37 @@ calculate_ionization (restart_stat)
     Log ("!!python: luminosity lost by the unknown                %18.12e \n", zz_else);
 
 
-    photon_checks (p, freqmin, freqmax, "Check after transport");
-
-    spectrum_create (p, freqmin, freqmax, geo.nangles, geo.select_extract);
-
-
 
     /* At this point we should communicate all the useful infomation 
        that has been accummulated on differenet MPI tasks */
 
 #ifdef MPI_ON
+    /* Wait for all of the processes to finish transporting their photons, so that the
+       time taken by the slowest one is recorded here rather than in the communication */
+
+    PARA_START (PARA_WAIT);
+    MPI_Barrier (MPI_COMM_WORLD);
+    PARA_STOP (PARA_WAIT);
+
+    PERF_START (PERF_T_COMMUNICATE);
 
     communicate_estimators_para ();
 
     communicate_matom_estimators_para ();       // this will return 0 if nlevels_macro == 0
+
+    communicate_costs_para ();
+
+    if (modes.photon_adaptive || modes.freeze_cells)
+      communicate_noise_para ();
+
+    PERF_STOP (PERF_T_COMMUNICATE);
 #endif
 
+    /* Choose the number of photons for the next cycle, before wind_update normalises the estimators */
+
+    if (modes.photon_adaptive)
+      nphot_adapt = phot_budget_next (NPHOT);
+
 
 
     /* Calculate and store the amount of heating of the disk due to radiation impinging on the disk */
@@ -311,7 +381,9 @@ calculate_ionization (restart_stat)
         qdisk_save (files.disk, ztot);
 #ifdef MPI_ON
     }
+    PARA_START (PARA_WAIT);
     MPI_Barrier (MPI_COMM_WORLD);
+    PARA_STOP (PARA_WAIT);
 #endif
 
 /* Completed writing file describing disk heating */
@@ -320,19 +392,24 @@ calculate_ionization (restart_stat)
 
 /* Note that this step is parallelized */
 
+    PERF_START (PERF_T_WIND_UPDATE);
     wind_update (w);
-
+    PERF_STOP (PERF_T_WIND_UPDATE);
 
     Log ("Completed ionization cycle %d :  The elapsed TIME was %f\n", geo.wcycle + 1, timer ());
 
     /* Do an MPI reduce to get the spectra all gathered to the master thread */
 
 #ifdef MPI_ON
+    PERF_START (PERF_T_COMMUNICATE);
 
     gather_spectra_para (ioniz_spec_helpers, MSPEC);
 
+    PERF_STOP (PERF_T_COMMUNICATE);
 #endif
 
+    PERF_START (PERF_T_OUTPUT);
+
 
 
 #ifdef MPI_ON
@@ -353,7 +430,9 @@ calculate_ionization (restart_stat)
                                            by the disk */
 #ifdef MPI_ON
     }
+    PARA_START (PARA_WAIT);
     MPI_Barrier (MPI_COMM_WORLD);
+    PARA_STOP (PARA_WAIT);
 #endif
 
     /* Save everything after each cycle and prepare for the next cycle 
@@ -384,18 +463,30 @@ calculate_ionization (restart_stat)
         wind_save (dummy);
         Log ("Saved wind structure in %s\n", dummy);
       }
-      if (modes.make_tables)
-      {
-        strcpy (dummy, "");
-        sprintf (dummy, "diag_%s/%s.%02d", files.root, files.root, geo.wcycle);
-        do_windsave2table (dummy, 0);
-      }
 
 #ifdef MPI_ON
     }
+    PARA_START (PARA_WAIT);
     MPI_Barrier (MPI_COMM_WORLD);
+    PARA_STOP (PARA_WAIT);
 #endif
 
+    /* Every thread holds the entire wind at this point, so the tables are shared between them */
+
+    if (modes.make_tables)
+    {
+      strcpy (dummy, "");
+      sprintf (dummy, "diag_%s/%s.%02d", files.root, files.root, geo.wcycle);
+      do_windsave2table (dummy, 0, FALSE);
+    }
+    PERF_STOP (PERF_T_OUTPUT);
+
+    /* Write out the counters and timers for the cycle which has just been completed */
+
+    perf_write ("ion", geo.wcycle - 1);
+    para_profile_write ("ion", geo.wcycle - 1);
+    mem_report ("ion", geo.wcycle - 1);
+
     check_time (files.root);
     Log_flush ();               /*Flush the logfile */
 
@@ -445,6 +536,8 @@ make_spectra (restart_stat)
   long nphot_to_define;
   int iwind;
   int n;
+  int nphot_first;
+  struct back_heating back_heating;
 
 #ifdef MPI_ON
   char dummy[LINELENGTH];
@@ -553,6 +646,9 @@ make_spectra (restart_stat)
 
     Log ("!!Cycle %d of %d to calculate a detailed spectrum\n", geo.pcycle + 1, geo.pcycles);
     Log_flush ();
+    perf_reset ();
+    para_profile_reset ();
+    wind_cost_init ();
 
     if (!geo.wind_radiation)
       iwind = -1;               /* Do not generate photons from wind */
@@ -570,43 +666,89 @@ make_spectra (restart_stat)
 
      */
 
-    NPHOT = NPHOT_MAX;          // Assure that we really are creating as many photons as we expect.
+    nphot_to_define = (long) NPHOT_MAX *(long) geo.pcycles;
 
-    nphot_to_define = (long) NPHOT *(long) geo.pcycles;
-    define_phot (p, freqmin, freqmax, nphot_to_define, 1, iwind, 0);
+    /* As in the ionization cycles, the photons are generated and transported in batches
+       if there are more of them than will fit in the photon structure at once */
 
-    /* TODAY */
-    if (modes.save_photons)
+    wind_hot_update ();
+
+    for (nphot_first = 0; nphot_first < NPHOT_MAX; nphot_first += NPHOT)
     {
-      for (n = 0; n < NPHOT; n++)
+      NPHOT = NPHOT_MAX - nphot_first < NPHOT_BATCH ? NPHOT_MAX - nphot_first : NPHOT_BATCH;
+
+      /* The heating of the star and disk goes on accumulating in the spectral cycles, but every batch
+         must be generated from the sources as they were at the start of the cycle */
+
+      if (nphot_first > 0)
+        swap_back_heating (&back_heating);
+
+      PERF_START (PERF_T_DEFINE_PHOT);
+      define_phot (p, freqmin, freqmax, nphot_to_define, 1, iwind, 0, NPHOT_MAX, nphot_first);
+      PERF_STOP (PERF_T_DEFINE_PHOT);
+
+      if (nphot_first > 0)
+        swap_back_heating (&back_heating);
+      else
       {
-        save_photons (&p[n], "CREATE");
+        back_heating.lum_star_back = geo.lum_star_back;
+        back_heating.lum_disk_back = geo.lum_disk_back;
+        for (n = 0; n < NRINGS; n++)
+          back_heating.heat[n] = qdisk.heat[n];
       }
-    }
 
-    for (icheck = 0; icheck < NPHOT; icheck++)
-    {
-      if (sane_check (p[icheck].freq))
+      /* TODAY */
+      if (modes.save_photons)
       {
-        Error ("python after define phot:sane_check unnatural frequency for photon %d\n", icheck);
+        for (n = 0; n < NPHOT; n++)
+        {
+          save_photons (&p[n], "CREATE");
+        }
       }
-    }
 
+      for (icheck = 0; icheck < NPHOT; icheck++)
+      {
+        if (sane_check (p[icheck].freq))
+        {
+          Error ("python after define phot:sane_check unnatural frequency for photon %d\n", icheck);
+        }
+      }
 
-    /* Tranport photons through the wind */
 
-    trans_phot (w, p, geo.select_extract);
+      /* Tranport photons through the wind */
 
-    spectrum_create (p, freqmin, freqmax, geo.nangles, geo.select_extract);
+      PERF_START (PERF_T_TRANS_PHOT);
+      PARA_START (PARA_TRANS_PHOT);
+      trans_phot (w, p, geo.select_extract);
+      PARA_STOP (PARA_TRANS_PHOT);
+      PERF_STOP (PERF_T_TRANS_PHOT);
+
+      PERF_START (PERF_T_SPECTRUM_CREATE);
+      spectrum_create (p, freqmin, freqmax, geo.nangles, geo.select_extract);
+      PERF_STOP (PERF_T_SPECTRUM_CREATE);
+    }
+
+    wind_hot_release ();
+
+    NPHOT = NPHOT_MAX;          // Assure that we really are creating as many photons as we expect.
 
 /* Write out the detailed spectrum each cycle so that one can see the statistics build up! */
     renorm = ((double) (geo.pcycles)) / (geo.pcycle + 1.0);
 
     /* Do an MPI reduce to get the spectra all gathered to the master thread */
 #ifdef MPI_ON
+    PARA_START (PARA_WAIT);
+    MPI_Barrier (MPI_COMM_WORLD);
+    PARA_STOP (PARA_WAIT);
+
+    PERF_START (PERF_T_COMMUNICATE);
     gather_spectra_para (spec_spec_helpers, nspectra);
+    communicate_costs_para ();
+    PERF_STOP (PERF_T_COMMUNICATE);
 #endif
 
+    PERF_START (PERF_T_OUTPUT);
+
 
 #ifdef MPI_ON
     if (rank_global == 0)
@@ -640,12 +782,20 @@ make_spectra (restart_stat)
 #ifdef MPI_ON
     }
 #endif
+    PERF_STOP (PERF_T_OUTPUT);
+
+    perf_write ("spec", geo.pcycle - 1);
+    para_profile_write ("spec", geo.pcycle - 1);
+    mem_report ("spec", geo.pcycle - 1);
+
     check_time (files.root);
   }
 
 
 /* END CYCLE TO CALCULATE DETAILED SPECTRUM */
 
+  extract_roulette_summary ();
+
 #ifdef MPI_ON
   if (rank_global == 0)
   {
@@ -670,7 +820,7 @@ make_spectra (restart_stat)
 #ifdef MPI_ON
   sprintf (dummy, "End of program, Thread %d only", rank_global);       // added so we make clear these are just errors for thread ngit status    
   error_summary (dummy);        // Summarize the errors that were recorded by the program
-  Log ("Run py_error.py for full error report.\n");
+  error_summary_all ("End of program"); // and those recorded by all of the threads together
 #else
   error_summary ("End of program");     // Summarize the errors that were recorded by the program
 #endif
@@ -691,3 +841,51 @@ make_spectra (restart_stat)
   phot_status ();
   return EXIT_SUCCESS;
 }
+
+
+
+/**********************************************************/
+/**
+ * @brief      Exchange the heating of the star and disk held in a back_heating
+ * structure with the values in geo and qdisk
+ *
+ * @param [in, out] struct back_heating *  back   The heating to exchange
+ * @return     Always returns 0
+ *
+ * @details
+ * During an ionization cycle, back holds the heating from the previous cycle,
+ * which star_init and disk_init use to set the temperatures of the star and
+ * disk, while geo and qdisk accumulate the heating in the current cycle.  Calling
+ * the routine before and after generating a batch of photons means that every 
+ * batch is generated from the same sources.  In a spectral cycle the heating
+ * is not zeroed at the start of the cycle, so back holds the heating as it
+ * was then.
+ *
+ * ### Notes ###
+ *
+ **********************************************************/
+
+int
+swap_back_heating (back)
+     struct back_heating *back;
+{
+  double x;
+  int n;
+
+  x = geo.lum_star_back;
+  geo.lum_star_back = back->lum_star_back;
+  back->lum_star_back = x;
+
+  x = geo.lum_disk_back;
+  geo.lum_disk_back = back->lum_disk_back;
+  back->lum_disk_back = x;
+
+  for (n = 0; n < NRINGS; n++)
+  {
+    x = qdisk.heat[n];
+    qdisk.heat[n] = back->heat[n];
+    back->heat[n] = x;
+  }
+
+  return (0);
+}
@@ -311,6 +311,12 @@ init_advanced_modes ()
   modes.quit_after_inputs = 0;  // testing mode which quits after reading in inputs
   modes.fixed_temp = 0;         // do not attempt to change temperature - used for testing
   modes.zeus_connect = 0;       // connect with zeus
+  modes.event_transport = 0;    // transport photons one at a time
+  modes.photon_adaptive = 0;    // the number of photons in ionization cycles does not depend on the errors in the estimators
+  modes.freeze_cells = 0;       // solve for the ionization of every cell in every cycle
+  modes.qmc_launch = 0;         // launch photons with numbers from the random number generator
+  modes.setup_cache = 0;        // calculate the volumes and velocity gradients of the wind cells afresh
+  modes.compress_windsave = 0;  // write the windsave files without compression
 
   //note write_atomicdata  is defined in atomic.h, rather than the modes structure
   write_atomicdata = 0;         // print out summary of atomic data
@@ -367,6 +373,10 @@ init_observers ()
   geo.swavemin = 850;
   geo.swavemax = 1850;
 
+  geo.extract_roulette = FALSE;
+  geo.roulette_frac = 1.e-4;
+  geo.roulette_kill = 0.9;
+
   rdpar_comment ("The minimum and maximum wavelengths in the final spectra");
   rddoub ("Spectrum.wavemin(Angstroms)", &geo.swavemin);
   rddoub ("Spectrum.wavemax(Angstroms)", &geo.swavemax);
@@ -468,6 +478,25 @@ init_observers ()
         }
       }
     }
+
+    /* Optionally kill extracted rays which have been so attenuated that they can no longer
+     * contribute significantly to the spectrum, see extract_one */
+
+    if (geo.select_extract)
+    {
+      strcpy (answer, "no");
+      geo.extract_roulette = rdchoice ("@Spectrum.extract_roulette(yes,no)", "1,0", answer);
+      if (geo.extract_roulette)
+      {
+        rddoub ("@Spectrum.roulette_threshold(fraction_of_bin)", &geo.roulette_frac);
+        rddoub ("@Spectrum.roulette_kill_probability", &geo.roulette_kill);
+        if (geo.roulette_kill <= 0.0 || geo.roulette_kill >= 1.0)
+        {
+          Error ("init_observers: roulette kill probability %e must lie between 0 and 1\n", geo.roulette_kill);
+          Exit (0);
+        }
+      }
+    }
   }
 
   /* Select the units of the output spectra.  This is always needed.
@@ -559,9 +588,20 @@ init_photons ()
     exit (1);                   //There is really nothing to do!
   }
 
-  /* Allocate the memory for the photon structure now that NPHOT is established */
+  /* Allocate the memory for the photon structure now that NPHOT is established.  If the photons
+   * are to be generated and transported in batches, the structure only needs to hold one batch.
+   */
+
+  if (NPHOT_BATCH <= 0 || NPHOT_BATCH > NPHOT)
+  {
+    NPHOT_BATCH = NPHOT;
+  }
+  else
+  {
+    Log ("Photons will be generated and transported in batches of up to %d photons\n", NPHOT_BATCH);
+  }
 
-  photmain = p = (PhotPtr) calloc (sizeof (p_dummy), NPHOT);
+  photmain = p = (PhotPtr) calloc (sizeof (p_dummy), NPHOT_BATCH);
   /* If the number of photons per cycle is changed, NPHOT can be less, so we define NPHOT_MAX
    * to the maximum number of photons that one can create.  NPHOT is used extensively with
    * Python.  It is the NPHOT in a particular cycle, in a given thread.
@@ -584,6 +624,7 @@ init_photons ()
     if ((NPHOT * sizeof (p_dummy)) > 1e9)
       Error ("Over 1 GIGABYTE of photon structure allocated. Could cause serious problems.\n");
   }
+  mem_register (MEM_PHOTONS, "photmain", (double) NPHOT_BATCH * sizeof (p_dummy));
 
   return (p);
 }
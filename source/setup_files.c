@@ -173,6 +173,9 @@ setup_created_files ()
   strcpy (files.windrad, "python");
   strcpy (files.windsave, files.root);
   strcpy (files.specsave, files.root);
+  strcpy (files.perf, files.root);
+  strcpy (files.mpi_profile, files.root);
+  strcpy (files.mem, files.root);
 
   /* save python.phot and disk.diag files under diag_root folder */
   strcpy (files.phot, files.diagfolder);
@@ -197,6 +200,9 @@ setup_created_files ()
   strcat (files.windrad, ".wind_rad");
   strcat (files.windsave, ".wind_save");
   strcat (files.specsave, ".spec_save");
+  strcat (files.perf, ".perf");
+  strcat (files.mpi_profile, ".mpi.csv");
+  strcat (files.mem, ".mem");
   strcat (files.phot, ".phot");
   strcat (files.disk, ".disk.diag");
 
@@ -116,6 +116,7 @@ spectrum_init (f1, f2, nangle, angle, phase, scat_select, top_bot_select, select
     }
 
     nspectra = nspec;           /* Note that nspectra is a global variable */
+    mem_register (MEM_SPECTRA, "xxspec", (double) nspec * sizeof (spectrum_dummy));
 
     i_spec_start = 1;           /* This is to prevent reallocation of the same arrays on multiple calls to spectrum_init */
   }
@@ -140,6 +141,8 @@ spectrum_init (f1, f2, nangle, angle, phase, scat_select, top_bot_select, select
     xxspec[n].ldfreq = ldfreq;
     for (i = 0; i < NSTAT; i++)
       xxspec[n].nphot[i] = 0;
+    xxspec[n].nroulette_kill = xxspec[n].nroulette_live = 0;
+    xxspec[n].roulette_tlive = 0.0;
     for (i = 0; i < NWAVE; i++)
     {
       xxspec[n].f[i] = 0;
@@ -274,6 +274,8 @@ spherical_volumes (ndom, w)
   for (i = 0; i < ndim; i++)
   {
     n = i + nstart;             /* nstart is the offset into the wind structure */
+    if (!setup_cell_mine (n))
+      continue;                 /* Another thread sets up this cell */
     rmin = zdom[ndom].wind_x[i];
     rmax = zdom[ndom].wind_x[i + 1];
 
@@ -33,15 +33,17 @@ int translate_in_wind(WindPtr w, PhotPtr p, double tau_scat, double *tau, int *n
 double ds_in_cell(int ndom, PhotPtr p);
 int walls(PhotPtr p, PhotPtr pold, double *normal);
 /* photon_gen.c */
-int define_phot(PhotPtr p, double f1, double f2, long nphot_tot, int ioniz_or_final, int iwind, int freq_sampling);
-double populate_bands(int ioniz_or_final, int iwind, struct xbands *band);
+int define_phot(PhotPtr p, double f1, double f2, long nphot_tot, int ioniz_or_final, int iwind, int freq_sampling, int nphot_cycle, int iphot_first);
+double populate_bands(int ioniz_or_final, int iwind, struct xbands *band, int nphot_rad);
 int xdefine_phot(double f1, double f2, int ioniz_or_final, int iwind, int print_mode);
 int phot_status(void);
-int xmake_phot(PhotPtr p, double f1, double f2, int ioniz_or_final, int iwind, double weight, int iphot_start, int nphotons);
+int batch_share(int *ifirst, int n, int istart, int nphot);
+int xmake_phot(PhotPtr p, double f1, double f2, int ioniz_or_final, int iwind, double weight, int iphot_start, int nphotons, int iphot_band, int nphot_band);
 int star_init(double freqmin, double freqmax, int ioniz_or_final, double *f);
 int photo_gen_star(PhotPtr p, double r, double t, double weight, double f1, double f2, int spectype, int istart, int nphot);
 double disk_init(double rmin, double rmax, double m, double mdot, double freqmin, double freqmax, int ioniz_or_final, double *ftot);
 int photo_gen_disk(PhotPtr p, double weight, double f1, double f2, int spectype, int istart, int nphot);
+int photo_gen_disk_one(PhotPtr p, double weight, int nring, int spectype, double freqmin, double freqmax);
 int phot_gen_sum(char filename[], char mode[]);
 double bl_init(double lum_bl, double t_bl, double freqmin, double freqmax, int ioniz_or_final, double *f);
 int photon_checks(PhotPtr p, double freqmin, double freqmax, char *comment);
@@ -64,6 +66,7 @@ int spectrum_restart_renormalise(int nangle);
 /* wind2d.c */
 int define_wind(void);
 int where_in_grid(int ndom, double x[]);
+int where_in_grid_hint(int ndom, double x[], int nhint);
 int vwind_xyz(int ndom, PhotPtr p, double v[]);
 int wind_div_v(void);
 double rho(WindPtr w, double x[]);
@@ -103,6 +106,13 @@ double func_minimiser(double a, double m, double b, double (*func)(double, void
 /* trans_phot.c */
 int trans_phot(WindPtr w, PhotPtr p, int iextract);
 int trans_phot_single(WindPtr w, PhotPtr p, int iextract);
+int init_flight(PhotPtr p, FlightPtr f);
+int flight_move(WindPtr w, PhotPtr p, FlightPtr f);
+int flight_interact(WindPtr w, PhotPtr p, FlightPtr f, int iextract);
+/* trans_phot_event.c */
+int trans_phot_event(WindPtr w, PhotPtr p, int iextract);
+int event_sort_by_cell(int nlive, int *live, int *cell, int *scratch, int *count);
+int event_partition(int nlive, int *live, int *event, int *scratch, int *nstart);
 /* phot_util.c */
 int stuff_phot(PhotPtr pin, PhotPtr pout);
 int move_phot(PhotPtr pp, double ds);
@@ -137,32 +147,47 @@ int init_log_and_windsave(int restart_stat);
 int setup_created_files(void);
 /* wind_updates2d.c */
 int wind_update(WindPtr (w));
+int wind_update_frozen(PlasmaPtr xplasma, double err, double *err_band);
 int wind_rad_init(void);
+int wind_cost_init(void);
 int report_bf_simple_ionpool(void);
 /* windsave.c */
 int wind_save(char filename[]);
 int wind_read(char filename[]);
+int windsave_write_cells(WindsaveFilePtr ws, struct windsave_array *one, void *cells, int cellsize, int ncell);
+int windsave_read_cells(WindsaveFilePtr ws, struct windsave_array *one, void *cells, int cellsize, int ncell);
+int wind_read_parts(char filename[], int parts);
+int wind_read_legacy(char filename[]);
 int wind_complete(WindPtr w);
 int spec_save(char filename[]);
 int spec_read(char filename[]);
 /* extract.c */
 int extract(WindPtr w, PhotPtr p, int itype);
 int extract_one(WindPtr w, PhotPtr pp, int itype, int nspec);
+int extract_roulette_summary(void);
 /* cdf.c */
 int cdf_gen_from_func(CdfPtr cdf, double (*func)(double), double xmin, double xmax, int njumps, double jump[]);
 double gen_array_from_func(double (*func)(double), double xmin, double xmax, int pdfsteps);
 int cdf_gen_from_array(CdfPtr cdf, double x[], double y[], int n_xy, double xmin, double xmax);
 double cdf_get_rand(CdfPtr cdf);
+int cdf_get_rand_n(CdfPtr cdf, double x[], int n);
+double cdf_interval_position(CdfPtr cdf, int i, double u);
 int cdf_limit(CdfPtr cdf, double xmin, double xmax);
 double cdf_get_rand_limit(CdfPtr cdf);
 int cdf_to_file(CdfPtr cdf, char filename[]);
 int cdf_check(CdfPtr cdf);
 int calc_cdf_gradient(CdfPtr cdf);
+int calc_cdf_guide(CdfPtr cdf);
+int cdf_alloc(CdfPtr cdf, int n);
 int cdf_array_fixup(double *x, double *y, int n_xy);
 /* roche.c */
 int binary_basics(void);
+int roche_surface_init(void);
+double roche_radius(double d[], double r);
+double roche_excess(double x[]);
 int hit_secondary(PhotPtr p);
 double pillbox(PhotPtr p, double *smin, double *smax);
+double roche_potential(double x[]);
 double phi(double s, void *params);
 double dphi_ds(double s, void *params);
 double roche_width(double x, void *params);
@@ -173,6 +198,14 @@ int randvcos(double lmn[], double north[]);
 double vcos(double x);
 int init_rand(int seed);
 double random_number(double min, double max);
+int qmc_init(int nphot);
+int qmc_start(int source);
+int qmc_skip(int dim);
+int qmc_stop(void);
+int qmc_suspend(void);
+int qmc_resume(int active);
+double qmc_uniform(void);
+int random_multinomial(int ncat, int ntot, double prob[], unsigned int counts[]);
 /* stellar_wind.c */
 int get_stellar_wind_params(int ndom);
 double stellar_velocity(int ndom, double x[], double v[]);
@@ -210,8 +243,12 @@ double gdisk(double mass, double mdot, double rmin);
 double geff(double g0, double x);
 double vdisk(double x[], double v[]);
 double zdisk(double r);
+double zdisk_power(double r);
+double zdisk_slope(double r);
+int disk_surface_init(void);
 double ds_to_disk(struct photon *p, int allow_negative);
-double disk_height(double s, void *params);
+int disk_path_r2_range(struct photon *p, double sign, double h, double s1, double s2, double *r2lo, double *r2hi);
+double ds_to_disk_surface(struct photon *p, double s1, double s2);
 int qdisk_init(void);
 int qdisk_save(char *diskfile, double ztot);
 int read_non_standard_disk_profile(char *tprofile);
@@ -219,6 +256,10 @@ int read_non_standard_disk_profile(char *tprofile);
 double total_line_emission(WindPtr one, double f1, double f2);
 double lum_lines(WindPtr one, int nmin, int nmax);
 double two_level_atom(struct lines *line_ptr, PlasmaPtr xplasma, double *d1, double *d2);
+double two_level_fractions(struct lines *line_ptr, PlasmaPtr xplasma, double *n1_over_dd, double *n2_over_dd);
+double two_level_atom_den(struct lines *line_ptr, PlasmaPtr xplasma, double den_ion, double *d1, double *d2);
+int tla_cache_reset(void);
+int tla_cache_free(void);
 double line_nsigma(struct lines *line_ptr, PlasmaPtr xplasma);
 double scattering_fraction(struct lines *line_ptr, PlasmaPtr xplasma);
 double p_escape(struct lines *line_ptr, PlasmaPtr xplasma);
@@ -290,6 +331,10 @@ double zero_emit(double t);
 int levels(PlasmaPtr xplasma, int mode);
 /* gradv.c */
 double dvwind_ds(PhotPtr p);
+double vseg_init(int ndom, PhotPtr p, double smax);
+int vseg_v(PhotPtr p, double s, double *v);
+double vseg_dvds(double x);
+int spherical_vgrad(double v_grad[][3], double *dvdr, double *v_over_r);
 int dvds_ave(void);
 /* reposition.c */
 int reposition(PhotPtr p);
@@ -390,6 +435,31 @@ int check_plasma(PlasmaPtr xplasma, char message[]);
 int calloc_macro(int nelem);
 int calloc_estimators(int nelem);
 int calloc_dyn_plasma(int nelem);
+int wind_hot_update(void);
+int wind_hot_release(void);
+/* wind_topology.c */
+int wind_topology(void);
+int topology_in_cell(int n, double x[]);
+/* wind_setup.c */
+int setup_cell_mine(int n);
+int setup_share(int mode);
+unsigned long long setup_hash(unsigned long long hash, void *data, int nbytes);
+int setup_cache_name(char filename[]);
+int setup_cache_read(char filename[]);
+int setup_cache_write(char filename[]);
+/* windsave_format.c */
+unsigned long long windsave_struct_hash(void);
+int windsave_open_write(WindsaveFilePtr ws, char filename[], int compress);
+int windsave_write_field(WindsaveFilePtr ws, char name[], int rowsize, int nrow, void **rows);
+int windsave_write_array(WindsaveFilePtr ws, char name[], void *data, int rowsize, int nrow);
+int windsave_read_array(WindsaveFilePtr ws, char name[], void *data, int rowsize, int nrow);
+int windsave_close(WindsaveFilePtr ws, int writing);
+int windsave_open_read(WindsaveFilePtr ws, char filename[]);
+WindsaveFieldPtr windsave_find_field(WindsaveFilePtr ws, char name[]);
+int windsave_read_rows(WindsaveFilePtr ws, char name[], int rowsize, int first, int nrow, void **rows);
+long long windsave_compress_bound(long long nbytes);
+long long windsave_compress(char *in, long long nbytes, char *out);
+int windsave_expand(char *in, long long nstored, char *out, long long nbytes);
 /* partition.c */
 int partition_functions(PlasmaPtr xplasma, int mode);
 int partition_functions_2(PlasmaPtr xplasma, int xnion, double temp, double weight);
@@ -398,6 +468,19 @@ int xsignal(char *root, char *format, ...);
 int xsignal_rm(char *root);
 int set_max_time(char *root, double t);
 int check_time(char *root);
+/* perf.c */
+int perf_reset(void);
+int perf_write(char *cycle_type, int cycle);
+/* memory.c */
+int mem_register(int subsystem, char *name, double bytes);
+int mem_record(int subsystem, char *name, double bytes, int fixed);
+int mem_static_init(void);
+int mem_rss(double *rss_peak, double *rss_now);
+int mem_report(char *phase, int cycle);
+/* phot_budget.c */
+double phot_budget_rel_error(double sum, double sum2, double nphot);
+double phot_budget_error(PlasmaPtr xplasma, double nphot);
+int phot_budget_next(int nphot);
 /* agn.c */
 double agn_init(double r, double lum, double alpha, double freqmin, double freqmax, int ioniz_or_final, double *f);
 double emittance_pow(double freqmin, double freqmax, double alpha);
@@ -456,7 +539,11 @@ int solve_matrix(double *a_data, double *b_data, int nrows, double *x, int nplas
 /* para_update.c */
 int communicate_estimators_para(void);
 int gather_spectra_para(int nspec_helper, int nspecs);
+int communicate_costs_para(void);
+int communicate_noise_para(void);
 int communicate_matom_estimators_para(void);
+int para_profile_reset(void);
+int para_profile_write(char *cycle_type, int cycle);
 /* setup_star_bh.c */
 double get_stellar_params(void);
 int get_bl_and_agn_params(double lstar);
@@ -476,13 +563,22 @@ int photo_gen_matom(PhotPtr p, double weight, int photstart, int nphot);
 int macro_gov(PhotPtr p, int *nres, int matom_or_kpkt, int *which_out);
 int macro_pops(PlasmaPtr xplasma, double xne);
 /* windsave2table_sub.c */
-int do_windsave2table(char *root, int ion_switch);
-int create_master_table(int ndom, char rootname[]);
-int create_heat_table(int ndom, char rootname[]);
-int create_convergence_table(int ndom, char rootname[]);
-int create_ion_table(int ndom, char rootname[], int iz, int ion_switch);
-double *get_ion(int ndom, int element, int istate, int iswitch, char *name);
-double *get_one(int ndom, char variable_name[]);
+int do_windsave2table(char *root, int ion_switch, int binary);
+TableColumnPtr table_add_column(ExportTablePtr table, char *name, char *head, char *fmt, int kind, size_t offset);
+TableColumnPtr table_add_plasma(ExportTablePtr table, char *name);
+TableColumnPtr table_add_ion(ExportTablePtr table, char *name, char *head, char *fmt, int element, int istate, int iswitch);
+int table_add_position(int ndom, ExportTablePtr table, int master);
+int create_master_table(int ndom, char rootname[], ExportTablePtr table);
+int create_heat_table(int ndom, char rootname[], ExportTablePtr table);
+int create_convergence_table(int ndom, char rootname[], ExportTablePtr table);
+int create_ion_table(int ndom, char rootname[], int iz, int ion_switch, ExportTablePtr table);
+int table_owner(int ntable);
+int table_gather(int ndom, int ntables, ExportTablePtr tables);
+double table_ion_value(PlasmaPtr xplasma, TableColumnPtr col);
+int table_write(int ndom, int ntables, ExportTablePtr tables, int binary);
+int table_write_ascii(ExportTablePtr table, int nrows);
+int table_write_binary(ExportTablePtr table, int nrows);
+int table_free(ExportTablePtr table);
 /* import.c */
 int import_wind(int ndom);
 int import_make_grid(WindPtr w, int ndom);
@@ -540,6 +636,7 @@ double setup_dfudge(void);
 /* run.c */
 int calculate_ionization(int restart_stat);
 int make_spectra(int restart_stat);
+int swap_back_heating(struct back_heating *back);
 /* brem.c */
 double integ_brem(double freq, void *params);
 double brem_d(double alpha);
@@ -636,13 +733,44 @@ int main(int argc, char *argv[]);
 int one_choice(int choice, char *root, int ochoice);
 void py_wind_help(void);
 /* windsave2table.c */
-void parse_arguments(int argc, char *argv[], char root[], int *ion_switch);
+void parse_arguments(int argc, char *argv[], char root[], int *ion_switch, int *binary);
 int main(int argc, char *argv[]);
 /* windsave2table_sub.c */
-int do_windsave2table(char *root, int ion_switch);
-int create_master_table(int ndom, char rootname[]);
-int create_heat_table(int ndom, char rootname[]);
-int create_convergence_table(int ndom, char rootname[]);
-int create_ion_table(int ndom, char rootname[], int iz, int ion_switch);
-double *get_ion(int ndom, int element, int istate, int iswitch, char *name);
-double *get_one(int ndom, char variable_name[]);
+int do_windsave2table(char *root, int ion_switch, int binary);
+TableColumnPtr table_add_column(ExportTablePtr table, char *name, char *head, char *fmt, int kind, size_t offset);
+TableColumnPtr table_add_plasma(ExportTablePtr table, char *name);
+TableColumnPtr table_add_ion(ExportTablePtr table, char *name, char *head, char *fmt, int element, int istate, int iswitch);
+int table_add_position(int ndom, ExportTablePtr table, int master);
+int create_master_table(int ndom, char rootname[], ExportTablePtr table);
+int create_heat_table(int ndom, char rootname[], ExportTablePtr table);
+int create_convergence_table(int ndom, char rootname[], ExportTablePtr table);
+int create_ion_table(int ndom, char rootname[], int iz, int ion_switch, ExportTablePtr table);
+int table_owner(int ntable);
+int table_gather(int ndom, int ntables, ExportTablePtr tables);
+double table_ion_value(PlasmaPtr xplasma, TableColumnPtr col);
+int table_write(int ndom, int ntables, ExportTablePtr tables, int binary);
+int table_write_ascii(ExportTablePtr table, int nrows);
+int table_write_binary(ExportTablePtr table, int nrows);
+int table_free(ExportTablePtr table);
+/* py_bench.c */
+double bench_calculate_ds(int i);
+double bench_radiation(int i);
+double bench_sigma_phot(int i);
+double bench_kappa_bf(int i);
+double bench_sobolev(int i);
+double bench_two_level_atom(int i);
+double bench_where_in_grid(int i);
+double bench_ds_in_cell(int i);
+double bench_vwind_xyz(int i);
+double bench_dvwind_ds(int i);
+double bench_cdf_get_rand(int i);
+double bench_planck(int i);
+double bench_compton_dir(int i);
+double bench_kpkt(int i);
+double bench_matom(int i);
+double bench_extract_one(int i);
+double bench_matrix_ion_populations(int i);
+int bench_photons(int nphot);
+int bench_run(int nkernel, char *name, int ncalls, int seed);
+void bench_parse_arguments(int argc, char *argv[], char root[], int *ncalls, int *nphot, int *seed, char kernel[]);
+int main(int argc, char *argv[]);
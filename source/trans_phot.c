@@ -114,10 +114,9 @@ trans_phot (WindPtr w, PhotPtr p, int iextract)
       else
         Log ("Spec. Cycle %d/%d of %s : Photon %10d of %10d or %6.1f per cent \n", geo.pcycle + 1, geo.pcycles, basename, nphot, NPHOT,
              nphot * 100. / NPHOT);
+      Log_flush ();
     }
 
-    Log_flush ();
-
     stuff_phot (&p[nphot], &pp);
     absorb_reflect = geo.absorb_reflect;
 
@@ -182,11 +181,16 @@ trans_phot (WindPtr w, PhotPtr p, int iextract)
 
     p[nphot].np = nphot;
 
-    /* Transport a single photon */
-    trans_phot_single (w, &p[nphot], iextract);
+    /* Transport a single photon, unless the photons are to be transported in batches below */
+    if (!modes.event_transport)
+      trans_phot_single (w, &p[nphot], iextract);
 
   }
 
+  /* With the event based engine all of the photons are transported together, once they have been extracted */
+  if (modes.event_transport)
+    trans_phot_event (w, p, iextract);
+
   /* This is the end of the loop over all of the photons; after this the routine returns */
 
   /* Line to complete watchdog timer */
@@ -258,389 +262,487 @@ trans_phot (WindPtr w, PhotPtr p, int iextract)
 int
 trans_phot_single (WindPtr w, PhotPtr p, int iextract)
 {
-  double tau_scat, tau;
-  int istat;
-  int ierr;
-  double rrr;
-  int icell;
-  int current_nres;
-  int kkk, n;
-  double weight_min;
-  struct photon pp, pextract;
-  struct photon pp_reposition_test;
-  int nnscat;
-  double p_norm, tau_norm;
-  double x_dfudge_check[3];
-  int ndom;
-  double normal[3];
+  struct flight f;
 
   /* Initialize parameters that are needed for the flight of the photon through the wind */
-  stuff_phot (p, &pp);
-  tau_scat = -log (1. - random_number (0.0, 1.0));
+  init_flight (p, &f);
 
-  weight_min = EPSILON * pp.w;
-  istat = P_INWIND;
-  tau = 0;
-  icell = 0;
+  /* This is the beginning of the loop for a single photon and executes until the photon leaves the wind */
 
-  n = 0;                        /* Avoid 03 warning */
+  while (!f.done)
+  {
+    flight_move (w, p, &f);
+    if (!f.done)
+      flight_interact (w, p, &f, iextract);
+  }
+  /* This is the end of the loop over a photon */
 
-  /* This is the beginning of the loop for a single photon and executes until the photon leaves the wind */
+  /* The next section is for diagnostic purposes.  There are two possibilities.  If you wish to know where
+   * the photon was last while in the wind, you want to track p; if you wish to know where it hits the
+   * outer boundary of the calculation you would want pp.  So one should keep both lines below, and comment
+   * out the one you do not want. */
 
-  while (istat == P_INWIND)
+  if (modes.save_photons)
   {
+    save_photons (&f.pp, "Final");      //The position of the photon where it exits the calculation
+  }
+
+  return (0);
+}
 
-    /* translate involves only a single shell (or alternatively a single tranfer in the windless region). istat as returned by
-       should either be 0 in which case the photon hit the other side of the shell without scattering or 1 in which case there
-       was a scattering event in the shell, 2 in which case the photon reached the outside edge of the grid and escaped, 3 in
-       which case it reach the inner edge and was reabsorbed. If the photon escapes then we leave the photon at the position
-       of it's last scatter.  In most other cases though we store the final position of the photon. */
 
-    pp.ds = 0;                  // EP 11-19: reinitialise for safety
-    istat = translate (w, &pp, tau_scat, &tau, &current_nres);
 
-    /* nres is the resonance at which the photon was stopped.  At present the same value is also stored in pp->nres, but I have
-       not yet eliminated it from translate. ?? 02jan ksl */
+/**********************************************************/
+/**
+ * @brief      Initialise the state needed to follow a photon through the wind
+ *
+ * @param [in] PhotPtr  p   The photon which is about to be transported
+ * @param [out] FlightPtr  f   The flight state of the photon
+ *
+ * @return     Always returns 0
+ *
+ * @details
+ * The flight state holds everything that trans_phot_single used to keep in
+ * local variables, so that a flight can be advanced one step at a time,
+ * either by trans_phot_single or by the event-based engine in trans_phot_event.c
+ *
+ **********************************************************/
 
-    icell++;
-    istat = walls (&pp, p, normal);
-    /* pp is where the photon is going, p is where it was  */
+int
+init_flight (PhotPtr p, FlightPtr f)
+{
+  PERF_COUNT (PERF_PHOTONS);
+
+  stuff_phot (p, &f->pp);
+  f->tau_scat = -log (1. - random_number (0.0, 1.0));
+  f->weight_min = EPSILON * f->pp.w;
+  f->tau = 0;
+  f->istat = P_INWIND;
+  f->nres = -1;
+  f->icell = 0;
+  f->done = FALSE;
+
+  return (0);
+}
 
-    if (istat == -1)
-    {
-      Error_silent ("trans_phot: Abnormal return from translate on photon %d\n", p->np);
-      break;
-    }
 
-    if (pp.w < weight_min)
-    {
-      istat = pp.istat = P_ABSORB;      /* This photon was absorbed by continuum opacity within the wind */
-      pp.tau = VERY_BIG;
-      stuff_phot (&pp, p);
-      break;
-    }
 
-    if (istat == P_HIT_STAR)
-    {                           /* It hit the star */
-      geo.lum_star_back += pp.w;
-      if (geo.absorb_reflect == BACK_RAD_SCATTER)
+/**********************************************************/
+/**
+ * @brief      Move a photon to the next point at which something happens to it
+ *
+ * @param [in] WindPtr  w   The entire wind
+ * @param [in, out] PhotPtr  p   The photon at the start of the step
+ * @param [in, out] FlightPtr  f   The flight state of the photon
+ *
+ * @return     The status of the photon after the move, which is also stored in f->istat
+ *
+ * @details
+ * translate moves the photon (f->pp) through a single cell or a single transfer
+ * in the windless region, and walls checks whether it hit a boundary on the way.
+ * The event that has to be processed next, a scatter, a hit on the star or disk,
+ * or simply a boundary crossing, is left in f->istat for flight_interact.
+ *
+ * If the photon has been lost or absorbed f->done is set, and no further
+ * processing is needed.
+ *
+ **********************************************************/
+
+int
+flight_move (WindPtr w, PhotPtr p, FlightPtr f)
+{
+  /* translate involves only a single shell (or alternatively a single tranfer in the windless region). istat as returned by
+     should either be 0 in which case the photon hit the other side of the shell without scattering or 1 in which case there
+     was a scattering event in the shell, 2 in which case the photon reached the outside edge of the grid and escaped, 3 in
+     which case it reach the inner edge and was reabsorbed. If the photon escapes then we leave the photon at the position
+     of it's last scatter.  In most other cases though we store the final position of the photon. */
+
+  f->pp.ds = 0;                 // EP 11-19: reinitialise for safety
+  PERF_COUNT (PERF_TRANSLATE_STEPS);
+  f->istat = translate (w, &f->pp, f->tau_scat, &f->tau, &f->nres);
+
+  /* nres is the resonance at which the photon was stopped.  At present the same value is also stored in pp->nres, but I have
+     not yet eliminated it from translate. ?? 02jan ksl */
+
+  f->icell++;
+  f->istat = walls (&f->pp, p, f->normal);
+  /* pp is where the photon is going, p is where it was  */
+
+  if (f->istat == -1)
+  {
+    Error_silent ("trans_phot: Abnormal return from translate on photon %d\n", p->np);
+    f->done = TRUE;
+  }
+  else if (f->pp.w < f->weight_min)
+  {
+    f->istat = f->pp.istat = P_ABSORB;  /* This photon was absorbed by continuum opacity within the wind */
+    f->pp.tau = VERY_BIG;
+    stuff_phot (&f->pp, p);
+    f->done = TRUE;
+  }
+
+  return (f->istat);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Process the event which ended the last move of a photon
+ *
+ * @param [in] WindPtr  w   The entire wind
+ * @param [in, out] PhotPtr  p   The photon at the start of the step
+ * @param [in, out] FlightPtr  f   The flight state of the photon
+ * @param [in] int  iextract   If 0, then process this photon in the live or die option, without
+ * calling extract
+ *
+ * @return     The status of the photon, which is also stored in f->istat
+ *
+ * @details
+ * If the photon hit the star or disk it is absorbed or reflected depending on
+ * the reflection/absorption mode; if it reached its scattering optical depth it
+ * is scattered, and extracted if necessary, and given a new optical depth to travel.
+ * Finally the photon is checked for too many scatters or errors, and p is updated.
+ *
+ * f->done is set when the photon needs no further processing.
+ *
+ **********************************************************/
+
+int
+flight_interact (WindPtr w, PhotPtr p, FlightPtr f, int iextract)
+{
+  double rrr;
+  int kkk, n;
+  int ierr;
+  struct photon pextract;
+  struct photon pp_reposition_test;
+  int nnscat;
+  double p_norm, tau_norm;
+  double x_dfudge_check[3];
+  int ndom;
+
+  if (f->istat == P_HIT_STAR)
+  {                             /* It hit the star */
+    geo.lum_star_back += f->pp.w;
+    if (geo.absorb_reflect == BACK_RAD_SCATTER)
+    {
+      /* If we got here, the a new photon direction needs to be defined that will cause the photon
+       * to continue in the wind.  Since this is effectively a scattering event we also have to
+       * extract a photon to construct the detailed spectrum
+       */
+      randvcos (f->pp.lmn, f->normal);
+      move_phot (&f->pp, DFUDGE);
+      stuff_phot (&f->pp, p);
+      f->tau_scat = -log (1. - random_number (0.0, 1.0));
+      f->istat = f->pp.istat = P_INWIND; /* Set the status back to P_INWIND so the photon will continue */
+      f->tau = 0;
+      if (iextract)
       {
-        /* If we got here, the a new photon direction needs to be defined that will cause the photon
-         * to continue in the wind.  Since this is effectively a scattering event we also have to
-         * extract a photon to construct the detailed spectrum
-         */
-        randvcos (pp.lmn, normal);
-        move_phot (&pp, DFUDGE);
-        stuff_phot (&pp, p);
-        tau_scat = -log (1. - random_number (0.0, 1.0));
-        istat = pp.istat = P_INWIND;    /* Set the status back to P_INWIND so the photon will continue */
-        tau = 0;
-        if (iextract)
-        {
-          stuff_phot (&pp, &pextract);
-          extract (w, &pextract, PTYPE_STAR);   // Treat as stellar photon for purpose of extraction
-        }
-      }
-      else
-      {                         /*Photons that hit the star are simply absorbed so this is the end of the line for this photon */
-        stuff_phot (&pp, p);
-        break;
+        stuff_phot (&f->pp, &pextract);
+        extract (w, &pextract, PTYPE_STAR); // Treat as stellar photon for purpose of extraction
       }
     }
+    else
+    {                           /*Photons that hit the star are simply absorbed so this is the end of the line for this photon */
+      stuff_phot (&f->pp, p);
+      f->done = TRUE;
+      return (f->istat);
+    }
+  }
 
-    if (istat == P_HIT_DISK)
+  if (f->istat == P_HIT_DISK)
+  {
+    /* It hit the disk */
+
+    /* Store the energy of the photon bundle into a disk structure so that one can determine later how much and where the
+       disk was heated by photons.
+       Note that the disk is defined from 0 to NRINGS-2. NRINGS-1 contains the position of the outer radius of the disk. */
+
+    rrr = sqrt (dot (f->pp.x, f->pp.x));
+    kkk = 0;
+    while (rrr > qdisk.r[kkk] && kkk < NRINGS - 1)
+      kkk++;
+    kkk--;                      /* So that the heating refers to the heating between kkk and kkk+1 */
+    qdisk.nhit[kkk]++;
+    geo.lum_disk_back = qdisk.heat[kkk] += f->pp.w;
+    qdisk.ave_freq[kkk] += f->pp.w * f->pp.freq;
+
+    if (geo.absorb_reflect == BACK_RAD_SCATTER)
     {
-      /* It hit the disk */
-
-      /* Store the energy of the photon bundle into a disk structure so that one can determine later how much and where the
-         disk was heated by photons.
-         Note that the disk is defined from 0 to NRINGS-2. NRINGS-1 contains the position of the outer radius of the disk. */
-
-      rrr = sqrt (dot (pp.x, pp.x));
-      kkk = 0;
-      while (rrr > qdisk.r[kkk] && kkk < NRINGS - 1)
-        kkk++;
-      kkk--;                    /* So that the heating refers to the heating between kkk and kkk+1 */
-      qdisk.nhit[kkk]++;
-      geo.lum_disk_back = qdisk.heat[kkk] += pp.w;
-      qdisk.ave_freq[kkk] += pp.w * pp.freq;
-
-      if (geo.absorb_reflect == BACK_RAD_SCATTER)
+      /* If we got here, the a new photon direction needs to be defined that will cause the photon
+       * to continue in the wind.  Since this is effectively a scattering event we also have to
+       * extract a photon to construct the detailed spectrum
+       */
+      randvcos (f->pp.lmn, f->normal);
+      stuff_phot (&f->pp, p);
+      f->tau_scat = -log (1. - random_number (0.0, 1.0));
+      f->istat = f->pp.istat = P_INWIND;
+      f->tau = 0;
+      if (iextract)
       {
-        /* If we got here, the a new photon direction needs to be defined that will cause the photon
-         * to continue in the wind.  Since this is effectively a scattering event we also have to
-         * extract a photon to construct the detailed spectrum
-         */
-        randvcos (pp.lmn, normal);
-        stuff_phot (&pp, p);
-        tau_scat = -log (1. - random_number (0.0, 1.0));
-        istat = pp.istat = P_INWIND;
-        tau = 0;
-        if (iextract)
-        {
-          stuff_phot (&pp, &pextract);
-          extract (w, &pextract, PTYPE_DISK);
-        }
-      }
-      else
-      {                         /* Photons that hit the disk are to be absorbed so this is the end of the line for this photon */
-        stuff_phot (&pp, p);
-        break;
+        stuff_phot (&f->pp, &pextract);
+        extract (w, &pextract, PTYPE_DISK);
       }
     }
+    else
+    {                           /* Photons that hit the disk are to be absorbed so this is the end of the line for this photon */
+      stuff_phot (&f->pp, p);
+      f->done = TRUE;
+      return (f->istat);
+    }
+  }
 
-    if (istat == P_SCAT)
-    {                           /* Cause the photon to scatter and reinitilize */
+  if (f->istat == P_SCAT)
+  {                             /* Cause the photon to scatter and reinitilize */
 
 
-      pp.grid = n = where_in_grid (wmain[pp.grid].ndom, pp.x);
+    f->pp.grid = n = where_in_grid_hint (wmain_hot[f->pp.grid].ndom, f->pp.x, f->pp.grid);
 
-      if (n < 0)
-      {
-        Error ("trans_phot: Trying to scatter a photon which is not in the wind\n");
-        Error ("trans_phot: %d grid %3d x %8.2e %8.2e %8.2e\n", pp.np, pp.grid, pp.x[0], pp.x[1], pp.x[2]);
-        Error ("trans_phot: This photon is effectively lost!\n");
-        istat = pp.istat = p->istat = P_ERROR;
-        stuff_phot (&pp, p);
-        break;
-      }
+    if (n < 0)
+    {
+      Error ("trans_phot: Trying to scatter a photon which is not in the wind\n");
+      Error ("trans_phot: %d grid %3d x %8.2e %8.2e %8.2e\n", f->pp.np, f->pp.grid, f->pp.x[0], f->pp.x[1], f->pp.x[2]);
+      Error ("trans_phot: This photon is effectively lost!\n");
+      f->istat = f->pp.istat = p->istat = P_ERROR;
+      stuff_phot (&f->pp, p);
+      f->done = TRUE;
+      return (f->istat);
+    }
 
-      /* 1506 JM -- If the next errors reoccur, see Issue #154 for discussion */
+    /* 1506 JM -- If the next errors reoccur, see Issue #154 for discussion */
 
-      if (wmain[n].nplasma == NPLASMA)
-      {
-        Error ("trans_phot: Trying to scatter a photon which is not in a cell in the plasma structure\n");
-        Error ("trans_phot: %d grid %3d x %8.2e %8.2e %8.2e\n", pp.np, pp.grid, pp.x[0], pp.x[1], pp.x[2]);
-        Error ("trans_phot: This photon is effectively lost!\n");
-        istat = pp.istat = p->istat = P_ERROR;
-        stuff_phot (&pp, p);
-        break;
-      }
+    if (wmain_hot[n].nplasma == NPLASMA)
+    {
+      Error ("trans_phot: Trying to scatter a photon which is not in a cell in the plasma structure\n");
+      Error ("trans_phot: %d grid %3d x %8.2e %8.2e %8.2e\n", f->pp.np, f->pp.grid, f->pp.x[0], f->pp.x[1], f->pp.x[2]);
+      Error ("trans_phot: This photon is effectively lost!\n");
+      f->istat = f->pp.istat = p->istat = P_ERROR;
+      stuff_phot (&f->pp, p);
+      f->done = TRUE;
+      return (f->istat);
+    }
 
 
-      if (wmain[n].vol <= 0)
-      {
-        Error ("trans_phot: Trying to scatter a photon in a cell with no wind volume\n");
-        Error ("trans_phot: %d grid %3d x %8.2e %8.2e %8.2e\n", pp.np, pp.grid, pp.x[0], pp.x[1], pp.x[2]);
-        Error ("trans_phot: istat %d\n", pp.istat);
-        Error ("trans_phot: This photon is effectively lost!\n");
-        istat = pp.istat = p->istat = P_ERROR;
-        stuff_phot (&pp, p);
-        break;
+    if (wmain_hot[n].vol <= 0)
+    {
+      Error ("trans_phot: Trying to scatter a photon in a cell with no wind volume\n");
+      Error ("trans_phot: %d grid %3d x %8.2e %8.2e %8.2e\n", f->pp.np, f->pp.grid, f->pp.x[0], f->pp.x[1], f->pp.x[2]);
+      Error ("trans_phot: istat %d\n", f->pp.istat);
+      Error ("trans_phot: This photon is effectively lost!\n");
+      f->istat = f->pp.istat = p->istat = P_ERROR;
+      stuff_phot (&f->pp, p);
+      f->done = TRUE;
+      return (f->istat);
 
-      }
+    }
 
-      /* Add path lengths for reverberation mapping */
-      if ((geo.reverb == REV_WIND || geo.reverb == REV_MATOM) && geo.ioniz_or_extract && geo.wcycle == geo.wcycles - 1)
-      {
-        wind_paths_add_phot (&wmain[n], &pp);
-      }
+    /* Add path lengths for reverberation mapping */
+    if ((geo.reverb == REV_WIND || geo.reverb == REV_MATOM) && geo.ioniz_or_extract && geo.wcycle == geo.wcycles - 1)
+    {
+      wind_paths_add_phot (&wmain[n], &f->pp);
+    }
 
 
-      /* SS July 04 - next lines modified so that the "thermal trapping" model of anisotropic scattering is included in the
-         macro atom method. What happens now is all in scatter - within that routine the "thermal trapping" model is used to
-         decide what the direction of emission is before returning here.
-       */
+    /* SS July 04 - next lines modified so that the "thermal trapping" model of anisotropic scattering is included in the
+       macro atom method. What happens now is all in scatter - within that routine the "thermal trapping" model is used to
+       decide what the direction of emission is before returning here.
+     */
 
-      nnscat = 1;
-      pp.nscat++;
+    nnscat = 1;
+    f->pp.nscat++;
 
-      ierr = scatter (&pp, &current_nres, &nnscat);
-      if (ierr)
-      {
-        Error ("trans_phot: bad return from scatter %d at point 2\n", ierr);
-      }
+    ierr = scatter (&f->pp, &f->nres, &nnscat);
+    if (ierr)
+    {
+      Error ("trans_phot: bad return from scatter %d at point 2\n", ierr);
+    }
 
 
-      /* SS June 04: During the spectrum calculation cycles, photons are thrown away when they interact with macro atoms or
-         become k-packets. This is done by setting their weight to zero (effectively they have been absorbed into either
-         excitation energy or thermal energy). Since they now have no weight there is no need to follow them further. */
-      /* 54b-ksl ??? Stuart do you really mean the comment above; it's not obvious to me since if true why does one need to
-         calculate the progression of photons through the wind at all??? Also how is this enforced; where is pp.w set to a
-         low value. */
-      /* JM 1504 -- This is correct. It's one of the odd things about combining the macro-atom approach with our way of doing
-         'spectral cycles'. If photons activate macro-atoms they are destroyed, but we counter this by generating photons
-         from deactivating macro-atoms with the already calculated emissivities. */
+    /* SS June 04: During the spectrum calculation cycles, photons are thrown away when they interact with macro atoms or
+       become k-packets. This is done by setting their weight to zero (effectively they have been absorbed into either
+       excitation energy or thermal energy). Since they now have no weight there is no need to follow them further. */
+    /* 54b-ksl ??? Stuart do you really mean the comment above; it's not obvious to me since if true why does one need to
+       calculate the progression of photons through the wind at all??? Also how is this enforced; where is pp.w set to a
+       low value. */
+    /* JM 1504 -- This is correct. It's one of the odd things about combining the macro-atom approach with our way of doing
+       'spectral cycles'. If photons activate macro-atoms they are destroyed, but we counter this by generating photons
+       from deactivating macro-atoms with the already calculated emissivities. */
 
-      if (geo.matom_radiation == 1 && geo.rt_mode == RT_MODE_MACRO && pp.w < weight_min)
-        /* Flag for the spectrum calculations in a macro atom calculation SS */
-      {
-        istat = pp.istat = P_ABSORB;
-        pp.tau = VERY_BIG;
-        stuff_phot (&pp, p);
-        break;
-      }
+    if (geo.matom_radiation == 1 && geo.rt_mode == RT_MODE_MACRO && f->pp.w < f->weight_min)
+      /* Flag for the spectrum calculations in a macro atom calculation SS */
+    {
+      f->istat = f->pp.istat = P_ABSORB;
+      f->pp.tau = VERY_BIG;
+      stuff_phot (&f->pp, p);
+      f->done = TRUE;
+      return (f->istat);
+    }
 
-      // Calculate the line heating and if the photon was absorbed break finish up
-      // XXXX ??? Need to modify line_heat for multiple scattering but not yet
-      // Condition that nres < nlines added (SS)
+    // Calculate the line heating and if the photon was absorbed break finish up
+    // XXXX ??? Need to modify line_heat for multiple scattering but not yet
+    // Condition that nres < nlines added (SS)
 
-      if (current_nres > -1 && current_nres < nlines)
-      {
-        pp.nrscat++;
+    if (f->nres > -1 && f->nres < nlines)
+    {
+      f->pp.nrscat++;
 
-        /* This next statement writes out the position of every resonant scattering event to a file */
-        if (modes.track_resonant_scatters)
-          track_scatters (&pp, wmain[n].nplasma, "Resonant");
+      /* This next statement writes out the position of every resonant scattering event to a file */
+      if (modes.track_resonant_scatters)
+        track_scatters (&f->pp, wmain_hot[n].nplasma, "Resonant");
 
 
-        plasmamain[wmain[n].nplasma].scatters[line[current_nres].nion] += 1;
+      plasmamain[wmain_hot[n].nplasma].scatters[line[f->nres].nion] += 1;
+      plasmamain[wmain_hot[n].nplasma].cost_lines++;
 
-        if (geo.rt_mode == RT_MODE_2LEVEL)      // only do next line for non-macro atom case
-        {
-          line_heat (&plasmamain[wmain[n].nplasma], &pp, current_nres);
-        }
+      if (geo.rt_mode == RT_MODE_2LEVEL) // only do next line for non-macro atom case
+      {
+        line_heat (&plasmamain[wmain_hot[n].nplasma], &f->pp, f->nres);
+      }
 
-        if (pp.w < weight_min)
-        {
-          istat = pp.istat = P_ABSORB;  /* This photon was absorbed by continuum opacity within the wind */
-          pp.tau = VERY_BIG;
-          stuff_phot (&pp, p);
-          break;
-        }
+      if (f->pp.w < f->weight_min)
+      {
+        f->istat = f->pp.istat = P_ABSORB; /* This photon was absorbed by continuum opacity within the wind */
+        f->pp.tau = VERY_BIG;
+        stuff_phot (&f->pp, p);
+        f->done = TRUE;
+        return (f->istat);
       }
+    }
 
 
-      /* The next if statement causes photons to be extracted during the creation of the detailed spectrum portion of the
-         program */
+    /* The next if statement causes photons to be extracted during the creation of the detailed spectrum portion of the
+       program */
 
-      /* N.B. To use the anisotropic scattering option, extract needs to follow scatter.  This is because the reweighting
-         which occurs in extract needs the pdf for scattering to have been initialized. 02may ksl.  This seems to be OK at
-         present. */
+    /* N.B. To use the anisotropic scattering option, extract needs to follow scatter.  This is because the reweighting
+       which occurs in extract needs the pdf for scattering to have been initialized. 02may ksl.  This seems to be OK at
+       present. */
 
-      if (iextract)
+    if (iextract)
+    {
+      stuff_phot (&f->pp, &pextract);
+
+
+      /* JM 1407 -- This next loop is required because in anisotropic scattering mode 2 we have normalised our rejection
+         method. This means that we have to adjust nnscat by this factor, since nnscat will be lower by a factor of
+         1/p_norm */
+      if (geo.scatter_mode == SCATTER_MODE_THERMAL && pextract.nres <= NLINES && pextract.nres > -1)
       {
-        stuff_phot (&pp, &pextract);
-
-
-        /* JM 1407 -- This next loop is required because in anisotropic scattering mode 2 we have normalised our rejection
-           method. This means that we have to adjust nnscat by this factor, since nnscat will be lower by a factor of
-           1/p_norm */
-        if (geo.scatter_mode == SCATTER_MODE_THERMAL && pextract.nres <= NLINES && pextract.nres > -1)
-        {
-          /* we normalised our rejection method by the escape probability along the vector of maximum velocity gradient.
-             First find the sobolev optical depth along that vector. The -1 enforces calculation of the ion density */
-          tau_norm = sobolev (&wmain[pextract.grid], pextract.x, -1.0, lin_ptr[pextract.nres], wmain[pextract.grid].dvds_max);
-
-          /* then turn into a probability */
-          p_norm = p_escape_from_tau (tau_norm);
-
-        }
-        else
-        {
-          p_norm = 1.0;
-
-          /* nnscat is the quantity associated with this photon being extracted */
-          if (nnscat != 1)
-            Error
-              ("nnscat is %i for photon %i in scatter mode %i! nres %i NLINES %i\n",
-               nnscat, p->np, geo.scatter_mode, pextract.nres, NLINES);
-        }
-
-        /* We then increase weight to account for number of scatters. This is done because in extract we multiply by the
-           escape probability along a given direction, but we also need to divide the weight by the mean escape
-           probability, which is equal to 1/nnscat */
-
-        pextract.w *= nnscat / p_norm;
-        extract (w, &pextract, PTYPE_WIND);     // Treat as wind photon for purpose of extraction
-      }
+        /* we normalised our rejection method by the escape probability along the vector of maximum velocity gradient.
+           First find the sobolev optical depth along that vector. The -1 enforces calculation of the ion density */
+        tau_norm = sobolev (&wmain[pextract.grid], pextract.x, -1.0, lin_ptr[pextract.nres], wmain[pextract.grid].dvds_max);
 
+        /* then turn into a probability */
+        p_norm = p_escape_from_tau (tau_norm);
 
-      /* OK we are ready to continue the processing of a photon which has scattered.
-       * The next steps reinitialize parameters
-       so that the photon can continue throug the wind */
+      }
+      else
+      {
+        p_norm = 1.0;
 
-      tau_scat = -log (1. - random_number (0.0, 1.0));
-      istat = pp.istat = P_INWIND;
-      tau = 0;
+        /* nnscat is the quantity associated with this photon being extracted */
+        if (nnscat != 1)
+          Error
+            ("nnscat is %i for photon %i in scatter mode %i! nres %i NLINES %i\n",
+             nnscat, p->np, geo.scatter_mode, pextract.nres, NLINES);
+      }
 
-      stuff_phot (&pp, &pp_reposition_test);
-      stuff_v (pp.x, x_dfudge_check);   // this is a vector we use to see if dfudge moved the photon outside the wind cone
+      /* We then increase weight to account for number of scatters. This is done because in extract we multiply by the
+         escape probability along a given direction, but we also need to divide the weight by the mean escape
+         probability, which is equal to 1/nnscat */
 
-      reposition (&pp);
+      pextract.w *= nnscat / p_norm;
+      extract (w, &pextract, PTYPE_WIND); // Treat as wind photon for purpose of extraction
+    }
 
-      /* JM 1506 -- call walls again to account for instance where DFUDGE
-         can take photon outside of the wind and into the disk or star
-         after scattering. Note that walls updates the istat in pp as well.
-         This may not be necessary but I think to account for every eventuality
-         it should be done. This *does not* update istat if the photon scatters
-         outside of the wind- I guess P_IN_WIND is really in wind or empty space
-         but not escaped. translate_in_space will take care of this next time
-         round. All a bit convoluted but should work. */
 
-      istat = walls (&pp, p, normal);
+    /* OK we are ready to continue the processing of a photon which has scattered.
+     * The next steps reinitialize parameters
+     so that the photon can continue throug the wind */
 
-      if (istat != p->istat)
-      {
-        Log ("Status of %9d changed from %d to %d after reposition\n", p->np, p->istat, istat);
-      }
+    f->tau_scat = -log (1. - random_number (0.0, 1.0));
+    f->istat = f->pp.istat = P_INWIND;
+    f->tau = 0;
 
-      /*
-       * EP 1908 -- see issue #584 for a more complete description of the problem.
-       * This additional error checking was added due to reposition () pushing
-       * photons through the disc plane for a geometrically thin accretion disc,
-       * which would sometimes result in a simulation exiting. The purpose of
-       * this is to move a photon a reduced distance to ensure that it does not
-       * get pushed through the disc plane accidentally
-       */
+    stuff_phot (&f->pp, &pp_reposition_test);
+    stuff_v (f->pp.x, x_dfudge_check); // this is a vector we use to see if dfudge moved the photon outside the wind cone
 
-      if (istat == P_REPOSITION_ERROR)
-      {
-        reposition_lost_disk_photon (&pp_reposition_test);
-        stuff_phot (&pp_reposition_test, &pp);
-        istat = walls (&pp, p, normal);
-      }
+    reposition (&f->pp);
 
-      /* JM 1506 -- we don't throw errors here now, but we do keep a track
-         of how many 4 photons were lost due to DFUDGE pushing them
-         outside of the wind after scatter */
+    /* JM 1506 -- call walls again to account for instance where DFUDGE
+       can take photon outside of the wind and into the disk or star
+       after scattering. Note that walls updates the istat in pp as well.
+       This may not be necessary but I think to account for every eventuality
+       it should be done. This *does not* update istat if the photon scatters
+       outside of the wind- I guess P_IN_WIND is really in wind or empty space
+       but not escaped. translate_in_space will take care of this next time
+       round. All a bit convoluted but should work. */
 
-      if (where_in_wind (pp.x, &ndom) != W_ALL_INWIND && where_in_wind (x_dfudge_check, &ndom) == W_ALL_INWIND)
-      {
-        n_lost_to_dfudge++;     // increment the counter (checked at end of trans_phot)
-      }
+    f->istat = walls (&f->pp, p, f->normal);
 
-      stuff_phot (&pp, p);
-      icell = 0;
+    if (f->istat != p->istat)
+    {
+      Log ("Status of %9d changed from %d to %d after reposition\n", p->np, p->istat, f->istat);
     }
 
-    /* This completes the portion of the code that handles the scattering of a photon.
-     * What follows is a simple check to see if
-     * this particular photon has gotten stuck in the wind */
+    /*
+     * EP 1908 -- see issue #584 for a more complete description of the problem.
+     * This additional error checking was added due to reposition () pushing
+     * photons through the disc plane for a geometrically thin accretion disc,
+     * which would sometimes result in a simulation exiting. The purpose of
+     * this is to move a photon a reduced distance to ensure that it does not
+     * get pushed through the disc plane accidentally
+     */
 
-    if (pp.nscat == MAXSCAT)
+    if (f->istat == P_REPOSITION_ERROR)
     {
-      istat = pp.istat = P_TOO_MANY_SCATTERS;
-      stuff_phot (&pp, p);
-      break;
+      reposition_lost_disk_photon (&pp_reposition_test);
+      stuff_phot (&pp_reposition_test, &f->pp);
+      f->istat = walls (&f->pp, p, f->normal);
     }
 
-    if (pp.istat == P_ERROR_MATOM || pp.istat == P_LOFREQ_FF || pp.istat == P_ADIABATIC)
+    /* JM 1506 -- we don't throw errors here now, but we do keep a track
+       of how many 4 photons were lost due to DFUDGE pushing them
+       outside of the wind after scatter */
+
+    if (where_in_wind (f->pp.x, &ndom) != W_ALL_INWIND && where_in_wind (x_dfudge_check, &ndom) == W_ALL_INWIND)
     {
-      istat = p->istat = pp.istat;
-      stuff_phot (&pp, p);
-      break;
+      n_lost_to_dfudge++;       // increment the counter (checked at end of trans_phot)
     }
 
-    /* This appears partly to be an insurance policy. It is not obvious that for example nscat
-     * and nrscat need to be updated */
-
-    p->istat = istat;
-    p->nscat = pp.nscat;
-    p->nrscat = pp.nrscat;
-    p->w = pp.w;                // Assure that final weight of photon is returned.
+    stuff_phot (&f->pp, p);
+    f->icell = 0;
   }
-  /* This is the end of the loop over a photon */
 
-  /* The next section is for diagnostic purposes.  There are two possibilities.  If you wish to know where
-   * the photon was last while in the wind, you want to track p; if you wish to know where it hits the
-   * outer boundary of the calculation you would want pp.  So one should keep both lines below, and comment
-   * out the one you do not want. */
+  /* This completes the portion of the code that handles the scattering of a photon.
+   * What follows is a simple check to see if
+   * this particular photon has gotten stuck in the wind */
 
-  if (modes.save_photons)
+  if (f->pp.nscat == MAXSCAT)
   {
-    save_photons (&pp, "Final");        //The position of the photon where it exits the calculation
+    f->istat = f->pp.istat = P_TOO_MANY_SCATTERS;
+    stuff_phot (&f->pp, p);
+    f->done = TRUE;
+    return (f->istat);
   }
 
-  return (0);
+  if (f->pp.istat == P_ERROR_MATOM || f->pp.istat == P_LOFREQ_FF || f->pp.istat == P_ADIABATIC)
+  {
+    f->istat = p->istat = f->pp.istat;
+    stuff_phot (&f->pp, p);
+    f->done = TRUE;
+    return (f->istat);
+  }
+
+  /* This appears partly to be an insurance policy. It is not obvious that for example nscat
+   * and nrscat need to be updated */
+
+  p->istat = f->istat;
+  p->nscat = f->pp.nscat;
+  p->nrscat = f->pp.nrscat;
+  p->w = f->pp.w;               // Assure that final weight of photon is returned.
+
+  if (f->istat != P_INWIND)
+    f->done = TRUE;
+
+  return (f->istat);
 }
@@ -0,0 +1,315 @@
+/***********************************************************/
+/** @file  trans_phot_event.c
+ * @date   October, 2026
+ *
+ * @brief  An event based engine for transporting a flight of
+ * photons through the wind
+ *
+ * ### Notes ###
+ *
+ * trans_phot_single follows one photon from the moment it is
+ * created until it leaves the system, before going on to the
+ * next.  This means that each step of the photon's flight
+ * touches a different part of the wind, and different code,
+ * from the one before.
+ *
+ * The routines here instead advance all of the photons in a
+ * batch by one step at a time.  Each sweep through the batch
+ *
+ * * orders the photons that are still in flight by the wind cell
+ * they are in,
+ * * moves each of them to the next cell boundary or scattering
+ * point (flight_move),
+ * * partitions them by what happened to them, that is whether
+ * they crossed into a new cell, are about to scatter, or hit
+ * the star or the disk, and
+ * * processes each of these groups of events in turn (flight_interact).
+ *
+ * Photons which have finished their flights are dropped from the
+ * batch, and the sweeps continue until the batch is empty.
+ *
+ * The photons themselves stay in the array of photon structures
+ * and the physics is done by exactly the same routines as are
+ * used by trans_phot_single.  What is held separately, as a set of
+ * parallel integer arrays, is the bank of keys which is sorted and
+ * partitioned on each sweep: the index of each live photon, the cell
+ * it is in and the event which it has just undergone.
+ *
+ * The engine is selected with the --event command line switch.
+ * Because photons are processed in a different order, the random
+ * number sequence is consumed in a different order, and so the
+ * results are statistically, but not bit for bit, the same as
+ * those obtained without it.
+ *
+ ***********************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "atomic.h"
+#include "python.h"
+
+#define NEVENT_BATCH  100000    /* The maximum number of photons which are in flight at once */
+
+/* The classes of event into which live photons are partitioned after each move. The
+   order here is the order in which the groups of events are processed */
+
+enum event_class_enum
+{
+  EVENT_CROSS = 0,              // The photon reached the edge of a cell, or left the system
+  EVENT_SCAT = 1,               // The photon reached its scattering optical depth
+  EVENT_SURFACE = 2,            // The photon hit the star or the disk
+  NEVENT_CLASS = 3
+};
+
+
+
+/**********************************************************/
+/**
+ * @brief      Transport a flight of photons through the wind in batches
+ *
+ * @param [in] WindPtr  w   The entire wind domain
+ * @param [in, out] PhotPtr  p   A pointer to a "flight" of photons
+ * @param [in] int  iextract   0 for the live or die option, non-zero if
+ * photons are also to be extracted in specific directions
+ * @return   Always returns 0
+ *
+ * @details
+ * This is an alternative to calling trans_phot_single for each photon
+ * in turn.  The photons are divided into batches of at most NEVENT_BATCH
+ * photons, and the photons within a batch are advanced together, one
+ * move at a time, as described in the notes at the top of this file.
+ *
+ * ### Notes ###
+ *
+ * trans_phot has already extracted the photons as they were generated,
+ * when this is required, so this routine only deals with what happens
+ * after the photons leave their point of origin.
+ *
+ **********************************************************/
+
+int
+trans_phot_event (WindPtr w, PhotPtr p, int iextract)
+{
+  FlightPtr f;
+  int *live, *cell, *event, *scratch, *count;
+  int nstart[NEVENT_CLASS + 1];
+  long nevent[NEVENT_CLASS];
+  int nbatch, nfirst, n, i, k, m, nlive, nsweep;
+  long nmove;
+
+  nbatch = NPHOT < NEVENT_BATCH ? NPHOT : NEVENT_BATCH;
+  if (nbatch < 1)
+    return (0);
+
+  f = (FlightPtr) calloc (nbatch, sizeof (flight_dummy));
+  live = (int *) calloc (nbatch, sizeof (int));
+  cell = (int *) calloc (nbatch, sizeof (int));
+  event = (int *) calloc (nbatch, sizeof (int));
+  scratch = (int *) calloc (nbatch, sizeof (int));
+  count = (int *) calloc (NDIM2 + 2, sizeof (int));
+
+  if (f == NULL || live == NULL || cell == NULL || event == NULL || scratch == NULL || count == NULL)
+  {
+    Error ("trans_phot_event: Could not allocate memory for a batch of %d photons\n", nbatch);
+    Exit (0);
+  }
+
+  /* The buffers are freed at the end of each call, but are registered with the size they have during transport */
+  mem_register (MEM_PHOTONS, "event_buffers",
+                (double) nbatch * (sizeof (flight_dummy) + 4 * sizeof (int)) + (double) (NDIM2 + 2) * sizeof (int));
+
+  nmove = 0;
+  for (k = 0; k < NEVENT_CLASS; k++)
+    nevent[k] = 0;
+
+  for (nfirst = 0; nfirst < NPHOT; nfirst += nbatch)
+  {
+    n = NPHOT - nfirst < nbatch ? NPHOT - nfirst : nbatch;
+
+    for (i = 0; i < n; i++)
+    {
+      init_flight (&p[nfirst + i], &f[i]);
+      live[i] = i;
+    }
+    nlive = n;
+    nsweep = 0;
+
+    while (nlive > 0)
+    {
+      /* Order the live photons by the cell they are in, so that each kernel below works through the wind in order */
+
+      for (m = 0; m < nlive; m++)
+        cell[live[m]] = f[live[m]].pp.grid;
+      event_sort_by_cell (nlive, live, cell, scratch, count);
+
+      /* Move every live photon to the next boundary or scattering point */
+
+      for (m = 0; m < nlive; m++)
+      {
+        i = live[m];
+        flight_move (w, &p[nfirst + i], &f[i]);
+
+        if (f[i].done)
+        {
+          if (modes.save_photons)
+            save_photons (&f[i].pp, "Final");
+          event[i] = EVENT_CROSS;
+        }
+        else if (f[i].istat == P_SCAT)
+          event[i] = EVENT_SCAT;
+        else if (f[i].istat == P_HIT_STAR || f[i].istat == P_HIT_DISK)
+          event[i] = EVENT_SURFACE;
+        else
+          event[i] = EVENT_CROSS;
+      }
+      nmove += nlive;
+
+      /* Group the photons by what has just happened to them, and process each group in turn */
+
+      event_partition (nlive, live, event, scratch, nstart);
+
+      for (k = 0; k < NEVENT_CLASS; k++)
+      {
+        nevent[k] += nstart[k + 1] - nstart[k];
+        for (m = nstart[k]; m < nstart[k + 1]; m++)
+        {
+          i = live[m];
+          if (f[i].done)
+            continue;
+          flight_interact (w, &p[nfirst + i], &f[i], iextract);
+          if (f[i].done && modes.save_photons)
+            save_photons (&f[i].pp, "Final");
+        }
+      }
+
+      /* Drop the photons whose flights are over */
+
+      k = 0;
+      for (m = 0; m < nlive; m++)
+      {
+        if (!f[live[m]].done)
+          live[k++] = live[m];
+      }
+      nlive = k;
+      nsweep++;
+    }
+
+    Log ("trans_phot_event: Photons %10d to %10d completed in %6d sweeps\n", nfirst, nfirst + n - 1, nsweep);
+  }
+
+  Log ("trans_phot_event: %ld moves, of which %ld ended at a cell boundary, %ld in a scatter and %ld on the star or disk\n",
+       nmove, nevent[EVENT_CROSS], nevent[EVENT_SCAT], nevent[EVENT_SURFACE]);
+
+  free (f);
+  free (live);
+  free (cell);
+  free (event);
+  free (scratch);
+  free (count);
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Order a list of live photons by the wind cell they are in
+ *
+ * @param [in] int  nlive   The number of live photons
+ * @param [in, out] int *  live   The indices of the live photons, which are reordered
+ * @param [in] int *  cell   The cell of each photon, indexed by the values in live
+ * @param [out] int *  scratch   Workspace with room for nlive elements
+ * @param [out] int *  count   Workspace with room for NDIM2 + 2 elements
+ * @return   Always returns 0
+ *
+ * @details
+ * This is a counting sort on the cell number, which is stable, so that photons
+ * in the same cell stay in the order they were in.  Photons which are not in a
+ * wind cell, for which the cell is negative, are placed first.
+ *
+ **********************************************************/
+
+int
+event_sort_by_cell (int nlive, int *live, int *cell, int *scratch, int *count)
+{
+  int nkey, key, m, sum, nn;
+
+  nkey = NDIM2 + 1;
+  memset (count, 0, (nkey + 1) * sizeof (int));
+
+  for (m = 0; m < nlive; m++)
+  {
+    key = cell[live[m]] >= 0 && cell[live[m]] < NDIM2 ? cell[live[m]] + 1 : 0;
+    count[key + 1]++;
+  }
+
+  sum = 0;
+  for (key = 0; key <= nkey; key++)
+  {
+    nn = count[key];
+    count[key] = sum;
+    sum += nn;
+  }
+
+  for (m = 0; m < nlive; m++)
+  {
+    key = cell[live[m]] >= 0 && cell[live[m]] < NDIM2 ? cell[live[m]] + 1 : 0;
+    scratch[count[key + 1]++] = live[m];
+  }
+
+  for (m = 0; m < nlive; m++)
+    live[m] = scratch[m];
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Partition a list of live photons by the event they have just undergone
+ *
+ * @param [in] int  nlive   The number of live photons
+ * @param [in, out] int *  live   The indices of the live photons, which are reordered
+ * @param [in] int *  event   The event class of each photon, indexed by the values in live
+ * @param [out] int *  scratch   Workspace with room for nlive elements
+ * @param [out] int *  nstart   The position in live of the first photon of each event
+ * class, with nstart[NEVENT_CLASS] set to nlive
+ * @return   Always returns 0
+ *
+ * @details
+ * The partition is stable, so that within each class of event the photons remain
+ * in the cell order established by event_sort_by_cell.
+ *
+ **********************************************************/
+
+int
+event_partition (int nlive, int *live, int *event, int *scratch, int *nstart)
+{
+  int pos[NEVENT_CLASS];
+  int k, m;
+
+  for (k = 0; k <= NEVENT_CLASS; k++)
+    nstart[k] = 0;
+
+  for (m = 0; m < nlive; m++)
+    nstart[event[live[m]] + 1]++;
+
+  for (k = 0; k < NEVENT_CLASS; k++)
+  {
+    nstart[k + 1] += nstart[k];
+    pos[k] = nstart[k];
+  }
+
+  for (m = 0; m < nlive; m++)
+    scratch[pos[event[live[m]]]++] = live[m];
+
+  for (m = 0; m < nlive; m++)
+    live[m] = scratch[m];
+
+  return (0);
+}
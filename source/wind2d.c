@@ -35,6 +35,9 @@
  * the wind.  In some case the initalization is done "in-line" but more often other routines,
  * many of which coordinate system specifica are clled.
  *
+ * If the --setup_cache switch has been given, the volumes, inwind, div_v and dvds quantities
+ * for the cells are read from a cache file if one exists for this geometry, and otherwise
+ * are saved to one once they have been calculated.  See wind_setup.c
  *
  **********************************************************/
 
@@ -52,6 +55,8 @@ define_wind ()
   int nwind, ndom;
   int nstart, ndim, mdim;
   int nplasma;
+  int use_cache;
+  char cache_file[LINELENGTH];
 
   WindPtr w;
 
@@ -166,11 +171,20 @@ define_wind ()
 
   wind_complete (w);
 
+  /* If possible, read the quantities which depend only on the geometry from a cache */
+
+  use_cache = FALSE;
+  if (modes.setup_cache)
+  {
+    setup_cache_name (cache_file);
+    use_cache = setup_cache_read (cache_file);
+  }
+
   /* Now determine the valid volumes of each cell and also determine whether the cells are in all
      or partially in the wind.
    */
 
-  for (ndom = 0; ndom < geo.ndomain; ndom++)
+  for (ndom = 0; ndom < geo.ndomain && !use_cache; ndom++)
   {
     if (zdom[ndom].coord_type == SPHERICAL)
     {
@@ -205,6 +219,9 @@ define_wind ()
     }
   }
 
+  if (!use_cache)
+    setup_share (SETUP_VOLUMES);
+
 
 
 
@@ -413,7 +430,8 @@ be optional which variables beyond here are moved to structures othere than Wind
 
 
 /* Calculate the the divergence of the wind at the center of each grid cell */
-  wind_div_v ();
+  if (!use_cache)
+    wind_div_v ();
 
 /* Now calculate the adiabatic cooling and shock heating */
   for (i = 0; i < NPLASMA; i++)
@@ -443,7 +461,11 @@ be optional which variables beyond here are moved to structures othere than Wind
 
 
   /* Calculate one over dvds */
-  dvds_ave ();
+  if (!use_cache || modes.print_dvds_info)
+    dvds_ave ();
+
+  if (modes.setup_cache && !use_cache)
+    setup_cache_write (cache_file);
 
 
   wind_check (w, -1);           // Check the wind for reasonability
@@ -569,9 +591,11 @@ where_in_grid (ndom, x)
   int n;
   double fx, fz;
 
+  PERF_COUNT (PERF_GRID_LOOKUPS);
 
   if (wig_x != x[0] || wig_y != x[1] || wig_z != x[2])  // Calculate if new position
   {
+    PERF_COUNT (PERF_GRID_SEARCHES);
 
     if (zdom[ndom].coord_type == CYLIND)
     {
@@ -604,10 +628,87 @@ where_in_grid (ndom, x)
     wig_z = x[2];
     wig_n = n;
   }
+  else
+  {
+    PERF_COUNT (PERF_GRID_CACHE_HITS);
+  }
 
   return (wig_n);
 }
 
+
+
+/**********************************************************/
+/**
+ * @brief      Find the cell in wmain associated with a position, given a
+ * cell which it is likely to be in or next to
+ *
+ * @param [in] int  ndom   The domain number
+ * @param [in] double  x[]   A position
+ * @param [in] int  nhint   A cell in wmain, usually the one the photon
+ * was in before it was last moved
+ * @return     The same value as where_in_grid would return
+ *
+ * @details
+ * The routine first checks whether the position is in the cell nhint,
+ * and then whether it is in one of the cells across the faces of nhint,
+ * using the topology constructed by wind_topology.  If neither is the
+ * case, where_in_grid is used to search the entire domain.
+ *
+ * ### Notes ###
+ * The position and the result are stored in the same way as by
+ * where_in_grid, so that subsequent calls to where_in_grid for the
+ * same position do not repeat the search.
+ *
+ **********************************************************/
+
+int
+where_in_grid_hint (ndom, x, nhint)
+     int ndom;
+     double x[];
+     int nhint;
+{
+  int n, k;
+
+  if (wig_x == x[0] && wig_y == x[1] && wig_z == x[2])
+  {
+    PERF_COUNT (PERF_GRID_CACHE_HITS);
+    return (wig_n);
+  }
+
+  if (wmain_topology == NULL || nhint < zdom[ndom].nstart || nhint >= zdom[ndom].nstop)
+    return (where_in_grid (ndom, x));
+
+  n = -1;
+  if (topology_in_cell (nhint, x))
+  {
+    n = nhint;
+  }
+  else
+  {
+    for (k = 0; k < NFACE; k++)
+    {
+      if (wmain_topology[nhint].nbr[k] >= 0 && topology_in_cell (wmain_topology[nhint].nbr[k], x))
+      {
+        n = wmain_topology[nhint].nbr[k];
+        break;
+      }
+    }
+  }
+
+  if (n < 0)
+    return (where_in_grid (ndom, x));
+
+  PERF_COUNT (PERF_GRID_HINT_HITS);
+
+  wig_x = x[0];
+  wig_y = x[1];
+  wig_z = x[2];
+  wig_n = n;
+
+  return (n);
+}
+
 int ierr_vwind = 0;
 
 
@@ -677,7 +778,7 @@ vwind_xyz (ndom, p, v)
 
     x = 0;
     for (nn = 0; nn < nelem; nn++)
-      x += wmain[nnn[nn]].v[i] * frac[nn];
+      x += WIND_V (nnn[nn])[i] * frac[nn];
 
     vv[i] = x;
   }
@@ -746,6 +847,9 @@ vwind_xyz (ndom, p, v)
  * need to be "rotated" differently in different coordinate
  * systems
  *
+ * With MPI, each thread calculates the divergence for the cells
+ * it owns (see setup_cell_mine) and the results are then shared.
+ *
  *
  **********************************************************/
 int wind_div_err = (-3);
@@ -766,6 +870,9 @@ wind_div_v ()
 
   for (icell = 0; icell < NDIM2; icell++)
   {
+    if (!setup_cell_mine (icell))
+      continue;
+
     /* Find the center of the cell */
 
     stuff_v (wmain[icell].xcen, x_zero);        /*Gget the centre of the current cell in the loop */
@@ -837,6 +944,8 @@ wind_div_v ()
     }
   }
 
+  setup_share (SETUP_DIV_V);
+
   return (0);
 }
 
@@ -0,0 +1,459 @@
+/***********************************************************/
+/** @file  wind_setup.c
+ * @date   October, 2026
+ *
+ * @brief  Routines which divide the construction of the wind grid
+ * between MPI threads, and which save and restore the quantities
+ * derived from the geometry of the grid so that they need not be
+ * calculated again.
+ *
+ * ### Notes ###
+ *
+ * When the wind is defined, the volume of each cell and whether it
+ * is in the wind are found by sampling those cells that are partially
+ * in the wind on a fine mesh, and the divergence of the velocity and
+ * the average and maximum of dv/ds are found by sampling the velocity
+ * field around the centre of each cell.  For large grids this takes
+ * a long time, and in the past every thread repeated the same
+ * calculation.
+ *
+ * Here the cells are instead dealt out to the threads in turn.  Each
+ * thread calculates these quantities only for the cells it owns, and
+ * the results are then shared, so that at the end every thread has
+ * the same values for every cell.  Without MPI, the one thread owns
+ * all of the cells and nothing changes.
+ *
+ * The same quantities depend only on the grid, the velocity field and
+ * the boundaries of the wind, the star and the disk.  If the --setup_cache
+ * switch is given, they are written to a file whose name contains a
+ * hash of all of these, and a later run (for example one
+ * of a set of models which differ only in their densities or temperatures)
+ * which finds the file reads them back rather than calculating them again.
+ *
+ ***********************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "atomic.h"
+#include "python.h"
+
+/* These must match the values used in the routines which calculate the volumes and dvds_ave,
+   as they form part of the key of the cache */
+
+#define SETUP_RESOLUTION_CYL   1000
+#define SETUP_RESOLUTION_SPH   100
+#define SETUP_N_DVDS_AVE       10000
+
+#define NSETUP_CACHE           8        /* The number of values saved for each cell */
+
+
+
+/**********************************************************/
+/**
+ * @brief      Determine whether this thread is responsible for setting up a wind cell
+ *
+ * @param [in] int  n   The cell in wmain
+ * @return     TRUE if this thread should calculate the properties of the cell,
+ * FALSE otherwise
+ *
+ * @details
+ * The cells are dealt out to the threads in turn, so that the cells which
+ * are partially in the wind, and so take longest to set up, are spread
+ * evenly between them.
+ *
+ **********************************************************/
+
+int
+setup_cell_mine (n)
+     int n;
+{
+#ifdef MPI_ON
+  return (n % np_mpi_global == rank_global);
+#else
+  return (TRUE);
+#endif
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Share the results of setting up the wind cells between threads
+ *
+ * @param [in] int  mode   SETUP_VOLUMES, SETUP_DIV_V or SETUP_DVDS, which
+ * indicates which quantities are to be shared
+ * @return     Always returns 0
+ *
+ * @details
+ * Each thread contributes the values for the cells it owns, as given by
+ * setup_cell_mine, and zero for the others, and the contributions are summed,
+ * so that every thread ends up with the values calculated by the owner of
+ * each cell.
+ *
+ * SETUP_VOLUMES shares vol and inwind, SETUP_DIV_V shares div_v, and SETUP_DVDS
+ * shares dvds_ave, dvds_max and lmn.
+ *
+ * ### Notes ###
+ *
+ * Without MPI this routine does nothing.
+ *
+ **********************************************************/
+
+int
+setup_share (mode)
+     int mode;
+{
+#ifdef MPI_ON
+  double *buf, *sum;
+  int nvals, n, k;
+
+  if (np_mpi_global < 2)
+    return (0);
+
+  if (mode == SETUP_VOLUMES)
+    nvals = 2;
+  else if (mode == SETUP_DIV_V)
+    nvals = 1;
+  else
+    nvals = 5;
+
+  buf = (double *) calloc (sizeof (double), nvals * NDIM2);
+  sum = (double *) calloc (sizeof (double), nvals * NDIM2);
+  if (buf == NULL || sum == NULL)
+  {
+    Error ("setup_share: Could not allocate memory for %d cells\n", NDIM2);
+    Exit (0);
+  }
+
+  for (n = 0; n < NDIM2; n++)
+  {
+    if (!setup_cell_mine (n))
+      continue;
+    k = nvals * n;
+    if (mode == SETUP_VOLUMES)
+    {
+      buf[k] = wmain[n].vol;
+      buf[k + 1] = wmain[n].inwind;
+    }
+    else if (mode == SETUP_DIV_V)
+    {
+      buf[k] = wmain[n].div_v;
+    }
+    else
+    {
+      buf[k] = wmain[n].dvds_ave;
+      buf[k + 1] = wmain[n].dvds_max;
+      buf[k + 2] = wmain[n].lmn[0];
+      buf[k + 3] = wmain[n].lmn[1];
+      buf[k + 4] = wmain[n].lmn[2];
+    }
+  }
+
+  MPI_Allreduce (buf, sum, nvals * NDIM2, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+  for (n = 0; n < NDIM2; n++)
+  {
+    k = nvals * n;
+    if (mode == SETUP_VOLUMES)
+    {
+      wmain[n].vol = sum[k];
+      wmain[n].inwind = (int) sum[k + 1];
+    }
+    else if (mode == SETUP_DIV_V)
+    {
+      wmain[n].div_v = sum[k];
+    }
+    else
+    {
+      wmain[n].dvds_ave = sum[k];
+      wmain[n].dvds_max = sum[k + 1];
+      wmain[n].lmn[0] = sum[k + 2];
+      wmain[n].lmn[1] = sum[k + 3];
+      wmain[n].lmn[2] = sum[k + 4];
+    }
+  }
+
+  free (buf);
+  free (sum);
+#endif
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Add a block of memory to a 64 bit FNV-1a hash
+ *
+ * @param [in] unsigned long long  hash   The hash so far
+ * @param [in] void *  data   The block of memory
+ * @param [in] int  nbytes   The size of the block
+ * @return     The updated hash
+ *
+ **********************************************************/
+
+unsigned long long
+setup_hash (unsigned long long hash, void *data, int nbytes)
+{
+  unsigned char *c;
+  int i;
+
+  c = (unsigned char *) data;
+  for (i = 0; i < nbytes; i++)
+  {
+    hash ^= c[i];
+    hash *= FNV_PRIME;
+  }
+
+  return (hash);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Construct the name of the cache file for the current wind geometry
+ *
+ * @param [out] char  filename[]   The name of the cache file
+ * @return     Always returns 0
+ *
+ * @details
+ * The name contains a hash of everything which the volumes, inwind, div_v and
+ * dvds quantities depend upon: the size of the grid, the positions of the
+ * cells, the velocities at their corners, any values of inwind which have already
+ * been assigned (for example by an imported model), the boundaries of each
+ * domain, the size of the star and the shape of the disk, as well as the
+ * resolution with which these quantities are calculated.
+ *
+ * ### Notes ###
+ *
+ * The routine must be called after the positions and velocities have been
+ * set up, but before the volumes have been calculated.  Quantities such as the
+ * mass loss rate, which only change the density, do not form part of the key,
+ * so a set of models which differ only in these share a cache file.
+ *
+ **********************************************************/
+
+int
+setup_cache_name (filename)
+     char filename[];
+{
+  unsigned long long hash;
+  int n, ndom, ival[8];
+  double dval[8];
+  DomainPtr one_dom;
+
+  hash = FNV_OFFSET;
+
+  ival[0] = NDIM2;
+  ival[1] = geo.ndomain;
+  ival[2] = geo.disk_type;
+  ival[3] = SETUP_RESOLUTION_CYL;
+  ival[4] = SETUP_RESOLUTION_SPH;
+  ival[5] = SETUP_N_DVDS_AVE;
+  hash = setup_hash (hash, ival, 6 * sizeof (int));
+
+  dval[0] = geo.rstar;
+  dval[1] = geo.diskrad;
+  dval[2] = geo.disk_z0;
+  dval[3] = geo.disk_z1;
+  hash = setup_hash (hash, dval, 4 * sizeof (double));
+
+  for (ndom = 0; ndom < geo.ndomain; ndom++)
+  {
+    one_dom = &zdom[ndom];
+
+    ival[0] = one_dom->coord_type;
+    ival[1] = one_dom->wind_type;
+    ival[2] = one_dom->ndim;
+    ival[3] = one_dom->mdim;
+    ival[4] = one_dom->nstart;
+    hash = setup_hash (hash, ival, 5 * sizeof (int));
+
+    dval[0] = one_dom->rmin;
+    dval[1] = one_dom->rmax;
+    dval[2] = one_dom->zmax;
+    dval[3] = one_dom->wind_rho_min;
+    dval[4] = one_dom->wind_rho_max;
+    dval[5] = one_dom->wind_thetamin;
+    dval[6] = one_dom->wind_thetamax;
+    hash = setup_hash (hash, dval, 7 * sizeof (double));
+
+    hash = setup_hash (hash, one_dom->wind_x, NDIM_MAX * sizeof (double));
+    hash = setup_hash (hash, one_dom->wind_z, NDIM_MAX * sizeof (double));
+  }
+
+  for (n = 0; n < NDIM2; n++)
+  {
+    hash = setup_hash (hash, wmain[n].x, 3 * sizeof (double));
+    hash = setup_hash (hash, wmain[n].xcen, 3 * sizeof (double));
+    hash = setup_hash (hash, wmain[n].v, 3 * sizeof (double));
+    hash = setup_hash (hash, &wmain[n].inwind, sizeof (int));
+    hash = setup_hash (hash, &wmain[n].ndom, sizeof (int));
+  }
+
+  sprintf (filename, "py_setup_%016llx.cache", hash);
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Read the volumes, inwind, div_v and dvds quantities from a cache file
+ *
+ * @param [in] char  filename[]   The name of the cache file
+ * @return     TRUE if the values were read, FALSE if the file does not exist
+ * or does not match the current grid
+ *
+ * @details
+ * wmain is only modified if the whole file has been read successfully.
+ *
+ * ### Notes ###
+ *
+ * With MPI, each thread reads the file itself, and the values are only used
+ * if every thread succeeded, so that the threads do not set up the wind
+ * differently.
+ *
+ **********************************************************/
+
+int
+setup_cache_read (filename)
+     char filename[];
+{
+  FILE *fptr;
+  char line[LINELENGTH], version[LINELENGTH], name[LINELENGTH];
+  double *buf;
+  int n, nwind, ok;
+
+  ok = FALSE;
+  buf = NULL;
+
+  if ((fptr = fopen (filename, "r")) != NULL)
+  {
+    if (fgets (line, LINELENGTH, fptr) != NULL && sscanf (line, "%*s %s %s %d", version, name, &nwind) == 3
+        && strcmp (version, VERSION) == 0 && strcmp (name, filename) == 0 && nwind == NDIM2)
+    {
+      buf = (double *) calloc (sizeof (double), NSETUP_CACHE * NDIM2);
+      if (buf != NULL && fread (buf, sizeof (double), NSETUP_CACHE * NDIM2, fptr) == (size_t) (NSETUP_CACHE * NDIM2))
+        ok = TRUE;
+    }
+    fclose (fptr);
+  }
+
+#ifdef MPI_ON
+  {
+    int ok_all;
+    MPI_Allreduce (&ok, &ok_all, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    ok = ok_all;
+  }
+#endif
+
+  if (ok)
+  {
+    for (n = 0; n < NDIM2; n++)
+    {
+      wmain[n].vol = buf[NSETUP_CACHE * n];
+      wmain[n].inwind = (int) buf[NSETUP_CACHE * n + 1];
+      wmain[n].div_v = buf[NSETUP_CACHE * n + 2];
+      wmain[n].dvds_ave = buf[NSETUP_CACHE * n + 3];
+      wmain[n].dvds_max = buf[NSETUP_CACHE * n + 4];
+      wmain[n].lmn[0] = buf[NSETUP_CACHE * n + 5];
+      wmain[n].lmn[1] = buf[NSETUP_CACHE * n + 6];
+      wmain[n].lmn[2] = buf[NSETUP_CACHE * n + 7];
+    }
+    Log ("setup_cache_read: Read the volumes and velocity gradients of the wind cells from %s\n", filename);
+  }
+  else
+  {
+    Log ("setup_cache_read: No usable cache %s, so the wind cells will be set up from scratch\n", filename);
+  }
+
+  free (buf);
+
+  return (ok);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Write the volumes, inwind, div_v and dvds quantities to a cache file
+ *
+ * @param [in] char  filename[]   The name of the cache file
+ * @return     Always returns 0
+ *
+ * @details
+ * The file consists of a line giving the version of Python, the name of the
+ * file, which contains the key, and the number of cells, followed by the
+ * values for each cell in binary.
+ *
+ * ### Notes ###
+ *
+ * Only the master thread writes the file.  It is written under a temporary
+ * name and then renamed, so that another run never sees a partial file.
+ *
+ **********************************************************/
+
+int
+setup_cache_write (filename)
+     char filename[];
+{
+  FILE *fptr;
+  char tmpname[LINELENGTH];
+  double *buf;
+  int n;
+
+  if (rank_global != 0)
+    return (0);
+
+  buf = (double *) calloc (sizeof (double), NSETUP_CACHE * NDIM2);
+  if (buf == NULL)
+  {
+    Error ("setup_cache_write: Could not allocate memory for %d cells\n", NDIM2);
+    return (0);
+  }
+
+  for (n = 0; n < NDIM2; n++)
+  {
+    buf[NSETUP_CACHE * n] = wmain[n].vol;
+    buf[NSETUP_CACHE * n + 1] = wmain[n].inwind;
+    buf[NSETUP_CACHE * n + 2] = wmain[n].div_v;
+    buf[NSETUP_CACHE * n + 3] = wmain[n].dvds_ave;
+    buf[NSETUP_CACHE * n + 4] = wmain[n].dvds_max;
+    buf[NSETUP_CACHE * n + 5] = wmain[n].lmn[0];
+    buf[NSETUP_CACHE * n + 6] = wmain[n].lmn[1];
+    buf[NSETUP_CACHE * n + 7] = wmain[n].lmn[2];
+  }
+
+  sprintf (tmpname, "%s.tmp", filename);
+  if ((fptr = fopen (tmpname, "w")) == NULL)
+  {
+    Error ("setup_cache_write: Unable to open %s\n", tmpname);
+    free (buf);
+    return (0);
+  }
+
+  fprintf (fptr, "Version %s %s %d\n", VERSION, filename, NDIM2);
+  n = fwrite (buf, sizeof (double), NSETUP_CACHE * NDIM2, fptr);
+  fclose (fptr);
+
+  if (n != NSETUP_CACHE * NDIM2 || rename (tmpname, filename) != 0)
+  {
+    Error ("setup_cache_write: Unable to write %s\n", filename);
+    remove (tmpname);
+  }
+  else
+  {
+    Log ("setup_cache_write: Saved the volumes and velocity gradients of the wind cells to %s\n", filename);
+  }
+
+  free (buf);
+
+  return (0);
+}
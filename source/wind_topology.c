@@ -0,0 +1,228 @@
+/***********************************************************/
+/** @file  wind_topology.c
+ * @date   October, 2026
+ *
+ * @brief  Routines which record the topology of the wind grid, that
+ * is the boundaries of each cell and the cells which adjoin it, and
+ * which use this to locate positions in the grid.
+ *
+ * ### Notes ###
+ *
+ * where_in_grid finds the cell associated with a position by
+ * searching the entire grid of a domain.  For cylvar coordinates,
+ * the search also involves inverting a bilinear interpolation
+ * for one or more cells.  During photon transport, however, a photon
+ * almost always ends a step either in the cell in which it began, or in
+ * the cell on the other side of the face through which it left.
+ *
+ * The topology constructed here allows one to test whether a position
+ * is in a particular cell with a handful of comparisons, and so to check
+ * a cell and its neighbours before resorting to a full search.
+ *
+ * A cell is only marked as one in which positions can be located from
+ * its boundaries if it is a cell that where_in_grid can return, so
+ * that the guard cells at the outer edges of the grid are excluded.
+ * Positions are assigned to cells with the same convention as fraction,
+ * so that a position which lies on a boundary belongs to the cell below it.
+ *
+ ***********************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "atomic.h"
+#include "python.h"
+
+
+
+/**********************************************************/
+/**
+ * @brief      Construct the topology of the wind grid for all domains
+ *
+ * @return     Always returns 0
+ *
+ * @details
+ * For each cell in wmain, the routine records the squares of the inner and
+ * outer radial boundaries, the boundaries in z (cylindrical and cylvar
+ * coordinates) or the cosines of the boundaries in theta (rtheta coordinates),
+ * and the cell on the other side of each face.
+ *
+ * For cylvar coordinates the lower and upper boundaries of a cell are the
+ * straight lines joining the corners of the cell, and so are recorded as
+ * the coefficients a and b of z = a + b rho.  For cylindrical coordinates b is 0.
+ *
+ * ### Notes ###
+ *
+ * The routine is called from wind_complete, so that the topology is
+ * available both when the wind is defined for the first time, and when
+ * it has been read from a windsave file.
+ *
+ **********************************************************/
+
+int
+wind_topology ()
+{
+  static int ntopology = 0;
+  int ndom, ndim, mdim, nstart;
+  int i, j, n;
+  TopologyPtr one;
+  DomainPtr one_dom;
+  double x0, x1, z0, z1;
+
+  if (wmain_topology == NULL || ntopology != NDIM2)
+  {
+    free (wmain_topology);
+    ntopology = NDIM2;
+    if ((wmain_topology = (TopologyPtr) calloc (sizeof (topology_dummy), ntopology)) == NULL)
+    {
+      Error ("wind_topology: Error in allocating memory for %d wind cells\n", ntopology);
+      Exit (0);
+    }
+    mem_register (MEM_WIND, "wmain_topology", (double) ntopology * sizeof (topology_dummy));
+  }
+
+  for (ndom = 0; ndom < geo.ndomain; ndom++)
+  {
+    one_dom = &zdom[ndom];
+    ndim = one_dom->ndim;
+    mdim = one_dom->mdim;
+    nstart = one_dom->nstart;
+
+    if (one_dom->coord_type == SPHERICAL)
+    {
+      for (i = 0; i < ndim; i++)
+      {
+        one = &wmain_topology[nstart + i];
+        one->ok = (i < ndim - 1);
+        one->nbr[FACE_INNER] = (i > 0) ? nstart + i - 1 : -1;
+        one->nbr[FACE_OUTER] = (i < ndim - 2) ? nstart + i + 1 : -1;
+        one->nbr[FACE_LOWER] = one->nbr[FACE_UPPER] = -1;
+        if (one->ok)
+        {
+          one->r2lo = one_dom->wind_x[i] * one_dom->wind_x[i];
+          one->r2hi = one_dom->wind_x[i + 1] * one_dom->wind_x[i + 1];
+        }
+      }
+      continue;
+    }
+
+    for (i = 0; i < ndim; i++)
+    {
+      for (j = 0; j < mdim; j++)
+      {
+        n = nstart + i * mdim + j;
+        one = &wmain_topology[n];
+        one->ok = (i < ndim - 1 && j < mdim - 1);
+        one->nbr[FACE_INNER] = (i > 0 && one->ok) ? n - mdim : -1;
+        one->nbr[FACE_OUTER] = (i < ndim - 2 && one->ok) ? n + mdim : -1;
+        one->nbr[FACE_LOWER] = (j > 0 && one->ok) ? n - 1 : -1;
+        one->nbr[FACE_UPPER] = (j < mdim - 2 && one->ok) ? n + 1 : -1;
+
+        if (!one->ok)
+          continue;
+
+        one->r2lo = one_dom->wind_x[i] * one_dom->wind_x[i];
+        one->r2hi = one_dom->wind_x[i + 1] * one_dom->wind_x[i + 1];
+
+        if (one_dom->coord_type == CYLIND)
+        {
+          one->zlo[0] = one_dom->wind_z[j];
+          one->zhi[0] = one_dom->wind_z[j + 1];
+          one->zlo[1] = one->zhi[1] = 0.0;
+        }
+        else if (one_dom->coord_type == RTHETA)
+        {
+          one->zlo[0] = cos (one_dom->wind_z[j + 1] / RADIAN);
+          one->zhi[0] = cos (one_dom->wind_z[j] / RADIAN);
+          one->zlo[1] = one->zhi[1] = 0.0;
+        }
+        else if (one_dom->coord_type == CYLVAR)
+        {
+          x0 = one_dom->wind_x[i];
+          x1 = one_dom->wind_x[i + 1];
+
+          z0 = one_dom->wind_z_var[i][j];
+          z1 = one_dom->wind_z_var[i + 1][j];
+          one->zlo[1] = (z1 - z0) / (x1 - x0);
+          one->zlo[0] = z0 - one->zlo[1] * x0;
+
+          z0 = one_dom->wind_z_var[i][j + 1];
+          z1 = one_dom->wind_z_var[i + 1][j + 1];
+          one->zhi[1] = (z1 - z0) / (x1 - x0);
+          one->zhi[0] = z0 - one->zhi[1] * x0;
+
+          one->zmax = one_dom->wind_z_var[i][mdim - 1];
+        }
+        else
+        {
+          Error ("wind_topology: Unknown coord_type %d for domain %d\n", one_dom->coord_type, ndom);
+          one->ok = FALSE;
+        }
+      }
+    }
+  }
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Determine whether a position lies inside a specific cell
+ *
+ * @param [in] int  n   The cell in wmain
+ * @param [in] double  x[]   A position
+ * @return     TRUE if the position is in the cell, FALSE otherwise
+ *
+ * @details
+ * The test uses the boundaries recorded by wind_topology.  A cell which
+ * cannot be tested in this way is treated as not containing the position.
+ *
+ **********************************************************/
+
+int
+topology_in_cell (n, x)
+     int n;
+     double x[];
+{
+  TopologyPtr one;
+  double rho2, r2, rho, z, cost;
+  int coord_type;
+
+  one = &wmain_topology[n];
+  if (!one->ok)
+    return (FALSE);
+
+  rho2 = x[0] * x[0] + x[1] * x[1];
+  coord_type = zdom[wmain[n].ndom].coord_type;
+
+  if (coord_type == SPHERICAL)
+  {
+    r2 = rho2 + x[2] * x[2];
+    return (r2 > one->r2lo && r2 <= one->r2hi);
+  }
+
+  if (coord_type == RTHETA)
+  {
+    r2 = rho2 + x[2] * x[2];
+    if (r2 <= one->r2lo || r2 > one->r2hi)
+      return (FALSE);
+    cost = fabs (x[2]) / sqrt (r2);
+    return (cost >= one->zlo[0] && cost < one->zhi[0]);
+  }
+
+  if (rho2 <= one->r2lo || rho2 > one->r2hi)
+    return (FALSE);
+
+  z = fabs (x[2]);
+  if (z == 0)
+    z = 1.e4;                   /* As in cylind_where_in_grid */
+
+  if (coord_type == CYLIND)
+    return (z > one->zlo[0] && z <= one->zhi[0]);
+
+  rho = sqrt (rho2);
+  return (z > one->zlo[0] + one->zlo[1] * rho && z <= one->zhi[0] + one->zhi[1] * rho && z <= one->zmax);
+}
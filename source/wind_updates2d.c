@@ -91,6 +91,9 @@ WindPtr (w);
   double t_opt, t_UV, t_Xray, v_th, fhat[3];    /*This is the dimensionless optical depth parameter computed for communication to rad-hydro. */
   struct photon ptest;          //We need a test photon structure in order to compute t
   double kappa_es;              //The electron scattering opacity used for t
+  double t_solve;               //The time at which the update of a cell began
+  double nphot_tot, err, err_band[NXBANDS];     //The photons transported in the cycle, and the errors in the estimators of a cell
+  int nsolved;                  //The number of cells whose ionization and temperature were solved for
 
 #ifdef MPI_ON
   int num_mpi_cells, num_mpi_extra, position, ndo, n_mpi, num_comm, n_mpi2;
@@ -108,7 +111,7 @@ WindPtr (w);
    */
 
   size_of_commbuffer =
-    8 * (n_inner_tot + 10 * nions + nlte_levels + 3 * nphot_total + 15 * NXBANDS + 126) * (floor (NPLASMA / np_mpi_global) + 1);
+    8 * (n_inner_tot + 10 * nions + nlte_levels + 3 * nphot_total + 16 * NXBANDS + 132) * (floor (NPLASMA / np_mpi_global) + 1);
   commbuffer = (char *) malloc (size_of_commbuffer * sizeof (char));
 
   /* JM 1409 -- Initialise parallel only variables */
@@ -116,10 +119,16 @@ WindPtr (w);
   dt_e_temp = dt_r_temp = 0.0;
 
 #endif
+
+  /* The level populations cached for the Sobolev optical depths are about to become out of date */
+  tla_cache_reset ();
+
   dt_r = dt_e = 0.0;
   iave = 0;
   nmax_r = nmax_e = -1;
   t_r_ave_old = t_r_ave = t_e_ave_old = t_e_ave = 0.0;
+  nphot_tot = (double) NPHOT *np_mpi_global;
+  err = 0.0;
 
 
   /* For MPI parallelisation, the following loop will be distributed over mutiple tasks.
@@ -156,9 +165,11 @@ WindPtr (w);
   /* we now know how many cells this thread has to process - note this will be
      0-NPLASMA in serial mode */
 
+  PARA_START (PARA_WIND_SOLVE);
+
   for (n = my_nmin; n < my_nmax; n++)
   {
-
+    t_solve = timer ();
 
     nwind = plasmamain[n].nwind;
     volume = w[nwind].vol;
@@ -177,6 +188,15 @@ WindPtr (w);
       macromain[n].kpkt_rates_known = -1;
     }
 
+    /* If converged cells can keep their solutions, find the errors in the estimators before they are normalised */
+
+    if (modes.freeze_cells)
+    {
+      err = phot_budget_error (&plasmamain[n], nphot_tot);
+      for (i = 0; i < geo.nxfreq; i++)
+        err_band[i] = phot_budget_rel_error (plasmamain[n].xj[i], plasmamain[n].xj2[i], nphot_tot);
+    }
+
     /* Store some information so one can determine how much the temps are changing */
     t_r_old = plasmamain[n].t_r;
     t_e_old = plasmamain[n].t_e;
@@ -301,9 +321,24 @@ WindPtr (w);
       plasmamain[n].heat_shock = 0;
 
 
-    /* Calculate the densities in various ways depending on the ioniz_mode */
+    /* Calculate the densities in various ways depending on the ioniz_mode, unless the cell
+       has converged and its estimators have not changed significantly since it was last solved */
+
+    if (modes.freeze_cells && wind_update_frozen (&plasmamain[n], err, err_band))
+    {
+      plasmamain[n].nfrozen++;
+    }
+    else
+    {
+      plasmamain[n].nfrozen = 0;
+      plasmamain[n].j_solved = plasmamain[n].j;
+      plasmamain[n].ave_freq_solved = plasmamain[n].ave_freq;
+      plasmamain[n].heat_solved = plasmamain[n].heat_tot;
+      for (i = 0; i < geo.nxfreq; i++)
+        plasmamain[n].xj_solved[i] = plasmamain[n].xj[i];
 
-    ion_abundances (&plasmamain[n], geo.ioniz_mode);
+      ion_abundances (&plasmamain[n], geo.ioniz_mode);
+    }
 
 
 
@@ -321,12 +356,16 @@ WindPtr (w);
     }
     t_r_ave += plasmamain[n].t_r;
     t_e_ave += plasmamain[n].t_e;
-  }
 
+    plasmamain[n].cost_solve = timer () - t_solve;
+  }
 
+  PARA_STOP (PARA_WIND_SOLVE);
 
   /*This is the end of the update loop that is parallised. We now need to exchange data between the tasks. */
 #ifdef MPI_ON
+  PARA_START (PARA_WIND_COMM);
+
   for (n_mpi = 0; n_mpi < np_mpi_global; n_mpi++)
   {
     position = 0;
@@ -445,6 +484,12 @@ WindPtr (w);
         MPI_Pack (&plasmamain[n].hccheck, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].converge_whole, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].converging, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
+        MPI_Pack (&plasmamain[n].nconverged, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
+        MPI_Pack (&plasmamain[n].nfrozen, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
+        MPI_Pack (&plasmamain[n].j_solved, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
+        MPI_Pack (&plasmamain[n].ave_freq_solved, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
+        MPI_Pack (&plasmamain[n].heat_solved, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
+        MPI_Pack (plasmamain[n].xj_solved, NXBANDS, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (plasmamain[n].spec_mod_type, NXBANDS, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (plasmamain[n].pl_alpha, NXBANDS, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (plasmamain[n].pl_log_w, NXBANDS, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
@@ -458,6 +503,7 @@ WindPtr (w);
         MPI_Pack (&plasmamain[n].xi, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].bf_simple_ionpool_in, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&plasmamain[n].bf_simple_ionpool_out, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
+        MPI_Pack (&plasmamain[n].cost_solve, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&dt_e, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&dt_r, 1, MPI_DOUBLE, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
         MPI_Pack (&nmax_e, 1, MPI_INT, commbuffer, size_of_commbuffer, &position, MPI_COMM_WORLD);
@@ -470,6 +516,7 @@ WindPtr (w);
     MPI_Barrier (MPI_COMM_WORLD);
     MPI_Bcast (commbuffer, size_of_commbuffer, MPI_PACKED, n_mpi, MPI_COMM_WORLD);
     MPI_Barrier (MPI_COMM_WORLD);
+    PARA_BYTES (PARA_WIND_COMM, size_of_commbuffer);
     Log ("MPI task %d survived broadcasting plasma update information.\n", rank_global);
 
     position = 0;
@@ -588,6 +635,12 @@ WindPtr (w);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].hccheck, 1, MPI_INT, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].converge_whole, 1, MPI_INT, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].converging, 1, MPI_INT, MPI_COMM_WORLD);
+        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].nconverged, 1, MPI_INT, MPI_COMM_WORLD);
+        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].nfrozen, 1, MPI_INT, MPI_COMM_WORLD);
+        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].j_solved, 1, MPI_DOUBLE, MPI_COMM_WORLD);
+        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].ave_freq_solved, 1, MPI_DOUBLE, MPI_COMM_WORLD);
+        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].heat_solved, 1, MPI_DOUBLE, MPI_COMM_WORLD);
+        MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].xj_solved, NXBANDS, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].spec_mod_type, NXBANDS, MPI_INT, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].pl_alpha, NXBANDS, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, plasmamain[n].pl_log_w, NXBANDS, MPI_DOUBLE, MPI_COMM_WORLD);
@@ -601,6 +654,7 @@ WindPtr (w);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].xi, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].bf_simple_ionpool_in, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].bf_simple_ionpool_out, 1, MPI_DOUBLE, MPI_COMM_WORLD);
+        MPI_Unpack (commbuffer, size_of_commbuffer, &position, &plasmamain[n].cost_solve, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &dt_e_temp, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &dt_r_temp, 1, MPI_DOUBLE, MPI_COMM_WORLD);
         MPI_Unpack (commbuffer, size_of_commbuffer, &position, &nmax_e_temp, 1, MPI_INT, MPI_COMM_WORLD);
@@ -631,8 +685,22 @@ WindPtr (w);
 
   }
   free (commbuffer);
+
+  PARA_STOP (PARA_WIND_COMM);
 #endif
 
+  if (modes.freeze_cells)
+  {
+    nsolved = 0;
+    for (n = 0; n < NPLASMA; n++)
+    {
+      if (plasmamain[n].nfrozen == 0)
+        nsolved++;
+    }
+    Log ("wind_update: The ionization and temperature of %d of %d cells (%.3f) were solved for, and %d kept their solutions\n",
+         nsolved, NPLASMA, (double) nsolved / NPLASMA, NPLASMA - nsolved);
+  }
+
 
   /* Now we need to updated the densities immediately outside the wind so that the density interpolation in resonate will work.
      In this case all we have done is to copy the densities from the cell which is just in the wind (as one goes outward) to the
@@ -1146,6 +1214,72 @@ WindPtr (w);
 
 
 
+/**********************************************************/
+/**
+ * @brief      decides whether a cell can keep the ionization and temperature
+ * found for it in an earlier cycle
+ *
+ * @param [in] PlasmaPtr  xplasma   The cell
+ * @param [in] double  err   The relative error in j, ip and heat_tot in this cycle
+ * @param [in] double *  err_band   The relative error in xj for each band in this cycle
+ * @return     TRUE if the cell can keep its solution, FALSE if it must be solved for again
+ *
+ * @details
+ * With --freeze_converged, a cell which has passed all of the convergence
+ * checks in the last FREEZE_NCONVERGED cycles is not solved for again if j,
+ * ave_freq, heat_tot and the banded xj have all changed by less than FREEZE_NSIGMA
+ * standard deviations since the cycle in which it was last solved for.  The
+ * estimators in both cycles have about the same error, so the error in the
+ * change is sqrt(2) times err.
+ *
+ * A cell is always solved for once it has kept its solution for FREEZE_RECHECK
+ * cycles, and in the last ionization cycle.
+ *
+ * ### Notes ###
+ *
+ * Cells are always solved for in macro-atom mode, since heat_tot then
+ * includes the macro-atom heating, which is recalculated with the temperature
+ * when the cell is solved for.
+ *
+ **********************************************************/
+
+int
+wind_update_frozen (xplasma, err, err_band)
+     PlasmaPtr xplasma;
+     double err;
+     double *err_band;
+{
+  int i;
+  double dmax;
+
+  if (geo.rt_mode == RT_MODE_MACRO || geo.wcycle >= geo.wcycles - 1)
+    return (FALSE);
+
+  if (xplasma->nconverged < FREEZE_NCONVERGED || xplasma->nfrozen >= FREEZE_RECHECK || xplasma->ntot == 0 || xplasma->j_solved <= 0)
+    return (FALSE);
+
+  dmax = FREEZE_NSIGMA * sqrt (2.) * err;
+
+  if (fabs (xplasma->j - xplasma->j_solved) > dmax * xplasma->j_solved)
+    return (FALSE);
+
+  if (fabs (xplasma->ave_freq - xplasma->ave_freq_solved) > dmax * xplasma->ave_freq_solved)
+    return (FALSE);
+
+  if (fabs (xplasma->heat_tot - xplasma->heat_solved) > dmax * fabs (xplasma->heat_solved))
+    return (FALSE);
+
+  for (i = 0; i < geo.nxfreq; i++)
+  {
+    if (fabs (xplasma->xj[i] - xplasma->xj_solved[i]) > FREEZE_NSIGMA * sqrt (2.) * err_band[i] * xplasma->xj_solved[i])
+      return (FALSE);
+  }
+
+  return (TRUE);
+}
+
+
+
 /**********************************************************/
 /**
  * @brief      zeros those portions of the wind which contain the radiation properties
@@ -1178,6 +1312,7 @@ wind_rad_init ()
     plasmamain[n].j_direct = plasmamain[n].j_scatt = 0.0;       //NSH 1309 zero j banded by number of scatters
     plasmamain[n].ip = 0.0;
     plasmamain[n].xi = 0.0;
+    plasmamain[n].j2 = plasmamain[n].ip2 = plasmamain[n].heat2 = 0.0;   /* the sums used for the errors in the estimators */
 
     plasmamain[n].ip_direct = plasmamain[n].ip_scatt = 0.0;
     plasmamain[n].mean_ds = 0.0;
@@ -1222,6 +1357,7 @@ wind_rad_init ()
     {
       plasmamain[n].xj[i] = plasmamain[n].xave_freq[i] = plasmamain[n].nxtot[i] = 0;
       plasmamain[n].xsd_freq[i] = 0.0;  /* NSH 120815 Zero the standard deviation counter */
+      plasmamain[n].xj2[i] = 0.0;
       plasmamain[n].fmin[i] = geo.xfreq[i + 1]; /* Set the minium frequency to the max frequency in the band */
       plasmamain[n].fmax[i] = geo.xfreq[i];     /* Set the maximum frequency to the min frequency in the band */
     }
@@ -1324,6 +1460,48 @@ wind_rad_init ()
     /* End of added material. */
   }
 
+  wind_cost_init ();
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      zeros the counters of the work done in each cell by the transport
+ * of photons
+ *
+ * @return    Always returns 0
+ *
+ * @details
+ * The counters, cost_steps, cost_lines, cost_matom and cost_extract, record
+ * how many steps photons took through each cell, how many times photons interacted
+ * with lines there, how many macro atoms and k-packets were activated there and
+ * how many steps extracted rays took through it.  Together with cost_solve,
+ * the time wind_update took to find the ionization and temperature of the cell,
+ * they show where the time in a run is spent, and are written to the master table
+ * by windsave2table.
+ *
+ * The routine is called by wind_rad_init at the start of each ionization cycle,
+ * and at the start of each spectral cycle.
+ *
+ * ### Notes ###
+ * cost_solve is not reset, so that after the spectral cycles it still records
+ * the last ionization cycle.
+ *
+ **********************************************************/
+
+int
+wind_cost_init ()
+{
+  int n;
+
+  for (n = 0; n < NPLASMA; n++)
+  {
+    plasmamain[n].cost_steps = plasmamain[n].cost_lines = 0.0;
+    plasmamain[n].cost_matom = plasmamain[n].cost_extract = 0.0;
+  }
 
   return (0);
 }
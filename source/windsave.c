@@ -17,6 +17,12 @@
  * used for restars, and also by routines like py_wind and windsave2talbe
  * which inspect what is happening in the wind.
  *
+ * Windsave files are divided into named fields, using the routines
+ * in windsave_format.c, so that a program can read only the parts
+ * of the model it needs.  Files written before this change are
+ * passed to wind_read_legacy, which can only read them if the
+ * structures have not changed since, and rejects them otherwise.
+ *
  * There are separate ascii_writing 
  * routines for writing the spectra out for plotting.)
  * 
@@ -24,6 +30,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <math.h>
 
@@ -31,21 +38,74 @@
 #include "python.h"
 
 
+/* The variable length arrays which belong to each plasma cell and each macro atom cell */
+
+struct windsave_array plasma_arrays[] = {
+  {"plasma.density", offsetof (plasma_dummy, density), sizeof (double), &nions, 0},
+  {"plasma.partition", offsetof (plasma_dummy, partition), sizeof (double), &nions, 0},
+  {"plasma.ioniz", offsetof (plasma_dummy, ioniz), sizeof (double), &nions, WINDSAVE_ION_ESTIMATORS},
+  {"plasma.recomb", offsetof (plasma_dummy, recomb), sizeof (double), &nions, WINDSAVE_ION_ESTIMATORS},
+  {"plasma.inner_recomb", offsetof (plasma_dummy, inner_recomb), sizeof (double), &nions, WINDSAVE_ION_ESTIMATORS},
+  {"plasma.scatters", offsetof (plasma_dummy, scatters), sizeof (int), &nions, WINDSAVE_ION_ESTIMATORS},
+  {"plasma.xscatters", offsetof (plasma_dummy, xscatters), sizeof (double), &nions, WINDSAVE_ION_ESTIMATORS},
+  {"plasma.heat_ion", offsetof (plasma_dummy, heat_ion), sizeof (double), &nions, WINDSAVE_ION_ESTIMATORS},
+  {"plasma.cool_rr_ion", offsetof (plasma_dummy, cool_rr_ion), sizeof (double), &nions, WINDSAVE_ION_ESTIMATORS},
+  {"plasma.cool_dr_ion", offsetof (plasma_dummy, cool_dr_ion), sizeof (double), &nions, WINDSAVE_ION_ESTIMATORS},
+  {"plasma.lum_rr_ion", offsetof (plasma_dummy, lum_rr_ion), sizeof (double), &nions, WINDSAVE_ION_ESTIMATORS},
+  {"plasma.levden", offsetof (plasma_dummy, levden), sizeof (double), &nlte_levels, WINDSAVE_RATES},
+  {"plasma.recomb_simple", offsetof (plasma_dummy, recomb_simple), sizeof (double), &nphot_total, WINDSAVE_RATES},
+  {"plasma.recomb_simple_upweight", offsetof (plasma_dummy, recomb_simple_upweight), sizeof (double), &nphot_total, WINDSAVE_RATES},
+  {"plasma.kbf_use", offsetof (plasma_dummy, kbf_use), sizeof (double), &nphot_total, WINDSAVE_RATES}
+};
+
+struct windsave_array macro_arrays[] = {
+  {"macro.jbar", offsetof (macro_dummy, jbar), sizeof (double), &size_Jbar_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.jbar_old", offsetof (macro_dummy, jbar_old), sizeof (double), &size_Jbar_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.gamma", offsetof (macro_dummy, gamma), sizeof (double), &size_gamma_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.gamma_old", offsetof (macro_dummy, gamma_old), sizeof (double), &size_gamma_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.gamma_e", offsetof (macro_dummy, gamma_e), sizeof (double), &size_gamma_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.gamma_e_old", offsetof (macro_dummy, gamma_e_old), sizeof (double), &size_gamma_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.alpha_st", offsetof (macro_dummy, alpha_st), sizeof (double), &size_gamma_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.alpha_st_old", offsetof (macro_dummy, alpha_st_old), sizeof (double), &size_gamma_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.alpha_st_e", offsetof (macro_dummy, alpha_st_e), sizeof (double), &size_gamma_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.alpha_st_e_old", offsetof (macro_dummy, alpha_st_e_old), sizeof (double), &size_gamma_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.recomb_sp", offsetof (macro_dummy, recomb_sp), sizeof (double), &size_alpha_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.recomb_sp_e", offsetof (macro_dummy, recomb_sp_e), sizeof (double), &size_alpha_est, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.matom_emiss", offsetof (macro_dummy, matom_emiss), sizeof (double), &nlevels_macro, WINDSAVE_MACRO_ESTIMATORS},
+  {"macro.matom_abs", offsetof (macro_dummy, matom_abs), sizeof (double), &nlevels_macro, WINDSAVE_MACRO_ESTIMATORS}
+};
+
+#define NPLASMA_ARRAYS  (sizeof (plasma_arrays) / sizeof (struct windsave_array))
+#define NMACRO_ARRAYS   (sizeof (macro_arrays) / sizeof (struct windsave_array))
+
+
+
 /**********************************************************/
 /** 
  * @brief      Save all of the strutures associated with the 
  * wind to a file
  *
  * @param [in] char  filename[]   The name of the file to write to
- * @return     The number of successful writes
+ * @return     The number of fields which were written
  *
  * @details
  *
+ * The file is written in the chunked format described in
+ * windsave_format.c.  The geometry, domain, wind, disk and plasma
+ * structures are each written as one field, as are each of the
+ * variable length arrays of the plasma cells, with one row per cell,
+ * and, if there are macro atoms, the macro atom structures and
+ * their arrays.
+ *
  * ### Notes ###
  *
  * For the most part, adding a variable to the structures geo,
  * or plasma, does not require changes to this routine, unless
- * new variable length arrays are involved.
+ * new variable length arrays are involved, in which case they
+ * should be added to plasma_arrays or macro_arrays.
+ *
+ * The chunks are compressed if Python was run with
+ * the --compress_windsave switch.
  *
  **********************************************************/
 
@@ -53,92 +113,298 @@ int
 wind_save (filename)
      char filename[];
 {
-  FILE *fptr, *fopen ();
-  char line[LINELENGTH];
-  int n, m;
+  windsave_file_dummy ws;
+  int n, k;
 
-  if ((fptr = fopen (filename, "w")) == NULL)
+  if (windsave_open_write (&ws, filename, modes.compress_windsave) < 0)
   {
     Error ("wind_save: Unable to open %s\n", filename);
     Exit (0);
   }
 
-  sprintf (line, "Version %s\n", VERSION);
-  n = fwrite (line, sizeof (line), 1, fptr);
-  n += fwrite (&geo, sizeof (geo), 1, fptr);
-  n += fwrite (zdom, sizeof (domain_dummy), geo.ndomain, fptr);
-  n += fwrite (wmain, sizeof (wind_dummy), NDIM2, fptr);
-  n += fwrite (&disk, sizeof (disk), 1, fptr);
-  n += fwrite (&qdisk, sizeof (disk), 1, fptr);
-  n += fwrite (plasmamain, sizeof (plasma_dummy), NPLASMA, fptr);
+  n = windsave_write_array (&ws, "geo", &geo, sizeof (geo), 1);
+  n += windsave_write_array (&ws, "zdom", zdom, sizeof (domain_dummy), geo.ndomain);
+  n += windsave_write_array (&ws, "wmain", wmain, sizeof (wind_dummy), NDIM2);
+  n += windsave_write_array (&ws, "disk", &disk, sizeof (disk), 1);
+  n += windsave_write_array (&ws, "qdisk", &qdisk, sizeof (disk), 1);
+  n += windsave_write_array (&ws, "plasmamain", plasmamain, sizeof (plasma_dummy), NPLASMA);
 
-/* Write out the variable length arrays
-in the plasma structure */
+  for (k = 0; k < (int) NPLASMA_ARRAYS; k++)
+    n += windsave_write_cells (&ws, &plasma_arrays[k], plasmamain, sizeof (plasma_dummy), NPLASMA);
 
-  for (m = 0; m < NPLASMA; m++)
+  /* Now write out the macro atom info */
+
+  if (geo.nmacro)
   {
-    n += fwrite (plasmamain[m].density, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].partition, sizeof (double), nions, fptr);
+    n += windsave_write_array (&ws, "macromain", macromain, sizeof (macro_dummy), NPLASMA);
+    for (k = 0; k < (int) NMACRO_ARRAYS; k++)
+      n += windsave_write_cells (&ws, &macro_arrays[k], macromain, sizeof (macro_dummy), NPLASMA);
+  }
 
-    n += fwrite (plasmamain[m].ioniz, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].recomb, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].inner_recomb, sizeof (double), nions, fptr);
+  if (windsave_close (&ws, TRUE) < 0)
+  {
+    Error ("wind_save: Could not complete %s\n", filename);
+  }
 
+  Log_silent
+    ("wind_write sizes: NPLASMA %d size_Jbar_est %d size_gamma_est %d size_alpha_est %d nlevels_macro %d\n",
+     NPLASMA, size_Jbar_est, size_gamma_est, size_alpha_est, nlevels_macro);
 
-    n += fwrite (plasmamain[m].scatters, sizeof (int), nions, fptr);
-    n += fwrite (plasmamain[m].xscatters, sizeof (double), nions, fptr);
+  return (n);
+
+}
 
-    n += fwrite (plasmamain[m].heat_ion, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].cool_rr_ion, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].cool_dr_ion, sizeof (double), nions, fptr);
-    n += fwrite (plasmamain[m].lum_rr_ion, sizeof (double), nions, fptr);
 
 
-    n += fwrite (plasmamain[m].levden, sizeof (double), nlte_levels, fptr);
-    n += fwrite (plasmamain[m].recomb_simple, sizeof (double), nphot_total, fptr);
-    n += fwrite (plasmamain[m].recomb_simple_upweight, sizeof (double), nphot_total, fptr);
-    n += fwrite (plasmamain[m].kbf_use, sizeof (double), nphot_total, fptr);
+/**********************************************************/
+/** 
+ * @brief      Write one variable length array of every cell to a windsave file
+ *
+ * @param [in, out] WindsaveFilePtr  ws   The file
+ * @param [in] struct windsave_array *  one   The array
+ * @param [in] void *  cells   The plasma or macro atom structures
+ * @param [in] int  cellsize   The size of one of these structures
+ * @param [in] int  ncell   The number of cells
+ * @return     1 if the array was written, 0 otherwise
+ *
+ **********************************************************/
+
+int
+windsave_write_cells (ws, one, cells, cellsize, ncell)
+     WindsaveFilePtr ws;
+     struct windsave_array *one;
+     void *cells;
+     int cellsize, ncell;
+{
+  void **rows;
+  int m, n;
+
+  if ((rows = (void **) calloc (ncell + 1, sizeof (void *))) == NULL)
+  {
+    Error ("windsave_write_cells: Could not allocate memory to write %s\n", one->name);
+    return (0);
   }
 
-/* Now write out the macro atom info */
+  for (m = 0; m < ncell; m++)
+    rows[m] = *(void **) ((char *) cells + (long long) m * cellsize + one->offset);
 
-  if (geo.nmacro)
+  n = windsave_write_field (ws, one->name, *one->nelem * one->elsize, ncell, rows);
+
+  free (rows);
+
+  return (n);
+}
+
+
+
+/**********************************************************/
+/** 
+ * @brief      Read one variable length array of every cell from a windsave file
+ *
+ * @param [in] WindsaveFilePtr  ws   The file
+ * @param [in] struct windsave_array *  one   The array
+ * @param [in, out] void *  cells   The plasma or macro atom structures, for which
+ * the arrays must already have been allocated
+ * @param [in] int  cellsize   The size of one of these structures
+ * @param [in] int  ncell   The number of cells
+ * @return     1 if the array was read, 0 otherwise
+ *
+ **********************************************************/
+
+int
+windsave_read_cells (ws, one, cells, cellsize, ncell)
+     WindsaveFilePtr ws;
+     struct windsave_array *one;
+     void *cells;
+     int cellsize, ncell;
+{
+  void **rows;
+  int m, n;
+
+  if ((rows = (void **) calloc (ncell + 1, sizeof (void *))) == NULL)
   {
-    n += fwrite (macromain, sizeof (macro_dummy), NPLASMA, fptr);
-    for (m = 0; m < NPLASMA; m++)
-    {
-      n += fwrite (macromain[m].jbar, sizeof (double), size_Jbar_est, fptr);
-      n += fwrite (macromain[m].jbar_old, sizeof (double), size_Jbar_est, fptr);
-      n += fwrite (macromain[m].gamma, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].gamma_old, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].gamma_e, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].gamma_e_old, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].alpha_st, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].alpha_st_old, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].alpha_st_e, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].alpha_st_e_old, sizeof (double), size_gamma_est, fptr);
-      n += fwrite (macromain[m].recomb_sp, sizeof (double), size_alpha_est, fptr);
-      n += fwrite (macromain[m].recomb_sp_e, sizeof (double), size_alpha_est, fptr);
-      n += fwrite (macromain[m].matom_emiss, sizeof (double), nlevels_macro, fptr);
-      n += fwrite (macromain[m].matom_abs, sizeof (double), nlevels_macro, fptr);
+    Error ("windsave_read_cells: Could not allocate memory to read %s\n", one->name);
+    return (0);
+  }
 
+  for (m = 0; m < ncell; m++)
+    rows[m] = *(void **) ((char *) cells + (long long) m * cellsize + one->offset);
+
+  n = (windsave_read_rows (ws, one->name, *one->nelem * one->elsize, 0, ncell, rows) == ncell);
+
+  free (rows);
+
+  return (n);
+}
+
+
+
+/**********************************************************/
+/** 
+ * @brief      Read back the windsavefile 
+ *
+ * @param [in] char  filename[]   The full name of the windsave file
+ * @return     The number of successful reads, or -1 if the file cannot 
+ * be opened
+ *
+ * @details
+ * 
+ * The routine reads in both the windsave file and the
+ * associated atomic data files for a model. It also reads the
+ * disk and qdisk structures.
+ *
+ * Everything in the file is read.  See wind_read_parts.
+ *
+ **********************************************************/
+
+int
+wind_read (filename)
+     char filename[];
+{
+  return (wind_read_parts (filename, WINDSAVE_ALL));
+}
+
+
+
+/**********************************************************/
+/** 
+ * @brief      Read back selected parts of the windsavefile 
+ *
+ * @param [in] char  filename[]   The full name of the windsave file
+ * @param [in] int  parts   The optional parts of the file to read, a sum of
+ * the values in windsave_part_enum
+ * @return     The number of fields read, or -1 if the file cannot 
+ * be opened or was written with different structures
+ *
+ * @details
+ * 
+ * The geometry, domain, wind, disk and plasma structures are
+ * always read, as are the ion densities and partition functions,
+ * and, if there are macro atoms, the macro atom structures.
+ * The estimators for each ion, the level populations and the rates
+ * for each cross section, and the estimators for the macro atoms,
+ * are only read if they are included in parts.  Space is allocated
+ * for all of the variable length arrays, so those which are not read
+ * are zero.
+ *
+ * The routine also reads the atomic data file for the model.
+ *
+ * ### Notes ###
+ *
+ * Files which were written before windsave files were divided into
+ * fields are read in their entirety by wind_read_legacy.
+ *
+ * ### Programming Comment ### 
+ * This routine calls wind_complete. This looks superfluous, since 
+ * wind_complete and its subsidiary routines but it
+ * also appears harmless.  ksl 
+ *
+ **********************************************************/
+
+int
+wind_read_parts (filename, parts)
+     char filename[];
+     int parts;
+{
+  windsave_file_dummy ws;
+  int n, m, k, status;
+
+  if ((status = windsave_open_read (&ws, filename)) == -2)
+  {
+    return (wind_read_legacy (filename));
+  }
+  else if (status < 0)
+  {
+    return (-1);
+  }
+
+  Log ("Reading Windfile %s created with python version %s with python version %s\n", filename, ws.header.version, VERSION);
+
+  if (ws.header.struct_hash != windsave_struct_hash ())
+  {
+    Error ("wind_read: %s was written by a version of python with different structures, and cannot be read\n", filename);
+    windsave_close (&ws, FALSE);
+    return (-1);
+  }
+
+  /* Now read in the geo structure */
+
+  n = windsave_read_array (&ws, "geo", &geo, sizeof (geo), 1);
+
+
+  /* Read the atomic data file.  This is necessary to do here in order to establish the 
+   * values for the dimensionality of some of the variable length structures, associated 
+   * with macro atoms, especially but likely to be a good idea ovrall
+   */
+
+  get_atomic_data (geo.atomic_filename);
+
+
+/* Now allocate space for the wind array */
+
+  NDIM2 = geo.ndim2;
+  NPLASMA = geo.nplasma;
+
+  zdom = (DomainPtr) calloc (sizeof (domain_dummy), MaxDom);
+  mem_register (MEM_WIND, "zdom", (double) MaxDom * sizeof (domain_dummy));
+  n += windsave_read_array (&ws, "zdom", zdom, sizeof (domain_dummy), geo.ndomain);
+
+  calloc_wind (NDIM2);
+  n += windsave_read_array (&ws, "wmain", wmain, sizeof (wind_dummy), NDIM2);
+
+  /* Read the disk and qdisk structures */
+
+  n += windsave_read_array (&ws, "disk", &disk, sizeof (disk), 1);
+  n += windsave_read_array (&ws, "qdisk", &qdisk, sizeof (disk), 1);
+
+  calloc_plasma (NPLASMA);
+  n += windsave_read_array (&ws, "plasmamain", plasmamain, sizeof (plasma_dummy), NPLASMA);
+
+  /* Allocate space for the dynamically allocated plasma arrays, and read in those that are wanted */
+
+  calloc_dyn_plasma (NPLASMA);
+
+  for (k = 0; k < (int) NPLASMA_ARRAYS; k++)
+  {
+    if (plasma_arrays[k].part == 0 || (plasma_arrays[k].part & parts))
+      n += windsave_read_cells (&ws, &plasma_arrays[k], plasmamain, sizeof (plasma_dummy), NPLASMA);
+  }
+
+  /*Allocate space for macro-atoms and read in the data */
+
+  if (geo.nmacro > 0)
+  {
+    calloc_macro (NPLASMA);
+    n += windsave_read_array (&ws, "macromain", macromain, sizeof (macro_dummy), NPLASMA);
+    calloc_estimators (NPLASMA);
+
+    for (k = 0; k < (int) NMACRO_ARRAYS; k++)
+    {
+      if (macro_arrays[k].part == 0 || (macro_arrays[k].part & parts))
+        n += windsave_read_cells (&ws, &macro_arrays[k], macromain, sizeof (macro_dummy), NPLASMA);
     }
 
+    /* Force recalculation of kpkt_rates */
+
+    for (m = 0; m < NPLASMA; m++)
+      macromain[m].kpkt_rates_known = 0;
   }
 
-  fclose (fptr);
+  windsave_close (&ws, FALSE);
 
-  Log_silent
-    ("wind_write sizes: NPLASMA %d size_Jbar_est %d size_gamma_est %d size_alpha_est %d nlevels_macro %d\n",
-     NPLASMA, size_Jbar_est, size_gamma_est, size_alpha_est, nlevels_macro);
+  wind_complete (wmain);
+
+  Log ("Read geometry and wind structures from windsavefile %s\n", filename);
 
   return (n);
 
 }
 
+
+
 /*
 
-   wind_read (filename)
+   wind_read_legacy (filename)
 
    History
 	11dec	ksl	Updated so returns -1 if it cannot open the windsave file.  This
@@ -152,7 +418,8 @@ in the plasma structure */
 
 /**********************************************************/
 /** 
- * @brief      Read back the windsavefile 
+ * @brief      Read back a windsavefile written before windsave files were
+ * divided into fields
  *
  * @param [in] char  filename[]   The full name of the windsave file
  * @return     The number of successful reads, or -1 if the file cannot 
@@ -167,35 +434,103 @@ in the plasma structure */
  *
  * ### Notes ###
  *
- * ### Programming Comment ### 
- * This routine calls wind_complete. This looks superfluous, since 
- * wind_complete and its subsidiary routines but it
- * also appears harmless.  ksl 
+ * Such files are raw copies of the structures, so they can only be
+ * read if the structures have not changed since the file was written.
+ * Since geo, wmain, plasmamain and macromain have all grown since windsave
+ * files were divided into fields, this means that files written by earlier
+ * versions of python generally cannot be read.  The length of the file is
+ * therefore checked against the length it would have had if it had been
+ * written with the current structures, first for the structures whose
+ * number is given in geo, before the atomic data are read, and then for
+ * the whole file.  A file which fails either check is rejected, so that a
+ * misaligned file is not read as garbage.
  *
  **********************************************************/
 
 int
-wind_read (filename)
+wind_read_legacy (filename)
      char filename[];
 {
-  FILE *fptr, *fopen ();
+  FILE *fptr, *aptr, *fopen ();
   int n, m;
   char line[LINELENGTH];
   char version[LINELENGTH];
+  double flen, xlen;
+  int nj, ng, na;
 
   if ((fptr = fopen (filename, "r")) == NULL)
   {
     return (-1);
   }
 
+  fseek (fptr, 0, SEEK_END);
+  flen = ftell (fptr);
+  rewind (fptr);
+
   n = fread (line, sizeof (line), 1, fptr);
   sscanf (line, "%*s %s", version);
   Log ("Reading Windfile %s created with python version %s with python version %s\n", filename, version, VERSION);
 
-  /* Now read in the geo structure */
+  /* Now read in the geo structure, and check that the file is long enough to contain the
+   * structures it describes before anything else is done with it */
 
   n += fread (&geo, sizeof (geo), 1, fptr);
 
+  xlen = sizeof (line) + sizeof (geo) + 2. * sizeof (disk) + (double) geo.ndomain * sizeof (domain_dummy) +
+    (double) geo.ndim2 * sizeof (wind_dummy) + (double) geo.nplasma * sizeof (plasma_dummy);
+
+  if (n != 2 || geo.ndomain < 1 || geo.ndomain > MaxDom || geo.ndim2 < 1 || geo.nplasma < 1 || geo.nplasma > geo.ndim2
+      || geo.atomic_filename[0] == '\0' || memchr (geo.atomic_filename, '\0', sizeof (geo.atomic_filename)) == NULL || xlen > flen)
+  {
+    Error ("wind_read: %s (python version %s) was written with structures which differ from those of this version, and cannot be read\n",
+           filename, version);
+    fclose (fptr);
+    return (-1);
+  }
+
+  /* get_atomic_data gives up if the masterfile is missing, which is also what happens if geo is misaligned */
+
+  if ((aptr = fopen (geo.atomic_filename, "r")) == NULL)
+  {
+    Error ("wind_read: %s names the atomic data %s, which cannot be opened.  It may have been written with different structures\n",
+           filename, geo.atomic_filename);
+    fclose (fptr);
+    return (-1);
+  }
+  fclose (aptr);
+
+
+  /* Read the atomic data file.  This is necessary to do here in order to establish the 
+   * values for the dimensionality of some of the variable length structures, associated 
+   * with macro atoms, especially but likely to be a good idea ovrall
+   */
+
+  get_atomic_data (geo.atomic_filename);
+
+  /* Now that the sizes of the variable length arrays are known, check the length of the whole file */
+
+  xlen += (double) geo.nplasma * ((10. * sizeof (double) + sizeof (int)) * nions + sizeof (double) * (nlte_levels + 3. * nphot_total));
+
+  if (geo.nmacro > 0)
+  {
+    nj = ng = na = 0;
+    for (m = 0; m < nlevels_macro; m++)
+    {
+      nj += config[m].n_bbu_jump;
+      ng += config[m].n_bfu_jump;
+      na += config[m].n_bfd_jump;
+    }
+    xlen += (double) geo.nplasma * (sizeof (macro_dummy) + sizeof (double) * (2. * nj + 8. * ng + 2. * na + 2. * nlevels_macro));
+  }
+
+  if (xlen != flen)
+  {
+    Error ("wind_read: %s has %.0f bytes rather than the %.0f expected, so it was written with different structures and cannot be read\n",
+           filename, flen, xlen);
+    fclose (fptr);
+    return (-1);
+  }
+
 
   /* Read the atomic data file.  This is necessary to do here in order to establish the 
    * values for the dimensionality of some of the variable length structures, associated 
@@ -211,6 +546,7 @@ wind_read (filename)
   NPLASMA = geo.nplasma;
 
   zdom = (DomainPtr) calloc (sizeof (domain_dummy), MaxDom);
+  mem_register (MEM_WIND, "zdom", (double) MaxDom * sizeof (domain_dummy));
   n += fread (zdom, sizeof (domain_dummy), geo.ndomain, fptr);
 
   calloc_wind (NDIM2);
@@ -316,6 +652,9 @@ wind_read (filename)
  * just recalculate some of the various arrays used for 
  * finding the boundaries of an individual cell.
  *
+ * Once this is done, wind_topology records the boundaries
+ * and neighbours of each cell for use in locating photons.
+ *
  * ### Notes ###
  *
  * The need to call this routine whenever a windsave file is read
@@ -360,6 +699,9 @@ wind_complete (w)
     }
 
   }
+
+  wind_topology ();
+
   return (0);
 }
 
@@ -455,6 +797,7 @@ spec_read (filename)
     Error ("spectrum_init: Could not allocate memory for %d spectra with %d wavelengths\n", nspectra, NWAVE);
     Exit (0);
   }
+  mem_register (MEM_SPECTRA, "xxspec", (double) nspectra * sizeof (spectrum_dummy));
 
 /* Now read the rest of the file */
 
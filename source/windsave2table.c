@@ -68,6 +68,8 @@
  * @param[in] int argc        The number of arguments in the command line
  * @param[in] char *argv[]    The command line arguments
  * @param[out] char root[]    The rootname of the Python simulation
+ * @param[out] int *ion_switch   What is to be written to the ion tables
+ * @param[out] int *binary   Set to TRUE if binary columnar tables are to be written
  *
  * @return void
  *
@@ -82,6 +84,8 @@
  *  -d   Write out ion densisties, rather than ion fractions in the cell
  *  -s   Write out the number of scatters per unit volume  by an ion in a cell, instead of the 
  *       ion fraction
+ *  -b   Also write each table as a binary file of columns, with a JSON file which
+ *       describes the columns
  *
  * The switches only affect the ion tables not the master table
  * This was originally implemented to enable somebody to query which version of
@@ -92,22 +96,24 @@
  *
  **********************************************************/
 
-char windsave2table_help[] = "Usage: windsave2table [-r or -s] [-h] [--version] rootname \n\
+char windsave2table_help[] = "Usage: windsave2table [-d or -s or -a] [-b] [-h] [--version] rootname \n\
 -d return denisities instead of ion fraction in ion tables \n\
 -s return number of scatters per unit volume of an ion instead if ion fractions \n\
 -all creates a number of tables describing recombination, ionization rates etc. \n\
+-b also write each table as a binary columnar file, with a JSON file describing its columns \n\
 --version return version info and quit \n\
 -h get this help message and quit\n\
 ";
 
 void
-parse_arguments (int argc, char *argv[], char root[], int *ion_switch)
+parse_arguments (int argc, char *argv[], char root[], int *ion_switch, int *binary)
 {
   int i;
   char *fget_rc;
   char input[LINELENGTH];
 
   *ion_switch = 0;
+  *binary = FALSE;
 
 
   if (argc == 1)
@@ -150,6 +156,11 @@ parse_arguments (int argc, char *argv[], char root[], int *ion_switch)
         *ion_switch = 99;
         printf ("Various files detailing inormation about each ion in a cell will be created");
       }
+      else if (!strncmp (argv[i], "-b", 2))
+      {
+        *binary = TRUE;
+        printf ("Binary columnar versions of the tables will also be written");
+      }
       else if (!strncmp (argv[i], "-h", 2))
       {
         printf ("%s", windsave2table_help);
@@ -209,7 +220,7 @@ main (argc, argv)
   char outputfile[LINELENGTH];
   char windsavefile[LINELENGTH];
   char parameter_file[LINELENGTH];
-  int ion_switch;
+  int ion_switch, binary;
 
 
   strcpy (parameter_file, "NONE");
@@ -223,7 +234,7 @@ main (argc, argv)
    * last compiled and on what commit this was
    */
 
-  parse_arguments (argc, argv, root, &ion_switch);
+  parse_arguments (argc, argv, root, &ion_switch, &binary);
 
   printf ("Reading data from file %s\n", root);
 
@@ -236,9 +247,10 @@ main (argc, argv)
   strcat (outputfile, ".txt");
 
 
-/* Read in the wind file */
+/* Read in the wind file.  The estimators for each ion are only needed for the tables
+   which are made with the ion switch, and the rates and macro atom estimators are not needed */
 
-  if (wind_read (windsavefile) < 0)
+  if (wind_read_parts (windsavefile, (ion_switch == 0 || ion_switch == 1) ? 0 : WINDSAVE_ION_ESTIMATORS) < 0)
   {
     Error ("py_wind: Could not open %s", windsavefile);
     exit (0);
@@ -253,7 +265,7 @@ main (argc, argv)
 
 
 
-  do_windsave2table (root, ion_switch);
+  do_windsave2table (root, ion_switch, binary);
 
   return (0);
 }
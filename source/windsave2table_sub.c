@@ -1,4 +1,3 @@
-
 /***********************************************************/
 /** @file  windsave2table_sub.c
  * @author ksl
@@ -13,10 +12,25 @@
  *
  * Unlike py_wind, windsave2table is hardwired and to change what
  * is written one must actually modify the routines themselves.
+ *
+ * ### Notes ###
+ *
+ * The tables are built in three steps.  The create_*_table routines
+ * define the columns of each table, that is where in wmain or
+ * plasmamain each value is to be found and how it is to be printed.
+ * table_gather then makes a single pass through the cells of a domain,
+ * filling the columns of all of the tables at once, and table_write
+ * writes each table from these columns.
+ *
+ * When python is run in parallel and tables are made each cycle, every
+ * process holds the entire wind, and so the tables are divided
+ * between the processes, each of which gathers and writes only its own.
+ *
  ***********************************************************/
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <string.h>
 #include <math.h>
 
@@ -24,36 +38,112 @@
 #include "python.h"
 
 
+/* The simple variables in the plasma structure which can be placed in a table, and where they are
+   to be found.  To make a new variable available, add it here */
+
+struct plasma_variable
+{
+  char *name;
+  size_t offset;
+  int kind;
+} plasma_variables[] = {
+  {"ne", offsetof (plasma_dummy, ne), TABLE_PLASMA_DOUBLE},
+  {"rho", offsetof (plasma_dummy, rho), TABLE_PLASMA_DOUBLE},
+  {"vol", offsetof (plasma_dummy, vol), TABLE_PLASMA_DOUBLE},
+  {"t_e", offsetof (plasma_dummy, t_e), TABLE_PLASMA_DOUBLE},
+  {"t_r", offsetof (plasma_dummy, t_r), TABLE_PLASMA_DOUBLE},
+  {"t_e_old", offsetof (plasma_dummy, t_e_old), TABLE_PLASMA_DOUBLE},
+  {"t_r_old", offsetof (plasma_dummy, t_r_old), TABLE_PLASMA_DOUBLE},
+  {"dt_e", offsetof (plasma_dummy, dt_e), TABLE_PLASMA_DOUBLE},
+  {"dt_e_old", offsetof (plasma_dummy, dt_e_old), TABLE_PLASMA_DOUBLE},
+  {"converge", offsetof (plasma_dummy, converge_whole), TABLE_PLASMA_INT},
+  {"dmo_dt_x", offsetof (plasma_dummy, dmo_dt[0]), TABLE_PLASMA_DOUBLE},
+  {"dmo_dt_y", offsetof (plasma_dummy, dmo_dt[1]), TABLE_PLASMA_DOUBLE},
+  {"dmo_dt_z", offsetof (plasma_dummy, dmo_dt[2]), TABLE_PLASMA_DOUBLE},
+  {"ntot", offsetof (plasma_dummy, ntot), TABLE_PLASMA_INT},
+  {"ip", offsetof (plasma_dummy, ip), TABLE_PLASMA_DOUBLE},
+  {"heat_tot", offsetof (plasma_dummy, heat_tot), TABLE_PLASMA_DOUBLE},
+  {"heat_tot_old", offsetof (plasma_dummy, heat_tot_old), TABLE_PLASMA_DOUBLE},
+  {"heat_comp", offsetof (plasma_dummy, heat_comp), TABLE_PLASMA_DOUBLE},
+  {"heat_lines", offsetof (plasma_dummy, heat_lines), TABLE_PLASMA_DOUBLE},
+  {"heat_ff", offsetof (plasma_dummy, heat_ff), TABLE_PLASMA_DOUBLE},
+  {"heat_photo", offsetof (plasma_dummy, heat_photo), TABLE_PLASMA_DOUBLE},
+  {"heat_auger", offsetof (plasma_dummy, heat_auger), TABLE_PLASMA_DOUBLE},
+  {"cool_comp", offsetof (plasma_dummy, cool_comp), TABLE_PLASMA_DOUBLE},
+  {"lum_lines", offsetof (plasma_dummy, lum_lines), TABLE_PLASMA_DOUBLE},
+  {"lum_ff", offsetof (plasma_dummy, lum_ff), TABLE_PLASMA_DOUBLE},
+  {"cool_rr", offsetof (plasma_dummy, cool_rr), TABLE_PLASMA_DOUBLE},
+  {"cool_dr", offsetof (plasma_dummy, cool_dr), TABLE_PLASMA_DOUBLE},
+  {"cool_tot", offsetof (plasma_dummy, cool_tot), TABLE_PLASMA_DOUBLE},
+  {"w", offsetof (plasma_dummy, w), TABLE_PLASMA_DOUBLE},
+  {"nrad", offsetof (plasma_dummy, nrad), TABLE_PLASMA_INT},
+  {"nioniz", offsetof (plasma_dummy, nioniz), TABLE_PLASMA_INT},
+  {"heat_shock", offsetof (plasma_dummy, heat_shock), TABLE_PLASMA_DOUBLE},
+  {"cool_adiab", offsetof (plasma_dummy, cool_adiabatic), TABLE_PLASMA_DOUBLE},
+  {"heat_lines_macro", offsetof (plasma_dummy, heat_lines_macro), TABLE_PLASMA_DOUBLE},
+  {"heat_photo_macro", offsetof (plasma_dummy, heat_photo_macro), TABLE_PLASMA_DOUBLE},
+  {"gain", offsetof (plasma_dummy, gain), TABLE_PLASMA_DOUBLE},
+  {"macro_bf_in", offsetof (plasma_dummy, bf_simple_ionpool_in), TABLE_PLASMA_DOUBLE},
+  {"macro_bf_out", offsetof (plasma_dummy, bf_simple_ionpool_out), TABLE_PLASMA_DOUBLE},
+  {"cost_steps", offsetof (plasma_dummy, cost_steps), TABLE_PLASMA_DOUBLE},
+  {"cost_lines", offsetof (plasma_dummy, cost_lines), TABLE_PLASMA_DOUBLE},
+  {"cost_matom", offsetof (plasma_dummy, cost_matom), TABLE_PLASMA_DOUBLE},
+  {"cost_extract", offsetof (plasma_dummy, cost_extract), TABLE_PLASMA_DOUBLE},
+  {"cost_solve", offsetof (plasma_dummy, cost_solve), TABLE_PLASMA_DOUBLE},
+};
+
+#define NPLASMA_VARIABLES (sizeof (plasma_variables) / sizeof (struct plasma_variable))
+
+/* The names of the quantities which can be tabulated for each ion, indexed by the ion switch,
+   which are used in the names of the ion tables */
+
+char *ion_switch_names[] = { "frac", "den", "scat", "ion_frac", "ioniz", "recomb", "heat", "cool_rr", "lum_rr", "cool_dr" };
+
+#define NION_SWITCHES (sizeof (ion_switch_names) / sizeof (char *))
+
+
+
 /**********************************************************/
 /**
  * @brief      The main routine associated with windsave2table, this routine calls
  * various other routines which write individual files
  *
  * @param [in] char *  root   The rootname of the windsave file
+ * @param [in] int  ion_switch   What is to be written to the ion tables
+ * @param [in] int  binary   If TRUE, binary columnar files are written in addition
+ * to the ascii files
  * @return     Always returns 0
  *
  * @details
  *
- *
+ * For each domain the routine defines the columns of all of the tables
+ * that are to be written, gathers them in a single pass through the
+ * cells of the domain and then writes the tables.
  *
  * ### Notes ###
  *
- * The routine cycles through the various domains and calles subroutines
- * that write the individual files for each domain.
- *
- *
+ * When python is run in parallel, all of the processes call this routine,
+ * and each one writes a share of the tables.
  *
  **********************************************************/
 
 int
-do_windsave2table (root, ion_switch)
+do_windsave2table (root, ion_switch, binary)
      char *root;
      int ion_switch;
+     int binary;
 {
-  int ndom, i;
+  int ndom, i, ntables;
   char rootname[LINELENGTH];
   int all[7] = { 0, 4, 5, 6, 7, 8, 9 };
+  int elements[8] = { 1, 2, 6, 7, 8, 11, 14, 26 };
+  ExportTablePtr tables;
 
+  if ((tables = (ExportTablePtr) calloc (sizeof (export_table_dummy), NEXPORT_TABLES)) == NULL)
+  {
+    Error ("do_windsave2table: Could not allocate memory for %d tables\n", NEXPORT_TABLES);
+    return (0);
+  }
 
   for (ndom = 0; ndom < geo.ndomain; ndom++)
   {
@@ -67,876 +157,801 @@ do_windsave2table (root, ion_switch)
       sprintf (rootname, "%s", root);
     }
 
-    create_master_table (ndom, rootname);
-    create_heat_table (ndom, rootname);
-    create_convergence_table (ndom, rootname);
+    ntables = 0;
+    create_master_table (ndom, rootname, &tables[ntables++]);
+    create_heat_table (ndom, rootname, &tables[ntables++]);
+    create_convergence_table (ndom, rootname, &tables[ntables++]);
 
     if (ion_switch != 99)
     {
-      create_ion_table (ndom, rootname, 1, ion_switch);
-      create_ion_table (ndom, rootname, 2, ion_switch);
-      create_ion_table (ndom, rootname, 6, ion_switch);
-      create_ion_table (ndom, rootname, 7, ion_switch);
-      create_ion_table (ndom, rootname, 8, ion_switch);
-      create_ion_table (ndom, rootname, 11, ion_switch);
-      create_ion_table (ndom, rootname, 14, ion_switch);
-      create_ion_table (ndom, rootname, 26, ion_switch);
+      for (i = 0; i < 8; i++)
+        ntables += create_ion_table (ndom, rootname, elements[i], ion_switch, &tables[ntables]);
     }
     else
     {
       for (i = 0; i < 7; i++)
       {
-        create_ion_table (ndom, rootname, 1, all[i]);
-        create_ion_table (ndom, rootname, 2, all[i]);
-        create_ion_table (ndom, rootname, 6, all[i]);
+        ntables += create_ion_table (ndom, rootname, 1, all[i], &tables[ntables]);
+        ntables += create_ion_table (ndom, rootname, 2, all[i], &tables[ntables]);
+        ntables += create_ion_table (ndom, rootname, 6, all[i], &tables[ntables]);
       }
-
     }
 
+    table_gather (ndom, ntables, tables);
+    table_write (ndom, ntables, tables, binary);
 
+    for (i = 0; i < ntables; i++)
+      table_free (&tables[i]);
   }
+
+  free (tables);
   return (0);
 }
 
 
 
-
-
-
 /**********************************************************/
 /**
- * @brief      writes specific  variables of a windsaave
- * which are intended to be of general interest to
- * file which has the format of an astropy table
- *
- * 	It is intended to be easily modifible.
+ * @brief      Add a column to a table
  *
- * @param [in] int  ndom   A domain number
- * @param [in] char  rootname   The rootname of the master file
- * @return   Always returns 0
+ * @param [in, out] ExportTablePtr  table   The table
+ * @param [in] char *  name   The name of the column
+ * @param [in] char *  head   The format of the heading of the column
+ * @param [in] char *  fmt   The format of each value of the column
+ * @param [in] int  kind   What the column contains
+ * @param [in] size_t  offset   The offset of the value in the wind or plasma structure
+ * @return     A pointer to the new column, or NULL if the table is full
  *
  * @details
- *
- * The master table is contains basic information for each
- * cell in the wind, such as the electron density, the density,
- * the ionization parameter, and the radiative and electron temperature
- *
- * The routine takes data directly from wmain, and then calls
- * get_one or get_ion multiple times to fet info from the Plasma
- * structure.
- *
- * It then writes the data to an ascii file which can be read as
- * an  astropy table
- *
- * ### Notes ###
- * To add a variable one just needs to define the column_name
- * and send the appropriate call to either get_one or get_ion.
- *
- * There is some duplicated code in the routine that pertains
- * to whether one is dealing with a spherecial or a 2d coordinate
- * system.  It should be possible to delete this
+ * The formats are those used in the ascii version of the table,
+ * and include the space which separates one column from the next.
+ * The format of a value should be an integer format only if the column
+ * is one of the integer kinds.
  *
  **********************************************************/
 
-int
-create_master_table (ndom, rootname)
-     int ndom;
-     char rootname[];
+TableColumnPtr
+table_add_column (table, name, head, fmt, kind, offset)
+     ExportTablePtr table;
+     char *name, *head, *fmt;
+     int kind;
+     size_t offset;
 {
-  char filename[132];
-  double *c[50], *converge;
-  char column_name[50][20];
-  char one_line[1024], start[132], one_value[20];
-  char name[132];               /* file name extension */
-
-
-  int i, ii, jj;
-  int nstart, ndim2;
-  int n, ncols;
-  FILE *fptr;
-
-  strcpy (filename, rootname);
-  strcat (filename, ".master.txt");
-
-
-  fptr = fopen (filename, "w");
+  TableColumnPtr col;
 
-  /* Get the variables that one needs */
-
-  c[0] = get_one (ndom, "vol");
-  strcpy (column_name[0], "vol");
-
-  c[1] = get_one (ndom, "rho");
-  strcpy (column_name[1], "rho");
+  if (table->ncols == NTABLE_COLUMNS)
+  {
+    Error ("table_add_column: Too many columns in %s to add %s\n", table->filename, name);
+    return (NULL);
+  }
 
-  c[2] = get_one (ndom, "ne");
-  strcpy (column_name[2], "ne");
+  col = &table->col[table->ncols++];
+  strcpy (col->name, name);
+  strcpy (col->head, head);
+  strcpy (col->fmt, fmt);
+  col->kind = kind;
+  col->offset = offset;
+  col->nion = col->nelem = col->iswitch = -1;
+  col->x = NULL;
 
-  c[3] = get_one (ndom, "t_e");
-  strcpy (column_name[3], "t_e");
+  return (col);
+}
 
-  c[4] = get_one (ndom, "t_r");
-  strcpy (column_name[4], "t_r");
 
-  c[5] = get_ion (ndom, 1, 1, 0, name);
-  strcpy (column_name[5], "h1");
 
-  c[6] = get_ion (ndom, 2, 2, 0, name);
-  strcpy (column_name[6], "he2");
+/**********************************************************/
+/**
+ * @brief      Add a column containing a simple variable from the plasma structure to a table
+ *
+ * @param [in, out] ExportTablePtr  table   The table
+ * @param [in] char *  name   The name of the variable, which must be one of plasma_variables
+ * @return     A pointer to the new column, or NULL if there is no such variable
+ *
+ * @details
+ * The column is written in the format used for all of the plasma variables in the
+ * master, heat and convergence tables.
+ *
+ **********************************************************/
 
-  c[7] = get_ion (ndom, 6, 4, 0, name);
-  strcpy (column_name[7], "c4");
+TableColumnPtr
+table_add_plasma (table, name)
+     ExportTablePtr table;
+     char *name;
+{
+  int n;
 
-  c[8] = get_ion (ndom, 7, 5, 0, name);
-  strcpy (column_name[8], "n5");
+  for (n = 0; n < (int) NPLASMA_VARIABLES; n++)
+  {
+    if (strcmp (name, plasma_variables[n].name) == 0)
+      return (table_add_column (table, name, "%9s ", "%9.2e ", plasma_variables[n].kind, plasma_variables[n].offset));
+  }
 
-  c[9] = get_ion (ndom, 8, 6, 0, name);
-  strcpy (column_name[9], "o6");
+  Error ("table_add_plasma: Unknown variable %s\n", name);
+  return (NULL);
+}
 
-  c[10] = get_one (ndom, "dmo_dt_x");
-  strcpy (column_name[10], "dmo_dt_x");
 
 
-  c[11] = get_one (ndom, "dmo_dt_y");
-  strcpy (column_name[11], "dmo_dt_y");
+/**********************************************************/
+/**
+ * @brief      Add a column containing a quantity for one ion to a table
+ *
+ * @param [in, out] ExportTablePtr  table   The table
+ * @param [in] char *  name   The name of the column
+ * @param [in] char *  head   The format of the heading of the column
+ * @param [in] char *  fmt   The format of each value of the column
+ * @param [in] int  element   The atomic number of the element
+ * @param [in] int  istate   The ionization state
+ * @param [in] int  iswitch   What is to be tabulated for the ion
+ * @return     A pointer to the new column, or NULL if the ion does not exist
+ *
+ * @details
+ *
+ * iswitch selects the quantity, as follows
+ *
+ * * 0 the fraction of the element in this ionization state
+ * * 1 the density of the ion
+ * * 2 the number of scatters per unit volume
+ * * 3 xscatters
+ * * 4 the ionization rate
+ * * 5 the recombination rate
+ * * 6 the heating due to the ion
+ * * 7 the cooling due to radiative recombination
+ * * 8 the luminosity due to radiative recombination
+ * * 9 the cooling due to dielectronic recombination
+ *
+ * ### Notes ###
+ *
+ * If the ion does not exist, as can happen with a restricted set of
+ * atomic data, the column is still added, and is filled with zeros.
+ *
+ **********************************************************/
 
-  c[12] = get_one (ndom, "dmo_dt_z");
-  strcpy (column_name[12], "dmo_dt_z");
+TableColumnPtr
+table_add_ion (table, name, head, fmt, element, istate, iswitch)
+     ExportTablePtr table;
+     char *name, *head, *fmt;
+     int element, istate, iswitch;
+{
+  TableColumnPtr col;
+  int nion, nelem;
 
-  c[13] = get_one (ndom, "ip");
-  strcpy (column_name[13], "ip");
+  if (iswitch < 0 || iswitch >= (int) NION_SWITCHES)
+  {
+    Error ("table_add_ion : Unknown switch %d \n", iswitch);
+    exit (0);
+  }
 
-  c[14] = get_one (ndom, "ntot");
-  strcpy (column_name[14], "ntot");
+  if ((col = table_add_column (table, name, head, fmt, TABLE_ION, 0)) == NULL)
+    return (NULL);
 
-  c[15] = get_one (ndom, "nrad");
-  strcpy (column_name[15], "nrad");
+  nion = 0;
+  while (nion < nions && !(ion[nion].z == element && ion[nion].istate == istate))
+    nion++;
 
-  c[16] = get_one (ndom, "nioniz");
-  strcpy (column_name[16], "nioniz");
+  if (nion == nions)
+  {
+    Log ("Error--element %d ion %d not found in define_wind\n", element, istate);
+    nion = -1;
+  }
 
+  nelem = 0;
+  while (nelem < nelements && ele[nelem].z != element)
+    nelem++;
 
-  /* This should be the maxium number above +1 */
-  ncols = 17;
+  col->nion = nion;
+  col->nelem = nelem;
+  col->iswitch = iswitch;
 
+  return (col);
+}
 
-  converge = get_one (ndom, "converge");
 
-  /* At this point oll of the data has been collected */
 
+/**********************************************************/
+/**
+ * @brief      Add the columns which describe the position, status and velocity of each
+ * cell to one of the master, heat or convergence tables
+ *
+ * @param [in] int  ndom   The domain
+ * @param [in, out] ExportTablePtr  table   The table
+ * @param [in] int  master   TRUE for the master table, which contains more information
+ * about the position of each cell than the others
+ * @return     0 on success, -1 if the coordinate system is not supported
+ *
+ * @details
+ *
+ * The columns and their formats are those which have always been used
+ * in these tables.
+ *
+ **********************************************************/
 
-  nstart = zdom[ndom].nstart;
-  ndim2 = zdom[ndom].ndim2;
+int
+table_add_position (ndom, table, master)
+     int ndom;
+     ExportTablePtr table;
+     int master;
+{
+  int coord_type;
 
+  coord_type = zdom[ndom].coord_type;
 
-  if (zdom[ndom].coord_type == SPHERICAL)
+  if (coord_type == SPHERICAL)
   {
-
-
-    /*
-     * First assemble the header line
-     */
-
-    sprintf (start, "%9s %9s %4s %6s %6s %9s %9s %9s ", "r", "rcen", "i", "inwind", "converge", "v_x", "v_y", "v_z");
-    strcpy (one_line, start);
-    n = 0;
-    while (n < ncols)
-    {
-      sprintf (one_value, "%9s ", column_name[n]);
-      strcat (one_line, one_value);
-
-      n++;
-    }
-    fprintf (fptr, "%s\n", one_line);
-
-
-    /* Now assemble the lines of the table */
-
-    for (i = 0; i < ndim2; i++)
-    {
-      //This line is different from the two d case
-      sprintf (start, "%9.3e %9.3e %4d %6d %8.0f %9.2e %9.2e %9.2e ",
-               wmain[nstart + i].r, wmain[nstart + i].rcen, i, wmain[nstart + i].inwind,
-               converge[i], wmain[nstart + i].v[0], wmain[nstart + i].v[1], wmain[nstart + i].v[2]);
-      strcpy (one_line, start);
-      n = 0;
-      while (n < ncols)
-      {
-        sprintf (one_value, "%9.2e ", c[n][i]);
-        strcat (one_line, one_value);
-        n++;
-      }
-      fprintf (fptr, "%s\n", one_line);
-    }
+    table_add_column (table, "r", "%9s ", "%9.3e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, r));
+    if (master)
+      table_add_column (table, "rcen", "%9s ", "%9.3e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, rcen));
+    table_add_column (table, "i", "%4s ", "%4d ", TABLE_CELL_I, 0);
+    table_add_column (table, "inwind", "%6s ", "%6d ", TABLE_WIND_INT, offsetof (wind_dummy, inwind));
+    table_add_column (table, "converge", "%6s ", "%8.0f ", TABLE_PLASMA_INT, offsetof (plasma_dummy, converge_whole));
   }
-  else if (zdom[ndom].coord_type == CYLIND)
+  else if (master && coord_type != CYLIND && coord_type != RTHETA)
   {
-
-    /* First assemble the header line */
-
-    sprintf (start, "%8s %8s %8s %8s %4s %4s %6s %8s %9s %9s %9s ", "x", "z", "xcen", "zcen", "i", "j", "inwind", "converge", "v_x", "v_y",
-             "v_z");
-    strcpy (one_line, start);
-    n = 0;
-    while (n < ncols)
-    {
-      sprintf (one_value, "%9s ", column_name[n]);
-      strcat (one_line, one_value);
-
-      n++;
-    }
-    fprintf (fptr, "%s\n", one_line);
-
-
-    /* Now assemble the lines of the table */
-
-    for (i = 0; i < ndim2; i++)
-    {
-      wind_n_to_ij (ndom, nstart + i, &ii, &jj);
-      sprintf (start,
-               "%8.2e %8.2e %8.2e %8.2e %4d %4d %6d %8.0f %9.2e %9.2e %9.2e ",
-               wmain[nstart + i].x[0], wmain[nstart + i].x[2], wmain[nstart + i].xcen[0], wmain[nstart + i].xcen[2], ii,
-               jj, wmain[nstart + i].inwind, converge[i], wmain[nstart + i].v[0], wmain[nstart + i].v[1], wmain[nstart + i].v[2]);
-      strcpy (one_line, start);
-      n = 0;
-      while (n < ncols)
-      {
-        sprintf (one_value, "%9.2e ", c[n][i]);
-        strcat (one_line, one_value);
-        n++;
-      }
-      fprintf (fptr, "%s\n", one_line);
-    }
+    printf ("Error: Cannot print out files for coordinate system type %d\n", coord_type);
+    return (-1);
   }
-  else if (zdom[ndom].coord_type == RTHETA)
+  else
   {
-
-    /* First assemble the header line */
-
-    sprintf (start, "%8s %8s %8s %9s %8s %8s %8s %8s %4s %4s %6s %8s %9s %9s %9s ", "r", "theta", "r_cen", "theta_cen", "x", "z", "xcen",
-             "zcen", "i", "j", "inwind", "converge", "v_x", "v_y", "v_z");
-    strcpy (one_line, start);
-    n = 0;
-    while (n < ncols)
+    if (master && coord_type == RTHETA)
     {
-      sprintf (one_value, "%9s ", column_name[n]);
-      strcat (one_line, one_value);
-
-      n++;
+      table_add_column (table, "r", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, r));
+      table_add_column (table, "theta", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, theta));
+      table_add_column (table, "r_cen", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, rcen));
+      table_add_column (table, "theta_cen", "%9s ", "%9.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, thetacen));
     }
-    fprintf (fptr, "%s\n", one_line);
-
-
-    /* Now assemble the lines of the table */
-
-    for (i = 0; i < ndim2; i++)
+    if (master)
     {
-      wind_n_to_ij (ndom, nstart + i, &ii, &jj);
-      sprintf (start,
-               "%8.2e %8.2e %8.2e %9.2e %8.2e %8.2e %8.2e %8.2e %4d %4d %6d %8.0f %9.2e %9.2e %9.2e ",
-               wmain[nstart + i].r, wmain[nstart + i].theta, wmain[nstart + i].rcen, wmain[nstart + i].thetacen,
-               wmain[nstart + i].x[0], wmain[nstart + i].x[2], wmain[nstart + i].xcen[0], wmain[nstart + i].xcen[2], ii,
-               jj, wmain[nstart + i].inwind, converge[i], wmain[nstart + i].v[0], wmain[nstart + i].v[1], wmain[nstart + i].v[2]);
-      strcpy (one_line, start);
-      n = 0;
-      while (n < ncols)
-      {
-        sprintf (one_value, "%9.2e ", c[n][i]);
-        strcat (one_line, one_value);
-        n++;
-      }
-      fprintf (fptr, "%s\n", one_line);
+      table_add_column (table, "x", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, x[0]));
+      table_add_column (table, "z", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, x[2]));
+      table_add_column (table, "xcen", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, xcen[0]));
+      table_add_column (table, "zcen", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, xcen[2]));
     }
+    else
+    {
+      table_add_column (table, "x", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, xcen[0]));
+      table_add_column (table, "z", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, xcen[2]));
+    }
+    table_add_column (table, "i", "%4s ", "%4d ", TABLE_CELL_I, 0);
+    table_add_column (table, "j", "%4s ", "%4d ", TABLE_CELL_J, 0);
+    table_add_column (table, "inwind", "%6s ", "%6d ", TABLE_WIND_INT, offsetof (wind_dummy, inwind));
+    table_add_column (table, "converge", "%8s ", "%8.0f ", TABLE_PLASMA_INT, offsetof (plasma_dummy, converge_whole));
   }
-  else
-  {
-    printf ("Error: Cannot print out files for coordinate system type %d\n", zdom[ndom].coord_type);
-  }
-
 
-  fclose (fptr);
+  table_add_column (table, "v_x", "%9s ", "%9.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, v[0]));
+  table_add_column (table, "v_y", "%9s ", "%9.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, v[1]));
+  table_add_column (table, "v_z", "%9s ", "%9.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, v[2]));
 
   return (0);
 }
 
 
 
-
 /**********************************************************/
 /**
- * @brief      writes a selected variables related to heating and cooling
- * processes to an ascii file which can be read as an astropy table
+ * @brief      defines the master table, which contains specific variables
+ * of a windsave file that are intended to be of general interest,
+ * in the format of an astropy table
  *
+ * 	It is intended to be easily modifible.
  *
- * @param [in] int  ndom   The domain of interest
- * @param [in, out] char  rootname[]   The rootname of the windsave file
- * @return     Always returns 0
+ * @param [in] int  ndom   A domain number
+ * @param [in] char  rootname   The rootname of the master file
+ * @param [out] ExportTablePtr  table   The table to be defined
+ * @return   Always returns 0
  *
  * @details
  *
- * ### Notes ###
+ * The master table is contains basic information for each
+ * cell in the wind, such as the electron density, the density,
+ * the ionization parameter, and the radiative and electron temperature
  *
- * To add a variable one just needs to define the column_name
- * and send the appropriate call to either get_one or get_ion.
+ * ### Notes ###
+ * To add a variable one just needs to add a call to table_add_plasma
+ * or table_add_ion.
  *
+ * Only spherical, cylindrical and rtheta coordinate systems are
+ * supported.  For other coordinate systems an empty file is written.
  *
  **********************************************************/
 
 int
-create_heat_table (ndom, rootname)
+create_master_table (ndom, rootname, table)
      int ndom;
      char rootname[];
+     ExportTablePtr table;
 {
-  char filename[132];
-  double *c[50], *converge;
-  char column_name[50][20];
-  char one_line[1024], start[132], one_value[20];
-
-
-  int i, ii, jj;
-  int nstart, ndim2;
-  int n, ncols;
-  FILE *fptr;
-
-  strcpy (filename, rootname);
-  strcat (filename, ".heat.txt");
-
-
-  fptr = fopen (filename, "w");
-
-  /* Get the variables that one needs */
-
-  c[0] = get_one (ndom, "vol");
-  strcpy (column_name[0], "vol");
-
-  c[1] = get_one (ndom, "rho");
-  strcpy (column_name[1], "rho");
-
-  c[2] = get_one (ndom, "ne");
-  strcpy (column_name[2], "ne");
-
-  c[3] = get_one (ndom, "t_e");
-  strcpy (column_name[3], "t_e");
-
-  c[4] = get_one (ndom, "t_r");
-  strcpy (column_name[4], "t_r");
-
-  c[5] = get_one (ndom, "w");
-  strcpy (column_name[5], "w");
-
-  c[6] = get_one (ndom, "heat_tot");
-  strcpy (column_name[6], "heat_tot");
-
-  c[7] = get_one (ndom, "heat_comp");
-  strcpy (column_name[7], "heat_comp");
-
-  c[8] = get_one (ndom, "heat_lines");
-  strcpy (column_name[8], "heat_lines");
-
-  c[9] = get_one (ndom, "heat_ff");
-  strcpy (column_name[9], "heat_ff");
-
-  c[10] = get_one (ndom, "heat_photo");
-  strcpy (column_name[10], "heat_photo");
-
-  c[11] = get_one (ndom, "heat_auger");
-  strcpy (column_name[11], "heat_auger");
-
-  c[12] = get_one (ndom, "cool_tot");
-  strcpy (column_name[12], "cool_tot");
-
-  c[13] = get_one (ndom, "cool_comp");
-  strcpy (column_name[13], "cool_comp");
-
-  c[14] = get_one (ndom, "lum_lines");
-  strcpy (column_name[14], "lum_lines");
-
-  c[15] = get_one (ndom, "cool_dr");
-  strcpy (column_name[15], "cool_dr");
-
-  c[16] = get_one (ndom, "lum_ff");
-  strcpy (column_name[16], "lum_ff");
-
-
-  c[17] = get_one (ndom, "cool_rr");
-  strcpy (column_name[17], "cool_rr");
-
-  c[18] = get_one (ndom, "cool_adiab");
-  strcpy (column_name[18], "cool_adiab");
-
-  c[19] = get_one (ndom, "heat_shock");
-  strcpy (column_name[19], "heat_shock");
-
-  c[20] = get_one (ndom, "heat_lines_macro");
-  strcpy (column_name[20], "heat_lines_macro");
+  sprintf (table->filename, "%s.master", rootname);
+  table->ncols = 0;
 
-  c[21] = get_one (ndom, "heat_photo_macro");
-  strcpy (column_name[21], "heat_photo_macro");
-
-  /* This should be the maxium number above +1 */
-  ncols = 22;
-
-
-  converge = get_one (ndom, "converge");
-
-  /* At this point all of the data has been collected */
-
-
-  nstart = zdom[ndom].nstart;
-  ndim2 = zdom[ndom].ndim2;
-
-
-  if (zdom[ndom].coord_type == SPHERICAL)
+  if (table_add_position (ndom, table, TRUE))
   {
-
-
-    /*
-     * First assemble the header line
-     */
-
-    sprintf (start, "%9s %4s %6s %6s %9s %9s %9s ", "r", "i", "inwind", "converge", "v_x", "v_y", "v_z");
-    strcpy (one_line, start);
-    n = 0;
-    while (n < ncols)
-    {
-      sprintf (one_value, "%9s ", column_name[n]);
-      strcat (one_line, one_value);
-
-      n++;
-    }
-    fprintf (fptr, "%s\n", one_line);
-
-
-    /* Now assemble the lines of the table */
-
-    for (i = 0; i < ndim2; i++)
-    {
-      //This line is different from the two d case
-      sprintf (start, "%9.3e %4d %6d %8.0f %9.2e %9.2e %9.2e ",
-               wmain[nstart + i].r, i, wmain[nstart + i].inwind,
-               converge[i], wmain[nstart + i].v[0], wmain[nstart + i].v[1], wmain[nstart + i].v[2]);
-      strcpy (one_line, start);
-      n = 0;
-      while (n < ncols)
-      {
-        sprintf (one_value, "%9.2e ", c[n][i]);
-        strcat (one_line, one_value);
-        n++;
-      }
-      fprintf (fptr, "%s\n", one_line);
-    }
+    table->ncols = 0;
+    return (0);
   }
-  else
-  {
 
-    /* First assemble the header line */
+  table_add_plasma (table, "vol");
+  table_add_plasma (table, "rho");
+  table_add_plasma (table, "ne");
+  table_add_plasma (table, "t_e");
+  table_add_plasma (table, "t_r");
+  table_add_ion (table, "h1", "%9s ", "%9.2e ", 1, 1, 0);
+  table_add_ion (table, "he2", "%9s ", "%9.2e ", 2, 2, 0);
+  table_add_ion (table, "c4", "%9s ", "%9.2e ", 6, 4, 0);
+  table_add_ion (table, "n5", "%9s ", "%9.2e ", 7, 5, 0);
+  table_add_ion (table, "o6", "%9s ", "%9.2e ", 8, 6, 0);
+  table_add_plasma (table, "dmo_dt_x");
+  table_add_plasma (table, "dmo_dt_y");
+  table_add_plasma (table, "dmo_dt_z");
+  table_add_plasma (table, "ip");
+  table_add_plasma (table, "ntot");
+  table_add_plasma (table, "nrad");
+  table_add_plasma (table, "nioniz");
+  table_add_plasma (table, "cost_steps");
+  table_add_plasma (table, "cost_lines");
+  table_add_plasma (table, "cost_matom");
+  table_add_plasma (table, "cost_extract");
+  table_add_plasma (table, "cost_solve");
 
-    sprintf (start, "%8s %8s %4s %4s %6s %8s %9s %9s %9s ", "x", "z", "i", "j", "inwind", "converge", "v_x", "v_y", "v_z");
-    strcpy (one_line, start);
-    n = 0;
-    while (n < ncols)
-    {
-      sprintf (one_value, "%9s ", column_name[n]);
-      strcat (one_line, one_value);
-
-      n++;
-    }
-    fprintf (fptr, "%s\n", one_line);
+  return (0);
+}
 
 
-    /* Now assemble the lines of the table */
 
-    for (i = 0; i < ndim2; i++)
-    {
-      wind_n_to_ij (ndom, nstart + i, &ii, &jj);
-      sprintf (start,
-               "%8.2e %8.2e %4d %4d %6d %8.0f %9.2e %9.2e %9.2e ",
-               wmain[nstart + i].xcen[0], wmain[nstart + i].xcen[2], ii,
-               jj, wmain[nstart + i].inwind, converge[i], wmain[nstart + i].v[0], wmain[nstart + i].v[1], wmain[nstart + i].v[2]);
-      strcpy (one_line, start);
-      n = 0;
-      while (n < ncols)
-      {
-        sprintf (one_value, "%9.2e ", c[n][i]);
-        strcat (one_line, one_value);
-        n++;
-      }
-      fprintf (fptr, "%s\n", one_line);
-    }
-  }
+/**********************************************************/
+/**
+ * @brief      defines a table of selected variables related to heating and cooling
+ * processes
+ *
+ * @param [in] int  ndom   The domain of interest
+ * @param [in] char  rootname[]   The rootname of the windsave file
+ * @param [out] ExportTablePtr  table   The table to be defined
+ * @return     Always returns 0
+ *
+ * @details
+ *
+ * ### Notes ###
+ *
+ * To add a variable one just needs to add a call to table_add_plasma.
+ *
+ **********************************************************/
 
-  fclose (fptr);
+int
+create_heat_table (ndom, rootname, table)
+     int ndom;
+     char rootname[];
+     ExportTablePtr table;
+{
+  sprintf (table->filename, "%s.heat", rootname);
+  table->ncols = 0;
+
+  table_add_position (ndom, table, FALSE);
+
+  table_add_plasma (table, "vol");
+  table_add_plasma (table, "rho");
+  table_add_plasma (table, "ne");
+  table_add_plasma (table, "t_e");
+  table_add_plasma (table, "t_r");
+  table_add_plasma (table, "w");
+  table_add_plasma (table, "heat_tot");
+  table_add_plasma (table, "heat_comp");
+  table_add_plasma (table, "heat_lines");
+  table_add_plasma (table, "heat_ff");
+  table_add_plasma (table, "heat_photo");
+  table_add_plasma (table, "heat_auger");
+  table_add_plasma (table, "cool_tot");
+  table_add_plasma (table, "cool_comp");
+  table_add_plasma (table, "lum_lines");
+  table_add_plasma (table, "cool_dr");
+  table_add_plasma (table, "lum_ff");
+  table_add_plasma (table, "cool_rr");
+  table_add_plasma (table, "cool_adiab");
+  table_add_plasma (table, "heat_shock");
+  table_add_plasma (table, "heat_lines_macro");
+  table_add_plasma (table, "heat_photo_macro");
 
   return (0);
 }
 
 
 
-
 /**********************************************************/
 /**
- * @brief      writes a selected variables related to issues about
- * convergence to an ascii file which can be read as an astropy table
- *
+ * @brief      defines a table of selected variables related to issues about
+ * convergence
  *
  * @param [in] int  ndom   The domain of interest
- * @param [in, out] char  rootname[]   The rootname of the windsave file
+ * @param [in] char  rootname[]   The rootname of the windsave file
+ * @param [out] ExportTablePtr  table   The table to be defined
  * @return     Always returns 0
  *
  * @details
  *
  * ### Notes ###
  *
- * To add a variable one just needs to define the column_name
- * and send the appropriate call to either get_one or get_ion.
- *
+ * To add a variable one just needs to add a call to table_add_plasma.
  *
  **********************************************************/
 
 int
-create_convergence_table (ndom, rootname)
+create_convergence_table (ndom, rootname, table)
      int ndom;
      char rootname[];
+     ExportTablePtr table;
 {
-  char filename[132];
-  double *c[50], *converge;
-  char column_name[50][20];
-  char one_line[1024], start[132], one_value[20];
+  sprintf (table->filename, "%s.converge", rootname);
+  table->ncols = 0;
+
+  table_add_position (ndom, table, FALSE);
+
+  table_add_plasma (table, "vol");
+  table_add_plasma (table, "rho");
+  table_add_plasma (table, "ne");
+  table_add_plasma (table, "t_e");
+  table_add_plasma (table, "t_e_old");
+  table_add_plasma (table, "dt_e");
+  table_add_plasma (table, "dt_e_old");
+  table_add_plasma (table, "t_r");
+  table_add_plasma (table, "t_r_old");
+  table_add_plasma (table, "w");
+  table_add_plasma (table, "heat_tot");
+  table_add_plasma (table, "heat_tot_old");
+  table_add_plasma (table, "cool_tot");
+  table_add_plasma (table, "ntot");
+  table_add_plasma (table, "ip");
+  table_add_plasma (table, "nioniz");
+  table_add_plasma (table, "gain");
+  table_add_plasma (table, "macro_bf_in");
+  table_add_plasma (table, "macro_bf_out");
 
+  return (0);
+}
 
-  int i, ii, jj;
-  int nstart, ndim2;
-  int n, ncols;
-  FILE *fptr;
-
-  strcpy (filename, rootname);
-  strcat (filename, ".converge.txt");
-
-
-  fptr = fopen (filename, "w");
-
-  /* Get the variables that one needs */
-
-  c[0] = get_one (ndom, "vol");
-  strcpy (column_name[0], "vol");
-
-  c[1] = get_one (ndom, "rho");
-  strcpy (column_name[1], "rho");
-
-  c[2] = get_one (ndom, "ne");
-  strcpy (column_name[2], "ne");
-
-  c[3] = get_one (ndom, "t_e");
-  strcpy (column_name[3], "t_e");
-
-  c[4] = get_one (ndom, "t_e_old");
-  strcpy (column_name[4], "t_e_old");
-
-  c[5] = get_one (ndom, "dt_e");
-  strcpy (column_name[5], "dt_e");
 
-  c[6] = get_one (ndom, "dt_e_old");
-  strcpy (column_name[6], "dt_e_old");
 
-  c[7] = get_one (ndom, "t_r");
-  strcpy (column_name[7], "t_r");
+/**********************************************************/
+/**
+ * @brief      defines an astropy table containing a quantity for each ion
+ *  of a given element as a function of the position in the grid
+ *
+ * @param [in] int  ndom   The domain number
+ * @param [in] char  rootname[]   The rootname of the windsave file
+ * @param [in] int  iz   atomic number of the element
+ * @param [in] int  ion_switch   What is to be tabulated for each ion
+ * @param [out] ExportTablePtr  table   The table to be defined
+ * @return     The number of tables defined, 1 normally, or 0 if the
+ * element is not in the atomic data
+ *
+ * @details
+ *
+ * The quantities which can be tabulated are described in table_add_ion.
+ *
+ **********************************************************/
 
-  c[8] = get_one (ndom, "t_r_old");
-  strcpy (column_name[8], "t_r_old");
+int
+create_ion_table (ndom, rootname, iz, ion_switch, table)
+     int ndom;
+     char rootname[];
+     int iz;
+     int ion_switch;
+     ExportTablePtr table;
+{
+  int nelem, n, istate;
+  char name[20];
 
-  c[9] = get_one (ndom, "w");
-  strcpy (column_name[9], "w");
+  nelem = 0;
+  while (nelem < nelements && ele[nelem].z != iz)
+    nelem++;
 
-  c[10] = get_one (ndom, "heat_tot");
-  strcpy (column_name[10], "heat_tot");
+  if (nelem == nelements)
+  {
+    Log ("create_ion_table: Element %d is not in the atomic data, so no table is made\n", iz);
+    return (0);
+  }
 
-  c[11] = get_one (ndom, "heat_tot_old");
-  strcpy (column_name[11], "heat_tot_old");
+  if (ion_switch < 0 || ion_switch >= (int) NION_SWITCHES)
+  {
+    Error ("create_ion_table : Unknown switch %d \n", ion_switch);
+    exit (0);
+  }
 
-  c[12] = get_one (ndom, "cool_tot");
-  strcpy (column_name[12], "cool_tot");
+  sprintf (table->filename, "%s.%s.%s", rootname, ele[nelem].name, ion_switch_names[ion_switch]);
+  table->ncols = 0;
 
-  c[13] = get_one (ndom, "ntot");
-  strcpy (column_name[13], "ntot");
+  if (zdom[ndom].coord_type == SPHERICAL)
+  {
+    table_add_column (table, "r", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, r));
+    table_add_column (table, "i", "%4s ", "%4d ", TABLE_CELL_I, 0);
+  }
+  else
+  {
+    table_add_column (table, "x", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, xcen[0]));
+    table_add_column (table, "z", "%8s ", "%8.2e ", TABLE_WIND_DOUBLE, offsetof (wind_dummy, xcen[2]));
+    table_add_column (table, "i", "%4s ", "%4d ", TABLE_CELL_I, 0);
+    table_add_column (table, "j", "%4s ", "%4d ", TABLE_CELL_J, 0);
+  }
+  table_add_column (table, "inwind", "%6s ", "%6d ", TABLE_WIND_INT, offsetof (wind_dummy, inwind));
 
-  c[14] = get_one (ndom, "ip");
-  strcpy (column_name[14], "ip");
+  for (n = 0; n < ele[nelem].nions; n++)
+  {
+    istate = ion[ele[nelem].firstion + n].istate;
+    sprintf (name, "i%02d", istate);
+    table_add_ion (table, name, "%8s ", "%8.2e ", iz, istate, ion_switch);
+  }
 
-  c[15] = get_one (ndom, "nioniz");
-  strcpy (column_name[15], "nioniz");
+  return (1);
+}
 
-  c[16] = get_one (ndom, "gain");
-  strcpy (column_name[16], "gain");
 
-  c[17] = get_one (ndom, "macro_bf_in");
-  strcpy (column_name[17], "macro_bf_in");
 
-  c[18] = get_one (ndom, "macro_bf_out");
-  strcpy (column_name[18], "macro_bf_out");
+/**********************************************************/
+/**
+ * @brief      Find the process which is to gather and write a table
+ *
+ * @param [in] int  ntable   The number of the table
+ * @return     The rank of the process responsible for the table
+ *
+ * @details
+ * The tables are dealt out to the processes in turn.  When python
+ * is not running in parallel, and in windsave2table, all of the
+ * tables belong to the one process.
+ *
+ **********************************************************/
 
-  /* This should be the maxium number above +1 */
-  ncols = 19;
+int
+table_owner (ntable)
+     int ntable;
+{
+  if (np_mpi_global > 1)
+    return (ntable % np_mpi_global);
+  return (0);
+}
 
 
-  converge = get_one (ndom, "converge");
 
-  /* At this point all of the data has been collected */
+/**********************************************************/
+/**
+ * @brief      Fill the columns of a set of tables for one domain, in a single
+ * pass through the cells of the domain
+ *
+ * @param [in] int  ndom   The domain
+ * @param [in] int  ntables   The number of tables
+ * @param [in, out] ExportTablePtr  tables   The tables
+ * @return     Always returns 0
+ *
+ * @details
+ *
+ * The routine allocates the buffer for each column of the tables which
+ * belong to this process, and then visits each cell of the domain once,
+ * storing each of the values which are required from wmain and plasmamain.
+ *
+ * ### Notes ###
+ *
+ * Values from the plasma structure are zero for cells which have no volume,
+ * and values for individual ions are also zero if the density is zero.
+ *
+ **********************************************************/
 
+int
+table_gather (ndom, ntables, tables)
+     int ndom;
+     int ntables;
+     ExportTablePtr tables;
+{
+  int nstart, ndim2, n, nt, nc, i, j;
+  int has_vol, has_rho;
+  WindPtr one;
+  PlasmaPtr xplasma;
+  TableColumnPtr col;
+  char *wbase, *pbase;
 
   nstart = zdom[ndom].nstart;
   ndim2 = zdom[ndom].ndim2;
 
-
-  if (zdom[ndom].coord_type == SPHERICAL)
+  for (nt = 0; nt < ntables; nt++)
   {
-
-
-    /*
-     * First assemble the header line
-     */
-
-    sprintf (start, "%9s %4s %6s %6s %9s %9s %9s ", "r", "i", "inwind", "converge", "v_x", "v_y", "v_z");
-    strcpy (one_line, start);
-    n = 0;
-    while (n < ncols)
-    {
-      sprintf (one_value, "%9s ", column_name[n]);
-      strcat (one_line, one_value);
-
-      n++;
-    }
-    fprintf (fptr, "%s\n", one_line);
-
-
-    /* Now assemble the lines of the table */
-
-    for (i = 0; i < ndim2; i++)
+    if (table_owner (nt) != rank_global)
+      continue;
+    for (nc = 0; nc < tables[nt].ncols; nc++)
     {
-      //This line is different from the two d case
-      sprintf (start, "%9.3e %4d %6d %8.0f %9.2e %9.2e %9.2e ",
-               wmain[nstart + i].r, i, wmain[nstart + i].inwind,
-               converge[i], wmain[nstart + i].v[0], wmain[nstart + i].v[1], wmain[nstart + i].v[2]);
-      strcpy (one_line, start);
-      n = 0;
-      while (n < ncols)
+      if ((tables[nt].col[nc].x = (double *) calloc (sizeof (double), ndim2)) == NULL)
       {
-        sprintf (one_value, "%9.2e ", c[n][i]);
-        strcat (one_line, one_value);
-        n++;
+        Error ("table_gather: Could not allocate memory for column %s of %s\n", tables[nt].col[nc].name, tables[nt].filename);
+        Exit (0);
       }
-      fprintf (fptr, "%s\n", one_line);
     }
   }
-  else
-  {
 
-    /* First assemble the header line */
+  for (n = 0; n < ndim2; n++)
+  {
+    one = &wmain[nstart + n];
+    xplasma = &plasmamain[one->nplasma];
+    wbase = (char *) one;
+    pbase = (char *) xplasma;
 
-    sprintf (start, "%8s %8s %4s %4s %6s %8s %9s %9s %9s ", "x", "z", "i", "j", "inwind", "converge", "v_x", "v_y", "v_z");
-    strcpy (one_line, start);
-    n = 0;
-    while (n < ncols)
+    if (zdom[ndom].coord_type == SPHERICAL)
     {
-      sprintf (one_value, "%9s ", column_name[n]);
-      strcat (one_line, one_value);
-
-      n++;
+      i = n;
+      j = 0;
     }
-    fprintf (fptr, "%s\n", one_line);
-
+    else
+      wind_n_to_ij (ndom, nstart + n, &i, &j);
 
-    /* Now assemble the lines of the table */
+    has_vol = (one->vol > 0.0);
+    has_rho = (has_vol && xplasma->rho > 0.0);
 
-    for (i = 0; i < ndim2; i++)
+    for (nt = 0; nt < ntables; nt++)
     {
-      wind_n_to_ij (ndom, nstart + i, &ii, &jj);
-      sprintf (start,
-               "%8.2e %8.2e %4d %4d %6d %8.0f %9.2e %9.2e %9.2e ",
-               wmain[nstart + i].xcen[0], wmain[nstart + i].xcen[2], ii,
-               jj, wmain[nstart + i].inwind, converge[i], wmain[nstart + i].v[0], wmain[nstart + i].v[1], wmain[nstart + i].v[2]);
-      strcpy (one_line, start);
-      n = 0;
-      while (n < ncols)
+      if (table_owner (nt) != rank_global)
+        continue;
+
+      for (nc = 0; nc < tables[nt].ncols; nc++)
       {
-        sprintf (one_value, "%9.2e ", c[n][i]);
-        strcat (one_line, one_value);
-        n++;
+        col = &tables[nt].col[nc];
+
+        if (col->kind == TABLE_WIND_DOUBLE)
+          col->x[n] = *(double *) (wbase + col->offset);
+        else if (col->kind == TABLE_WIND_INT)
+          col->x[n] = *(int *) (wbase + col->offset);
+        else if (col->kind == TABLE_CELL_I)
+          col->x[n] = i;
+        else if (col->kind == TABLE_CELL_J)
+          col->x[n] = j;
+        else if (col->kind == TABLE_PLASMA_DOUBLE)
+          col->x[n] = has_vol ? *(double *) (pbase + col->offset) : 0.0;
+        else if (col->kind == TABLE_PLASMA_INT)
+          col->x[n] = has_vol ? *(int *) (pbase + col->offset) : 0.0;
+        else if (col->kind == TABLE_ION)
+          col->x[n] = (has_rho && col->nion >= 0) ? table_ion_value (xplasma, col) : 0.0;
       }
-      fprintf (fptr, "%s\n", one_line);
     }
   }
 
-  fclose (fptr);
-
   return (0);
 }
 
 
 
-
 /**********************************************************/
 /**
- * @brief      makes an astropy table containing the relative abundances
- *  of a given element as a function of the position in the grid
+ * @brief      Get the quantity tabulated in an ion column for one cell
  *
- * @param [in] int  ndom   The domain number
- * @param [in] char  rootname[]   The rootname of the windsave file
- * @param [in] int  iz   atomic number of the element
- * @return     0 on completion
+ * @param [in] PlasmaPtr  xplasma   The plasma cell
+ * @param [in] TableColumnPtr  col   The column
+ * @return     The value of the quantity
  *
  * @details
- *
- * ### Notes ###
- *
- * The routine calls get_ion_density mulitiple times, once for
- * each ion of an atom
+ * The quantities are described in table_add_ion
  *
  **********************************************************/
 
-int
-create_ion_table (ndom, rootname, iz, ion_switch)
-     int ndom;
-     char rootname[];
-     int iz;
-//Where z is the element
-     int ion_switch;
-//Determines what is actually printed out
+double
+table_ion_value (xplasma, col)
+     PlasmaPtr xplasma;
+     TableColumnPtr col;
 {
-  char filename[132];
-  double *c[100];
-  int first_ion, number_ions;
-  char element_name[20];
-  int istate[50];
-  char one_line[1024], start[132], one_value[20];
-  int nstart, ndim2;
-  char name[132];               /* Name of extension for a
-                                 * particular ion table */
-
-
-  int i, ii, jj, n;
-  FILE *fptr;
-
-  /*
-   * First we actually need to determine what ions exits, but we will
-   * ignore this for now
-   */
-
-  i = 0;
-  while (i < nelements)
-  {
-    if (ele[i].z == iz)
-    {
-      break;
-    }
-    i++;
-  }
-
-
-  first_ion = ele[i].firstion;
-  number_ions = ele[i].nions;
-  strcpy (element_name, ele[i].name);
+  int nion;
+  double nh;
 
-  //Log("element %d %d %s\n", first_ion, number_ions, element_name);
+  nion = col->nion;
 
-  i = 0;
-  while (i < number_ions)
+  switch (col->iswitch)
   {
-    istate[i] = ion[first_ion + i].istate;
-
-    c[i] = get_ion (ndom, iz, istate[i], ion_switch, name);
-    i++;
+  case 0:
+    nh = rho2nh * xplasma->rho;
+    return (xplasma->density[nion] / (nh * ele[col->nelem].abun));
+  case 1:
+    return (xplasma->density[nion]);
+  case 2:
+    return ((double) xplasma->scatters[nion] / xplasma->vol);
+  case 3:
+    return (xplasma->xscatters[nion]);
+  case 4:
+    return (xplasma->ioniz[nion]);
+  case 5:
+    return (xplasma->recomb[nion]);
+  case 6:
+    return (xplasma->heat_ion[nion]);
+  case 7:
+    return (xplasma->cool_rr_ion[nion]);
+  case 8:
+    return (xplasma->lum_rr_ion[nion]);
+  case 9:
+    return (xplasma->cool_dr_ion[nion]);
   }
 
-
-  /* Open the output file */
-
-  sprintf (filename, "%s.%s.%s.txt", rootname, element_name, name);
-
-  fptr = fopen (filename, "w");
-
+  return (0.0);
+}
 
 
-  nstart = zdom[ndom].nstart;
-  ndim2 = zdom[ndom].ndim2;
 
+/**********************************************************/
+/**
+ * @brief      Write the tables for a domain which belong to this process
+ *
+ * @param [in] int  ndom   The domain
+ * @param [in] int  ntables   The number of tables
+ * @param [in] ExportTablePtr  tables   The tables, whose columns have been gathered
+ * @param [in] int  binary   If TRUE write binary columnar files as well as ascii files
+ * @return     Always returns 0
+ *
+ **********************************************************/
 
+int
+table_write (ndom, ntables, tables, binary)
+     int ndom;
+     int ntables;
+     ExportTablePtr tables;
+     int binary;
+{
+  int nt;
 
-  if (zdom[ndom].coord_type == SPHERICAL)
+  for (nt = 0; nt < ntables; nt++)
   {
+    if (table_owner (nt) != rank_global)
+      continue;
+    table_write_ascii (&tables[nt], zdom[ndom].ndim2);
+    if (binary)
+      table_write_binary (&tables[nt], zdom[ndom].ndim2);
+  }
 
+  return (0);
+}
 
-    /*
-     * First assemble the header line
-     */
-
-    sprintf (start, "%8s %4s %6s ", "r", "i", "inwind");
-
-    strcpy (one_line, start);
-    n = 0;
-    while (n < number_ions)
-    {
-      sprintf (one_value, "     i%02d ", istate[n]);
-      strcat (one_line, one_value);
-
-      n++;
-    }
-
-
-    fprintf (fptr, "%s\n", one_line);
-
-
-    /* Now assemble the lines of the table */
 
-    for (i = 0; i < ndim2; i++)
-    {
-      //This line is different from the two d case
-      sprintf (start, "%8.2e %4d %6d ", wmain[nstart + i].r, i, wmain[nstart + i].inwind);
-      strcpy (one_line, start);
 
-      n = 0;
-      while (n < number_ions)
-      {
-        sprintf (one_value, "%8.2e ", c[n][i]);
-        strcat (one_line, one_value);
-        n++;
-      }
+/**********************************************************/
+/**
+ * @brief      Write a table as an ascii file which can be read as an astropy table
+ *
+ * @param [in] ExportTablePtr  table   The table
+ * @param [in] int  nrows   The number of rows, that is cells, in the table
+ * @return     0 on success, -1 if the file could not be opened
+ *
+ * @details
+ * The file is the name of the table with the extension .txt.  The first
+ * line contains the names of the columns, and there is one line for each cell.
+ * A table with no columns produces an empty file.
+ *
+ **********************************************************/
 
+int
+table_write_ascii (table, nrows)
+     ExportTablePtr table;
+     int nrows;
+{
+  char filename[LINELENGTH + 48];
+  char one_line[NTABLE_COLUMNS * 32];
+  char *s;
+  int is_int[NTABLE_COLUMNS];
+  int n, nc;
+  FILE *fptr;
 
-      fprintf (fptr, "%s\n", one_line);
-    }
-  }
-  else
+  sprintf (filename, "%s.txt", table->filename);
+  if ((fptr = fopen (filename, "w")) == NULL)
   {
+    Error ("table_write_ascii: Could not open %s\n", filename);
+    return (-1);
+  }
 
-
-    /* First assemble the header line */
-
-    sprintf (start, "%8s %8s %4s %4s %6s ", "x", "z", "i", "j", "inwind");
-    strcpy (one_line, start);
-    n = 0;
-    while (n < number_ions)
+  if (table->ncols > 0)
+  {
+    s = one_line;
+    for (nc = 0; nc < table->ncols; nc++)
     {
-      sprintf (one_value, "     i%02d ", istate[n]);
-      strcat (one_line, one_value);
-
-      n++;
+      s += sprintf (s, table->col[nc].head, table->col[nc].name);
+      is_int[nc] = (strchr (table->col[nc].fmt, 'd') != NULL);
     }
-
     fprintf (fptr, "%s\n", one_line);
 
-    /* Now assemble the lines of the table */
-
-    for (i = 0; i < ndim2; i++)
+    for (n = 0; n < nrows; n++)
     {
-      wind_n_to_ij (ndom, nstart + i, &ii, &jj);
-      sprintf (start, "%8.2e %8.2e %4d %4d %6d ", wmain[nstart + i].xcen[0], wmain[nstart + i].xcen[2], ii, jj, wmain[nstart + i].inwind);
-      strcpy (one_line, start);
-      n = 0;
-      while (n < number_ions)
+      s = one_line;
+      for (nc = 0; nc < table->ncols; nc++)
       {
-        sprintf (one_value, "%8.2e ", c[n][i]);
-        strcat (one_line, one_value);
-        n++;
+        if (is_int[nc])
+          s += sprintf (s, table->col[nc].fmt, (int) table->col[nc].x[n]);
+        else
+          s += sprintf (s, table->col[nc].fmt, table->col[nc].x[n]);
       }
       fprintf (fptr, "%s\n", one_line);
     }
@@ -944,340 +959,124 @@ create_ion_table (ndom, rootname, iz, ion_switch)
 
   fclose (fptr);
   return (0);
-
 }
 
 
 
 /**********************************************************/
 /**
- * @brief      Get get density, etc for one particular ion
+ * @brief      Write a table as a binary columnar file, with a schema
+ * which describes it
  *
- * @param [in] int  ndom   the domain number
- * @param [in] int  element   the element number
- * @param [in] int  istate   the ionization state
- * @param [in] int  iswitch   a switch controlling exactly what is returned for that ion
- * @return     Normally returns an array with values associated with what is requested
- *    	This will return an array with all zeros if there is no such ion
+ * @param [in] ExportTablePtr  table   The table
+ * @param [in] int  nrows   The number of rows, that is cells, in the table
+ * @return     0 on success, -1 if the files could not be opened
  *
  * @details
  *
- * ### Notes ###
+ * The columns are written one after another to a file with the
+ * extension .bin.  Integer columns are written as 4 byte integers,
+ * and all others as 8 byte doubles, in the byte order of the machine.
+ *
+ * The schema is written in JSON to a file with the extension .json,
+ * and gives the number of rows and the name, type and byte offset of
+ * each column, with types in the notation used by numpy, so that
+ * for example a column can be read with numpy.fromfile.
  *
  **********************************************************/
 
-double *
-get_ion (ndom, element, istate, iswitch, name)
-     int ndom, element, istate, iswitch;
-     char *name;
+int
+table_write_binary (table, nrows)
+     ExportTablePtr table;
+     int nrows;
 {
-  int nion, nelem;
-  int n;
-  int nplasma;
-  double *x;
-  int nstart, ndim2;
-  double nh;
-
-
-  nstart = zdom[ndom].nstart;
-  ndim2 = zdom[ndom].ndim2;
-
-  x = (double *) calloc (sizeof (double), ndim2);
-
-  /* Find the ion */
+  char filename[LINELENGTH + 48];
+  char order;
+  int n, nc, one;
+  int *ibuf;
+  long offset;
+  FILE *fbin, *fjson;
+  TableColumnPtr col;
+
+  one = 1;
+  order = (*(char *) &one == 1) ? '<' : '>';
+
+  sprintf (filename, "%s.bin", table->filename);
+  if ((fbin = fopen (filename, "w")) == NULL)
+  {
+    Error ("table_write_binary: Could not open %s\n", filename);
+    return (-1);
+  }
 
-  nion = 0;
-  while (nion < nions && !(ion[nion].z == element && ion[nion].istate == istate))
-    nion++;
-  if (nion == nions)
+  sprintf (filename, "%s.json", table->filename);
+  if ((fjson = fopen (filename, "w")) == NULL)
   {
-    Log ("Error--element %d ion %d not found in define_wind\n", element, istate);
-    return (x);
+    Error ("table_write_binary: Could not open %s\n", filename);
+    fclose (fbin);
+    return (-1);
   }
-  nelem = 0;
-  while (nelem < nelements && ele[nelem].z != element)
-    nelem++;
 
+  if ((ibuf = (int *) calloc (sizeof (int), nrows > 0 ? nrows : 1)) == NULL)
+  {
+    Error ("table_write_binary: Could not allocate memory for %d rows\n", nrows);
+    Exit (0);
+  }
 
-  /* Now populate the array */
+  fprintf (fjson, "{\n  \"table\": \"%s\",\n  \"nrows\": %d,\n  \"columns\": [", table->filename, nrows);
 
-  for (n = 0; n < ndim2; n++)
+  offset = 0;
+  for (nc = 0; nc < table->ncols; nc++)
   {
-    x[n] = 0;
-    nplasma = wmain[nstart + n].nplasma;
-    if (wmain[nstart + n].vol > 0.0 && plasmamain[nplasma].rho > 0.0)
+    col = &table->col[nc];
+    if (col->kind == TABLE_WIND_INT || col->kind == TABLE_CELL_I || col->kind == TABLE_CELL_J || col->kind == TABLE_PLASMA_INT)
     {
-      if (iswitch == 0)
-      {
-        x[n] = plasmamain[nplasma].density[nion];
-        nh = rho2nh * plasmamain[nplasma].rho;
-        x[n] /= (nh * ele[nelem].abun);
-        strcpy (name, "frac");
-      }
-      else if (iswitch == 1)
-      {
-        x[n] = plasmamain[nplasma].density[nion];
-        strcpy (name, "den");
-      }
-      else if (iswitch == 2)
-      {
-        x[n] = (double) plasmamain[nplasma].scatters[nion] / plasmamain[nplasma].vol;
-        strcpy (name, "scat");
-      }
-      else if (iswitch == 3)
-      {
-        x[n] = plasmamain[nplasma].xscatters[nion];
-        strcpy (name, "ion_frac");
-      }
-      else if (iswitch == 4)
-      {
-        x[n] = plasmamain[nplasma].ioniz[nion];
-        strcpy (name, "ioniz");
-      }
-      else if (iswitch == 5)
-      {
-        x[n] = plasmamain[nplasma].recomb[nion];
-        strcpy (name, "recomb");
-      }
-      else if (iswitch == 6)
-      {
-        x[n] = plasmamain[nplasma].heat_ion[nion];
-        strcpy (name, "heat");
-      }
-      else if (iswitch == 7)
-      {
-        x[n] = plasmamain[nplasma].cool_rr_ion[nion];
-        strcpy (name, "cool_rr");
-      }
-      else if (iswitch == 8)
-      {
-        x[n] = plasmamain[nplasma].lum_rr_ion[nion];
-        strcpy (name, "lum_rr");
-      }
-      else if (iswitch == 9)
-      {
-        x[n] = plasmamain[nplasma].cool_dr_ion[nion];
-        strcpy (name, "cool_dr");
-      }
-      else
-      {
-        Error ("get_ion : Unknown switch %d \n", iswitch);
-        exit (0);
-      }
+      for (n = 0; n < nrows; n++)
+        ibuf[n] = (int) col->x[n];
+      fwrite (ibuf, sizeof (int), nrows, fbin);
+      fprintf (fjson, "%s\n    {\"name\": \"%s\", \"dtype\": \"%ci%d\", \"offset\": %ld}", nc ? "," : "", col->name, order,
+               (int) sizeof (int), offset);
+      offset += (long) nrows * sizeof (int);
+    }
+    else
+    {
+      fwrite (col->x, sizeof (double), nrows, fbin);
+      fprintf (fjson, "%s\n    {\"name\": \"%s\", \"dtype\": \"%cf%d\", \"offset\": %ld}", nc ? "," : "", col->name, order,
+               (int) sizeof (double), offset);
+      offset += (long) nrows * sizeof (double);
     }
   }
 
-  return (x);
+  fprintf (fjson, "\n  ]\n}\n");
+
+  free (ibuf);
+  fclose (fbin);
+  fclose (fjson);
+
+  return (0);
 }
 
 
 
 /**********************************************************/
 /**
- * @brief      Get a simple variable from the PlasmaPtr array
- *
- * @param [in] int  ndom   The domain in question
- * @param [in] char  variable_name[]   The name of the variable
- * @return     The values in the plasma pointer for this variable. A double
- * 	will be returned even if the PlasmaPtr varible is an integer
- *
- *
- * @details
- *
- * A simple variable is a variable that is just a number, not an array
- *
- * The routine performes a simple tranlation of the character name
- * to a variable in the PlasmaPtr.
+ * @brief      Release the buffers which hold the columns of a table
  *
- * ### Notes ###
- * Only selected variables are returned, but new variables are easy
- * to add using the template of the other variables
+ * @param [in, out] ExportTablePtr  table   The table
+ * @return     Always returns 0
  *
  **********************************************************/
 
-double *
-get_one (ndom, variable_name)
-     int ndom;
-     char variable_name[];
+int
+table_free (table)
+     ExportTablePtr table;
 {
-  int n;
-  int nplasma;
-  double *x;
-  int ndim2;
-  int nstart;
-
-  nstart = zdom[ndom].nstart;
-  ndim2 = zdom[ndom].ndim2;
-
-  x = (double *) calloc (sizeof (double), ndim2);
+  int nc;
 
-  for (n = 0; n < ndim2; n++)
+  for (nc = 0; nc < table->ncols; nc++)
   {
-    x[n] = 0;
-    if (wmain[n + nstart].vol > 0.0)
-    {
-      nplasma = wmain[n + nstart].nplasma;
-
-
-      if (strcmp (variable_name, "ne") == 0)
-      {
-        x[n] = plasmamain[nplasma].ne;
-      }
-      else if (strcmp (variable_name, "rho") == 0)
-      {
-        x[n] = plasmamain[nplasma].rho;
-      }
-      else if (strcmp (variable_name, "vol") == 0)
-      {
-        x[n] = plasmamain[nplasma].vol;
-      }
-      else if (strcmp (variable_name, "t_e") == 0)
-      {
-        x[n] = plasmamain[nplasma].t_e;
-      }
-      else if (strcmp (variable_name, "t_r") == 0)
-      {
-        x[n] = plasmamain[nplasma].t_r;
-      }
-      else if (strcmp (variable_name, "t_e_old") == 0)
-      {
-        x[n] = plasmamain[nplasma].t_e_old;
-      }
-      else if (strcmp (variable_name, "t_r_old") == 0)
-      {
-        x[n] = plasmamain[nplasma].t_r_old;
-      }
-      else if (strcmp (variable_name, "dt_e") == 0)
-      {
-        x[n] = plasmamain[nplasma].dt_e;
-      }
-      else if (strcmp (variable_name, "dt_e_old") == 0)
-      {
-        x[n] = plasmamain[nplasma].dt_e_old;
-      }
-      else if (strcmp (variable_name, "converge") == 0)
-      {
-        x[n] = plasmamain[nplasma].converge_whole;
-      }
-      else if (strcmp (variable_name, "dmo_dt_x") == 0)
-      {
-        x[n] = plasmamain[nplasma].dmo_dt[0];
-      }
-      else if (strcmp (variable_name, "dmo_dt_y") == 0)
-      {
-        x[n] = plasmamain[nplasma].dmo_dt[1];
-      }
-      else if (strcmp (variable_name, "dmo_dt_z") == 0)
-      {
-        x[n] = plasmamain[nplasma].dmo_dt[2];
-      }
-      else if (strcmp (variable_name, "ntot") == 0)
-      {
-        x[n] = plasmamain[nplasma].ntot;
-      }
-      else if (strcmp (variable_name, "ip") == 0)
-      {
-        x[n] = plasmamain[nplasma].ip;
-      }
-      else if (strcmp (variable_name, "heat_tot") == 0)
-      {
-        x[n] = plasmamain[nplasma].heat_tot;
-      }
-      else if (strcmp (variable_name, "heat_tot_old") == 0)
-      {
-        x[n] = plasmamain[nplasma].heat_tot_old;
-      }
-      else if (strcmp (variable_name, "heat_comp") == 0)
-      {
-        x[n] = plasmamain[nplasma].heat_comp;
-      }
-      else if (strcmp (variable_name, "heat_lines") == 0)
-      {
-        x[n] = plasmamain[nplasma].heat_lines;
-      }
-      else if (strcmp (variable_name, "heat_ff") == 0)
-      {
-        x[n] = plasmamain[nplasma].heat_ff;
-      }
-      else if (strcmp (variable_name, "heat_photo") == 0)
-      {
-        x[n] = plasmamain[nplasma].heat_photo;
-      }
-      else if (strcmp (variable_name, "heat_auger") == 0)
-      {
-        x[n] = plasmamain[nplasma].heat_auger;
-      }
-      else if (strcmp (variable_name, "cool_comp") == 0)
-      {
-        x[n] = plasmamain[nplasma].cool_comp;
-      }
-      else if (strcmp (variable_name, "lum_lines") == 0)
-      {
-        x[n] = plasmamain[nplasma].lum_lines;
-      }
-      else if (strcmp (variable_name, "lum_ff") == 0)
-      {
-        x[n] = plasmamain[nplasma].lum_ff;
-      }
-      else if (strcmp (variable_name, "cool_rr") == 0)
-      {
-        x[n] = plasmamain[nplasma].cool_rr;
-      }
-      else if (strcmp (variable_name, "cool_dr") == 0)
-      {
-        x[n] = plasmamain[nplasma].cool_dr;
-      }
-      else if (strcmp (variable_name, "cool_tot") == 0)
-      {
-        x[n] = plasmamain[nplasma].cool_tot;
-      }
-      else if (strcmp (variable_name, "w") == 0)
-      {
-        x[n] = plasmamain[nplasma].w;
-      }
-      else if (strcmp (variable_name, "nrad") == 0)
-      {
-        x[n] = plasmamain[nplasma].nrad;
-      }
-      else if (strcmp (variable_name, "nioniz") == 0)
-      {
-        x[n] = plasmamain[nplasma].nioniz;
-      }
-      else if (strcmp (variable_name, "heat_shock") == 0)
-      {
-        x[n] = plasmamain[nplasma].heat_shock;
-      }
-      else if (strcmp (variable_name, "cool_adiab") == 0)
-      {
-        x[n] = plasmamain[nplasma].cool_adiabatic;
-      }
-      else if (strcmp (variable_name, "heat_lines_macro") == 0)
-      {
-        x[n] = plasmamain[nplasma].heat_lines_macro;
-      }
-      else if (strcmp (variable_name, "heat_photo_macro") == 0)
-      {
-        x[n] = plasmamain[nplasma].heat_photo_macro;
-      }
-      else if (strcmp (variable_name, "gain") == 0)
-      {
-        x[n] = plasmamain[nplasma].gain;
-      }
-      else if (strcmp (variable_name, "macro_bf_in") == 0)
-      {
-        x[n] = plasmamain[nplasma].bf_simple_ionpool_in;
-      }
-      else if (strcmp (variable_name, "macro_bf_out") == 0)
-      {
-        x[n] = plasmamain[nplasma].bf_simple_ionpool_out;
-      }
-      else
-      {
-        Error ("get_one: Unknown variable %s\n", variable_name);
-      }
-    }
+    free (table->col[nc].x);
+    table->col[nc].x = NULL;
   }
 
-  return (x);
-
+  return (0);
 }
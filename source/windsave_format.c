@@ -0,0 +1,679 @@
+
+/***********************************************************/
+/** @file  windsave_format.c
+ * @date   October, 2026
+ *
+ * @brief  Routines to write and read the chunked files in which
+ * the wind is saved
+ *
+ * ### Notes ###
+ *
+ * A windsave file consists of
+ *
+ * * a header, which identifies the file, and records the version of
+ * Python which wrote it and a hash of the sizes of the structures
+ * which are written as they are held in memory,
+ * * a set of named fields, each of which is an array of rows of equal
+ * size, stored as chunks of whole rows, together with a table giving
+ * the offset and stored size of each chunk, and
+ * * a directory of the fields, which is written at the end of the file.
+ *
+ * Each chunk is written either as it is, or, if compression has been
+ * requested and makes the chunk smaller, with the runs of zero words
+ * it contains removed.  Most of the per ion and per level arrays of a
+ * model are dominated by such runs.  A chunk is compressed if and only
+ * if its stored size is less than the size of the rows it contains.
+ *
+ * Because the directory records where every chunk is, a program can
+ * read only the fields, or only the range of cells in a field, which it
+ * needs.  The routines which decide what goes into a windsave file are
+ * wind_save and wind_read_parts in windsave.c.
+ *
+ ***********************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "atomic.h"
+#include "python.h"
+
+
+
+/**********************************************************/
+/**
+ * @brief      Calculate a hash of the sizes of the structures that are
+ * written to windsave files as they are held in memory
+ *
+ * @return     The hash
+ *
+ * @details
+ * If any of these structures changes size, files written before
+ * the change cannot be read.
+ *
+ * ### Notes ###
+ *
+ * A change which leaves the size of a structure the same is not
+ * detected.
+ *
+ **********************************************************/
+
+unsigned long long
+windsave_struct_hash ()
+{
+  long long size[8];
+
+  size[0] = sizeof (geo);
+  size[1] = sizeof (domain_dummy);
+  size[2] = sizeof (wind_dummy);
+  size[3] = sizeof (plasma_dummy);
+  size[4] = sizeof (macro_dummy);
+  size[5] = sizeof (disk);
+  size[6] = WINDSAVE_FORMAT;
+  size[7] = sizeof (struct windsave_header);
+
+  return (setup_hash (FNV_OFFSET, size, sizeof (size)));
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Open a windsave file for writing
+ *
+ * @param [out] WindsaveFilePtr  ws   The structure describing the file
+ * @param [in] char  filename[]   The name of the file
+ * @param [in] int  compress   TRUE if the chunks are to be compressed
+ * @return     0 on success, -1 if the file cannot be opened
+ *
+ * @details
+ * A header is written to reserve space for it.  It is written again,
+ * with the location of the directory, by windsave_close.
+ *
+ **********************************************************/
+
+int
+windsave_open_write (ws, filename, compress)
+     WindsaveFilePtr ws;
+     char filename[];
+     int compress;
+{
+  memset (ws, 0, sizeof (windsave_file_dummy));
+
+  if ((ws->fptr = fopen (filename, "w")) == NULL)
+  {
+    return (-1);
+  }
+
+  ws->compress = compress;
+  strcpy (ws->header.magic, WINDSAVE_MAGIC);
+  ws->header.format = WINDSAVE_FORMAT;
+  sprintf (ws->header.version, "%s", VERSION);
+  ws->header.struct_hash = windsave_struct_hash ();
+
+  if (fwrite (&ws->header, sizeof (struct windsave_header), 1, ws->fptr) != 1)
+  {
+    Error ("windsave_open_write: Could not write the header of %s\n", filename);
+    fclose (ws->fptr);
+    return (-1);
+  }
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Write one field to a windsave file
+ *
+ * @param [in, out] WindsaveFilePtr  ws   The file
+ * @param [in] char  name[]   The name of the field
+ * @param [in] int  rowsize   The number of bytes in each row
+ * @param [in] int  nrow   The number of rows
+ * @param [in] void **  rows   A pointer to the data for each row
+ * @return     1 if the field was written, 0 otherwise
+ *
+ * @details
+ * The rows are gathered into chunks of about WINDSAVE_CHUNK_BYTES,
+ * which are compressed if this was requested when the file was opened,
+ * and written out, followed by the table of chunks.
+ *
+ * ### Notes ###
+ *
+ * Rows are passed as an array of pointers so that the variable length
+ * arrays of each plasma cell, which are allocated separately, can be
+ * written as one field without first being copied into a single array.
+ *
+ **********************************************************/
+
+int
+windsave_write_field (ws, name, rowsize, nrow, rows)
+     WindsaveFilePtr ws;
+     char name[];
+     int rowsize, nrow;
+     void **rows;
+{
+  WindsaveFieldPtr one;
+  long long *table;
+  long long nbytes, nstored;
+  char *buf, *cbuf;
+  int n, m, mfirst, mlast, ok;
+
+  if (ws->header.nfield >= NWINDSAVE_FIELDS)
+  {
+    Error ("windsave_write_field: Too many fields to write %s\n", name);
+    return (0);
+  }
+
+  one = &ws->field[ws->header.nfield];
+  memset (one, 0, sizeof (windsave_field_dummy));
+  strncpy (one->name, name, sizeof (one->name) - 1);
+  one->rowsize = rowsize;
+  one->nrow = nrow;
+  if (rowsize >= WINDSAVE_CHUNK_BYTES)
+    one->rows_per_chunk = 1;
+  else if (rowsize > 0)
+    one->rows_per_chunk = WINDSAVE_CHUNK_BYTES / rowsize;
+  else
+    one->rows_per_chunk = nrow > 0 ? nrow : 1;
+  one->nchunk = (nrow + one->rows_per_chunk - 1) / one->rows_per_chunk;
+
+  nbytes = (long long) rowsize * one->rows_per_chunk;
+  buf = (char *) malloc (nbytes + 1);
+  cbuf = ws->compress ? (char *) malloc (windsave_compress_bound (nbytes) + 1) : NULL;
+  table = (long long *) calloc (2 * one->nchunk + 1, sizeof (long long));
+
+  if (buf == NULL || table == NULL || (ws->compress && cbuf == NULL))
+  {
+    Error ("windsave_write_field: Could not allocate memory to write %s\n", name);
+    free (buf);
+    free (cbuf);
+    free (table);
+    return (0);
+  }
+
+  ok = TRUE;
+  for (n = 0; n < one->nchunk && ok; n++)
+  {
+    mfirst = n * one->rows_per_chunk;
+    mlast = mfirst + one->rows_per_chunk < nrow ? mfirst + one->rows_per_chunk : nrow;
+    for (m = mfirst; m < mlast; m++)
+      memcpy (buf + (long long) (m - mfirst) * rowsize, rows[m], rowsize);
+    nbytes = (long long) (mlast - mfirst) * rowsize;
+
+    table[2 * n] = ftell (ws->fptr);
+    if (ws->compress && (nstored = windsave_compress (buf, nbytes, cbuf)) < nbytes)
+    {
+      ok = (fwrite (cbuf, 1, nstored, ws->fptr) == (size_t) nstored);
+    }
+    else
+    {
+      nstored = nbytes;
+      ok = (fwrite (buf, 1, nbytes, ws->fptr) == (size_t) nbytes);
+    }
+    table[2 * n + 1] = nstored;
+  }
+
+  one->table = ftell (ws->fptr);
+  if (ok)
+    ok = (fwrite (table, sizeof (long long), 2 * one->nchunk, ws->fptr) == (size_t) (2 * one->nchunk));
+
+  free (buf);
+  free (cbuf);
+  free (table);
+
+  if (!ok)
+  {
+    Error ("windsave_write_field: Could not write %s\n", name);
+    return (0);
+  }
+
+  ws->header.nfield++;
+  return (1);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Write an array which is held in one block of memory to a windsave file
+ *
+ * @param [in, out] WindsaveFilePtr  ws   The file
+ * @param [in] char  name[]   The name of the field
+ * @param [in] void *  data   The array
+ * @param [in] int  rowsize   The size of one element of the array
+ * @param [in] int  nrow   The number of elements
+ * @return     1 if the field was written, 0 otherwise
+ *
+ **********************************************************/
+
+int
+windsave_write_array (ws, name, data, rowsize, nrow)
+     WindsaveFilePtr ws;
+     char name[];
+     void *data;
+     int rowsize, nrow;
+{
+  void **rows;
+  int m, n;
+
+  if ((rows = (void **) calloc (nrow + 1, sizeof (void *))) == NULL)
+  {
+    Error ("windsave_write_array: Could not allocate memory to write %s\n", name);
+    return (0);
+  }
+
+  for (m = 0; m < nrow; m++)
+    rows[m] = (char *) data + (long long) m * rowsize;
+
+  n = windsave_write_field (ws, name, rowsize, nrow, rows);
+
+  free (rows);
+
+  return (n);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Read an array which is held in one block of memory from a windsave file
+ *
+ * @param [in] WindsaveFilePtr  ws   The file
+ * @param [in] char  name[]   The name of the field
+ * @param [out] void *  data   The array
+ * @param [in] int  rowsize   The size of one element of the array
+ * @param [in] int  nrow   The number of elements
+ * @return     1 if the field was read, 0 otherwise
+ *
+ **********************************************************/
+
+int
+windsave_read_array (ws, name, data, rowsize, nrow)
+     WindsaveFilePtr ws;
+     char name[];
+     void *data;
+     int rowsize, nrow;
+{
+  void **rows;
+  int m, n;
+
+  if ((rows = (void **) calloc (nrow + 1, sizeof (void *))) == NULL)
+  {
+    Error ("windsave_read_array: Could not allocate memory to read %s\n", name);
+    return (0);
+  }
+
+  for (m = 0; m < nrow; m++)
+    rows[m] = (char *) data + (long long) m * rowsize;
+
+  n = (windsave_read_rows (ws, name, rowsize, 0, nrow, rows) == nrow);
+
+  free (rows);
+
+  return (n);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Complete and close a windsave file
+ *
+ * @param [in, out] WindsaveFilePtr  ws   The file
+ * @param [in] int  writing   TRUE if the file was opened for writing
+ * @return     0 on success, -1 if the directory or header could not be written
+ *
+ * @details
+ * For a file which has been written, the directory of fields is written
+ * at the end of the file, and the header is written again with its location.
+ *
+ **********************************************************/
+
+int
+windsave_close (ws, writing)
+     WindsaveFilePtr ws;
+     int writing;
+{
+  int ok = TRUE;
+
+  if (writing)
+  {
+    ws->header.directory = ftell (ws->fptr);
+    ok = (fwrite (ws->field, sizeof (windsave_field_dummy), ws->header.nfield, ws->fptr) == (size_t) ws->header.nfield);
+    if (ok)
+    {
+      fseek (ws->fptr, 0L, SEEK_SET);
+      ok = (fwrite (&ws->header, sizeof (struct windsave_header), 1, ws->fptr) == 1);
+    }
+  }
+
+  fclose (ws->fptr);
+  ws->fptr = NULL;
+
+  return (ok ? 0 : -1);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Open a windsave file for reading, and read its directory
+ *
+ * @param [out] WindsaveFilePtr  ws   The structure describing the file
+ * @param [in] char  filename[]   The name of the file
+ * @return     0 on success, -1 if the file cannot be opened, and -2
+ * if it is not a chunked windsave file, in which case it is closed
+ *
+ * @details
+ * Files written in the format used before windsave files were
+ * divided into fields do not begin with WINDSAVE_MAGIC, which is
+ * how they are recognised.
+ *
+ **********************************************************/
+
+int
+windsave_open_read (ws, filename)
+     WindsaveFilePtr ws;
+     char filename[];
+{
+  memset (ws, 0, sizeof (windsave_file_dummy));
+
+  if ((ws->fptr = fopen (filename, "r")) == NULL)
+  {
+    return (-1);
+  }
+
+  if (fread (&ws->header, sizeof (struct windsave_header), 1, ws->fptr) != 1
+      || strncmp (ws->header.magic, WINDSAVE_MAGIC, sizeof (ws->header.magic)) != 0)
+  {
+    fclose (ws->fptr);
+    return (-2);
+  }
+
+  if (ws->header.nfield < 0 || ws->header.nfield > NWINDSAVE_FIELDS
+      || fseek (ws->fptr, ws->header.directory, SEEK_SET) != 0
+      || fread (ws->field, sizeof (windsave_field_dummy), ws->header.nfield, ws->fptr) != (size_t) ws->header.nfield)
+  {
+    Error ("windsave_open_read: The directory of %s could not be read\n", filename);
+    fclose (ws->fptr);
+    return (-1);
+  }
+
+  return (0);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Find a field in a windsave file
+ *
+ * @param [in] WindsaveFilePtr  ws   The file
+ * @param [in] char  name[]   The name of the field
+ * @return     A pointer to the directory entry for the field, or NULL if
+ * there is no such field
+ *
+ **********************************************************/
+
+WindsaveFieldPtr
+windsave_find_field (ws, name)
+     WindsaveFilePtr ws;
+     char name[];
+{
+  int n;
+
+  for (n = 0; n < ws->header.nfield; n++)
+  {
+    if (strcmp (ws->field[n].name, name) == 0)
+      return (&ws->field[n]);
+  }
+
+  return (NULL);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Read a range of rows of a field from a windsave file
+ *
+ * @param [in] WindsaveFilePtr  ws   The file
+ * @param [in] char  name[]   The name of the field
+ * @param [in] int  rowsize   The number of bytes expected in each row
+ * @param [in] int  first   The first row to read
+ * @param [in] int  nrow   The number of rows to read
+ * @param [out] void **  rows   Where to put each row
+ * @return     The number of rows read, or -1 if the field does not exist,
+ * has rows of a different size, or cannot be read
+ *
+ * @details
+ * Only the chunks which contain the rows that are requested are read.
+ *
+ **********************************************************/
+
+int
+windsave_read_rows (ws, name, rowsize, first, nrow, rows)
+     WindsaveFilePtr ws;
+     char name[];
+     int rowsize, first, nrow;
+     void **rows;
+{
+  WindsaveFieldPtr one;
+  long long *table;
+  long long nbytes, nstored;
+  char *buf, *cbuf;
+  int n, m, nfirst, nlast, mfirst, mlast, ok;
+
+  if ((one = windsave_find_field (ws, name)) == NULL)
+  {
+    Error ("windsave_read_rows: There is no field %s\n", name);
+    return (-1);
+  }
+
+  if (one->rowsize != rowsize)
+  {
+    Error ("windsave_read_rows: The rows of %s have %d bytes, not %d\n", name, one->rowsize, rowsize);
+    return (-1);
+  }
+
+  if (first < 0 || first + nrow > one->nrow)
+  {
+    Error ("windsave_read_rows: Rows %d to %d are not all in %s, which has %d\n", first, first + nrow - 1, name, one->nrow);
+    return (-1);
+  }
+
+  if (nrow == 0)
+    return (0);
+
+  nbytes = (long long) rowsize * one->rows_per_chunk;
+  buf = (char *) malloc (nbytes + 1);
+  cbuf = (char *) malloc (windsave_compress_bound (nbytes) + 1);
+  table = (long long *) calloc (2 * one->nchunk + 1, sizeof (long long));
+
+  if (buf == NULL || cbuf == NULL || table == NULL)
+  {
+    Error ("windsave_read_rows: Could not allocate memory to read %s\n", name);
+    free (buf);
+    free (cbuf);
+    free (table);
+    return (-1);
+  }
+
+  ok = (fseek (ws->fptr, one->table, SEEK_SET) == 0
+        && fread (table, sizeof (long long), 2 * one->nchunk, ws->fptr) == (size_t) (2 * one->nchunk));
+
+  nfirst = first / one->rows_per_chunk;
+  nlast = (first + nrow - 1) / one->rows_per_chunk;
+
+  for (n = nfirst; n <= nlast && ok; n++)
+  {
+    mfirst = n * one->rows_per_chunk;
+    mlast = mfirst + one->rows_per_chunk < one->nrow ? mfirst + one->rows_per_chunk : one->nrow;
+    nbytes = (long long) (mlast - mfirst) * rowsize;
+    nstored = table[2 * n + 1];
+
+    ok = (nstored <= nbytes && fseek (ws->fptr, table[2 * n], SEEK_SET) == 0);
+    if (ok && nstored < nbytes)
+    {
+      ok = (fread (cbuf, 1, nstored, ws->fptr) == (size_t) nstored && windsave_expand (cbuf, nstored, buf, nbytes) == 0);
+    }
+    else if (ok)
+    {
+      ok = (fread (buf, 1, nbytes, ws->fptr) == (size_t) nbytes);
+    }
+
+    for (m = (mfirst > first ? mfirst : first); ok && m < mlast && m < first + nrow; m++)
+      memcpy (rows[m - first], buf + (long long) (m - mfirst) * rowsize, rowsize);
+  }
+
+  free (buf);
+  free (cbuf);
+  free (table);
+
+  if (!ok)
+  {
+    Error ("windsave_read_rows: Could not read rows %d to %d of %s\n", first, first + nrow - 1, name);
+    return (-1);
+  }
+
+  return (nrow);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      The largest size a block of data can have once compressed
+ *
+ * @param [in] long long  nbytes   The size of the block
+ * @return     The maximum size of the compressed block
+ *
+ **********************************************************/
+
+long long
+windsave_compress_bound (nbytes)
+     long long nbytes;
+{
+  return (nbytes + 8 * (nbytes / 16 + 2));
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Compress a block of data by removing runs of zero words
+ *
+ * @param [in] char *  in   The data
+ * @param [in] long long  nbytes   The size of the data
+ * @param [out] char *  out   The compressed data, which must have room for
+ * windsave_compress_bound(nbytes) bytes
+ * @return     The size of the compressed data
+ *
+ * @details
+ * The data are treated as 8 byte words.  The compressed data are a
+ * sequence of pairs of unsigned ints, giving the number of zero words
+ * and then the number of non-zero words which follow, with each pair followed
+ * by the non-zero words.  Any bytes beyond the last whole word are copied
+ * as they are at the end.
+ *
+ **********************************************************/
+
+long long
+windsave_compress (in, nbytes, out)
+     char *in;
+     long long nbytes;
+     char *out;
+{
+  unsigned long long word;
+  unsigned int count[2];
+  long long nword, i, j, nout;
+
+  nword = nbytes / 8;
+  nout = 0;
+  i = 0;
+
+  while (i < nword)
+  {
+    for (j = i; j < nword && j - i < 0xffffffffLL; j++)
+    {
+      memcpy (&word, in + 8 * j, 8);
+      if (word != 0)
+        break;
+    }
+    count[0] = j - i;
+    i = j;
+
+    for (j = i; j < nword && j - i < 0xffffffffLL; j++)
+    {
+      memcpy (&word, in + 8 * j, 8);
+      if (word == 0)
+        break;
+    }
+    count[1] = j - i;
+
+    memcpy (out + nout, count, sizeof (count));
+    nout += sizeof (count);
+    memcpy (out + nout, in + 8 * i, 8 * (j - i));
+    nout += 8 * (j - i);
+    i = j;
+  }
+
+  memcpy (out + nout, in + 8 * nword, nbytes - 8 * nword);
+  nout += nbytes - 8 * nword;
+
+  return (nout);
+}
+
+
+
+/**********************************************************/
+/**
+ * @brief      Expand a block of data compressed by windsave_compress
+ *
+ * @param [in] char *  in   The compressed data
+ * @param [in] long long  nstored   The size of the compressed data
+ * @param [out] char *  out   The expanded data
+ * @param [in] long long  nbytes   The size of the expanded data
+ * @return     0 on success, -1 if the compressed data are inconsistent with nbytes
+ *
+ **********************************************************/
+
+int
+windsave_expand (in, nstored, out, nbytes)
+     char *in;
+     long long nstored;
+     char *out;
+     long long nbytes;
+{
+  unsigned int count[2];
+  long long nword, nin, nout;
+
+  nword = nbytes / 8;
+  nin = nout = 0;
+
+  while (nout < 8 * nword)
+  {
+    if (nin + (long long) sizeof (count) > nstored)
+      return (-1);
+    memcpy (count, in + nin, sizeof (count));
+    nin += sizeof (count);
+
+    if (nout + 8 * ((long long) count[0] + count[1]) > 8 * nword || nin + 8 * (long long) count[1] > nstored)
+      return (-1);
+
+    memset (out + nout, 0, 8 * (long long) count[0]);
+    nout += 8 * (long long) count[0];
+    memcpy (out + nout, in + nin, 8 * (long long) count[1]);
+    nout += 8 * (long long) count[1];
+    nin += 8 * (long long) count[1];
+  }
+
+  if (nin + nbytes - nout != nstored)
+    return (-1);
+  memcpy (out + nout, in + nin, nbytes - nout);
+
+  return (0);
+}
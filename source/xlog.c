@@ -67,6 +67,13 @@
  *
  *  - error_summary(char *format)	Summarize all of the erors that have been
  * 					logged to this point in time
+ *  - error_summary_all(char *format)	Combine the errors logged by all of the mpi
+ * 					processes into a single summary
+ *
+ *  Errors are looked up in a hash table, so the cost of reporting an error does not depend on how many
+ *  different errors have been seen.  Output to the diag file is held in a large buffer, which is written when
+ *  it fills, when Log_flush is called, and otherwise at most every LOG_FLUSH_INTERVAL seconds, so that
+ *  frequent logging from many processes does not turn into many small writes.
  *
  *
  *  In addition there are several routines that largely internal
@@ -89,11 +96,15 @@
 #include <string.h>
 #include <stdarg.h>
 #include <math.h>
+#include <time.h>
 
 #include "log.h"
 
 #define LINELENGTH 256
 #define NERROR_MAX 500          // Number of different errors that are recorded
+#define NERROR_HASH 1024        // Size of the hash table used to find an error, a power of 2 well above NERROR_MAX
+#define LOG_BUFFER_SIZE 1048576 // Size of the buffer in which messages for the diag file are held before being written
+#define LOG_FLUSH_INTERVAL 1    // The minimum time in seconds between automatic flushes of the diag file
 
 /* definitions of what is logged at what verbosity level */
 
@@ -122,9 +133,11 @@ ErrorPtr errorlog;
 
 
 int nerrors;
+int error_hash[NERROR_HASH];    // For each slot, 1 + the position of an error in errorlog, or 0 if the slot is empty
 
 FILE *diagptr;
 int init_log = 0;
+time_t log_last_flush = 0;      // When the diag file was last flushed
 int log_verbosity = 5;          // A parameter which can be used to suppress what would normally be logged or printed
 
 
@@ -139,6 +152,11 @@ int log_verbosity = 5;          // A parameter which can be used to suppress wha
  *
  * The routine will exit is log the file can not be opened
  *
+ * Messages are held in a buffer of LOG_BUFFER_SIZE bytes, and are written
+ * to the file when the buffer fills, when Log_flush is called, and
+ * otherwise when something is logged more than LOG_FLUSH_INTERVAL seconds
+ * after the file was last flushed.
+ *
  *
  **********************************************************/
 
@@ -151,9 +169,12 @@ Log_init (filename)
     printf ("Yikes: could not even open log file %s\n", filename);
     Exit (0);
   }
+  setvbuf (diagptr, NULL, _IOFBF, LOG_BUFFER_SIZE);
+  log_last_flush = time (NULL);
   init_log = 1;
 
   nerrors = 0;
+  memset (error_hash, 0, sizeof (error_hash));
   errorlog = (ErrorPtr) calloc (sizeof (error_dummy), NERROR_MAX);
 
   if (errorlog == NULL)
@@ -194,9 +215,12 @@ Log_append (filename)
     printf ("Yikes: could not even open log file %s\n", filename);
     Exit (0);
   }
+  setvbuf (diagptr, NULL, _IOFBF, LOG_BUFFER_SIZE);
+  log_last_flush = time (NULL);
   init_log = 1;
 
   nerrors = 0;
+  memset (error_hash, 0, sizeof (error_hash));
   errorlog = (ErrorPtr) calloc (sizeof (error_dummy), NERROR_MAX);
 
   if (errorlog == NULL)
@@ -359,6 +383,7 @@ Log (char *format, ...)
     result = vprintf (format, ap);
   result = vfprintf (diagptr, format, ap2);
   va_end (ap);
+  log_flush_check ();
   return (result);
 }
 
@@ -395,6 +420,7 @@ Log_silent (char *format, ...)
 
   result = vfprintf (diagptr, format, ap);
   va_end (ap);
+  log_flush_check ();
   return (result);
 }
 
@@ -437,6 +463,7 @@ Error (char *format, ...)
   fprintf (diagptr, "Error: ");
   result = vfprintf (diagptr, format, ap2);
   va_end (ap);
+  log_flush_check ();
   return (result);
 }
 
@@ -479,6 +506,7 @@ Error_silent (char *format, ...)
   fprintf (diagptr, "Error: ");
   result = vfprintf (diagptr, format, ap2);
   va_end (ap);
+  log_flush_check ();
   return (result);
 }
 
@@ -520,8 +548,9 @@ Shout (char *format, ...)
   va_copy (ap2, ap);            /* ap is not necessarily preserved by vprintf */
   result = vprintf (format, ap);
   fprintf (diagptr, "Error: ");
-  result = vfprintf (diagptr, format, ap);
+  result = vfprintf (diagptr, format, ap2);
   va_end (ap);
+  log_flush_check ();
   return (result);
 }
 
@@ -581,34 +610,33 @@ sane_check (x)
  * The number for stopping  the program is controled by max_errors and can be altered, see
  * log_set_max_errors 
  *
+ * Errors are found in a hash table, so that the cost of counting an error does not
+ * grow with the number of different errors which have been seen.
+ *
  **********************************************************/
 
 int
 error_count (char *format)
 {
-  int n;
-  n = 0;
-  while (n < nerrors)
-  {
-    if (strcmp (errorlog[n].description, (format)) == 0)
-      break;
-    n++;
-  }
+  int n, slot;
+
+  slot = error_hash_value (format) & (NERROR_HASH - 1);
+  while ((n = error_hash[slot] - 1) >= 0 && strncmp (errorlog[n].description, format, LINELENGTH - 1) != 0)
+    slot = (slot + 1) & (NERROR_HASH - 1);
 
-  if (n == nerrors)
+  if (n < 0)
   {
-    strcpy (errorlog[nerrors].description, format);
-    errorlog[n].n = 1;
-    if (nerrors < NERROR_MAX)
-    {
-      nerrors++;
-    }
-    else
+    if (nerrors == NERROR_MAX)
     {
       printf ("Exceeded number of different errors that can be stored\n");
       error_summary ("Quitting because there are too many differnt types of errors\n");
       Exit (0);
     }
+    error_hash[slot] = nerrors + 1;
+    strncpy (errorlog[nerrors].description, format, LINELENGTH - 1);
+    errorlog[nerrors].n = 1;
+    nerrors++;
+    return (1);
   }
   else
   {
@@ -626,6 +654,39 @@ error_count (char *format)
 
 
 
+/**********************************************************/
+/** 
+ * @brief      Hash the description of an error
+ *
+ * @param [in] char *  description   The format statement which identifies the error
+ * @return     The FNV-1a hash of the description
+ *
+ * The hash gives the slot in a hash table at which to start looking for an error,
+ * so that normally only one string comparison is needed to find it.
+ *
+ * ###Notes###
+ *
+ * Only the part of the description which is stored in the error log is hashed.
+ *
+ **********************************************************/
+
+unsigned int
+error_hash_value (char *description)
+{
+  unsigned int h;
+  int i;
+
+  h = 2166136261u;
+  for (i = 0; i < LINELENGTH - 1 && description[i] != '\0'; i++)
+  {
+    h ^= (unsigned char) description[i];
+    h *= 16777619u;
+  }
+  return (h);
+}
+
+
+
 
 /**********************************************************/
 /** 
@@ -696,6 +757,120 @@ error_summary_parallel (char *msg)
 
 
 
+/**********************************************************/
+/**
+ * @brief      Summarize the errors that have occurred in all of the mpi processes
+ *
+ * @param [in] char *  message   A message that can accompany the error summary
+ * @return     Always returns 0
+ *
+ * The errors recorded by each process are gathered by thread 0, which combines
+ * them into a single table giving, for each distinct error, the total number of
+ * times it occurred and the number of threads in which it occurred.
+ *
+ * ###Notes###
+ *
+ * When running in parallel this must be called by all of the processes.
+ * Otherwise it is the same as error_summary.
+ *
+ **********************************************************/
+
+int
+error_summary_all (char *message)
+{
+#ifdef MPI_ON
+  int nbytes, ntot, i, k, n, nmerged, count, slot;
+  int *nrecv, *displs, *nthreads, *merged_hash;
+  char *sendbuf, *recvbuf, *record;
+  ErrorPtr merged;
+  int record_size, nmerged_max, nmerged_hash;
+
+  if (n_mpi_procs <= 1)
+    return (error_summary (message));
+
+  /* Each error is sent as its description followed by the number of times it occurred */
+
+  record_size = LINELENGTH + sizeof (int);
+  nbytes = nerrors * record_size;
+  sendbuf = (char *) calloc (nbytes > 0 ? nbytes : 1, 1);
+  for (i = 0; i < nerrors; i++)
+  {
+    memcpy (sendbuf + i * record_size, errorlog[i].description, LINELENGTH);
+    memcpy (sendbuf + i * record_size + LINELENGTH, &errorlog[i].n, sizeof (int));
+  }
+
+  nrecv = (int *) calloc (n_mpi_procs, sizeof (int));
+  displs = (int *) calloc (n_mpi_procs, sizeof (int));
+  MPI_Gather (&nbytes, 1, MPI_INT, nrecv, 1, MPI_INT, 0, MPI_COMM_WORLD);
+
+  ntot = 0;
+  if (my_rank == 0)
+  {
+    for (i = 0; i < n_mpi_procs; i++)
+    {
+      displs[i] = ntot;
+      ntot += nrecv[i];
+    }
+  }
+  recvbuf = (char *) calloc (ntot > 0 ? ntot : 1, 1);
+
+  MPI_Gatherv (sendbuf, nbytes, MPI_CHAR, recvbuf, nrecv, displs, MPI_CHAR, 0, MPI_COMM_WORLD);
+
+  if (my_rank == 0)
+  {
+    /* Combine the errors from all of the threads.  The same error in different threads
+       is counted once for each thread in which it appears */
+
+    nmerged_max = ntot / record_size;
+    nmerged_hash = 2;
+    while (nmerged_hash <= 2 * nmerged_max)
+      nmerged_hash *= 2;
+    merged = (ErrorPtr) calloc (nmerged_max > 0 ? nmerged_max : 1, sizeof (error_dummy));
+    nthreads = (int *) calloc (nmerged_max > 0 ? nmerged_max : 1, sizeof (int));
+    merged_hash = (int *) calloc (nmerged_hash, sizeof (int));
+
+    nmerged = 0;
+    for (k = 0; k < nmerged_max; k++)
+    {
+      record = recvbuf + k * record_size;
+      memcpy (&count, record + LINELENGTH, sizeof (int));
+      slot = error_hash_value (record) & (nmerged_hash - 1);
+      while ((n = merged_hash[slot] - 1) >= 0 && strncmp (merged[n].description, record, LINELENGTH - 1) != 0)
+        slot = (slot + 1) & (nmerged_hash - 1);
+      if (n < 0)
+      {
+        merged_hash[slot] = nmerged + 1;
+        n = nmerged++;
+        memcpy (merged[n].description, record, LINELENGTH);
+      }
+      merged[n].n += count;
+      nthreads[n]++;
+    }
+
+    Log ("\nError summary for all %d threads: %s\n", n_mpi_procs, message);
+    Log ("Recurrences --  Threads -- Description\n");
+    for (n = 0; n < nmerged; n++)
+      Log ("%11d -- %8d -- %s", merged[n].n, nthreads[n], merged[n].description);
+    Log_flush ();
+
+    free (merged);
+    free (nthreads);
+    free (merged_hash);
+  }
+
+  free (sendbuf);
+  free (recvbuf);
+  free (nrecv);
+  free (displs);
+  return (0);
+#else
+  return (error_summary (message));
+#endif
+}
+
+
+
+
 /**********************************************************/
 /** 
  * @brief      Flush the diagnostic file to assure that one has an up-to-date version of the log file
@@ -718,11 +893,43 @@ Log_flush ()
     Log_init ("logfile");
 
   fflush (diagptr);
+  log_last_flush = time (NULL);
   return (0);
 }
 
 
 
+/**********************************************************/
+/** 
+ * @brief      Flush the diagnostic file if it has not been flushed recently
+ *
+ * @return     1 if the file was flushed, 0 otherwise
+ *
+ * This routine is called each time something is written to the diagnostic file,
+ * so that the file is never more than about LOG_FLUSH_INTERVAL seconds out of
+ * date while the program is running, without the cost of flushing after
+ * every message.
+ *
+ * ###Notes###
+ *
+ **********************************************************/
+
+int
+log_flush_check ()
+{
+  time_t now;
+
+  now = time (NULL);
+  if (now - log_last_flush < LOG_FLUSH_INTERVAL)
+    return (0);
+
+  fflush (diagptr);
+  log_last_flush = now;
+  return (1);
+}
+
+
+
 
 
 /**********************************************************/
@@ -794,6 +1001,7 @@ Log_parallel (char *format, ...)
 
   fprintf (diagptr, "Para: ");
   result = vfprintf (diagptr, format, ap2);
+  log_flush_check ();
 
   return (result);
 }
@@ -842,6 +1050,7 @@ Debug (char *format, ...)
   fprintf (diagptr, "Debug: ");
   result = vfprintf (diagptr, format, ap2);
   va_end (ap);
+  log_flush_check ();
   return (result);
 }
 